@@ -0,0 +1,351 @@
+#include "AssetCooker.h"
+#include "FbxLoader/FbxLoader.h"
+#include "FbxLoader/BakedModelFormat.h"
+
+#include <DirectXTex.h>
+#include <Windows.h>
+#include <objbase.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <thread>
+
+using namespace DirectX;
+
+/// <summary>
+/// Static Member Variable Entity
+/// </summary>
+const char* const AssetCooker::MANIFEST_FILE_NAME = "cook_manifest.txt";
+const uint32_t AssetCooker::TEXTURE_COOK_VERSION;
+
+// Lower case extension of a path including the dot (empty if none)
+static std::string GetExtension(const std::string& path)
+{
+	const size_t dotPos = path.find_last_of('.');
+	const size_t slashPos = path.find_last_of("/\\");
+	if (dotPos == std::string::npos || (slashPos != std::string::npos && dotPos < slashPos))
+	{
+		return std::string();
+	}
+	std::string extension = path.substr(dotPos);
+	std::transform(extension.begin(), extension.end(), extension.begin(),
+		[](char c) { return (char)tolower((unsigned char)c); });
+	return extension;
+}
+
+// Whether the file exists
+static bool FileExists(const std::string& path)
+{
+	return GetFileAttributesA(path.c_str()) != INVALID_FILE_ATTRIBUTES;
+}
+
+AssetCooker::AssetCooker(const Options& options)
+	: options(options), nextAsset(0), cookedCount(0), skippedCount(0), failedCount(0)
+{
+	if (this->options.threadCount == 0)
+	{
+		this->options.threadCount = (std::max)(std::thread::hardware_concurrency(), 1u);
+	}
+}
+
+int AssetCooker::Run()
+{
+	auto cookStart = std::chrono::steady_clock::now();
+
+	LoadManifest();
+	CollectAssets(FbxLoader::baseDirectory);
+
+	// Textures first: the model import reads the DDS files written by the texture pass
+	auto firstModel = std::stable_partition(assets.begin(), assets.end(),
+		[](const Asset& asset) { return asset.type == AssetType::Texture; });
+	const size_t textureCount = firstModel - assets.begin();
+
+	CookRange(0, textureCount);
+	CookRange(textureCount, assets.size());
+
+	SaveManifest();
+
+	auto cookEnd = std::chrono::steady_clock::now();
+	printf("AssetCooker: %zu assets, %d cooked, %d up to date, %d failed in %.1f s (%u threads)\n",
+		assets.size(), cookedCount.load(), skippedCount.load(), failedCount.load(),
+		std::chrono::duration<double>(cookEnd - cookStart).count(), options.threadCount);
+
+	return failedCount;
+}
+
+bool AssetCooker::HashFile(const string& path, uint64_t seed, uint64_t& hash)
+{
+	HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+	if (file == INVALID_HANDLE_VALUE)
+	{
+		return false;
+	}
+
+	// FNV-1a, starting with the seed bytes
+	hash = 14695981039346656037ull;
+	for (int i = 0; i < 8; i++)
+	{
+		hash ^= (seed >> (i * 8)) & 0xff;
+		hash *= 1099511628211ull;
+	}
+
+	// Hash the memory-mapped content (empty files cannot be mapped)
+	LARGE_INTEGER fileSize = {};
+	GetFileSizeEx(file, &fileSize);
+	bool result = true;
+	if (fileSize.QuadPart > 0)
+	{
+		HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+		const uint8_t* data = mapping ? (const uint8_t*)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0) : nullptr;
+		if (data)
+		{
+			for (LONGLONG i = 0; i < fileSize.QuadPart; i++)
+			{
+				hash ^= data[i];
+				hash *= 1099511628211ull;
+			}
+			UnmapViewOfFile(data);
+		}
+		else
+		{
+			result = false;
+		}
+		if (mapping)
+		{
+			CloseHandle(mapping);
+		}
+	}
+	CloseHandle(file);
+
+	return result;
+}
+
+void AssetCooker::CollectAssets(const string& directory)
+{
+	WIN32_FIND_DATAA findData;
+	HANDLE find = FindFirstFileA((directory + "*").c_str(), &findData);
+	if (find == INVALID_HANDLE_VALUE)
+	{
+		return;
+	}
+
+	do
+	{
+		const string name = findData.cFileName;
+		if (name == "." || name == "..")
+		{
+			continue;
+		}
+		const string path = directory + name;
+
+		if (findData.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY)
+		{
+			CollectAssets(path + "/");
+			continue;
+		}
+
+		const string extension = GetExtension(name);
+		Asset asset;
+		asset.sourcePath = path;
+		if (extension == ".fbx" || extension == ".obj")
+		{
+			// Only the layout FbxLoader can load: Resources/name/name.fbx (or name.obj when there is no FBX file)
+			const string modelName = name.substr(0, name.size() - extension.size());
+			if (directory != FbxLoader::baseDirectory + modelName + "/" ||
+				(extension == ".obj" && FileExists(directory + modelName + ".fbx")))
+			{
+				continue;
+			}
+			asset.type = AssetType::Model;
+			asset.modelName = modelName;
+			asset.outputPath = directory + modelName + BakedModelFormat::EXTENSION;
+		}
+		else if (extension == ".png" || extension == ".jpg" || extension == ".jpeg" || extension == ".bmp")
+		{
+			asset.type = AssetType::Texture;
+			asset.outputPath = path.substr(0, path.size() - extension.size()) + ".dds";
+		}
+		else
+		{
+			continue;
+		}
+		assets.push_back(asset);
+	} while (FindNextFileA(find, &findData));
+
+	FindClose(find);
+}
+
+void AssetCooker::CookRange(size_t begin, size_t end)
+{
+	nextAsset = begin;
+
+	std::vector<std::thread> workers;
+	for (unsigned int i = 0; i < options.threadCount; i++)
+	{
+		workers.emplace_back(&AssetCooker::WorkerMain, this, end);
+	}
+	for (std::thread& worker : workers)
+	{
+		worker.join();
+	}
+}
+
+void AssetCooker::WorkerMain(size_t end)
+{
+	// WIC (texture loading and mip generation) needs COM on this thread
+	HRESULT result = CoInitializeEx(nullptr, COINIT_MULTITHREADED);
+
+	for (size_t i = nextAsset++; i < end; i = nextAsset++)
+	{
+		if (!CookAsset(assets[i]))
+		{
+			failedCount++;
+		}
+	}
+
+	if (SUCCEEDED(result))
+	{
+		CoUninitialize();
+	}
+}
+
+bool AssetCooker::CookAsset(const Asset& asset)
+{
+	// The converter version is part of the hash, so format changes cook everything again
+	uint64_t seed = asset.type == AssetType::Model ? BakedModelFormat::VERSION :
+		((uint64_t)TEXTURE_COOK_VERSION << 32) | (options.useBC7 ? 1 : 0);
+	uint64_t hash = 0;
+	if (!HashFile(asset.sourcePath, seed, hash))
+	{
+		std::lock_guard<std::mutex> lock(logMutex);
+		printf("failed to read %s\n", asset.sourcePath.c_str());
+		return false;
+	}
+
+	// Unchanged since the last run
+	auto previous = previousManifest.find(asset.sourcePath);
+	if (!options.force && previous != previousManifest.end() && previous->second == hash && FileExists(asset.outputPath))
+	{
+		skippedCount++;
+		std::lock_guard<std::mutex> lock(manifestMutex);
+		manifest[asset.sourcePath] = hash;
+		return true;
+	}
+
+	auto cookStart = std::chrono::steady_clock::now();
+	bool result = false;
+	if (asset.type == AssetType::Model)
+	{
+		result = FbxLoader::GetInstance()->CookModel(asset.modelName);
+	}
+	else
+	{
+		result = CookTexture(asset);
+	}
+	auto cookEnd = std::chrono::steady_clock::now();
+
+	{
+		std::lock_guard<std::mutex> lock(logMutex);
+		printf("%s -> %s %s (%.1f ms)\n", asset.sourcePath.c_str(), asset.outputPath.c_str(),
+			result ? "cooked" : "FAILED", std::chrono::duration<double, std::milli>(cookEnd - cookStart).count());
+	}
+
+	if (result)
+	{
+		cookedCount++;
+		std::lock_guard<std::mutex> lock(manifestMutex);
+		manifest[asset.sourcePath] = hash;
+	}
+
+	return result;
+}
+
+bool AssetCooker::CookTexture(const Asset& asset)
+{
+	HRESULT result = S_FALSE;
+
+	// Convert to unicode string
+	wchar_t wfilepath[256];
+	MultiByteToWideChar(CP_ACP, 0, asset.sourcePath.c_str(), -1, wfilepath, _countof(wfilepath));
+
+	TexMetadata metadata = {};
+	ScratchImage image;
+	result = LoadFromWICFile(wfilepath, WIC_FLAGS_NONE, &metadata, image);
+	if (FAILED(result))
+	{
+		return false;
+	}
+
+	// Full mip chain (a 1x1 image is its own chain)
+	ScratchImage mipChain;
+	if (metadata.width > 1 || metadata.height > 1)
+	{
+		result = GenerateMipMaps(*image.GetImage(0, 0, 0), TEX_FILTER_DEFAULT, 0, mipChain);
+		if (FAILED(result))
+		{
+			return false;
+		}
+	}
+	else
+	{
+		mipChain = std::move(image);
+	}
+
+	// Block compression needs the top level to be made of whole 4x4 blocks, other sizes stay uncompressed
+	ScratchImage compressed;
+	ScratchImage* output = &mipChain;
+	if (metadata.width % 4 == 0 && metadata.height % 4 == 0)
+	{
+		DXGI_FORMAT format = options.useBC7 ? DXGI_FORMAT_BC7_UNORM :
+			mipChain.IsAlphaAllOpaque() ? DXGI_FORMAT_BC1_UNORM : DXGI_FORMAT_BC3_UNORM;
+		result = Compress(mipChain.GetImages(), mipChain.GetImageCount(), mipChain.GetMetadata(),
+			format, TEX_COMPRESS_DEFAULT, TEX_THRESHOLD_DEFAULT, compressed);
+		if (FAILED(result))
+		{
+			return false;
+		}
+		output = &compressed;
+	}
+
+	MultiByteToWideChar(CP_ACP, 0, asset.outputPath.c_str(), -1, wfilepath, _countof(wfilepath));
+	result = SaveToDDSFile(output->GetImages(), output->GetImageCount(), output->GetMetadata(), DDS_FLAGS_NONE, wfilepath);
+
+	return SUCCEEDED(result);
+}
+
+void AssetCooker::LoadManifest()
+{
+	FILE* file = nullptr;
+	if (fopen_s(&file, (FbxLoader::baseDirectory + MANIFEST_FILE_NAME).c_str(), "r") != 0)
+	{
+		return;
+	}
+
+	// One "hash path" pair per line
+	unsigned long long hash = 0;
+	char path[MAX_PATH];
+	while (fscanf_s(file, "%llx %259[^\n]", &hash, path, (unsigned)_countof(path)) == 2)
+	{
+		previousManifest[path] = hash;
+	}
+
+	fclose(file);
+}
+
+void AssetCooker::SaveManifest()
+{
+	FILE* file = nullptr;
+	if (fopen_s(&file, (FbxLoader::baseDirectory + MANIFEST_FILE_NAME).c_str(), "w") != 0)
+	{
+		printf("failed to write the manifest\n");
+		return;
+	}
+
+	for (const auto& entry : manifest)
+	{
+		fprintf(file, "%016llx %s\n", (unsigned long long)entry.second, entry.first.c_str());
+	}
+
+	fclose(file);
+}
@@ -0,0 +1,124 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+/// <summary>
+/// Offline conversion of the resource tree into runtime formats
+/// Models (Resources/name/name.fbx or name.obj) are baked into *.bmdl by FbxLoader,
+/// textures (png/jpg/bmp) are converted into block-compressed DDS with a full mip chain.
+/// A manifest of content hashes skips assets that did not change since the last run.
+/// </summary>
+class AssetCooker
+{
+private: // Alias
+	// std abbreviation
+	using string = std::string;
+
+public: // Constant
+	// Manifest file name (in the resource directory)
+	static const char* const MANIFEST_FILE_NAME;
+
+	// Increase whenever the texture conversion changes
+	static const uint32_t TEXTURE_COOK_VERSION = 1;
+
+public: // Subclass
+	// Kind of asset
+	enum class AssetType
+	{
+		Model,
+		Texture,
+	};
+
+	// Asset to cook
+	struct Asset
+	{
+		AssetType type = AssetType::Texture;
+		// Source file path
+		string sourcePath;
+		// Output file path
+		string outputPath;
+		// Model name (models only)
+		string modelName;
+		// Hash of the source content and the converter version
+		uint64_t hash = 0;
+	};
+
+	// Cooking options
+	struct Options
+	{
+		// Number of worker threads (0: one per hardware thread)
+		unsigned int threadCount = 0;
+		// Cook everything regardless of the manifest
+		bool force = false;
+		// Use BC7 instead of BC1/BC3 for textures (slow to compress)
+		bool useBC7 = false;
+	};
+
+public:
+	/// <summary>
+	/// Constructor
+	/// </summary>
+	/// <param name="options">Cooking options</param>
+	explicit AssetCooker(const Options& options);
+
+	/// <summary>
+	/// Cook every asset under the resource directory (the current directory must contain it)
+	/// </summary>
+	/// <returns>Number of assets that failed</returns>
+	int Run();
+
+	/// <summary>
+	/// 64-bit FNV-1a hash of the file content
+	/// </summary>
+	/// <param name="path">File path</param>
+	/// <param name="seed">Value mixed in before the content (converter version)</param>
+	/// <param name="hash">Receives the hash</param>
+	/// <returns>Success or failure</returns>
+	static bool HashFile(const string& path, uint64_t seed, uint64_t& hash);
+
+private:
+	// Recursively collect the assets of a directory
+	void CollectAssets(const string& directory);
+
+	// Cook the assets [begin, end) on all worker threads
+	void CookRange(size_t begin, size_t end);
+
+	// Worker thread loop
+	void WorkerMain(size_t end);
+
+	// Cook one asset
+	bool CookAsset(const Asset& asset);
+
+	// Convert a texture into a DDS file
+	bool CookTexture(const Asset& asset);
+
+	// Read the hashes of the previous run
+	void LoadManifest();
+
+	// Write the hashes of the cooked assets
+	void SaveManifest();
+
+private:
+	// Options
+	Options options;
+	// Collected assets
+	std::vector<Asset> assets;
+	// Next asset to be taken by a worker
+	std::atomic<size_t> nextAsset;
+	// Counters for the report
+	std::atomic<int> cookedCount;
+	std::atomic<int> skippedCount;
+	std::atomic<int> failedCount;
+	// Source path -> hash of the previous run
+	std::map<string, uint64_t> previousManifest;
+	// Source path -> hash of the assets that are up to date after this run
+	std::map<string, uint64_t> manifest;
+	std::mutex manifestMutex;
+	// Console output
+	std::mutex logMutex;
+};
@@ -0,0 +1,118 @@
+#include "AssetCooker.h"
+#include "FbxLoader/FbxLoader.h"
+#include "CpuSkinning.h"
+#include "base/FramePacer.h"
+
+#include <Windows.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+// Compare dual quaternion skinning with the matrix path on a model, without a GPU
+// Fails when the vertices bound to a single bone do not agree
+static int CompareSkinning(const std::string& modelName)
+{
+	Model* model = FbxLoader::GetInstance()->ImportModelFromFile(modelName);
+	const CpuSkinning::DualQuaternionComparison comparison = CpuSkinning::CompareDualQuaternion(model);
+	delete model;
+
+	if (comparison.vertexCount == 0)
+	{
+		printf("%s: no skinned vertices or animation to compare\n", modelName.c_str());
+		return 1;
+	}
+
+	printf("%s: %zu rigid vertices max difference %g, %zu blended vertices max %g mean %g (model size %g)\n",
+		modelName.c_str(), comparison.rigidCount, comparison.maxRigidDifference, comparison.blendedCount,
+		comparison.maxBlendedDifference, comparison.meanBlendedDifference, comparison.modelSize);
+
+	// Single bone vertices differ only by rounding (or by a bone scale dual quaternions cannot represent)
+	const float tolerance = comparison.modelSize * 1e-4f;
+	if (comparison.maxRigidDifference > tolerance)
+	{
+		printf("%s: rigid vertices differ by more than %g\n", modelName.c_str(), tolerance);
+		return 1;
+	}
+	return 0;
+}
+
+// Check the frame pacing against a fake GPU timeline, without a device
+static int CheckFramePacing()
+{
+	const FramePacer::PacingCheck check = FramePacer::CheckPacing();
+	if (check.failureCount > 0)
+	{
+		printf("frame pacing: %d of %d checks failed, first: %s (%d frames in flight)\n",
+			check.failureCount, check.checkCount, check.firstFailure, check.failedFrameCount);
+		return 1;
+	}
+	printf("frame pacing: %d checks passed\n", check.checkCount);
+	return 0;
+}
+
+// Console entry point
+// Usage: AssetCooker <game directory containing Resources/> [-threads N] [-force] [-bc7] [-compareskinning model] [-checkpacing]
+int main(int argc, char* argv[])
+{
+	if (argc < 2)
+	{
+		printf("usage: AssetCooker <game directory> [-threads N] [-force] [-bc7] [-compareskinning model] [-checkpacing]\n");
+		return 1;
+	}
+
+	AssetCooker::Options options;
+	std::string compareModelName;
+	bool checkPacing = false;
+	for (int i = 2; i < argc; i++)
+	{
+		if (strcmp(argv[i], "-threads") == 0 && i + 1 < argc)
+		{
+			options.threadCount = (unsigned int)atoi(argv[++i]);
+		}
+		else if (strcmp(argv[i], "-force") == 0)
+		{
+			options.force = true;
+		}
+		else if (strcmp(argv[i], "-bc7") == 0)
+		{
+			options.useBC7 = true;
+		}
+		else if (strcmp(argv[i], "-compareskinning") == 0 && i + 1 < argc)
+		{
+			compareModelName = argv[++i];
+		}
+		else if (strcmp(argv[i], "-checkpacing") == 0)
+		{
+			checkPacing = true;
+		}
+		else
+		{
+			printf("unknown option %s\n", argv[i]);
+			return 1;
+		}
+	}
+
+	// Resource paths are relative to the game directory, same as at runtime
+	if (!SetCurrentDirectoryA(argv[1]))
+	{
+		printf("cannot open %s\n", argv[1]);
+		return 1;
+	}
+
+	// Check the frame pacing instead of cooking
+	if (checkPacing)
+	{
+		return CheckFramePacing();
+	}
+
+	// Check the skinning instead of cooking
+	if (!compareModelName.empty())
+	{
+		return CompareSkinning(compareModelName);
+	}
+
+	AssetCooker cooker(options);
+	return cooker.Run() == 0 ? 0 : 1;
+}
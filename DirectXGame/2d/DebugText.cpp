@@ -86,5 +86,17 @@ void DebugText::DrawAll(ID3D12GraphicsCommandList* cmdList)
 		spriteDatas[i]->Draw();
 	}
 
+	spriteIndex = 0;
+}
+
+void DebugText::Submit(DrawQueue* drawQueue)
+{
+	// 全ての文字のスプライトについて
+	for (int i = 0; i < spriteIndex; i++)
+	{
+		// 描画パケットの追加
+		spriteDatas[i]->Submit(drawQueue);
+	}
+
 	spriteIndex = 0;
 }
\ No newline at end of file
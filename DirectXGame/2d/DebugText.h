@@ -37,6 +37,9 @@ public:// メンバ関数
 
 	void DrawAll(ID3D12GraphicsCommandList * cmdList);
 
+	// 全ての文字を描画キューに追加
+	void Submit(DrawQueue* drawQueue);
+
 private:
 	DebugText();
 	DebugText(const DebugText&) = delete;
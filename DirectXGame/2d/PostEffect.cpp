@@ -65,16 +65,6 @@ void PostEffect::Initialize()
 	vbView.SizeInBytes = sizeof(VertexPosUv) * 4;
 	vbView.StrideInBytes = sizeof(VertexPosUv);
 
-	// Generate Constant Buffer
-	result = device->CreateCommittedResource(
-		&CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD),
-		D3D12_HEAP_FLAG_NONE,
-		&CD3DX12_RESOURCE_DESC::Buffer((sizeof(ConstBufferData) + 0xff) && ~0xff),
-		D3D12_RESOURCE_STATE_GENERIC_READ,
-		nullptr,
-		IID_PPV_ARGS(&constBuff));
-	assert(SUCCEEDED(result));
-
 	// Texture resource settings
 	CD3DX12_RESOURCE_DESC texresDesc = CD3DX12_RESOURCE_DESC::Tex2D(
 		DXGI_FORMAT_R8G8B8A8_UNORM,
@@ -360,6 +350,35 @@ void PostEffect::PreDrawScene(ID3D12GraphicsCommandList* cmdList)
 				D3D12_RESOURCE_STATE_RENDER_TARGET));
 	}
 
+	// Set render target, viewport and scissor rectangle
+	SetRenderTargets(cmdList);
+
+	// Get handle of descriptor heap for render target view
+	D3D12_CPU_DESCRIPTOR_HANDLE rtvHs[2];
+	for (int i = 0; i < 2; i++)
+	{
+		rtvHs[i] = CD3DX12_CPU_DESCRIPTOR_HANDLE(
+			descHeapRTV->GetCPUDescriptorHandleForHeapStart(), i,
+			device->GetDescriptorHandleIncrementSize(D3D12_DESCRIPTOR_HEAP_TYPE_RTV)
+		);
+	}
+
+	// Get handle of depth stencil view descriptor heap
+	D3D12_CPU_DESCRIPTOR_HANDLE dsvH = descHeapDSV->GetCPUDescriptorHandleForHeapStart();
+
+	for (int i = 0; i < 2; i++)
+	{
+		// Clear full screen
+		cmdList->ClearRenderTargetView(rtvHs[i], clearColor, 0, nullptr);
+	}
+
+	// Clear depth buffer
+	cmdList->ClearDepthStencilView(dsvH, D3D12_CLEAR_FLAG_DEPTH, 1.0f, 0, 0,
+		nullptr);
+}
+
+void PostEffect::SetRenderTargets(ID3D12GraphicsCommandList* cmdList) const
+{
 	// Get handle of descriptor heap for render target view
 	D3D12_CPU_DESCRIPTOR_HANDLE rtvHs[2];
 	for (int i = 0; i < 2; i++)
@@ -390,16 +409,11 @@ void PostEffect::PreDrawScene(ID3D12GraphicsCommandList* cmdList)
 
 	// Scissoring short form setting
 	cmdList->RSSetScissorRects(2, scissorRects);
+}
 
-	for (int i = 0; i < 2; i++)
-	{
-		// Clear full screen
-		cmdList->ClearRenderTargetView(rtvHs[i], clearColor, 0, nullptr);
-	}
-
-	// Clear depth buffer
-	cmdList->ClearDepthStencilView(dsvH, D3D12_CLEAR_FLAG_DEPTH, 1.0f, 0, 0,
-		nullptr);
+void PostEffect::RecordRenderTargets(ID3D12GraphicsCommandList* cmdList, const void* data)
+{
+	((const PostEffect*)data)->SetRenderTargets(cmdList);
 }
 
 void PostEffect::Draw(ID3D12GraphicsCommandList* cmdList)
@@ -410,14 +424,11 @@ void PostEffect::Draw(ID3D12GraphicsCommandList* cmdList)
 	//this->matWorld *= XMMatrixTranslation(position.x, position.y, 0.0f);
 
 	// Data transfer to a constant buffer
-	ConstBufferData* constMap = nullptr;
-	HRESULT result = this->constBuff->Map(0, nullptr, (void**)&constMap);
-	if (SUCCEEDED(result)) {
-		constMap->color = this->color;
-		//constMap->mat = this->matWorld * matProjection;	// Matrix composition
-		constMap->mat = XMMatrixIdentity();
-		this->constBuff->Unmap(0, nullptr);
-	}
+	ConstBufferData constData;
+	constData.color = this->color;
+	//constData.mat = this->matWorld * matProjection;	// Matrix composition
+	constData.mat = XMMatrixIdentity();
+	this->constBuffAddress = UploadAllocator::GetInstance()->Upload(constData);
 
 	// Pipeline state settings
 	cmdList->SetPipelineState(pipelineState.Get());
@@ -436,7 +447,7 @@ void PostEffect::Draw(ID3D12GraphicsCommandList* cmdList)
 	// Set descriptor heap
 	cmdList->SetDescriptorHeaps(_countof(ppHeaps), ppHeaps);
 	// Set constant buffer view
-	cmdList->SetGraphicsRootConstantBufferView(0, this->constBuff->GetGPUVirtualAddress());
+	cmdList->SetGraphicsRootConstantBufferView(0, this->constBuffAddress);
 	// Set shader resource view
 	//cmdList->SetGraphicsRootDescriptorTable(1, CD3DX12_GPU_DESCRIPTOR_HANDLE(descHeap->GetGPUDescriptorHandleForHeapStart(), this->texNumber, descriptorHandleIncrementSize));
 	//cmdList->SetGraphicsRootDescriptorTable(1, descHeapSRV->GetGPUDescriptorHandleForHeapStart());
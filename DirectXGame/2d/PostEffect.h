@@ -35,7 +35,20 @@ public:
     /// </summary>
     void PostDrawScene(ID3D12GraphicsCommandList* cmdList);
 
+    /// <summary>
+    /// Set the render targets, viewports and scissor rectangles of the scene (no clear, no barrier)
+    /// </summary>
+    void SetRenderTargets(ID3D12GraphicsCommandList* cmdList) const;
+
+    /// <summary>
+    /// SetRenderTargets of the post effect passed as data (DrawQueue::SetupFunction of the parallel recording)
+    /// </summary>
+    static void RecordRenderTargets(ID3D12GraphicsCommandList* cmdList, const void* data);
+
 public: // Member Variables
+    // Vertex Buffer (the full screen quad never changes, so it is not part of the per-frame upload memory)
+    ComPtr<ID3D12Resource> vertBuff;
+
     // Texture Buffer
     ComPtr<ID3D12Resource> texBuff[2];
 
@@ -342,51 +342,13 @@ bool Sprite::Initialize()
 	// nullptrチェック
 	assert(device);
 
-	HRESULT result = S_FALSE;
-
-	// 頂点バッファ生成
-	result = device->CreateCommittedResource(
-		&CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD),
-		D3D12_HEAP_FLAG_NONE,
-		&CD3DX12_RESOURCE_DESC::Buffer(sizeof(VertexPosUv) * vertNum),
-		D3D12_RESOURCE_STATE_GENERIC_READ,
-		nullptr,
-		IID_PPV_ARGS(&vertBuff));
-	if (FAILED(result)) {
-		assert(0);
-		return false;
-	}
-
-	// 頂点バッファへのデータ転送
+	// 頂点データの更新
 	TransferVertices();
 
-	// 頂点バッファビューの作成
-	vbView.BufferLocation = vertBuff->GetGPUVirtualAddress();
+	// 頂点バッファビューの作成(位置は描画のたびに設定)
 	vbView.SizeInBytes = sizeof(VertexPosUv) * 4;
 	vbView.StrideInBytes = sizeof(VertexPosUv);
 
-	// 定数バッファの生成
-	result = device->CreateCommittedResource(
-		&CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD), 	// アップロード可能
-		D3D12_HEAP_FLAG_NONE,
-		&CD3DX12_RESOURCE_DESC::Buffer((sizeof(ConstBufferData) + 0xff)&~0xff),
-		D3D12_RESOURCE_STATE_GENERIC_READ,
-		nullptr,
-		IID_PPV_ARGS(&constBuff));
-	if (FAILED(result)) {
-		assert(0);
-		return false;
-	}
-
-	// 定数バッファにデータ転送
-	ConstBufferData* constMap = nullptr;
-	result = constBuff->Map(0, nullptr, (void**)&constMap);
-	if (SUCCEEDED(result)) {
-		constMap->color = color;
-		constMap->mat = matProjection;
-		constBuff->Unmap(0, nullptr);
-	}
-
 	return true;
 }
 
@@ -448,39 +410,69 @@ void Sprite::SetTextureRect(XMFLOAT2 texBase, XMFLOAT2 texSize)
 }
 
 void Sprite::Draw()
+{
+	TransferConstBuffer();
+
+	ID3D12DescriptorHeap* ppHeaps[] = { descHeap.Get() };
+	// デスクリプタヒープをセット
+	cmdList->SetDescriptorHeaps(_countof(ppHeaps), ppHeaps);
+
+	RecordDraw(cmdList, this);
+}
+
+void Sprite::Submit(DrawQueue* drawQueue, DrawQueue::Pass pass)
+{
+	TransferConstBuffer();
+
+	DrawQueue::DrawPacket packet;
+	packet.pipelineState = pipelineState.Get();
+	packet.rootSignature = rootSignature.Get();
+	packet.topology = D3D_PRIMITIVE_TOPOLOGY_TRIANGLESTRIP;
+	packet.descriptorHeap = descHeap.Get();
+	packet.record = RecordDraw;
+	packet.data = this;
+	// 重なり順を保つため、テクスチャと深度はキーに含めない
+	packet.key = drawQueue->MakeKey(pass, packet.pipelineState, nullptr, 0.0f);
+	drawQueue->Add(packet);
+}
+
+void Sprite::TransferConstBuffer()
 {
 	// ワールド行列の更新
 	this->matWorld = XMMatrixIdentity();
 	this->matWorld *= XMMatrixRotationZ(XMConvertToRadians(rotation));
 	this->matWorld *= XMMatrixTranslation(position.x, position.y, 0.0f);
 
-	// 定数バッファにデータ転送
-	ConstBufferData* constMap = nullptr;
-	HRESULT result = this->constBuff->Map(0, nullptr, (void**)&constMap);
-	if (SUCCEEDED(result)) {
-		constMap->color = this->color;
-		constMap->mat = this->matWorld * matProjection;	// 行列の合成	
-		this->constBuff->Unmap(0, nullptr);
+	// 頂点バッファへのデータ転送(GPUが前のフレームの頂点を読んでいる間も書き換えられるよう毎回新しい領域へ)
+	UploadAllocator::Allocation vertAllocation = UploadAllocator::GetInstance()->Allocate(sizeof(vertices), sizeof(float));
+	if (vertAllocation.cpuAddress != nullptr) {
+		memcpy(vertAllocation.cpuAddress, vertices, sizeof(vertices));
 	}
+	vbView.BufferLocation = vertAllocation.gpuAddress;
 
-	// 頂点バッファの設定
-	cmdList->IASetVertexBuffers(0, 1, &this->vbView);
+	// 定数バッファにデータ転送
+	ConstBufferData constData;
+	constData.color = this->color;
+	constData.mat = this->matWorld * matProjection;	// 行列の合成
+	this->constBuffAddress = UploadAllocator::GetInstance()->Upload(constData);
+}
 
-	ID3D12DescriptorHeap* ppHeaps[] = { descHeap.Get() };
-	// デスクリプタヒープをセット
-	cmdList->SetDescriptorHeaps(_countof(ppHeaps), ppHeaps);
+void Sprite::RecordDraw(ID3D12GraphicsCommandList* cmdList, const void* data)
+{
+	const Sprite* sprite = (const Sprite*)data;
+
+	// 頂点バッファの設定
+	cmdList->IASetVertexBuffers(0, 1, &sprite->vbView);
 	// 定数バッファビューをセット
-	cmdList->SetGraphicsRootConstantBufferView(0, this->constBuff->GetGPUVirtualAddress());
+	cmdList->SetGraphicsRootConstantBufferView(0, sprite->constBuffAddress);
 	// シェーダリソースビューをセット
-	cmdList->SetGraphicsRootDescriptorTable(1, CD3DX12_GPU_DESCRIPTOR_HANDLE(descHeap->GetGPUDescriptorHandleForHeapStart(), this->texNumber, descriptorHandleIncrementSize));
+	cmdList->SetGraphicsRootDescriptorTable(1, CD3DX12_GPU_DESCRIPTOR_HANDLE(descHeap->GetGPUDescriptorHandleForHeapStart(), sprite->texNumber, descriptorHandleIncrementSize));
 	// 描画コマンド
 	cmdList->DrawInstanced(4, 1, 0, 0);
 }
 
 void Sprite::TransferVertices()
 {
-	HRESULT result = S_FALSE;
-	
 	// 左下、左上、右下、右上
 	enum { LB, LT, RB, RT };
 
@@ -500,9 +492,6 @@ void Sprite::TransferVertices()
 		bottom = -bottom;
 	}
 
-	// 頂点データ
-	VertexPosUv vertices[vertNum];
-
 	vertices[LB].pos = { left,	bottom,	0.0f }; // 左下
 	vertices[LT].pos = { left,	top,	0.0f }; // 左上
 	vertices[RB].pos = { right,	bottom,	0.0f }; // 右下
@@ -523,12 +512,4 @@ void Sprite::TransferVertices()
 		vertices[RB].uv = { tex_right,	tex_bottom }; // 右下
 		vertices[RT].uv = { tex_right,	tex_top }; // 右上
 	}
-
-	// 頂点バッファへのデータ転送
-	VertexPosUv* vertMap = nullptr;
-	result = vertBuff->Map(0, nullptr, (void**)&vertMap);
-	if (SUCCEEDED(result)) {
-		memcpy(vertMap, vertices, sizeof(vertices));
-		vertBuff->Unmap(0, nullptr);
-	}
 }
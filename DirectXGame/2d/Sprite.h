@@ -5,6 +5,9 @@
 #include <d3d12.h>
 #include <DirectXMath.h>
 
+#include "DrawQueue.h"
+#include "UploadAllocator.h"
+
 /// <summary>
 /// スプライト
 /// </summary>
@@ -169,12 +172,19 @@ public: // メンバ関数
 	/// </summary>
 	void Draw();
 
+	/// <summary>
+	/// 描画パケットの追加(同じパス内では追加順に描画)
+	/// </summary>
+	/// <param name="drawQueue">描画キュー</param>
+	/// <param name="pass">パス</param>
+	void Submit(DrawQueue* drawQueue, DrawQueue::Pass pass = DrawQueue::Pass::Foreground);
+
 //private: // メンバ変数
 protected:
-	// 頂点バッファ
-	ComPtr<ID3D12Resource> vertBuff;
-	// 定数バッファ
-	ComPtr<ID3D12Resource> constBuff;
+	// 頂点データ(描画のたびにアップロードアロケータへ転送)
+	VertexPosUv vertices[vertNum] = {};
+	// 定数バッファ(アップロードアロケータ内、描画のたびに転送)
+	D3D12_GPU_VIRTUAL_ADDRESS constBuffAddress = 0;
 	// 頂点バッファビュー
 	D3D12_VERTEX_BUFFER_VIEW vbView{};
 	// テクスチャ番号
@@ -202,8 +212,20 @@ protected:
 
 private: // メンバ関数
 	/// <summary>
-	/// 頂点データ転送
+	/// 頂点データの更新
 	/// </summary>
 	void TransferVertices();
+
+	/// <summary>
+	/// ワールド行列の更新と頂点、定数バッファへのデータ転送
+	/// </summary>
+	void TransferConstBuffer();
+
+	/// <summary>
+	/// ステート設定済みのコマンドリストへの描画(描画パケットの記録関数)
+	/// </summary>
+	/// <param name="cmdList">コマンドリスト</param>
+	/// <param name="data">スプライト</param>
+	static void RecordDraw(ID3D12GraphicsCommandList* cmdList, const void* data);
 };
 
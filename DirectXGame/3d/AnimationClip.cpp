@@ -0,0 +1,326 @@
+#include "AnimationClip.h"
+
+#include <algorithm>
+#include <cmath>
+
+using namespace DirectX;
+
+// Largest frame number a key can refer to
+static const size_t MAX_FRAME_COUNT = 0x10000;
+
+// Linear interpolation of 3D vectors
+static XMFLOAT3 Lerp(const XMFLOAT3& a, const XMFLOAT3& b, float t)
+{
+	return XMFLOAT3(a.x + (b.x - a.x) * t, a.y + (b.y - a.y) * t, a.z + (b.z - a.z) * t);
+}
+
+// Normalized linear interpolation of quaternions along the shorter arc
+static XMFLOAT4 Nlerp(const XMFLOAT4& a, const XMFLOAT4& b, float t)
+{
+	const float dot = a.x * b.x + a.y * b.y + a.z * b.z + a.w * b.w;
+	const float tb = dot < 0.0f ? -t : t;
+	const float ta = 1.0f - t;
+	XMFLOAT4 q(a.x * ta + b.x * tb, a.y * ta + b.y * tb, a.z * ta + b.z * tb, a.w * ta + b.w * tb);
+	const float length = sqrtf(q.x * q.x + q.y * q.y + q.z * q.z + q.w * q.w);
+	if (length > 0.0f)
+	{
+		const float invLength = 1.0f / length;
+		q.x *= invLength;
+		q.y *= invLength;
+		q.z *= invLength;
+		q.w *= invLength;
+	}
+	return q;
+}
+
+// Largest component difference of 3D vectors
+static float GetError(const XMFLOAT3& a, const XMFLOAT3& b)
+{
+	return (std::max)({ fabsf(a.x - b.x), fabsf(a.y - b.y), fabsf(a.z - b.z) });
+}
+
+// Angle between the rotations of two unit quaternions
+// Taken from the relative rotation conj(a) * b with atan2, acos of the dot product is too coarse near zero
+static float GetError(const XMFLOAT4& a, const XMFLOAT4& b)
+{
+	const float x = a.w * b.x - a.x * b.w - a.y * b.z + a.z * b.y;
+	const float y = a.w * b.y + a.x * b.z - a.y * b.w - a.z * b.x;
+	const float z = a.w * b.z - a.x * b.y + a.y * b.x - a.z * b.w;
+	const float w = a.w * b.w + a.x * b.x + a.y * b.y + a.z * b.z;
+	return 2.0f * atan2f(sqrtf(x * x + y * y + z * z), fabsf(w));
+}
+
+static XMFLOAT3 Interpolate(const XMFLOAT3& a, const XMFLOAT3& b, float t) { return Lerp(a, b, t); }
+static XMFLOAT4 Interpolate(const XMFLOAT4& a, const XMFLOAT4& b, float t) { return Nlerp(a, b, t); }
+
+// Frames to keep so that interpolating between them stays within the tolerance of every sampled key
+template <class T>
+static std::vector<uint16_t> ReduceKeys(const std::vector<T>& keys, float tolerance)
+{
+	std::vector<uint16_t> frames(1, 0);
+
+	// Constant channel
+	bool constant = true;
+	for (const T& key : keys)
+	{
+		constant = constant && GetError(key, keys[0]) <= tolerance;
+	}
+	if (constant)
+	{
+		return frames;
+	}
+
+	// Extend each segment while its interpolation reproduces all keys it skips
+	size_t start = 0;
+	for (size_t end = start + 2; end < keys.size(); end++)
+	{
+		bool fits = true;
+		for (size_t i = start + 1; i < end && fits; i++)
+		{
+			const float t = (float)(i - start) / (end - start);
+			fits = GetError(Interpolate(keys[start], keys[end], t), keys[i]) <= tolerance;
+		}
+		if (!fits)
+		{
+			start = end - 1;
+			frames.push_back((uint16_t)start);
+		}
+	}
+	frames.push_back((uint16_t)(keys.size() - 1));
+
+	return frames;
+}
+
+// Store the kept keys of a scale or translation channel relative to their range
+static void QuantizeChannel(const std::vector<XMFLOAT3>& keys, AnimationClip::Channel& channel)
+{
+	XMFLOAT3 keyMin = keys[channel.frames[0]];
+	XMFLOAT3 keyMax = keyMin;
+	for (uint16_t frame : channel.frames)
+	{
+		const XMFLOAT3& key = keys[frame];
+		keyMin = XMFLOAT3((std::min)(keyMin.x, key.x), (std::min)(keyMin.y, key.y), (std::min)(keyMin.z, key.z));
+		keyMax = XMFLOAT3((std::max)(keyMax.x, key.x), (std::max)(keyMax.y, key.y), (std::max)(keyMax.z, key.z));
+	}
+	channel.rangeMin = keyMin;
+	channel.rangeExtent = XMFLOAT3(keyMax.x - keyMin.x, keyMax.y - keyMin.y, keyMax.z - keyMin.z);
+
+	auto quantize = [](float value, float minimum, float extent)
+	{
+		return extent > 0.0f ? (uint16_t)lroundf((value - minimum) / extent * 65535.0f) : (uint16_t)0;
+	};
+	channel.values.reserve(channel.frames.size() * 3);
+	for (uint16_t frame : channel.frames)
+	{
+		const XMFLOAT3& key = keys[frame];
+		channel.values.push_back(quantize(key.x, keyMin.x, channel.rangeExtent.x));
+		channel.values.push_back(quantize(key.y, keyMin.y, channel.rangeExtent.y));
+		channel.values.push_back(quantize(key.z, keyMin.z, channel.rangeExtent.z));
+	}
+}
+
+// Store the kept keys of a rotation channel as smallest-three quaternions
+// The three smaller components use 15 bits each, the index of the dropped largest one is split over the top bits of the first two
+static void QuantizeRotationChannel(const std::vector<XMFLOAT4>& keys, AnimationClip::Channel& channel)
+{
+	channel.values.reserve(channel.frames.size() * 3);
+	for (uint16_t frame : channel.frames)
+	{
+		const float q[4] = { keys[frame].x, keys[frame].y, keys[frame].z, keys[frame].w };
+
+		int largest = 0;
+		for (int i = 1; i < 4; i++)
+		{
+			if (fabsf(q[i]) > fabsf(q[largest]))
+			{
+				largest = i;
+			}
+		}
+
+		// q and -q are the same rotation, so the dropped component can be made positive
+		const float sign = q[largest] < 0.0f ? -1.0f : 1.0f;
+		uint16_t words[3];
+		for (int i = 0, j = 0; i < 4; i++)
+		{
+			if (i == largest)
+			{
+				continue;
+			}
+			// The smaller components lie in [-1/sqrt(2), 1/sqrt(2)]
+			const float normalized = (std::min)((std::max)(q[i] * sign * 0.70710678f + 0.5f, 0.0f), 1.0f);
+			words[j++] = (uint16_t)lroundf(normalized * 32767.0f);
+		}
+		words[0] |= (uint16_t)((largest & 1) << 15);
+		words[1] |= (uint16_t)((largest >> 1) << 15);
+
+		channel.values.insert(channel.values.end(), words, words + 3);
+	}
+}
+
+// Key of a scale or translation channel
+static XMFLOAT3 DecodeVector(const AnimationClip::Channel& channel, size_t key)
+{
+	const uint16_t* values = &channel.values[key * 3];
+	const float scale = 1.0f / 65535.0f;
+	return XMFLOAT3(
+		channel.rangeMin.x + values[0] * scale * channel.rangeExtent.x,
+		channel.rangeMin.y + values[1] * scale * channel.rangeExtent.y,
+		channel.rangeMin.z + values[2] * scale * channel.rangeExtent.z);
+}
+
+// Key of a rotation channel
+static XMFLOAT4 DecodeRotation(const AnimationClip::Channel& channel, size_t key)
+{
+	const uint16_t* values = &channel.values[key * 3];
+	const int largest = (values[0] >> 15) | ((values[1] >> 15) << 1);
+
+	float q[4];
+	float sumSquares = 0.0f;
+	for (int i = 0, j = 0; i < 4; i++)
+	{
+		if (i == largest)
+		{
+			continue;
+		}
+		q[i] = ((values[j++] & 0x7fff) / 32767.0f - 0.5f) * 1.41421356f;
+		sumSquares += q[i] * q[i];
+	}
+	q[largest] = sqrtf((std::max)(1.0f - sumSquares, 0.0f));
+
+	return XMFLOAT4(q[0], q[1], q[2], q[3]);
+}
+
+// Keys around a fractional frame and the blend factor between them
+static void FindKeys(const AnimationClip::Channel& channel, float frame, size_t& key0, size_t& key1, float& t)
+{
+	// Index of the first key after the frame
+	const size_t next = std::upper_bound(channel.frames.begin(), channel.frames.end(), frame,
+		[](float value, uint16_t keyFrame) { return value < keyFrame; }) - channel.frames.begin();
+
+	if (next >= channel.frames.size())
+	{
+		key0 = key1 = channel.frames.size() - 1;
+		t = 0.0f;
+		return;
+	}
+	key0 = next - 1;
+	key1 = next;
+	t = (frame - channel.frames[key0]) / (channel.frames[key1] - channel.frames[key0]);
+}
+
+static XMFLOAT3 SampleVector(const AnimationClip::Channel& channel, float frame)
+{
+	size_t key0, key1;
+	float t;
+	FindKeys(channel, frame, key0, key1, t);
+	return key0 == key1 ? DecodeVector(channel, key0) : Lerp(DecodeVector(channel, key0), DecodeVector(channel, key1), t);
+}
+
+static XMFLOAT4 SampleRotation(const AnimationClip::Channel& channel, float frame)
+{
+	size_t key0, key1;
+	float t;
+	FindKeys(channel, frame, key0, key1, t);
+	return key0 == key1 ? DecodeRotation(channel, key0) : Nlerp(DecodeRotation(channel, key0), DecodeRotation(channel, key1), t);
+}
+
+AnimationClip::CompressionReport AnimationClip::Build(const string& name, float sampleRate,
+	const vector<Track>& sampledTracks, const CompressionSettings& settings)
+{
+	this->name = name;
+	this->sampleRate = sampleRate;
+	frameCount = sampledTracks.empty() ? 0 : (uint32_t)(std::min)(sampledTracks[0].rotations.size(), MAX_FRAME_COUNT);
+
+	tracks.clear();
+	tracks.resize(sampledTracks.size());
+
+	CompressionReport report;
+	if (frameCount == 0)
+	{
+		return report;
+	}
+
+	for (size_t i = 0; i < sampledTracks.size(); i++)
+	{
+		const Track& sampled = sampledTracks[i];
+		CompressedTrack& track = tracks[i];
+
+		// Only the first frameCount keys can be addressed
+		vector<XMFLOAT3> scales(sampled.scales.begin(), sampled.scales.begin() + frameCount);
+		vector<XMFLOAT4> rotations(sampled.rotations.begin(), sampled.rotations.begin() + frameCount);
+		vector<XMFLOAT3> translations(sampled.translations.begin(), sampled.translations.begin() + frameCount);
+
+		track.scale.frames = ReduceKeys(scales, settings.scaleTolerance);
+		QuantizeChannel(scales, track.scale);
+		track.rotation.frames = ReduceKeys(rotations, settings.rotationTolerance);
+		QuantizeRotationChannel(rotations, track.rotation);
+		track.translation.frames = ReduceKeys(translations, settings.translationTolerance);
+		QuantizeChannel(translations, track.translation);
+	}
+
+	// Error of reduction and quantization together, against every sampled key
+	Skeleton::LocalPose localPose;
+	localPose.Resize(tracks.size());
+	for (uint32_t frame = 0; frame < frameCount; frame++)
+	{
+		SampleFrame((float)frame, localPose);
+		for (size_t i = 0; i < tracks.size(); i++)
+		{
+			const Track& sampled = sampledTracks[i];
+			XMFLOAT3 scale, translation;
+			XMFLOAT4 rotation;
+			XMStoreFloat3(&scale, localPose.scales[i]);
+			XMStoreFloat4(&rotation, localPose.rotations[i]);
+			XMStoreFloat3(&translation, localPose.translations[i]);
+			report.maxScaleError = (std::max)(report.maxScaleError, GetError(scale, sampled.scales[frame]));
+			report.maxRotationError = (std::max)(report.maxRotationError, GetError(rotation, sampled.rotations[frame]));
+			report.maxTranslationError = (std::max)(report.maxTranslationError, GetError(translation, sampled.translations[frame]));
+		}
+	}
+
+	report.rawBytes = (size_t)frameCount * tracks.size() * (sizeof(XMFLOAT3) * 2 + sizeof(XMFLOAT4));
+	report.compressedBytes = GetCompressedSize();
+
+	return report;
+}
+
+void AnimationClip::Sample(float time, Skeleton::LocalPose& localPose) const
+{
+	if (frameCount == 0)
+	{
+		return;
+	}
+
+	SampleFrame((std::min)((std::max)(time, 0.0f) * sampleRate, (float)(frameCount - 1)), localPose);
+}
+
+void AnimationClip::SampleFrame(float frame, Skeleton::LocalPose& localPose) const
+{
+	for (size_t i = 0; i < tracks.size(); i++)
+	{
+		const CompressedTrack& track = tracks[i];
+		const XMFLOAT3 scale = SampleVector(track.scale, frame);
+		const XMFLOAT4 rotation = SampleRotation(track.rotation, frame);
+		const XMFLOAT3 translation = SampleVector(track.translation, frame);
+		localPose.scales[i] = XMLoadFloat3(&scale);
+		localPose.rotations[i] = XMLoadFloat4(&rotation);
+		localPose.translations[i] = XMLoadFloat3(&translation);
+	}
+}
+
+size_t AnimationClip::GetKeyCount() const
+{
+	size_t count = 0;
+	for (const CompressedTrack& track : tracks)
+	{
+		count += track.scale.frames.size() + track.rotation.frames.size() + track.translation.frames.size();
+	}
+	return count;
+}
+
+size_t AnimationClip::GetCompressedSize() const
+{
+	// Key frames and values, plus the range of each channel
+	const size_t channelSize = sizeof(XMFLOAT3) * 2;
+	return GetKeyCount() * sizeof(uint16_t) * 4 + tracks.size() * channelSize * 3;
+}
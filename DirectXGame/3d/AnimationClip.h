@@ -0,0 +1,128 @@
+#pragma once
+
+#include "Skeleton.h"
+
+#include <DirectXMath.h>
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/// <summary>
+/// Joint animation pre-sampled at a fixed rate into compressed local scale/rotation/translation keys
+/// Each channel keeps only the keys needed to stay within the error tolerance (linear interpolation in between).
+/// Rotations are stored as smallest-three quaternions, scales and translations relative to their range, 16 bits per component.
+/// </summary>
+class AnimationClip
+{
+private: // Alias
+	// Using DirectX::
+	using XMFLOAT3 = DirectX::XMFLOAT3;
+	using XMFLOAT4 = DirectX::XMFLOAT4;
+
+	// Using std::
+	using string = std::string;
+	template <class T> using vector = std::vector<T>;
+
+public: // Subclass
+	// Uncompressed keys of one joint, one per frame (input of Build)
+	struct Track
+	{
+		vector<XMFLOAT3> scales;
+		vector<XMFLOAT4> rotations;
+		vector<XMFLOAT3> translations;
+	};
+
+	// Largest error each channel may gain by the key reduction
+	struct CompressionSettings
+	{
+		// Angle in radians
+		float rotationTolerance = 0.0005f;
+		// Distance in the units of the parent joint
+		float translationTolerance = 0.0005f;
+		float scaleTolerance = 0.0005f;
+	};
+
+	// Result of Build, errors are measured in joint (bone) space on every frame
+	struct CompressionReport
+	{
+		// Size of the sampled float keys
+		size_t rawBytes = 0;
+		// Size of the compressed channels
+		size_t compressedBytes = 0;
+		// Largest rotation error in radians
+		float maxRotationError = 0.0f;
+		float maxTranslationError = 0.0f;
+		float maxScaleError = 0.0f;
+	};
+
+	// Compressed keys of one channel
+	struct Channel
+	{
+		// Frame of each key (ascending, the first key is frame 0)
+		vector<uint16_t> frames;
+		// Three 16-bit values per key
+		vector<uint16_t> values;
+		// Dequantization range of scale and translation channels
+		XMFLOAT3 rangeMin = { 0,0,0 };
+		XMFLOAT3 rangeExtent = { 0,0,0 };
+	};
+
+	// Compressed keys of one joint
+	struct CompressedTrack
+	{
+		Channel scale;
+		Channel rotation;
+		Channel translation;
+	};
+
+public:
+	// Friend Class
+	friend class FbxLoader;
+
+public:
+	/// <summary>
+	/// Compress sampled keys into the clip
+	/// </summary>
+	/// <param name="name">Clip name</param>
+	/// <param name="sampleRate">Frames per second of the keys</param>
+	/// <param name="sampledTracks">One track per joint, frameCount keys per channel</param>
+	/// <param name="settings">Error tolerances of the key reduction</param>
+	/// <returns>Sizes and errors of the compressed clip</returns>
+	CompressionReport Build(const string& name, float sampleRate, const vector<Track>& sampledTracks,
+		const CompressionSettings& settings);
+
+	/// <summary>
+	/// Sample the local transformation of every joint
+	/// </summary>
+	/// <param name="time">Time in seconds (clamped to the clip)</param>
+	/// <param name="localPose">Destination, one transformation per track</param>
+	void Sample(float time, Skeleton::LocalPose& localPose) const;
+
+	// Number of keys of all channels (for reports)
+	size_t GetKeyCount() const;
+
+	// Size of the compressed channels in bytes
+	size_t GetCompressedSize() const;
+
+	// getter
+	const string& GetName() const { return name; }
+	float GetDuration() const { return frameCount > 1 ? (frameCount - 1) / sampleRate : 0.0f; }
+	float GetSampleRate() const { return sampleRate; }
+	uint32_t GetFrameCount() const { return frameCount; }
+	const vector<CompressedTrack>& GetTracks() const { return tracks; }
+
+private:
+	// Sample the local transformation of every joint at a fractional frame
+	void SampleFrame(float frame, Skeleton::LocalPose& localPose) const;
+
+private:
+	// Name (animation stack name)
+	string name;
+	// Keys per second
+	float sampleRate = 60.0f;
+	// Number of sampled frames
+	uint32_t frameCount = 0;
+	// One track per joint of the model
+	vector<CompressedTrack> tracks;
+};
@@ -0,0 +1,285 @@
+#include "AnimationPlayer.h"
+#include "Model.h"
+
+#include <algorithm>
+#include <cmath>
+
+using namespace DirectX;
+
+/// <summary>
+/// Static Member Variable Entity
+/// </summary>
+const int AnimationPlayer::MAX_LAYERS;
+
+void AnimationPlayer::Initialize(const Model* model)
+{
+	this->model = model;
+
+	current = ClipState();
+	previous = ClipState();
+	fadeDuration = 0.0f;
+	fadeElapsed = 0.0f;
+
+	for (Layer& layer : layers)
+	{
+		layer = Layer();
+	}
+
+	scratchPose.Resize(model->GetSkeleton().GetJointCount());
+}
+
+bool AnimationPlayer::Play(const string& clipName, float fadeTime, bool loop)
+{
+	const AnimationClip* clip = model->FindAnimationClip(clipName);
+	if (clip == nullptr)
+	{
+		return false;
+	}
+
+	// Fade out the playing clip (an unfinished fade continues from the clip that was fading in)
+	if (fadeTime > 0.0f && current.clip != nullptr)
+	{
+		previous = current;
+		fadeDuration = fadeTime;
+		fadeElapsed = 0.0f;
+	}
+	else
+	{
+		previous.clip = nullptr;
+	}
+
+	current.clip = clip;
+	current.time = 0.0f;
+	current.loop = loop;
+	return true;
+}
+
+bool AnimationPlayer::PlayLayer(int layerIndex, const string& clipName, BlendMode blendMode, float weight, bool loop)
+{
+	if (layerIndex < 0 || layerIndex >= MAX_LAYERS)
+	{
+		return false;
+	}
+
+	const AnimationClip* clip = model->FindAnimationClip(clipName);
+	if (clip == nullptr)
+	{
+		return false;
+	}
+
+	Layer& layer = layers[layerIndex];
+	layer.state.clip = clip;
+	layer.state.time = 0.0f;
+	layer.state.loop = loop;
+	layer.blendMode = blendMode;
+	layer.weight = weight;
+
+	// Additive clips are relative to their first frame
+	if (blendMode == BlendMode::Additive)
+	{
+		layer.referencePose.Resize(model->GetSkeleton().GetJointCount());
+		clip->Sample(0.0f, layer.referencePose);
+	}
+	return true;
+}
+
+void AnimationPlayer::StopLayer(int layerIndex)
+{
+	if (layerIndex < 0 || layerIndex >= MAX_LAYERS)
+	{
+		return;
+	}
+
+	layers[layerIndex].state.clip = nullptr;
+}
+
+void AnimationPlayer::SetLayerWeight(int layerIndex, float weight)
+{
+	if (layerIndex < 0 || layerIndex >= MAX_LAYERS)
+	{
+		return;
+	}
+
+	layers[layerIndex].weight = weight;
+}
+
+void AnimationPlayer::SetLayerMask(int layerIndex, const vector<float>& jointMask)
+{
+	if (layerIndex < 0 || layerIndex >= MAX_LAYERS)
+	{
+		return;
+	}
+
+	// A mask of another joint count would index outside the pose
+	Layer& layer = layers[layerIndex];
+	layer.jointMask = jointMask.size() == model->GetSkeleton().GetJointCount() ? jointMask : vector<float>();
+}
+
+std::vector<float> AnimationPlayer::CreateJointMask(const string& jointName, float weight) const
+{
+	const std::vector<Model::Joint>& joints = model->GetJoints();
+	vector<float> jointMask(joints.size(), 0.0f);
+
+	const int32_t rootIndex = model->FindJointIndex(jointName);
+	if (rootIndex < 0)
+	{
+		return jointMask;
+	}
+
+	// Parents come before their children, so one pass marks the whole subtree
+	vector<bool> inSubtree(joints.size(), false);
+	inSubtree[rootIndex] = true;
+	jointMask[rootIndex] = weight;
+	for (size_t i = rootIndex + 1; i < joints.size(); i++)
+	{
+		const int32_t parentIndex = joints[i].parentIndex;
+		if (parentIndex >= 0 && inSubtree[parentIndex])
+		{
+			inSubtree[i] = true;
+			jointMask[i] = weight;
+		}
+	}
+	return jointMask;
+}
+
+void AnimationPlayer::Update(float deltaTime)
+{
+	const float scaledTime = deltaTime * speed;
+
+	if (current.clip != nullptr)
+	{
+		Advance(current, scaledTime);
+	}
+
+	// The faded out clip keeps moving until the fade is over
+	if (previous.clip != nullptr)
+	{
+		Advance(previous, scaledTime);
+		fadeElapsed += deltaTime;
+		if (fadeElapsed >= fadeDuration)
+		{
+			previous.clip = nullptr;
+		}
+	}
+
+	for (Layer& layer : layers)
+	{
+		if (layer.state.clip != nullptr)
+		{
+			Advance(layer.state, scaledTime);
+		}
+	}
+}
+
+void AnimationPlayer::Evaluate(Skeleton::LocalPose& localPose)
+{
+	if (current.clip == nullptr)
+	{
+		return;
+	}
+
+	current.clip->Sample(current.time, localPose);
+
+	// Cross-fade, the previous clip weighs 1 at the start of the fade and 0 at the end
+	if (previous.clip != nullptr)
+	{
+		previous.clip->Sample(previous.time, scratchPose);
+		BlendPose(localPose, scratchPose, 1.0f - fadeElapsed / fadeDuration, nullptr);
+	}
+
+	for (const Layer& layer : layers)
+	{
+		if (layer.state.clip == nullptr || layer.weight <= 0.0f)
+		{
+			continue;
+		}
+
+		const float* jointMask = layer.jointMask.empty() ? nullptr : layer.jointMask.data();
+		layer.state.clip->Sample(layer.state.time, scratchPose);
+		if (layer.blendMode == BlendMode::Additive)
+		{
+			AddPose(localPose, scratchPose, layer.referencePose, layer.weight, jointMask);
+		}
+		else
+		{
+			BlendPose(localPose, scratchPose, layer.weight, jointMask);
+		}
+	}
+}
+
+void AnimationPlayer::Advance(ClipState& state, float deltaTime)
+{
+	const float duration = state.clip->GetDuration();
+	if (duration <= 0.0f)
+	{
+		state.time = 0.0f;
+		return;
+	}
+
+	state.time += deltaTime;
+	if (state.loop)
+	{
+		// Wrap in both directions (negative speeds play backwards)
+		state.time = std::fmod(state.time, duration);
+		if (state.time < 0.0f)
+		{
+			state.time += duration;
+		}
+	}
+	else
+	{
+		// Hold the first or last frame
+		state.time = (std::min)((std::max)(state.time, 0.0f), duration);
+	}
+}
+
+void AnimationPlayer::BlendPose(Skeleton::LocalPose& pose, const Skeleton::LocalPose& target, float weight,
+	const float* jointMask)
+{
+	for (size_t i = 0; i < pose.rotations.size(); i++)
+	{
+		const float jointWeight = jointMask ? weight * jointMask[i] : weight;
+		if (jointWeight <= 0.0f)
+		{
+			continue;
+		}
+		const XMVECTOR t = XMVectorReplicate(jointWeight);
+
+		pose.scales[i] = XMVectorLerpV(pose.scales[i], target.scales[i], t);
+		pose.translations[i] = XMVectorLerpV(pose.translations[i], target.translations[i], t);
+
+		// Normalized linear interpolation along the shorter arc
+		XMVECTOR rotation = target.rotations[i];
+		const XMVECTOR opposite = XMVectorLess(XMVector4Dot(pose.rotations[i], rotation), g_XMZero);
+		rotation = XMVectorSelect(rotation, XMVectorNegate(rotation), opposite);
+		pose.rotations[i] = XMQuaternionNormalize(XMVectorLerpV(pose.rotations[i], rotation, t));
+	}
+}
+
+void AnimationPlayer::AddPose(Skeleton::LocalPose& pose, const Skeleton::LocalPose& additivePose,
+	const Skeleton::LocalPose& referencePose, float weight, const float* jointMask)
+{
+	for (size_t i = 0; i < pose.rotations.size(); i++)
+	{
+		const float jointWeight = jointMask ? weight * jointMask[i] : weight;
+		if (jointWeight <= 0.0f)
+		{
+			continue;
+		}
+		const XMVECTOR t = XMVectorReplicate(jointWeight);
+
+		// Scale and translation differences are added
+		pose.scales[i] = XMVectorMultiplyAdd(XMVectorSubtract(additivePose.scales[i], referencePose.scales[i]), t, pose.scales[i]);
+		pose.translations[i] = XMVectorMultiplyAdd(
+			XMVectorSubtract(additivePose.translations[i], referencePose.translations[i]), t, pose.translations[i]);
+
+		// Rotation from the reference to the additive pose, scaled by the weight (shorter arc from identity)
+		XMVECTOR delta = XMQuaternionMultiply(additivePose.rotations[i], XMQuaternionConjugate(referencePose.rotations[i]));
+		const XMVECTOR opposite = XMVectorLess(XMVectorSplatW(delta), g_XMZero);
+		delta = XMVectorSelect(delta, XMVectorNegate(delta), opposite);
+		delta = XMQuaternionNormalize(XMVectorLerpV(g_XMIdentityR3, delta, t));
+
+		// Applied in the joint's own space
+		pose.rotations[i] = XMQuaternionNormalize(XMQuaternionMultiply(delta, pose.rotations[i]));
+	}
+}
@@ -0,0 +1,151 @@
+#pragma once
+
+#include "AnimationClip.h"
+#include "Skeleton.h"
+
+#include <string>
+#include <vector>
+
+class Model;
+
+/// <summary>
+/// Plays the animation clips of a model by name
+/// A base clip can cross-fade into the next one, layers on top override or add to the pose, optionally per joint (mask).
+/// Every working pose is allocated when the player or a layer is set up, so Update and Evaluate never allocate.
+/// </summary>
+class AnimationPlayer
+{
+private: // Alias
+	// Using std::
+	using string = std::string;
+	template <class T> using vector = std::vector<T>;
+
+public: // Constant
+	// Number of layers above the base clip
+	static const int MAX_LAYERS = 4;
+
+public: // Enumeration
+	// How a layer is combined with the pose below it
+	enum class BlendMode
+	{
+		// Blend toward the layer pose by the weight
+		Override,
+		// Add the difference of the layer pose from its first frame
+		Additive,
+	};
+
+public: // Subclass
+	// Playback position in one clip
+	struct ClipState
+	{
+		const AnimationClip* clip = nullptr;
+		// Seconds from the start of the clip
+		float time = 0.0f;
+		// Return to the start after the end (otherwise hold the last frame)
+		bool loop = true;
+	};
+
+	// Clip played on top of the base clip
+	struct Layer
+	{
+		ClipState state;
+		BlendMode blendMode = BlendMode::Override;
+		float weight = 0.0f;
+		// Weight of every joint (empty if every joint is fully affected)
+		vector<float> jointMask;
+		// First frame of an additive clip
+		Skeleton::LocalPose referencePose;
+	};
+
+public:
+	/// <summary>
+	/// Prepare the player for the clips and the joints of a model
+	/// </summary>
+	/// <param name="model">Model whose clips are played</param>
+	void Initialize(const Model* model);
+
+	/// <summary>
+	/// Play a clip as the base of the pose
+	/// </summary>
+	/// <param name="clipName">Name of the clip (animation stack)</param>
+	/// <param name="fadeTime">Seconds of the cross-fade from the playing clip (0 to switch at once)</param>
+	/// <param name="loop">Return to the start after the end</param>
+	/// <returns>False if the model has no clip of the name</returns>
+	bool Play(const string& clipName, float fadeTime = 0.0f, bool loop = true);
+
+	/// <summary>
+	/// Play a clip on a layer above the base clip
+	/// </summary>
+	/// <param name="layerIndex">Layer (0 to MAX_LAYERS - 1, applied in order)</param>
+	/// <param name="clipName">Name of the clip (animation stack)</param>
+	/// <param name="blendMode">How the layer is combined with the pose below it</param>
+	/// <param name="weight">Influence of the layer (0 to 1)</param>
+	/// <param name="loop">Return to the start after the end</param>
+	/// <returns>False if the layer or the clip does not exist</returns>
+	bool PlayLayer(int layerIndex, const string& clipName, BlendMode blendMode, float weight, bool loop = true);
+
+	// Stop the layer
+	void StopLayer(int layerIndex);
+
+	// Influence of the layer (0 to 1)
+	void SetLayerWeight(int layerIndex, float weight);
+
+	// Weight of every joint of the layer (empty to affect every joint)
+	void SetLayerMask(int layerIndex, const vector<float>& jointMask);
+
+	/// <summary>
+	/// Joint mask covering a joint and every joint below it
+	/// </summary>
+	/// <param name="jointName">Root joint of the masked part</param>
+	/// <param name="weight">Weight of the masked joints (the others are 0)</param>
+	/// <returns>Weight of every joint of the model</returns>
+	vector<float> CreateJointMask(const string& jointName, float weight = 1.0f) const;
+
+	/// <summary>
+	/// Advance the clips and the cross-fade
+	/// </summary>
+	/// <param name="deltaTime">Seconds since the previous update</param>
+	void Update(float deltaTime);
+
+	/// <summary>
+	/// Blend the clips into the local transformation of every joint
+	/// </summary>
+	/// <param name="localPose">Destination, sized for the joints of the model</param>
+	void Evaluate(Skeleton::LocalPose& localPose);
+
+	// Playback speed of every clip (1 = real time)
+	void SetSpeed(float speed) { this->speed = speed; }
+
+	// getter
+	const Model* GetModel() const { return model; }
+	bool IsPlaying() const { return current.clip != nullptr; }
+	const ClipState& GetCurrentState() const { return current; }
+
+private:
+	// Advance the playback position of a clip
+	static void Advance(ClipState& state, float deltaTime);
+
+	// Blend the pose toward another pose
+	static void BlendPose(Skeleton::LocalPose& pose, const Skeleton::LocalPose& target, float weight, const float* jointMask);
+
+	// Add the difference of a pose from its reference pose
+	static void AddPose(Skeleton::LocalPose& pose, const Skeleton::LocalPose& additivePose,
+		const Skeleton::LocalPose& referencePose, float weight, const float* jointMask);
+
+private:
+	// Model whose clips are played
+	const Model* model = nullptr;
+	// Base clip
+	ClipState current;
+	// Clip faded out during a cross-fade
+	ClipState previous;
+	// Length and progress of the cross-fade in seconds
+	float fadeDuration = 0.0f;
+	float fadeElapsed = 0.0f;
+	// Playback speed
+	float speed = 1.0f;
+	// Layers above the base clip
+	Layer layers[MAX_LAYERS];
+	// Pose of the clip being blended
+	Skeleton::LocalPose scratchPose;
+};
@@ -0,0 +1,179 @@
+#include "AnimationSystem.h"
+#include "JobSystem.h"
+
+#include <d3dx12.h>
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <cstdio>
+
+/// <summary>
+/// Static Member Variable Entity
+/// </summary>
+const int AnimationSystem::MAX_INSTANCES;
+const int AnimationSystem::MAX_PALETTE_VECTORS;
+const int AnimationSystem::FRAME_COUNT;
+const int AnimationSystem::BATCH_SIZE;
+
+void AnimationSystem::Initialize(ID3D12Device* device)
+{
+	HRESULT result;
+
+	// Ring buffer of the skinning palettes (stays mapped)
+	result = device->CreateCommittedResource(
+		&CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD),
+		D3D12_HEAP_FLAG_NONE,
+		&CD3DX12_RESOURCE_DESC::Buffer(sizeof(XMVECTOR) * MAX_PALETTE_VECTORS * FRAME_COUNT),
+		D3D12_RESOURCE_STATE_GENERIC_READ,
+		nullptr,
+		IID_PPV_ARGS(&paletteRingBuffer));
+	assert(SUCCEEDED(result));
+
+	result = paletteRingBuffer->Map(0, nullptr, (void**)&mappedPalette);
+	assert(SUCCEEDED(result));
+
+	objects.reserve(MAX_INSTANCES);
+	overflowObjects.reserve(MAX_INSTANCES);
+}
+
+bool AnimationSystem::Register(Object3d* object)
+{
+	if (objects.size() >= MAX_INSTANCES)
+	{
+		return false;
+	}
+
+	if (std::find(objects.begin(), objects.end(), object) == objects.end())
+	{
+		objects.push_back(object);
+		object->animatedBySystem = true;
+	}
+	return true;
+}
+
+void AnimationSystem::Unregister(Object3d* object)
+{
+	auto it = std::find(objects.begin(), objects.end(), object);
+	if (it == objects.end())
+	{
+		return;
+	}
+
+	objects.erase(it);
+	object->animatedBySystem = false;
+	object->paletteAddress = 0;
+}
+
+void AnimationSystem::Update(float deltaTime)
+{
+	// Next region of the ring
+	frameIndex = (frameIndex + 1) % FRAME_COUNT;
+	XMVECTOR* framePalette = mappedPalette + (size_t)frameIndex * MAX_PALETTE_VECTORS;
+	const D3D12_GPU_VIRTUAL_ADDRESS frameAddress =
+		paletteRingBuffer->GetGPUVirtualAddress() + (UINT64)frameIndex * MAX_PALETTE_VECTORS * sizeof(XMVECTOR);
+
+	// Pack the palettes of the objects one after another, each starting on a matrix boundary so that it can be
+	// indexed both as matrices and as dual quaternions from the start of the region
+	size_t paletteSize = 0;
+	overflowObjects.clear();
+	for (Object3d* object : objects)
+	{
+		object->paletteAddress = 0;
+		if (object->model == nullptr)
+		{
+			continue;
+		}
+
+		const size_t objectPaletteSize = object->GetPaletteSize();
+		const size_t objectPaletteStart = (paletteSize + 3) & ~(size_t)3;
+		if (objectPaletteStart + objectPaletteSize > MAX_PALETTE_VECTORS)
+		{
+			overflowObjects.push_back(object);
+			continue;
+		}
+		object->paletteAddress = frameAddress;
+		object->paletteOffset = (UINT)(objectPaletteStart / object->GetPaletteStride());
+		paletteSize = objectPaletteStart + objectPaletteSize;
+	}
+
+	// Every object writes only its own part of the palette, so the batches need no synchronisation
+	JobSystem::GetInstance()->ParallelFor(objects.size(), BATCH_SIZE, [&](size_t begin, size_t end)
+		{
+			for (size_t i = begin; i < end; i++)
+			{
+				Object3d* object = objects[i];
+				if (object->paletteAddress != 0)
+				{
+					object->UpdateAnimation(deltaTime, framePalette + object->paletteOffset * object->GetPaletteStride());
+				}
+			}
+		});
+
+	// Objects that did not fit use their own palette
+	if (!overflowObjects.empty() && !overflowReported)
+	{
+		char str[256];
+		sprintf_s(str, "AnimationSystem: palette full (%d vectors), %zu objects animated separately\n",
+			MAX_PALETTE_VECTORS, overflowObjects.size());
+		OutputDebugStringA(str);
+		overflowReported = true;
+	}
+	for (Object3d* object : overflowObjects)
+	{
+		object->UpdateSkinPalette(deltaTime);
+	}
+}
+
+void AnimationSystem::BenchmarkScaling(Model* model, int instanceCount)
+{
+	// Number of frames timed per thread count
+	const int frameCount = 60;
+	const float deltaTime = 1.0f / 60.0f;
+
+	// Instances without GPU resources, the animation only needs the model
+	std::vector<Object3d> instances(instanceCount);
+	for (int i = 0; i < instanceCount; i++)
+	{
+		instances[i].SetModel(model);
+		instances[i].PlayAnimation();
+		// Spread the instances over the clip
+		instances[i].GetAnimationPlayer().Update(i * 0.01f);
+	}
+
+	// Palettes packed like in Update
+	const size_t paletteSize = instances.empty() ? 0 : instances[0].GetPaletteSize();
+	std::vector<XMVECTOR> palette(paletteSize * instanceCount);
+
+	JobSystem* jobSystem = JobSystem::GetInstance();
+	const size_t maxThreadCount = jobSystem->GetThreadCount();
+	double serialMilliseconds = 0.0;
+	for (size_t threadCount = 1; threadCount <= maxThreadCount; threadCount++)
+	{
+		jobSystem->SetThreadLimit(threadCount);
+
+		auto start = std::chrono::steady_clock::now();
+		for (int frame = 0; frame < frameCount; frame++)
+		{
+			jobSystem->ParallelFor(instances.size(), BATCH_SIZE, [&](size_t begin, size_t end)
+				{
+					for (size_t i = begin; i < end; i++)
+					{
+						instances[i].UpdateAnimation(deltaTime, palette.data() + i * paletteSize);
+					}
+				});
+		}
+		auto end = std::chrono::steady_clock::now();
+
+		const double milliseconds = std::chrono::duration<double, std::milli>(end - start).count() / frameCount;
+		if (threadCount == 1)
+		{
+			serialMilliseconds = milliseconds;
+		}
+
+		char str[256];
+		sprintf_s(str, "AnimationSystem: %d instances, %zu threads, %.3f ms per frame (x%.2f)\n", instanceCount,
+			threadCount, milliseconds, milliseconds > 0.0 ? serialMilliseconds / milliseconds : 0.0);
+		OutputDebugStringA(str);
+	}
+	jobSystem->SetThreadLimit(maxThreadCount);
+}
@@ -0,0 +1,84 @@
+#pragma once
+
+#include "Object3d.h"
+#include "FramePacer.h"
+
+#include <d3d12.h>
+#include <wrl.h>
+#include <vector>
+
+/// <summary>
+/// Animates many Object3d instances in parallel on the JobSystem
+/// The skinning transformations of all instances are packed one after another into a palette (structured buffer) in one
+/// persistently mapped upload buffer, split into FRAME_COUNT regions used in turn (ring) so that a frame still
+/// read by the GPU is not overwritten.
+/// </summary>
+class AnimationSystem
+{
+private: // Alias
+	// using Microsoft::WRL
+	template <class T> using ComPtr = Microsoft::WRL::ComPtr<T>;
+
+	// Using DirectX::
+	using XMVECTOR = DirectX::XMVECTOR;
+
+public: // Constant
+	// Maximum number of animated instances
+	static const int MAX_INSTANCES = 1024;
+	// Vectors per region of the palette, 4 per matrix or 2 per dual quaternion (instances beyond it animate into
+	// their own palette)
+	static const int MAX_PALETTE_VECTORS = 0x40000;
+	// Regions of the ring buffer (frames the GPU may read at once)
+	static const int FRAME_COUNT = FramePacer::FRAMES_IN_FLIGHT;
+	// Instances per job (the unit of work stealing)
+	static const int BATCH_SIZE = 16;
+
+public:
+	/// <summary>
+	/// Initialization
+	/// </summary>
+	/// <param name="device">D3D12Device</param>
+	void Initialize(ID3D12Device* device);
+
+	/// <summary>
+	/// Animate an object here instead of in its Update
+	/// </summary>
+	/// <param name="object">Object with a model</param>
+	/// <returns>False if MAX_INSTANCES objects are registered already</returns>
+	bool Register(Object3d* object);
+
+	/// <summary>
+	/// Return an object to animating itself
+	/// </summary>
+	/// <param name="object">Registered object</param>
+	void Unregister(Object3d* object);
+
+	/// <summary>
+	/// Advance the animations of every registered object and write their skinning transformations for this frame
+	/// </summary>
+	/// <param name="deltaTime">Seconds since the previous frame</param>
+	void Update(float deltaTime);
+
+	/// <summary>
+	/// Report the animation update time of many instances for every thread count from 1 to all cores
+	/// </summary>
+	/// <param name="model">Animated model</param>
+	/// <param name="instanceCount">Number of instances</param>
+	void BenchmarkScaling(Model* model, int instanceCount);
+
+	// Number of registered objects
+	size_t GetInstanceCount() const { return objects.size(); }
+
+private:
+	// Skinning transformations of every instance, FRAME_COUNT regions of MAX_PALETTE_VECTORS vectors
+	ComPtr<ID3D12Resource> paletteRingBuffer;
+	XMVECTOR* mappedPalette = nullptr;
+	// Region written this frame
+	int frameIndex = 0;
+	// Registered objects
+	std::vector<Object3d*> objects;
+	// Objects whose palette did not fit into the region this frame
+	std::vector<Object3d*> overflowObjects;
+	// The overflow has been reported
+	bool overflowReported = false;
+};
@@ -0,0 +1,412 @@
+#include "CpuSkinning.h"
+
+#include <Windows.h>
+#include <intrin.h>
+#include <immintrin.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+using namespace DirectX;
+
+// The CPU and the OS support AVX2 and FMA (the OS must save the YMM registers)
+static bool DetectAVX2()
+{
+	int info[4];
+	__cpuid(info, 0);
+	if (info[0] < 7)
+	{
+		return false;
+	}
+
+	__cpuid(info, 1);
+	const bool fma = (info[2] & (1 << 12)) != 0;
+	const bool osxsave = (info[2] & (1 << 27)) != 0;
+	const bool avx = (info[2] & (1 << 28)) != 0;
+	if (!fma || !osxsave || !avx || (_xgetbv(0) & 6) != 6)
+	{
+		return false;
+	}
+
+	__cpuidex(info, 7, 0);
+	return (info[1] & (1 << 5)) != 0;
+}
+
+// Two 128-bit halves into one 256-bit register
+static inline __m256 Combine(__m128 low, __m128 high)
+{
+	return _mm256_insertf128_ps(_mm256_castps128_ps256(low), high, 1);
+}
+
+void CpuSkinning::Skin(const Vertex* vertices, size_t count, const XMMATRIX* palette, SkinnedVertex* output)
+{
+	static const Implementation best = GetBestImplementation();
+	Skin(best, vertices, count, palette, output);
+}
+
+void CpuSkinning::Skin(Implementation implementation, const Vertex* vertices, size_t count, const XMMATRIX* palette,
+	SkinnedVertex* output)
+{
+	switch (implementation)
+	{
+	case Implementation::AVX2:
+		SkinAVX2(vertices, count, palette, output);
+		break;
+	case Implementation::SSE:
+		SkinSSE(vertices, count, palette, output);
+		break;
+	default:
+		SkinScalar(vertices, count, palette, output);
+		break;
+	}
+}
+
+bool CpuSkinning::IsSupported(Implementation implementation)
+{
+	static const bool avx2 = DetectAVX2();
+
+	switch (implementation)
+	{
+	case Implementation::Scalar:
+		return true;
+	case Implementation::SSE:
+		// Part of every x64 CPU
+		return true;
+	case Implementation::AVX2:
+		return avx2;
+	default:
+		return false;
+	}
+}
+
+CpuSkinning::Implementation CpuSkinning::GetBestImplementation()
+{
+	return IsSupported(Implementation::AVX2) ? Implementation::AVX2 : Implementation::SSE;
+}
+
+const char* CpuSkinning::GetImplementationName(Implementation implementation)
+{
+	switch (implementation)
+	{
+	case Implementation::Scalar:
+		return "scalar";
+	case Implementation::SSE:
+		return "SSE";
+	case Implementation::AVX2:
+		return "AVX2";
+	default:
+		return "unknown";
+	}
+}
+
+void CpuSkinning::SkinScalar(const Vertex* vertices, size_t count, const XMMATRIX* palette, SkinnedVertex* output)
+{
+	for (size_t i = 0; i < count; i++)
+	{
+		const Vertex& vertex = vertices[i];
+		float pos[4] = { 0,0,0,0 };
+		float normal[4] = { 0,0,0,0 };
+
+		for (int j = 0; j < Model::MAX_BONE_INDICES; j++)
+		{
+			// Rows of the matrix (the shader multiplies the position as a row vector)
+			const float* m = reinterpret_cast<const float*>(&palette[vertex.boneIndex[j]]);
+			const float weight = vertex.boneWeight[j];
+
+			// Same order of operations as the SSE version, so that both give the same bits
+			for (int k = 0; k < 4; k++)
+			{
+				const float skinnedPos = vertex.pos.x * m[k] + vertex.pos.y * m[4 + k] + vertex.pos.z * m[8 + k] + m[12 + k];
+				const float skinnedNormal = vertex.normal.x * m[k] + vertex.normal.y * m[4 + k] + vertex.normal.z * m[8 + k];
+				pos[k] = pos[k] + weight * skinnedPos;
+				normal[k] = normal[k] + weight * skinnedNormal;
+			}
+		}
+
+		output[i].pos = XMFLOAT4(pos[0], pos[1], pos[2], pos[3]);
+		output[i].normal = XMFLOAT4(normal[0], normal[1], normal[2], normal[3]);
+	}
+}
+
+void CpuSkinning::SkinSSE(const Vertex* vertices, size_t count, const XMMATRIX* palette, SkinnedVertex* output)
+{
+	for (size_t i = 0; i < count; i++)
+	{
+		const Vertex& vertex = vertices[i];
+		const __m128 px = _mm_set1_ps(vertex.pos.x);
+		const __m128 py = _mm_set1_ps(vertex.pos.y);
+		const __m128 pz = _mm_set1_ps(vertex.pos.z);
+		const __m128 nx = _mm_set1_ps(vertex.normal.x);
+		const __m128 ny = _mm_set1_ps(vertex.normal.y);
+		const __m128 nz = _mm_set1_ps(vertex.normal.z);
+		__m128 pos = _mm_setzero_ps();
+		__m128 normal = _mm_setzero_ps();
+
+		for (int j = 0; j < Model::MAX_BONE_INDICES; j++)
+		{
+			const XMMATRIX& m = palette[vertex.boneIndex[j]];
+			const __m128 weight = _mm_set1_ps(vertex.boneWeight[j]);
+
+			__m128 skinnedPos = _mm_add_ps(_mm_add_ps(_mm_add_ps(
+				_mm_mul_ps(px, m.r[0]), _mm_mul_ps(py, m.r[1])), _mm_mul_ps(pz, m.r[2])), m.r[3]);
+			__m128 skinnedNormal = _mm_add_ps(_mm_add_ps(
+				_mm_mul_ps(nx, m.r[0]), _mm_mul_ps(ny, m.r[1])), _mm_mul_ps(nz, m.r[2]));
+			pos = _mm_add_ps(pos, _mm_mul_ps(weight, skinnedPos));
+			normal = _mm_add_ps(normal, _mm_mul_ps(weight, skinnedNormal));
+		}
+
+		_mm_storeu_ps(&output[i].pos.x, pos);
+		_mm_storeu_ps(&output[i].normal.x, normal);
+	}
+}
+
+void CpuSkinning::SkinAVX2(const Vertex* vertices, size_t count, const XMMATRIX* palette, SkinnedVertex* output)
+{
+	// Two vertices at once, one per 128-bit half
+	size_t i = 0;
+	for (; i + 2 <= count; i += 2)
+	{
+		const Vertex& a = vertices[i];
+		const Vertex& b = vertices[i + 1];
+		const __m256 px = _mm256_setr_ps(a.pos.x, a.pos.x, a.pos.x, a.pos.x, b.pos.x, b.pos.x, b.pos.x, b.pos.x);
+		const __m256 py = _mm256_setr_ps(a.pos.y, a.pos.y, a.pos.y, a.pos.y, b.pos.y, b.pos.y, b.pos.y, b.pos.y);
+		const __m256 pz = _mm256_setr_ps(a.pos.z, a.pos.z, a.pos.z, a.pos.z, b.pos.z, b.pos.z, b.pos.z, b.pos.z);
+		const __m256 nx = _mm256_setr_ps(a.normal.x, a.normal.x, a.normal.x, a.normal.x,
+			b.normal.x, b.normal.x, b.normal.x, b.normal.x);
+		const __m256 ny = _mm256_setr_ps(a.normal.y, a.normal.y, a.normal.y, a.normal.y,
+			b.normal.y, b.normal.y, b.normal.y, b.normal.y);
+		const __m256 nz = _mm256_setr_ps(a.normal.z, a.normal.z, a.normal.z, a.normal.z,
+			b.normal.z, b.normal.z, b.normal.z, b.normal.z);
+		__m256 pos = _mm256_setzero_ps();
+		__m256 normal = _mm256_setzero_ps();
+
+		for (int j = 0; j < Model::MAX_BONE_INDICES; j++)
+		{
+			const XMMATRIX& ma = palette[a.boneIndex[j]];
+			const XMMATRIX& mb = palette[b.boneIndex[j]];
+			const __m256 r0 = Combine(ma.r[0], mb.r[0]);
+			const __m256 r1 = Combine(ma.r[1], mb.r[1]);
+			const __m256 r2 = Combine(ma.r[2], mb.r[2]);
+			const __m256 r3 = Combine(ma.r[3], mb.r[3]);
+			const __m256 weight = Combine(_mm_set1_ps(a.boneWeight[j]), _mm_set1_ps(b.boneWeight[j]));
+
+			// Fused multiply-add rounds once per step, so the results may differ from the reference in the last bits
+			const __m256 skinnedPos = _mm256_fmadd_ps(px, r0, _mm256_fmadd_ps(py, r1, _mm256_fmadd_ps(pz, r2, r3)));
+			const __m256 skinnedNormal = _mm256_fmadd_ps(nx, r0, _mm256_fmadd_ps(ny, r1, _mm256_mul_ps(nz, r2)));
+			pos = _mm256_fmadd_ps(weight, skinnedPos, pos);
+			normal = _mm256_fmadd_ps(weight, skinnedNormal, normal);
+		}
+
+		_mm_storeu_ps(&output[i].pos.x, _mm256_castps256_ps128(pos));
+		_mm_storeu_ps(&output[i].normal.x, _mm256_castps256_ps128(normal));
+		_mm_storeu_ps(&output[i + 1].pos.x, _mm256_extractf128_ps(pos, 1));
+		_mm_storeu_ps(&output[i + 1].normal.x, _mm256_extractf128_ps(normal, 1));
+	}
+
+	// Avoid the SSE/AVX transition penalty in the code that follows
+	_mm256_zeroupper();
+
+	// Odd vertex
+	SkinSSE(vertices + i, count - i, palette, output + i);
+}
+
+void CpuSkinning::Benchmark(const Model* model)
+{
+	const std::vector<Vertex>& vertices = model->GetVertices();
+	if (vertices.empty())
+	{
+		return;
+	}
+
+	// Number of timed runs per implementation
+	const int runCount = 10;
+
+	// Repeat the vertices so that one run takes long enough to measure
+	const size_t repeatCount = (std::max)((size_t)1, ((size_t)1 << 20) / vertices.size());
+	std::vector<Vertex> source;
+	source.reserve(vertices.size() * repeatCount);
+	for (size_t i = 0; i < repeatCount; i++)
+	{
+		source.insert(source.end(), vertices.begin(), vertices.end());
+	}
+
+	// Palette of different scales, rotations and translations so that every bit of the blend is exercised
+	const size_t paletteSize = (std::max)(model->GetSkeleton().GetBoneCount(), (size_t)1);
+	std::vector<XMMATRIX> palette(paletteSize);
+	for (size_t i = 0; i < paletteSize; i++)
+	{
+		const float f = (float)i;
+		palette[i] = XMMatrixScaling(1.0f + 0.1f * f, 1.0f, 1.0f - 0.05f * f) *
+			XMMatrixRotationRollPitchYaw(0.37f * f, 0.11f * f, 0.23f * f) *
+			XMMatrixTranslation(0.5f * f, -f, 0.25f * f);
+	}
+
+	// Scalar reference
+	std::vector<SkinnedVertex> reference(source.size());
+	SkinScalar(source.data(), source.size(), palette.data(), reference.data());
+
+	std::vector<SkinnedVertex> output(source.size());
+	for (int implementation = 0; implementation < (int)Implementation::Count; implementation++)
+	{
+		char str[256];
+		if (!IsSupported((Implementation)implementation))
+		{
+			sprintf_s(str, "CpuSkinning: %s not supported by this CPU\n", GetImplementationName((Implementation)implementation));
+			OutputDebugStringA(str);
+			continue;
+		}
+
+		auto start = std::chrono::steady_clock::now();
+		for (int run = 0; run < runCount; run++)
+		{
+			Skin((Implementation)implementation, source.data(), source.size(), palette.data(), output.data());
+		}
+		auto end = std::chrono::steady_clock::now();
+		const double seconds = std::chrono::duration<double>(end - start).count() / runCount;
+
+		// Compare every component with the reference
+		const float* referenceValues = &reference[0].pos.x;
+		const float* values = &output[0].pos.x;
+		const size_t valueCount = output.size() * sizeof(SkinnedVertex) / sizeof(float);
+		size_t exactCount = 0;
+		float maxDifference = 0.0f;
+		for (size_t i = 0; i < valueCount; i++)
+		{
+			if (memcmp(&referenceValues[i], &values[i], sizeof(float)) == 0)
+			{
+				exactCount++;
+			}
+			else
+			{
+				maxDifference = (std::max)(maxDifference, fabsf(referenceValues[i] - values[i]));
+			}
+		}
+
+		sprintf_s(str, "CpuSkinning: %s %zu vertices, %.1f M vertices/s, %.3f%% bit-exact, max difference %g\n",
+			GetImplementationName((Implementation)implementation), source.size(),
+			seconds > 0.0 ? source.size() / seconds / 1000000.0 : 0.0, 100.0 * exactCount / valueCount, maxDifference);
+		OutputDebugStringA(str);
+	}
+}
+
+void CpuSkinning::SkinDualQuaternion(const Vertex* vertices, size_t count, const XMVECTOR* palette, SkinnedVertex* output)
+{
+	for (size_t i = 0; i < count; i++)
+	{
+		const Vertex& vertex = vertices[i];
+
+		// Blend in the hemisphere of bone 0 (shortest rotation), like the shader
+		const XMVECTOR real0 = palette[vertex.boneIndex[0] * 2];
+		XMVECTOR real = XMVectorZero();
+		XMVECTOR dual = XMVectorZero();
+		for (int j = 0; j < Model::MAX_BONE_INDICES; j++)
+		{
+			const XMVECTOR boneReal = palette[vertex.boneIndex[j] * 2];
+			const XMVECTOR boneDual = palette[vertex.boneIndex[j] * 2 + 1];
+			float weight = vertex.boneWeight[j];
+			if (XMVectorGetX(XMVector4Dot(real0, boneReal)) < 0.0f)
+			{
+				weight = -weight;
+			}
+			const XMVECTOR w = XMVectorReplicate(weight);
+			real = XMVectorMultiplyAdd(w, boneReal, real);
+			dual = XMVectorMultiplyAdd(w, boneDual, dual);
+		}
+
+		const XMVECTOR invLength = XMVectorReciprocal(XMVector4Length(real));
+		real = XMVectorMultiply(real, invLength);
+		dual = XMVectorMultiply(dual, invLength);
+
+		// Rotate, then translate by 2 * dual * conjugate(real)
+		const XMVECTOR translation = XMVectorScale(XMQuaternionMultiply(XMQuaternionConjugate(real), dual), 2.0f);
+		const XMVECTOR pos = XMVectorAdd(XMVector3Rotate(XMLoadFloat3(&vertex.pos), real), translation);
+		const XMVECTOR normal = XMVector3Rotate(XMLoadFloat3(&vertex.normal), real);
+
+		XMStoreFloat4(&output[i].pos, XMVectorSetW(pos, 1.0f));
+		XMStoreFloat4(&output[i].normal, XMVectorSetW(normal, 0.0f));
+	}
+}
+
+CpuSkinning::DualQuaternionComparison CpuSkinning::CompareDualQuaternion(const Model* model)
+{
+	DualQuaternionComparison comparison;
+
+	const std::vector<Vertex>& vertices = model->GetVertices();
+	const std::vector<AnimationClip>& animationClips = model->GetAnimationClips();
+	const Skeleton& skeleton = model->GetSkeleton();
+	if (vertices.empty() || animationClips.empty() || skeleton.GetBoneCount() == 0)
+	{
+		OutputDebugStringA("CpuSkinning: no skinned vertices or animation to compare\n");
+		return comparison;
+	}
+
+	// Scale of the model
+	XMVECTOR minPos = XMLoadFloat3(&vertices[0].pos);
+	XMVECTOR maxPos = minPos;
+	for (const Vertex& vertex : vertices)
+	{
+		minPos = XMVectorMin(minPos, XMLoadFloat3(&vertex.pos));
+		maxPos = XMVectorMax(maxPos, XMLoadFloat3(&vertex.pos));
+	}
+	comparison.modelSize = XMVectorGetX(XMVector3Length(XMVectorSubtract(maxPos, minPos)));
+
+	// Number of times sampled over the clip
+	const int sampleCount = 8;
+
+	const AnimationClip& clip = animationClips[0];
+	Skeleton::LocalPose localPose;
+	localPose.Resize(skeleton.GetJointCount());
+	std::vector<XMMATRIX> modelTransforms(skeleton.GetJointCount());
+	std::vector<XMMATRIX> skinMatrices(skeleton.GetBoneCount());
+	std::vector<XMVECTOR> dualQuaternions(skeleton.GetBoneCount() * 2);
+	std::vector<SkinnedVertex> linearOutput(vertices.size());
+	std::vector<SkinnedVertex> dualQuaternionOutput(vertices.size());
+
+	double blendedSum = 0.0;
+	for (int sample = 0; sample < sampleCount; sample++)
+	{
+		// Both palettes from the same pose
+		clip.Sample(clip.GetDuration() * sample / (sampleCount - 1), localPose);
+		skeleton.ComputeModelTransforms(localPose, modelTransforms.data());
+		skeleton.ComputeSkinMatrices(modelTransforms.data(), skinMatrices.data());
+		skeleton.ComputeSkinDualQuaternions(modelTransforms.data(), dualQuaternions.data());
+
+		SkinScalar(vertices.data(), vertices.size(), skinMatrices.data(), linearOutput.data());
+		SkinDualQuaternion(vertices.data(), vertices.size(), dualQuaternions.data(), dualQuaternionOutput.data());
+
+		for (size_t i = 0; i < vertices.size(); i++)
+		{
+			const float difference = XMVectorGetX(XMVector3Length(
+				XMVectorSubtract(XMLoadFloat4(&linearOutput[i].pos), XMLoadFloat4(&dualQuaternionOutput[i].pos))));
+
+			// One bone carries (almost) the whole weight
+			const float* weights = vertices[i].boneWeight;
+			const float maxWeight = *std::max_element(weights, weights + Model::MAX_BONE_INDICES);
+			if (maxWeight >= 0.999f)
+			{
+				comparison.rigidCount++;
+				comparison.maxRigidDifference = (std::max)(comparison.maxRigidDifference, difference);
+			}
+			else
+			{
+				comparison.blendedCount++;
+				comparison.maxBlendedDifference = (std::max)(comparison.maxBlendedDifference, difference);
+				blendedSum += difference;
+			}
+		}
+		comparison.vertexCount += vertices.size();
+	}
+	comparison.meanBlendedDifference = comparison.blendedCount > 0 ? (float)(blendedSum / comparison.blendedCount) : 0.0f;
+
+	char str[256];
+	sprintf_s(str, "CpuSkinning: dual quaternion vs matrices, %zu rigid vertices max %g, %zu blended vertices max %g mean %g"
+		" (model size %g)\n", comparison.rigidCount, comparison.maxRigidDifference, comparison.blendedCount,
+		comparison.maxBlendedDifference, comparison.meanBlendedDifference, comparison.modelSize);
+	OutputDebugStringA(str);
+
+	return comparison;
+}
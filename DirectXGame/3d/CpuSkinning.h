@@ -0,0 +1,120 @@
+#pragma once
+
+#include "Model.h"
+
+#include <DirectXMath.h>
+
+#include <cstddef>
+
+/// <summary>
+/// Linear blend skinning on the CPU, the same 4-bone blend as ComputeSkin in FBX.hlsli
+/// For bounding volumes, picking and checking the skinning without a GPU.
+/// The scalar version is the reference, the SSE and AVX2 versions are chosen at run time when the CPU has them.
+/// Dual quaternion skinning (the DUAL_QUATERNION_SKINNING variant of the shader) has a scalar version only.
+/// </summary>
+class CpuSkinning
+{
+private: // Alias
+	// Using DirectX::
+	using XMFLOAT4 = DirectX::XMFLOAT4;
+	using XMVECTOR = DirectX::XMVECTOR;
+	using XMMATRIX = DirectX::XMMATRIX;
+
+	using Vertex = Model::VertexPosNormalUvSkin;
+
+public: // Enumeration
+	// Instruction set of the kernel
+	enum class Implementation
+	{
+		Scalar,
+		SSE,
+		// AVX2 with FMA, two vertices per instruction
+		AVX2,
+		Count,
+	};
+
+public: // Subclass
+	// Skinned vertex (like SkinOutput of the shader)
+	struct SkinnedVertex
+	{
+		// Position, w is the sum of the weights
+		XMFLOAT4 pos;
+		// Normal (not normalized, like the shader), w is 0
+		XMFLOAT4 normal;
+	};
+
+	// Difference of dual quaternion skinning from linear blend skinning
+	struct DualQuaternionComparison
+	{
+		// Skinned vertices compared (every vertex at every sampled time)
+		size_t vertexCount = 0;
+		// Vertices bound to a single bone, where both must agree
+		size_t rigidCount = 0;
+		float maxRigidDifference = 0.0f;
+		// Vertices blended from several bones, where dual quaternions keep the volume
+		size_t blendedCount = 0;
+		float maxBlendedDifference = 0.0f;
+		float meanBlendedDifference = 0.0f;
+		// Diagonal of the bounding box of the model (scale of the differences)
+		float modelSize = 0.0f;
+	};
+
+public:
+	/// <summary>
+	/// Skin vertices with the fastest implementation the CPU supports
+	/// </summary>
+	/// <param name="vertices">Source vertices</param>
+	/// <param name="count">Number of vertices</param>
+	/// <param name="palette">Skinning matrices, indexed by the bone numbers of the vertices</param>
+	/// <param name="output">Destination, count entries</param>
+	static void Skin(const Vertex* vertices, size_t count, const XMMATRIX* palette, SkinnedVertex* output);
+
+	/// <summary>
+	/// Skin vertices with a given implementation
+	/// </summary>
+	/// <param name="implementation">Kernel to use (must be supported)</param>
+	/// <param name="vertices">Source vertices</param>
+	/// <param name="count">Number of vertices</param>
+	/// <param name="palette">Skinning matrices, indexed by the bone numbers of the vertices</param>
+	/// <param name="output">Destination, count entries</param>
+	static void Skin(Implementation implementation, const Vertex* vertices, size_t count, const XMMATRIX* palette,
+		SkinnedVertex* output);
+
+	// The CPU can run the implementation
+	static bool IsSupported(Implementation implementation);
+
+	// Fastest implementation the CPU can run
+	static Implementation GetBestImplementation();
+
+	// Name for reports
+	static const char* GetImplementationName(Implementation implementation);
+
+	/// <summary>
+	/// Report vertices per second of every supported implementation for the vertices of a model,
+	/// and how many results match the scalar reference bit for bit (largest difference otherwise)
+	/// </summary>
+	/// <param name="model">Model whose vertices are skinned (with a generated palette)</param>
+	static void Benchmark(const Model* model);
+
+	/// <summary>
+	/// Dual quaternion skinning, the same blend as the DUAL_QUATERNION_SKINNING variant of ComputeSkin
+	/// </summary>
+	/// <param name="vertices">Source vertices</param>
+	/// <param name="count">Number of vertices</param>
+	/// <param name="palette">Two vectors (real, dual) per bone, indexed by the bone numbers of the vertices</param>
+	/// <param name="output">Destination, count entries (pos.w is 1)</param>
+	static void SkinDualQuaternion(const Vertex* vertices, size_t count, const XMVECTOR* palette, SkinnedVertex* output);
+
+	/// <summary>
+	/// Skin the vertices of a model with both palettes of the skeleton at times over its first clip and report
+	/// the position differences (needs no GPU)
+	/// </summary>
+	/// <param name="model">Skinned model with an animation clip</param>
+	/// <returns>Differences (vertexCount is 0 without a clip)</returns>
+	static DualQuaternionComparison CompareDualQuaternion(const Model* model);
+
+private:
+	static void SkinScalar(const Vertex* vertices, size_t count, const XMMATRIX* palette, SkinnedVertex* output);
+	static void SkinSSE(const Vertex* vertices, size_t count, const XMMATRIX* palette, SkinnedVertex* output);
+	static void SkinAVX2(const Vertex* vertices, size_t count, const XMMATRIX* palette, SkinnedVertex* output);
+};
@@ -0,0 +1,215 @@
+#include "InstancedRenderer.h"
+#include "CountingCommandList.h"
+
+#include <d3dx12.h>
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <functional>
+
+using namespace DirectX;
+
+/// <summary>
+/// Static Member Variable Entity
+/// </summary>
+const int InstancedRenderer::MAX_INSTANCES;
+
+void InstancedRenderer::Initialize()
+{
+	objects.reserve(MAX_INSTANCES);
+}
+
+void InstancedRenderer::Submit(Object3d* object)
+{
+	if (object->model != nullptr)
+	{
+		objects.push_back(object);
+	}
+}
+
+void InstancedRenderer::Flush(DrawQueue* drawQueue)
+{
+	drawCallCount = 0;
+	groups.clear();
+	if (objects.empty())
+	{
+		return;
+	}
+
+	UploadAllocator* uploadAllocator = UploadAllocator::GetInstance();
+
+	// Instances of this frame (room for every object, those drawn one by one leave theirs unused)
+	size_t instanceCapacity = (std::min)(objects.size(), (size_t)MAX_INSTANCES);
+	const UploadAllocator::Allocation instanceAllocation = uploadAllocator->Allocate(sizeof(InstanceData) * instanceCapacity);
+	if (instanceAllocation.cpuAddress == nullptr)
+	{
+		instanceCapacity = 0;
+	}
+	InstanceData* frameInstances = (InstanceData*)instanceAllocation.cpuAddress;
+	const D3D12_GPU_VIRTUAL_ADDRESS instanceAddress = instanceAllocation.gpuAddress;
+
+	// Camera of this frame (the world matrices come from the instances)
+	Object3d::ConstBufferDataTransform frameConstants;
+	frameConstants.viewproj = Object3d::camera->GetViewProjectionMatrix();
+	frameConstants.world = XMMatrixIdentity();
+	frameConstants.cameraPos = Object3d::camera->GetEye();
+	const D3D12_GPU_VIRTUAL_ADDRESS frameAddress = uploadAllocator->Upload(frameConstants);
+
+	// Objects of the same model and palette next to each other
+	std::sort(objects.begin(), objects.end(), [](const Object3d* a, const Object3d* b)
+		{
+			if (a->model != b->model)
+			{
+				return std::less<const Model*>()(a->model, b->model);
+			}
+			return a->paletteAddress < b->paletteAddress;
+		});
+
+	size_t instanceCount = 0;
+	for (size_t begin = 0; begin < objects.size();)
+	{
+		Object3d* first = objects[begin];
+		Model* model = first->model;
+		size_t end = begin + 1;
+		while (end < objects.size() && objects[end]->model == model && objects[end]->paletteAddress == first->paletteAddress)
+		{
+			end++;
+		}
+		const size_t groupSize = end - begin;
+
+		// Objects with their own palette cannot share a draw, neither can objects beyond the instance buffer
+		if (first->paletteAddress == 0 || instanceCount + groupSize > instanceCapacity)
+		{
+			for (size_t i = begin; i < end; i++)
+			{
+				objects[i]->Submit(drawQueue);
+				drawCallCount++;
+			}
+			begin = end;
+			continue;
+		}
+
+		// World matrix and bones of every object of the group
+		const XMMATRIX& modelTransform = model->GetModelTransform();
+		for (size_t i = 0; i < groupSize; i++)
+		{
+			const Object3d* object = objects[begin + i];
+			InstanceData& instance = frameInstances[instanceCount + i];
+			instance.world = modelTransform * object->matWorld;
+			instance.paletteOffset = object->paletteOffset;
+		}
+
+		InstanceGroup group;
+		group.model = model;
+		group.frameAddress = frameAddress;
+		group.instanceAddress = instanceAddress;
+		group.paletteAddress = first->paletteAddress;
+		group.instanceOffset = (UINT)instanceCount;
+		group.instanceCount = (UINT)groupSize;
+		groups.push_back(group);
+
+		instanceCount += groupSize;
+		begin = end;
+	}
+
+	// Packets point into groups, which no longer grows
+	for (const InstanceGroup& group : groups)
+	{
+		DrawQueue::DrawPacket packet;
+		packet.pipelineState =
+			Object3d::instancedPipelinestates[(int)group.model->GetSkinningMode()][(int)group.model->GetVertexFormat()].Get();
+		packet.rootSignature = Object3d::rootsignature.Get();
+		packet.topology = D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST;
+		packet.descriptorHeap = group.model->GetDescriptorHeap();
+		packet.record = RecordGroup;
+		packet.data = &group;
+		packet.key = drawQueue->MakeKey(DrawQueue::Pass::Opaque, packet.pipelineState, group.model, 0.0f);
+		drawQueue->Add(packet);
+		drawCallCount++;
+	}
+
+	objects.clear();
+}
+
+void InstancedRenderer::RecordGroup(ID3D12GraphicsCommandList* cmdList, const void* data)
+{
+	const InstanceGroup* group = (const InstanceGroup*)data;
+
+	// Camera, instances and palette of the group, and its first instance
+	cmdList->SetGraphicsRootConstantBufferView(0, group->frameAddress);
+	cmdList->SetGraphicsRootShaderResourceView(5, group->instanceAddress);
+	cmdList->SetGraphicsRootShaderResourceView(4, group->paletteAddress);
+	cmdList->SetGraphicsRoot32BitConstant(2, group->instanceOffset, 1);
+
+	// One draw per submesh for the whole group
+	group->model->DrawSubmeshes(cmdList, group->instanceCount);
+}
+
+void InstancedRenderer::BenchmarkSubmission(Object3d* object, int objectCount)
+{
+	// Number of timed frames per path
+	const int frameCount = 10;
+
+	// Recording stub: commands are counted and thrown away, no device is involved
+	CountingCommandList cmdList;
+
+	UploadAllocator* uploadAllocator = UploadAllocator::GetInstance();
+
+	// Objects of the same model at different places, sharing one palette like objects of an AnimationSystem
+	// (the address is never read by the GPU)
+	const D3D12_GPU_VIRTUAL_ADDRESS paletteAddress = uploadAllocator->Allocate(sizeof(XMVECTOR)).gpuAddress;
+	std::vector<Object3d> instances(objectCount);
+	for (int i = 0; i < objectCount; i++)
+	{
+		instances[i].SetModel(object->model);
+		instances[i].matWorld = XMMatrixTranslation((float)(i % 100), 0.0f, (float)(i / 100));
+		instances[i].paletteAddress = paletteAddress;
+		instances[i].paletteOffset = 0;
+	}
+
+	// One by one: the same object drawn objectCount times records the same commands as objectCount objects
+	double singleMilliseconds = 0.0;
+	for (int frame = 0; frame < frameCount; frame++)
+	{
+		cmdList.Reset(nullptr, nullptr);
+		uploadAllocator->BeginFrame();
+
+		auto start = std::chrono::steady_clock::now();
+		for (int i = 0; i < objectCount; i++)
+		{
+			object->Draw(&cmdList);
+		}
+		cmdList.Close();
+		auto end = std::chrono::steady_clock::now();
+		singleMilliseconds += std::chrono::duration<double, std::milli>(end - start).count();
+	}
+	singleMilliseconds /= frameCount;
+	const size_t singleCallCount = cmdList.GetCallCount();
+
+	// Instanced: submission, grouping, instance upload, packet sorting and recording
+	DrawQueue drawQueue;
+	double instancedMilliseconds = 0.0;
+	for (int frame = 0; frame < frameCount; frame++)
+	{
+		cmdList.Reset(nullptr, nullptr);
+		uploadAllocator->BeginFrame();
+
+		auto start = std::chrono::steady_clock::now();
+		for (Object3d& instance : instances)
+		{
+			Submit(&instance);
+		}
+		Flush(&drawQueue);
+		drawQueue.Execute(&cmdList);
+		cmdList.Close();
+		auto end = std::chrono::steady_clock::now();
+		instancedMilliseconds += std::chrono::duration<double, std::milli>(end - start).count();
+	}
+	instancedMilliseconds /= frameCount;
+
+	char str[256];
+	sprintf_s(str, "InstancedRenderer: %d objects, one by one %.3f ms (%zu calls), instanced %.3f ms (%zu draws, %zu calls, x%.1f)\n",
+		objectCount, singleMilliseconds, singleCallCount, instancedMilliseconds, drawCallCount, cmdList.GetCallCount(),
+		instancedMilliseconds > 0.0 ? singleMilliseconds / instancedMilliseconds : 0.0);
+	OutputDebugStringA(str);
+}
@@ -0,0 +1,95 @@
+#pragma once
+
+#include "Object3d.h"
+#include "DrawQueue.h"
+#include "UploadAllocator.h"
+
+#include <d3d12.h>
+#include <wrl.h>
+#include <vector>
+
+/// <summary>
+/// Draws Object3d instances sharing a model with one instanced draw per model
+/// The world matrices and palette offsets of the submitted objects are written into a structured buffer in the
+/// UploadAllocator every frame and read by the INSTANCED variant of the vertex shaders.
+/// Objects animated by an AnimationSystem share its palette and are batched; objects using their own palette are
+/// drawn one by one. Every draw goes into a DrawQueue as a packet.
+/// </summary>
+class InstancedRenderer
+{
+private: // Alias
+	// using Microsoft::WRL
+	template <class T> using ComPtr = Microsoft::WRL::ComPtr<T>;
+
+	// Using DirectX::
+	using XMMATRIX = DirectX::XMMATRIX;
+
+public: // Constant
+	// Instances per frame (objects beyond it are drawn one by one)
+	static const int MAX_INSTANCES = 0x4000;
+
+public: // Subclass
+	// Per-object data of an instanced draw (InstanceData in FBX.hlsli)
+	struct InstanceData
+	{
+		XMMATRIX world; // World matrix
+		UINT paletteOffset; // First bone of the object in the palette
+		UINT padding[3];
+	};
+
+private: // Subclass
+	// One instanced draw (data of its draw packet)
+	struct InstanceGroup
+	{
+		Model* model;
+		D3D12_GPU_VIRTUAL_ADDRESS frameAddress;
+		D3D12_GPU_VIRTUAL_ADDRESS instanceAddress;
+		D3D12_GPU_VIRTUAL_ADDRESS paletteAddress;
+		// First instance of the group in the instance buffer
+		UINT instanceOffset;
+		UINT instanceCount;
+	};
+
+public:
+	/// <summary>
+	/// Initialization
+	/// </summary>
+	void Initialize();
+
+	/// <summary>
+	/// Queue an object for this frame's Flush (after its Update)
+	/// </summary>
+	/// <param name="object">Object with a model</param>
+	void Submit(Object3d* object);
+
+	/// <summary>
+	/// Add the draws of the queued objects grouped by model to a DrawQueue and clear the queue
+	/// The packets refer to this renderer until the DrawQueue is executed.
+	/// </summary>
+	/// <param name="drawQueue">Queue executed this frame</param>
+	void Flush(DrawQueue* drawQueue);
+
+	/// <summary>
+	/// Report the command recording time of many objects drawn one by one and instanced
+	/// The commands go into a headless CountingCommandList; every timed frame starts a frame of the UploadAllocator
+	/// (call before the first frame).
+	/// </summary>
+	/// <param name="object">Initialized object with a model, drawn repeatedly</param>
+	/// <param name="objectCount">Number of objects per frame</param>
+	void BenchmarkSubmission(Object3d* object, int objectCount);
+
+	// Model draws of the last Flush (one per group of instances or per object drawn one by one)
+	size_t GetDrawCallCount() const { return drawCallCount; }
+
+private:
+	// Root parameters and draw of a group (record function of its draw packet)
+	static void RecordGroup(ID3D12GraphicsCommandList* cmdList, const void* data);
+
+private:
+	// Objects submitted this frame
+	std::vector<Object3d*> objects;
+	// Instanced draws of this frame
+	std::vector<InstanceGroup> groups;
+	// Model draws of the last Flush
+	size_t drawCallCount = 0;
+};
@@ -1,4 +1,5 @@
 ﻿#include "LightGroup.h"
+#include "UploadAllocator.h"
 #include <assert.h>
 
 using namespace DirectX;
@@ -37,19 +38,6 @@ void LightGroup::Initialize()
 
 	DefaultLightSetting();
 
-	HRESULT result;
-	// 定数バッファの生成
-	result = device->CreateCommittedResource(
-		&CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD), 	// アップロード可能
-		D3D12_HEAP_FLAG_NONE,
-		&CD3DX12_RESOURCE_DESC::Buffer((sizeof(ConstBufferData) + 0xff)&~0xff),
-		D3D12_RESOURCE_STATE_GENERIC_READ,
-		nullptr,
-		IID_PPV_ARGS(&constBuff));
-	if (FAILED(result)){
-		assert(0);
-	}
-
 	// 定数バッファへデータ転送
 	TransferConstBuffer();
 }
@@ -65,79 +53,74 @@ void LightGroup::Update()
 
 void LightGroup::Draw(ID3D12GraphicsCommandList * cmdList, UINT rootParameterIndex)
 {
-	// 定数バッファビューをセット
-	cmdList->SetGraphicsRootConstantBufferView(rootParameterIndex, constBuff->GetGPUVirtualAddress());
+	// 今フレームの定数バッファへコピーしてビューをセット
+	cmdList->SetGraphicsRootConstantBufferView(rootParameterIndex, UploadAllocator::GetInstance()->Upload(constData));
 }
 
 void LightGroup::TransferConstBuffer()
 {
-	HRESULT result;
-	// 定数バッファへデータ転送
-	ConstBufferData* constMap = nullptr;
-	result = constBuff->Map(0, nullptr, (void**)&constMap);
-	if (SUCCEEDED(result)) {
-		// 環境光
-		constMap->ambientColor = ambientColor;
-		// 平行光源
-		for (int i = 0; i < DirLightNum; i++) {
-			// ライトが有効なら設定を転送
-			if (dirLights[i].IsActive()) {
-				constMap->dirLights[i].active = 1;
-				constMap->dirLights[i].lightv = -dirLights[i].GetLightDir();
-				constMap->dirLights[i].lightcolor = dirLights[i].GetLightColor();
-			}
-			// ライトが無効ならライト色を0に
-			else {
-				constMap->dirLights[i].active = 0;
-			}
+	// 定数バッファのデータを更新(転送は描画時)
+	ConstBufferData* constMap = &constData;
+	// 環境光
+	constMap->ambientColor = ambientColor;
+	// 平行光源
+	for (int i = 0; i < DirLightNum; i++) {
+		// ライトが有効なら設定を転送
+		if (dirLights[i].IsActive()) {
+			constMap->dirLights[i].active = 1;
+			constMap->dirLights[i].lightv = -dirLights[i].GetLightDir();
+			constMap->dirLights[i].lightcolor = dirLights[i].GetLightColor();
+		}
+		// ライトが無効ならライト色を0に
+		else {
+			constMap->dirLights[i].active = 0;
+		}
+	}
+	// 点光源
+	for (int i = 0; i < PointLightNum; i++) {
+		// ライトが有効なら設定を転送
+		if (pointLights[i].IsActive()) {
+			constMap->pointLights[i].active = 1;
+			constMap->pointLights[i].lightpos = pointLights[i].GetLightPos();
+			constMap->pointLights[i].lightcolor = pointLights[i].GetLightColor();
+			constMap->pointLights[i].lightatten = pointLights[i].GetLightAtten();
+		}
+		// ライトが無効ならライト色を0に
+		else {
+			constMap->pointLights[i].active = 0;
 		}
-		// 点光源
-		for (int i = 0; i < PointLightNum; i++) {
-			// ライトが有効なら設定を転送
-			if (pointLights[i].IsActive()) {
-				constMap->pointLights[i].active = 1;
-				constMap->pointLights[i].lightpos = pointLights[i].GetLightPos();
-				constMap->pointLights[i].lightcolor = pointLights[i].GetLightColor();
-				constMap->pointLights[i].lightatten = pointLights[i].GetLightAtten();
-			}
-			// ライトが無効ならライト色を0に
-			else {
-				constMap->pointLights[i].active = 0;
-			}
+	}
+	// スポットライト
+	for (int i = 0; i < SpotLightNum; i++) {
+		// ライトが有効なら設定を転送
+		if (spotLights[i].IsActive()) {
+			constMap->spotLights[i].active = 1;
+			constMap->spotLights[i].lightv = -spotLights[i].GetLightDir();
+			constMap->spotLights[i].lightpos = spotLights[i].GetLightPos();
+			constMap->spotLights[i].lightcolor = spotLights[i].GetLightColor();
+			constMap->spotLights[i].lightatten = spotLights[i].GetLightAtten();
+			constMap->spotLights[i].lightfactoranglecos = spotLights[i].GetLightFactorAngleCos();
 		}
-		// スポットライト
-		for (int i = 0; i < SpotLightNum; i++) {
-			// ライトが有効なら設定を転送
-			if (spotLights[i].IsActive()) {
-				constMap->spotLights[i].active = 1;
-				constMap->spotLights[i].lightv = -spotLights[i].GetLightDir();
-				constMap->spotLights[i].lightpos = spotLights[i].GetLightPos();
-				constMap->spotLights[i].lightcolor = spotLights[i].GetLightColor();
-				constMap->spotLights[i].lightatten = spotLights[i].GetLightAtten();
-				constMap->spotLights[i].lightfactoranglecos = spotLights[i].GetLightFactorAngleCos();
-			}
-			// ライトが無効ならライト色を0に
-			else {
-				constMap->spotLights[i].active = 0;
-			}
+		// ライトが無効ならライト色を0に
+		else {
+			constMap->spotLights[i].active = 0;
+		}
+	}
+	// 丸影
+	for (int i = 0; i < CircleShadowNum; i++) {
+		// 有効なら設定を転送
+		if (circleShadows[i].IsActive()) {
+			constMap->circleShadows[i].active = 1;
+			constMap->circleShadows[i].dir = -circleShadows[i].GetDir();
+			constMap->circleShadows[i].casterPos = circleShadows[i].GetCasterPos();
+			constMap->circleShadows[i].distanceCasterLight = circleShadows[i].GetDistanceCasterLight();
+			constMap->circleShadows[i].atten = circleShadows[i].GetAtten();
+			constMap->circleShadows[i].factorAngleCos = circleShadows[i].GetFactorAngleCos();
 		}
-		// 丸影
-		for (int i = 0; i < CircleShadowNum; i++) {
-			// 有効なら設定を転送
-			if (circleShadows[i].IsActive()) {
-				constMap->circleShadows[i].active = 1;
-				constMap->circleShadows[i].dir = -circleShadows[i].GetDir();
-				constMap->circleShadows[i].casterPos = circleShadows[i].GetCasterPos();
-				constMap->circleShadows[i].distanceCasterLight = circleShadows[i].GetDistanceCasterLight();
-				constMap->circleShadows[i].atten = circleShadows[i].GetAtten();
-				constMap->circleShadows[i].factorAngleCos = circleShadows[i].GetFactorAngleCos();
-			}
-			// 無効なら色を0に
-			else {
-				constMap->circleShadows[i].active = 0;
-			}
+		// 無効なら色を0に
+		else {
+			constMap->circleShadows[i].active = 0;
 		}
-		constBuff->Unmap(0, nullptr);
 	}
 }
 
@@ -237,8 +237,8 @@ public: // メンバ関数
 	void SetCircleShadowFactorAngle(int index, const XMFLOAT2& lightFactorAngle);
 
 private: // メンバ変数
-	// 定数バッファ
-	ComPtr<ID3D12Resource> constBuff;
+	// 定数バッファのデータ(描画のたびにアップロードアロケータへコピー)
+	ConstBufferData constData{};
 
 	// 環境光の色
 	XMFLOAT3 ambientColor = { 1,1,1 };
@@ -0,0 +1,574 @@
+#include "MeshOptimizer.h"
+
+#include <Windows.h>
+#include <algorithm>
+#include <cfloat>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+using namespace DirectX;
+
+/// <summary>
+/// Static Member Variable Entity
+/// </summary>
+const int MeshOptimizer::OPTIMIZE_CACHE_SIZE;
+const int MeshOptimizer::ANALYZE_CACHE_SIZE;
+const int MeshOptimizer::ANALYZE_VIEWPORT_SIZE;
+
+// Score of a vertex in the Forsyth algorithm
+static float ForsythVertexScore(int cachePosition, uint32_t remainingTriangles)
+{
+	// Vertex no longer used by any triangle
+	if (remainingTriangles == 0)
+	{
+		return -1.0f;
+	}
+
+	float score = 0.0f;
+	if (cachePosition >= 0)
+	{
+		// The last triangle's vertices get a fixed score so that strips are not preferred over fans
+		if (cachePosition < 3)
+		{
+			score = 0.75f;
+		}
+		// Decreasing score towards the end of the cache
+		else
+		{
+			const float scaler = 1.0f / (MeshOptimizer::OPTIMIZE_CACHE_SIZE - 3);
+			score = powf(1.0f - (cachePosition - 3) * scaler, 1.5f);
+		}
+	}
+
+	// Bonus for vertices with few remaining triangles, to finish them off quickly
+	score += 2.0f / sqrtf((float)remainingTriangles);
+
+	return score;
+}
+
+void MeshOptimizer::OptimizeVertexCache(uint32_t* indices, size_t indexCount, size_t vertexCount)
+{
+	const size_t triangleCount = indexCount / 3;
+	if (triangleCount == 0)
+	{
+		return;
+	}
+
+	// Triangles using each vertex (adjacency, compressed into one array)
+	std::vector<uint32_t> remaining(vertexCount, 0);
+	for (size_t i = 0; i < triangleCount * 3; i++)
+	{
+		remaining[indices[i]]++;
+	}
+	std::vector<uint32_t> offsets(vertexCount + 1, 0);
+	for (size_t v = 0; v < vertexCount; v++)
+	{
+		offsets[v + 1] = offsets[v] + remaining[v];
+	}
+	std::vector<uint32_t> adjacency(triangleCount * 3);
+	{
+		std::vector<uint32_t> fill(offsets.begin(), offsets.end() - 1);
+		for (size_t i = 0; i < triangleCount * 3; i++)
+		{
+			adjacency[fill[indices[i]]++] = (uint32_t)(i / 3);
+		}
+	}
+
+	// Initial scores
+	std::vector<int> cachePosition(vertexCount, -1);
+	std::vector<float> vertexScore(vertexCount);
+	for (size_t v = 0; v < vertexCount; v++)
+	{
+		vertexScore[v] = ForsythVertexScore(-1, remaining[v]);
+	}
+	std::vector<float> triangleScore(triangleCount);
+	for (size_t t = 0; t < triangleCount; t++)
+	{
+		triangleScore[t] = vertexScore[indices[t * 3]] + vertexScore[indices[t * 3 + 1]] + vertexScore[indices[t * 3 + 2]];
+	}
+
+	std::vector<char> emitted(triangleCount, 0);
+	std::vector<uint32_t> output;
+	output.reserve(triangleCount * 3);
+
+	// Modelled LRU cache (3 extra entries while a triangle is being added)
+	uint32_t cache[OPTIMIZE_CACHE_SIZE + 3];
+	uint32_t newCache[OPTIMIZE_CACHE_SIZE + 3];
+	int cacheCount = 0;
+
+	// Start from the best triangle overall
+	int bestTriangle = (int)(std::max_element(triangleScore.begin(), triangleScore.end()) - triangleScore.begin());
+	size_t scanCursor = 0;
+
+	for (size_t emittedCount = 0; emittedCount < triangleCount; emittedCount++)
+	{
+		// No candidate in the cache, continue with the next unused triangle in the input order
+		if (bestTriangle < 0)
+		{
+			while (emitted[scanCursor])
+			{
+				scanCursor++;
+			}
+			bestTriangle = (int)scanCursor;
+		}
+
+		// Emit the triangle
+		const uint32_t* triangle = indices + bestTriangle * 3;
+		output.insert(output.end(), triangle, triangle + 3);
+		emitted[bestTriangle] = 1;
+
+		// Remove it from the adjacency of its vertices
+		for (int i = 0; i < 3; i++)
+		{
+			const uint32_t v = triangle[i];
+			uint32_t* list = &adjacency[offsets[v]];
+			for (uint32_t j = 0; j < remaining[v]; j++)
+			{
+				if (list[j] == (uint32_t)bestTriangle)
+				{
+					std::swap(list[j], list[remaining[v] - 1]);
+					break;
+				}
+			}
+			remaining[v]--;
+		}
+
+		// Move the triangle's vertices to the front of the cache
+		int newCacheCount = 0;
+		for (int i = 0; i < 3; i++)
+		{
+			newCache[newCacheCount++] = triangle[i];
+		}
+		for (int i = 0; i < cacheCount; i++)
+		{
+			const uint32_t v = cache[i];
+			if (v != triangle[0] && v != triangle[1] && v != triangle[2])
+			{
+				newCache[newCacheCount++] = v;
+			}
+		}
+
+		// Update the scores of every vertex that moved (evicted ones included)
+		for (int i = 0; i < newCacheCount; i++)
+		{
+			const uint32_t v = newCache[i];
+			cachePosition[v] = i < OPTIMIZE_CACHE_SIZE ? i : -1;
+
+			const float score = ForsythVertexScore(cachePosition[v], remaining[v]);
+			const float difference = score - vertexScore[v];
+			vertexScore[v] = score;
+
+			const uint32_t* list = &adjacency[offsets[v]];
+			for (uint32_t j = 0; j < remaining[v]; j++)
+			{
+				triangleScore[list[j]] += difference;
+			}
+		}
+
+		// Next triangle: the best one among those using a cached vertex
+		bestTriangle = -1;
+		float bestScore = -1.0f;
+		cacheCount = (std::min)(newCacheCount, OPTIMIZE_CACHE_SIZE);
+		for (int i = 0; i < cacheCount; i++)
+		{
+			const uint32_t v = newCache[i];
+			cache[i] = v;
+
+			const uint32_t* list = &adjacency[offsets[v]];
+			for (uint32_t j = 0; j < remaining[v]; j++)
+			{
+				if (triangleScore[list[j]] > bestScore)
+				{
+					bestScore = triangleScore[list[j]];
+					bestTriangle = (int)list[j];
+				}
+			}
+		}
+	}
+
+	std::copy(output.begin(), output.end(), indices);
+}
+
+void MeshOptimizer::OptimizeOverdraw(uint32_t* indices, size_t indexCount,
+	const XMFLOAT3* positions, size_t vertexStride, size_t vertexCount, float threshold)
+{
+	const size_t triangleCount = indexCount / 3;
+	if (triangleCount < 2)
+	{
+		return;
+	}
+
+	// Position of a vertex
+	auto position = [&](uint32_t v)
+	{
+		return XMLoadFloat3(reinterpret_cast<const XMFLOAT3*>(reinterpret_cast<const char*>(positions) + v * vertexStride));
+	};
+
+	// FIFO cache misses of a triangle
+	std::vector<uint32_t> cacheTimestamp(vertexCount, 0);
+	uint32_t timestamp = ANALYZE_CACHE_SIZE + 1;
+	auto countMisses = [&](size_t t)
+	{
+		int misses = 0;
+		for (int i = 0; i < 3; i++)
+		{
+			const uint32_t v = indices[t * 3 + i];
+			if (timestamp - cacheTimestamp[v] > (uint32_t)ANALYZE_CACHE_SIZE)
+			{
+				cacheTimestamp[v] = timestamp++;
+				misses++;
+			}
+		}
+		return misses;
+	};
+	// Start over with an empty cache
+	auto resetCache = [&]()
+	{
+		timestamp += ANALYZE_CACHE_SIZE + 1;
+	};
+
+	// Hard borders: triangles where all three vertices miss the cache
+	std::vector<uint32_t> hardStarts;
+	for (size_t t = 0; t < triangleCount; t++)
+	{
+		if (countMisses(t) == 3)
+		{
+			hardStarts.push_back((uint32_t)t);
+		}
+	}
+	if (hardStarts.empty() || hardStarts[0] != 0)
+	{
+		hardStarts.insert(hardStarts.begin(), 0);
+	}
+	hardStarts.push_back((uint32_t)triangleCount);
+
+	// Soft borders: close a cluster as soon as its own ACMR is within threshold of the hard cluster's
+	std::vector<uint32_t> clusterStarts;
+	for (size_t h = 0; h + 1 < hardStarts.size(); h++)
+	{
+		const uint32_t hardStart = hardStarts[h];
+		const uint32_t hardEnd = hardStarts[h + 1];
+
+		resetCache();
+		size_t hardMisses = 0;
+		for (uint32_t t = hardStart; t < hardEnd; t++)
+		{
+			hardMisses += countMisses(t);
+		}
+		const float clusterThreshold = threshold * hardMisses / (hardEnd - hardStart);
+
+		resetCache();
+		uint32_t start = hardStart;
+		size_t misses = 0;
+		clusterStarts.push_back(start);
+		for (uint32_t t = hardStart; t < hardEnd; t++)
+		{
+			misses += countMisses(t);
+			if (t + 1 < hardEnd && (float)misses / (t + 1 - start) <= clusterThreshold)
+			{
+				start = t + 1;
+				misses = 0;
+				clusterStarts.push_back(start);
+				resetCache();
+			}
+		}
+	}
+	if (clusterStarts.size() < 2)
+	{
+		return;
+	}
+	clusterStarts.push_back((uint32_t)triangleCount);
+
+	// Cluster centroids and area weighted normals
+	const size_t clusterCount = clusterStarts.size() - 1;
+	std::vector<XMFLOAT3> clusterCentroids(clusterCount);
+	std::vector<XMFLOAT3> clusterNormals(clusterCount);
+	XMVECTOR meshCentroid = XMVectorZero();
+	for (size_t c = 0; c < clusterCount; c++)
+	{
+		XMVECTOR centroid = XMVectorZero();
+		XMVECTOR normal = XMVectorZero();
+		for (uint32_t t = clusterStarts[c]; t < clusterStarts[c + 1]; t++)
+		{
+			XMVECTOR p0 = position(indices[t * 3]);
+			XMVECTOR p1 = position(indices[t * 3 + 1]);
+			XMVECTOR p2 = position(indices[t * 3 + 2]);
+			centroid += p0 + p1 + p2;
+			normal += XMVector3Cross(p1 - p0, p2 - p0);
+		}
+		centroid /= (float)((clusterStarts[c + 1] - clusterStarts[c]) * 3);
+		meshCentroid += centroid;
+		XMStoreFloat3(&clusterCentroids[c], centroid);
+		XMStoreFloat3(&clusterNormals[c], normal);
+	}
+	meshCentroid /= (float)clusterCount;
+
+	// Clusters facing away from the mesh centre are likely to occlude the others: draw them first
+	std::vector<float> sortKeys(clusterCount);
+	for (size_t c = 0; c < clusterCount; c++)
+	{
+		XMVECTOR offset = XMLoadFloat3(&clusterCentroids[c]) - meshCentroid;
+		XMVECTOR normal = XMVector3Normalize(XMLoadFloat3(&clusterNormals[c]));
+		sortKeys[c] = XMVectorGetX(XMVector3Dot(offset, normal));
+	}
+	std::vector<uint32_t> clusterOrder(clusterCount);
+	for (size_t c = 0; c < clusterCount; c++)
+	{
+		clusterOrder[c] = (uint32_t)c;
+	}
+	std::stable_sort(clusterOrder.begin(), clusterOrder.end(),
+		[&](uint32_t lhs, uint32_t rhs)
+		{
+			return sortKeys[lhs] > sortKeys[rhs];
+		});
+
+	// Rebuild the index list in cluster order
+	std::vector<uint32_t> output;
+	output.reserve(triangleCount * 3);
+	for (uint32_t c : clusterOrder)
+	{
+		output.insert(output.end(), indices + clusterStarts[c] * 3, indices + clusterStarts[c + 1] * 3);
+	}
+	std::copy(output.begin(), output.end(), indices);
+}
+
+void MeshOptimizer::BuildVertexFetchRemap(uint32_t* indices, size_t indexCount, uint32_t* remap, uint32_t& nextVertex)
+{
+	for (size_t i = 0; i < indexCount; i++)
+	{
+		uint32_t& index = indices[i];
+
+		// First use of this vertex
+		if (remap[index] == UINT32_MAX)
+		{
+			remap[index] = nextVertex++;
+		}
+		index = remap[index];
+	}
+}
+
+MeshOptimizer::VertexCacheStats MeshOptimizer::AnalyzeVertexCache(const uint32_t* indices, size_t indexCount, size_t vertexCount)
+{
+	VertexCacheStats stats;
+
+	const size_t triangleCount = indexCount / 3;
+	if (triangleCount == 0)
+	{
+		return stats;
+	}
+
+	// FIFO cache simulated with timestamps
+	std::vector<uint32_t> cacheTimestamp(vertexCount, 0);
+	std::vector<char> referenced(vertexCount, 0);
+	uint32_t timestamp = ANALYZE_CACHE_SIZE + 1;
+	size_t misses = 0;
+	size_t uniqueVertices = 0;
+
+	for (size_t i = 0; i < triangleCount * 3; i++)
+	{
+		const uint32_t v = indices[i];
+		if (timestamp - cacheTimestamp[v] > (uint32_t)ANALYZE_CACHE_SIZE)
+		{
+			cacheTimestamp[v] = timestamp++;
+			misses++;
+		}
+		if (!referenced[v])
+		{
+			referenced[v] = 1;
+			uniqueVertices++;
+		}
+	}
+
+	stats.acmr = (float)misses / triangleCount;
+	stats.atvr = (float)misses / uniqueVertices;
+
+	return stats;
+}
+
+MeshOptimizer::OverdrawStats MeshOptimizer::AnalyzeOverdraw(const uint32_t* indices, size_t indexCount,
+	const XMFLOAT3* positions, size_t vertexStride, size_t vertexCount)
+{
+	OverdrawStats stats;
+
+	const size_t triangleCount = indexCount / 3;
+	if (triangleCount == 0)
+	{
+		return stats;
+	}
+
+	// Position of a vertex
+	auto position = [&](uint32_t v)
+	{
+		return *reinterpret_cast<const XMFLOAT3*>(reinterpret_cast<const char*>(positions) + v * vertexStride);
+	};
+
+	// Box of the referenced vertices, scaled uniformly to [0, 1]
+	XMFLOAT3 boxMin(FLT_MAX, FLT_MAX, FLT_MAX);
+	XMFLOAT3 boxMax(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+	for (size_t i = 0; i < triangleCount * 3; i++)
+	{
+		const XMFLOAT3 p = position(indices[i]);
+		boxMin = XMFLOAT3((std::min)(boxMin.x, p.x), (std::min)(boxMin.y, p.y), (std::min)(boxMin.z, p.z));
+		boxMax = XMFLOAT3((std::max)(boxMax.x, p.x), (std::max)(boxMax.y, p.y), (std::max)(boxMax.z, p.z));
+	}
+	const float extent = (std::max)({ boxMax.x - boxMin.x, boxMax.y - boxMin.y, boxMax.z - boxMin.z, FLT_MIN });
+	const float scale = 1.0f / extent;
+
+	std::vector<float> depthBuffer(ANALYZE_VIEWPORT_SIZE * ANALYZE_VIEWPORT_SIZE);
+	size_t coveredCount = 0;
+	size_t shadedCount = 0;
+
+	// Looking along each axis from both sides
+	for (int view = 0; view < 6; view++)
+	{
+		const int axis = view / 2;
+		const bool flip = (view & 1) != 0;
+		std::fill(depthBuffer.begin(), depthBuffer.end(), FLT_MAX);
+
+		for (size_t t = 0; t < triangleCount; t++)
+		{
+			// Screen position and depth of the corners (mirroring x for the opposite side keeps the winding meaning)
+			float x[3], y[3], z[3];
+			for (int i = 0; i < 3; i++)
+			{
+				const XMFLOAT3 p = position(indices[t * 3 + i]);
+				const float local[3] = { (p.x - boxMin.x) * scale, (p.y - boxMin.y) * scale, (p.z - boxMin.z) * scale };
+				x[i] = local[(axis + 1) % 3];
+				y[i] = local[(axis + 2) % 3];
+				z[i] = local[axis];
+				if (flip)
+				{
+					x[i] = 1.0f - x[i];
+					z[i] = 1.0f - z[i];
+				}
+				x[i] *= ANALYZE_VIEWPORT_SIZE;
+				y[i] *= ANALYZE_VIEWPORT_SIZE;
+			}
+
+			// Front faces are clockwise on the screen as in Direct3D, back faces and degenerate triangles are culled
+			float area = (x[1] - x[0]) * (y[2] - y[0]) - (y[1] - y[0]) * (x[2] - x[0]);
+			if (area >= 0.0f)
+			{
+				continue;
+			}
+			// Counterclockwise from here on so that the edge functions are positive inside
+			std::swap(x[1], x[2]);
+			std::swap(y[1], y[2]);
+			std::swap(z[1], z[2]);
+			area = -area;
+
+			// Pixel centres inside the triangle
+			const int minX = (std::max)((int)floorf((std::min)({ x[0], x[1], x[2] })), 0);
+			const int maxX = (std::min)((int)ceilf((std::max)({ x[0], x[1], x[2] })), ANALYZE_VIEWPORT_SIZE - 1);
+			const int minY = (std::max)((int)floorf((std::min)({ y[0], y[1], y[2] })), 0);
+			const int maxY = (std::min)((int)ceilf((std::max)({ y[0], y[1], y[2] })), ANALYZE_VIEWPORT_SIZE - 1);
+			for (int py = minY; py <= maxY; py++)
+			{
+				const float cy = py + 0.5f;
+				for (int px = minX; px <= maxX; px++)
+				{
+					const float cx = px + 0.5f;
+					const float w0 = (x[2] - x[1]) * (cy - y[1]) - (y[2] - y[1]) * (cx - x[1]);
+					const float w1 = (x[0] - x[2]) * (cy - y[2]) - (y[0] - y[2]) * (cx - x[2]);
+					const float w2 = (x[1] - x[0]) * (cy - y[0]) - (y[1] - y[0]) * (cx - x[0]);
+					if (w0 < 0.0f || w1 < 0.0f || w2 < 0.0f)
+					{
+						continue;
+					}
+
+					// Depth test
+					const float depth = (w0 * z[0] + w1 * z[1] + w2 * z[2]) / area;
+					float& stored = depthBuffer[py * ANALYZE_VIEWPORT_SIZE + px];
+					if (depth < stored)
+					{
+						if (stored == FLT_MAX)
+						{
+							coveredCount++;
+						}
+						stored = depth;
+						shadedCount++;
+					}
+				}
+			}
+		}
+	}
+
+	stats.overdraw = coveredCount ? (float)shadedCount / coveredCount : 0.0f;
+
+	return stats;
+}
+
+void MeshOptimizer::Benchmark(int slices)
+{
+	// Tessellation of the sphere
+	slices = (std::max)(slices, 4);
+	const int stacks = slices / 2;
+
+	// Radius displaced by bumps, so that parts of the surface hide others
+	std::vector<XMFLOAT3> positions;
+	std::vector<uint32_t> indices;
+	positions.reserve((size_t)(slices + 1) * (stacks + 1));
+	indices.reserve((size_t)slices * stacks * 6);
+	for (int stack = 0; stack <= stacks; stack++)
+	{
+		const float theta = XM_PI * stack / stacks;
+		for (int slice = 0; slice <= slices; slice++)
+		{
+			const float phi = XM_2PI * slice / slices;
+			const float radius = 1.0f + 0.3f * sinf(6.0f * theta) * sinf(6.0f * phi);
+			positions.push_back(XMFLOAT3(radius * sinf(theta) * cosf(phi), radius * cosf(theta), radius * sinf(theta) * sinf(phi)));
+		}
+	}
+	for (int stack = 0; stack < stacks; stack++)
+	{
+		for (int slice = 0; slice < slices; slice++)
+		{
+			// Clockwise seen from outside
+			const uint32_t v0 = stack * (slices + 1) + slice;
+			const uint32_t v1 = v0 + slices + 1;
+			const uint32_t quad[6] = { v0, v0 + 1, v1, v1, v0 + 1, v1 + 1 };
+			indices.insert(indices.end(), quad, quad + 6);
+		}
+	}
+
+	// Triangles in no particular order, as exported meshes often are
+	std::mt19937 random(12345);
+	const size_t triangleCount = indices.size() / 3;
+	for (size_t t = triangleCount - 1; t > 0; t--)
+	{
+		const size_t other = random() % (t + 1);
+		std::swap_ranges(indices.begin() + t * 3, indices.begin() + t * 3 + 3, indices.begin() + other * 3);
+	}
+
+	const VertexCacheStats cacheBefore = AnalyzeVertexCache(indices.data(), indices.size(), positions.size());
+	const OverdrawStats overdrawBefore = AnalyzeOverdraw(indices.data(), indices.size(), positions.data(), sizeof(XMFLOAT3), positions.size());
+
+	auto cacheStart = std::chrono::steady_clock::now();
+	OptimizeVertexCache(indices.data(), indices.size(), positions.size());
+	auto cacheEnd = std::chrono::steady_clock::now();
+
+	// Vertex cache order alone (the timing of the overdraw pass starts after this analysis)
+	const VertexCacheStats cacheOnly = AnalyzeVertexCache(indices.data(), indices.size(), positions.size());
+	const OverdrawStats overdrawCacheOnly = AnalyzeOverdraw(indices.data(), indices.size(), positions.data(), sizeof(XMFLOAT3), positions.size());
+
+	auto overdrawStart = std::chrono::steady_clock::now();
+	OptimizeOverdraw(indices.data(), indices.size(), positions.data(), sizeof(XMFLOAT3), positions.size());
+	auto overdrawEnd = std::chrono::steady_clock::now();
+
+	const VertexCacheStats cacheAfter = AnalyzeVertexCache(indices.data(), indices.size(), positions.size());
+	const OverdrawStats overdrawAfter = AnalyzeOverdraw(indices.data(), indices.size(), positions.data(), sizeof(XMFLOAT3), positions.size());
+
+	char str[256];
+	sprintf_s(str, "MeshOptimizer: bumpy sphere, %zu triangles, vertex cache %.3f ms, overdraw %.3f ms\n",
+		triangleCount,
+		std::chrono::duration<double, std::milli>(cacheEnd - cacheStart).count(),
+		std::chrono::duration<double, std::milli>(overdrawEnd - overdrawStart).count());
+	OutputDebugStringA(str);
+	sprintf_s(str, "MeshOptimizer: ACMR %.3f -> %.3f -> %.3f, ATVR %.3f -> %.3f -> %.3f, overdraw %.3f -> %.3f -> %.3f (source, vertex cache, overdraw)\n",
+		cacheBefore.acmr, cacheOnly.acmr, cacheAfter.acmr, cacheBefore.atvr, cacheOnly.atvr, cacheAfter.atvr,
+		overdrawBefore.overdraw, overdrawCacheOnly.overdraw, overdrawAfter.overdraw);
+	OutputDebugStringA(str);
+}
@@ -0,0 +1,101 @@
+#pragma once
+
+#include <DirectXMath.h>
+
+#include <cstddef>
+#include <cstdint>
+
+/// <summary>
+/// CPU-side triangle and vertex reordering for better GPU cache use
+/// All index arrays are triangle lists; vertex indices must be below vertexCount
+/// </summary>
+class MeshOptimizer
+{
+public: // Constant
+	// Size of the LRU cache modelled by the vertex cache optimisation
+	static const int OPTIMIZE_CACHE_SIZE = 32;
+
+	// Size of the FIFO cache used to report statistics
+	static const int ANALYZE_CACHE_SIZE = 16;
+
+	// Width and height in pixels of the views rasterised to report overdraw
+	static const int ANALYZE_VIEWPORT_SIZE = 256;
+
+public: // Subclass
+	// Post-transform vertex cache statistics
+	struct VertexCacheStats
+	{
+		// Average cache miss ratio (transformed vertices per triangle, 0.5 - 3.0)
+		float acmr = 0.0f;
+		// Average transform to vertex ratio (transformed vertices per referenced vertex, 1.0 or more)
+		float atvr = 0.0f;
+	};
+
+	// Overdraw statistics
+	struct OverdrawStats
+	{
+		// Pixels shaded per covered pixel (1.0 or more), averaged over six axis aligned views
+		float overdraw = 0.0f;
+	};
+
+public: // Static member functions
+	/// <summary>
+	/// Reorder triangles for the post-transform vertex cache (Tom Forsyth's linear-speed algorithm)
+	/// </summary>
+	/// <param name="indices">Triangle list indices (rewritten in place)</param>
+	/// <param name="indexCount">Number of indices</param>
+	/// <param name="vertexCount">Number of addressable vertices</param>
+	static void OptimizeVertexCache(uint32_t* indices, size_t indexCount, size_t vertexCount);
+
+	/// <summary>
+	/// Reorder clusters of cache-optimised triangles so that outward facing ones are drawn first
+	/// Clusters start where the triangle order restarts the cache and are split further wherever the ACMR of
+	/// the part so far is within threshold of the ACMR of the whole cluster, so the ACMR grows by threshold at most
+	/// </summary>
+	/// <param name="indices">Triangle list indices, already vertex cache optimised (rewritten in place)</param>
+	/// <param name="indexCount">Number of indices</param>
+	/// <param name="positions">Vertex positions (first element of each vertex)</param>
+	/// <param name="vertexStride">Byte distance between two positions</param>
+	/// <param name="vertexCount">Number of addressable vertices</param>
+	/// <param name="threshold">Allowed ACMR growth factor (1.05 allows 5%)</param>
+	static void OptimizeOverdraw(uint32_t* indices, size_t indexCount,
+		const DirectX::XMFLOAT3* positions, size_t vertexStride, size_t vertexCount, float threshold = 1.05f);
+
+	/// <summary>
+	/// Build a vertex order following the first use by the indices, and rewrite the indices to it
+	/// </summary>
+	/// <param name="indices">Triangle list indices (rewritten in place)</param>
+	/// <param name="indexCount">Number of indices</param>
+	/// <param name="remap">Receives new index per old vertex; entries already set (not UINT32_MAX) are kept</param>
+	/// <param name="nextVertex">Next free new vertex index (advanced)</param>
+	static void BuildVertexFetchRemap(uint32_t* indices, size_t indexCount, uint32_t* remap, uint32_t& nextVertex);
+
+	/// <summary>
+	/// Simulate a FIFO post-transform cache and compute ACMR/ATVR
+	/// </summary>
+	/// <param name="indices">Triangle list indices</param>
+	/// <param name="indexCount">Number of indices</param>
+	/// <param name="vertexCount">Number of addressable vertices</param>
+	/// <returns>Statistics</returns>
+	static VertexCacheStats AnalyzeVertexCache(const uint32_t* indices, size_t indexCount, size_t vertexCount);
+
+	/// <summary>
+	/// Rasterise the triangles in index order from the six axis directions (back faces culled, depth test on)
+	/// and count how often each covered pixel is shaded
+	/// </summary>
+	/// <param name="indices">Triangle list indices</param>
+	/// <param name="indexCount">Number of indices</param>
+	/// <param name="positions">Vertex positions (first element of each vertex)</param>
+	/// <param name="vertexStride">Byte distance between two positions</param>
+	/// <param name="vertexCount">Number of addressable vertices</param>
+	/// <returns>Statistics</returns>
+	static OverdrawStats AnalyzeOverdraw(const uint32_t* indices, size_t indexCount,
+		const DirectX::XMFLOAT3* positions, size_t vertexStride, size_t vertexCount);
+
+	/// <summary>
+	/// Optimise a generated bumpy sphere (self-occluding) with shuffled triangles and report
+	/// ACMR, ATVR and overdraw before and after, and the optimisation times
+	/// </summary>
+	/// <param name="slices">Segments around the sphere (slices x slices triangles)</param>
+	static void Benchmark(int slices);
+};
@@ -1,17 +1,105 @@
 #include "Model.h"
+#include "FbxLoader/FbxLoader.h"
+#include "VertexWelder.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cfloat>
+#include <chrono>
+#include <climits>
+#include <cmath>
+#include <cstring>
+#include <DirectXPackedVector.h>
+
+using namespace DirectX;
+
+/// <summary>
+/// Static Member Variable Entity
+/// </summary>
+bool Model::preferShortIndices = true;
+
+const size_t Model::MAX_COMPACT_BONES;
+const size_t Model::STREAMING_RESIDENT_SIZE;
+const size_t Model::STREAMING_BUDGET;
+const UINT Model::VIEWS_PER_MATERIAL;
+
+// Float in [-1, 1] to snorm16
+static int16_t EncodeSnorm16(float value)
+{
+	value = (std::min)((std::max)(value, -1.0f), 1.0f);
+	return (int16_t)lroundf(value * 32767.0f);
+}
+
+// Float in [0, 1] to unorm16
+static uint16_t EncodeUnorm16(float value)
+{
+	value = (std::min)((std::max)(value, 0.0f), 1.0f);
+	return (uint16_t)lroundf(value * 65535.0f);
+}
+
+// Unit vector to octahedral encoding (both components in [-1, 1])
+static XMFLOAT2 EncodeOctahedral(XMFLOAT3 n)
+{
+	const float length = fabsf(n.x) + fabsf(n.y) + fabsf(n.z);
+	if (length == 0.0f)
+	{
+		return XMFLOAT2(0.0f, 0.0f);
+	}
+	XMFLOAT2 e(n.x / length, n.y / length);
+
+	// Fold the lower hemisphere over the diagonals
+	if (n.z < 0.0f)
+	{
+		const float x = e.x;
+		e.x = (1.0f - fabsf(e.y)) * (x >= 0.0f ? 1.0f : -1.0f);
+		e.y = (1.0f - fabsf(x)) * (e.y >= 0.0f ? 1.0f : -1.0f);
+	}
+	return e;
+}
+
+// Octahedral encoding to unit vector (same as DecodeOctahedral in FBX.hlsli)
+static XMVECTOR DecodeOctahedral(float x, float y)
+{
+	float z = 1.0f - fabsf(x) - fabsf(y);
+	const float t = (std::max)(-z, 0.0f);
+	x += x >= 0.0f ? -t : t;
+	y += y >= 0.0f ? -t : t;
+	return XMVector3Normalize(XMVectorSet(x, y, z, 0.0f));
+}
 
 Model::~Model()
 {
-	// Release FBX scene
-	fbxScene->Destroy();
+	// Only models with mips left are registered for streaming (their buffers were created on the main thread)
+	if (HasStreamingMips())
+	{
+		FbxLoader::GetInstance()->CancelStreaming(this);
+	}
 }
 
 void Model::CreateBuffers(ID3D12Device* device)
 {
 	HRESULT result;
 
+	// Bounds for culling (skinned objects widen them by the bone boxes)
+	if (!vertices.empty())
+	{
+		BoundingBox::CreateFromPoints(boundingBox, vertices.size(), &vertices[0].pos, sizeof(VertexPosNormalUvSkin));
+	}
+
+	// Compact vertices address the bones with 8 bits
+	if (vertexFormat != VertexFormat::Full && bones.size() > MAX_COMPACT_BONES)
+	{
+		char str[256];
+		sprintf_s(str, "Model: %s has %zu bones (compact vertices address %zu), using full vertices\n",
+			name.c_str(), bones.size(), MAX_COMPACT_BONES);
+		OutputDebugStringA(str);
+		vertexFormat = VertexFormat::Full;
+	}
+	const bool compactVertices = vertexFormat != VertexFormat::Full;
+	const UINT vertexStride = compactVertices ? sizeof(VertexCompact) : sizeof(VertexPosNormalUvSkin);
+
 	// Overall size of vertex data
-	UINT sizeVB = static_cast<UINT>(sizeof(VertexPosNormalUvSkin) * vertices.size());
+	UINT sizeVB = static_cast<UINT>(vertexStride * vertices.size());
 
 	// Vertex buffer generation
 	result = device->CreateCommittedResource(
@@ -22,22 +110,52 @@ void Model::CreateBuffers(ID3D12Device* device)
 		nullptr,
 		IID_PPV_ARGS(&vertBuff));
 
-	// Data transfer to vertex buffer
-	VertexPosNormalUvSkin* vertMap = nullptr;
-	result = vertBuff->Map(0, nullptr, (void**)&vertMap);
+	// Data transfer to vertex buffer (encoded when compact vertices are used)
+	void* vertMap = nullptr;
+	ConstBufferDataQuantization quantization = {};
+	result = vertBuff->Map(0, nullptr, &vertMap);
 	if (SUCCEEDED(result))
 	{
-		std::copy(vertices.begin(), vertices.end(), vertMap);
+		if (compactVertices)
+		{
+			EncodeCompactVertices((VertexCompact*)vertMap, quantization);
+		}
+		else
+		{
+			std::copy(vertices.begin(), vertices.end(), (VertexPosNormalUvSkin*)vertMap);
+		}
 		vertBuff->Unmap(0, nullptr);
 	}
 
 	// Create vertex buffer view
 	vbView.BufferLocation = vertBuff->GetGPUVirtualAddress();
 	vbView.SizeInBytes = sizeVB;
-	vbView.StrideInBytes = sizeof(vertices[0]);
+	vbView.StrideInBytes = vertexStride;
+
+	// Constant buffer for dequantization
+	if (compactVertices)
+	{
+		result = device->CreateCommittedResource(
+			&CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD),
+			D3D12_HEAP_FLAG_NONE,
+			&CD3DX12_RESOURCE_DESC::Buffer((sizeof(ConstBufferDataQuantization) + 0xff) & ~0xff),
+			D3D12_RESOURCE_STATE_GENERIC_READ,
+			nullptr,
+			IID_PPV_ARGS(&constBuffQuantization));
+
+		ConstBufferDataQuantization* constMap = nullptr;
+		result = constBuffQuantization->Map(0, nullptr, (void**)&constMap);
+		if (SUCCEEDED(result))
+		{
+			*constMap = quantization;
+			constBuffQuantization->Unmap(0, nullptr);
+		}
+	}
 
 	// Overall size of Index Buffer
-	UINT sizeIB = static_cast<UINT>(sizeof(unsigned short) * indices.size());
+	const bool shortIndices = indexFormat == DXGI_FORMAT_R16_UINT;
+	const UINT indexStride = shortIndices ? sizeof(uint16_t) : sizeof(uint32_t);
+	UINT sizeIB = static_cast<UINT>(indexStride * indices.size());
 
 	// Create Index Buffer
 	result = device->CreateCommittedResource(
@@ -48,74 +166,211 @@ void Model::CreateBuffers(ID3D12Device* device)
 		nullptr,
 		IID_PPV_ARGS(&indexBuff));
 
-	// Data transfer to index buffer
-	unsigned short* indexMap = nullptr;
-	result = indexBuff->Map(0, nullptr, (void**)&indexMap);
+	// Data transfer to index buffer (narrowed when 16-bit indices are used)
+	void* indexMap = nullptr;
+	result = indexBuff->Map(0, nullptr, &indexMap);
 	if (SUCCEEDED(result))
 	{
-		std::copy(indices.begin(), indices.end(), indexMap);
+		if (shortIndices)
+		{
+			std::transform(indices.begin(), indices.end(), (uint16_t*)indexMap,
+				[](uint32_t index) { return (uint16_t)index; });
+		}
+		else
+		{
+			std::copy(indices.begin(), indices.end(), (uint32_t*)indexMap);
+		}
 		indexBuff->Unmap(0, nullptr);
 	}
 
 	// Create Index Buffer View
 	ibView.BufferLocation = indexBuff->GetGPUVirtualAddress();
-	ibView.Format = DXGI_FORMAT_R16_UINT;
+	ibView.Format = indexFormat;
 	ibView.SizeInBytes = sizeIB;
 
-	// Texture Image Data
-	const DirectX::Image* img = scratchImg.GetImage(0, 0, 0); // Raw data extraction
-	assert(img);
+	// SRV descriptor heap creation
+	D3D12_DESCRIPTOR_HEAP_DESC descHeapDesc = {};
+	descHeapDesc.Type = D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV;
+	descHeapDesc.Flags = D3D12_DESCRIPTOR_HEAP_FLAG_SHADER_VISIBLE; // As visible from the shader
+	descHeapDesc.NumDescriptors = (UINT)materials.size() * VIEWS_PER_MATERIAL; // Number of textures
+	result = device->CreateDescriptorHeap(&descHeapDesc, IID_PPV_ARGS(&descHeapSRV)); // Creation
+	descriptorSize = device->GetDescriptorHandleIncrementSize(D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
 
-	// Resource settings
-	CD3DX12_RESOURCE_DESC texresDesc = CD3DX12_RESOURCE_DESC::Tex2D(
-		metadata.format,
-		metadata.width,
-		(UINT)metadata.height,
-		(UINT16)metadata.arraySize,
-		(UINT16)metadata.mipLevels
-	);
+	// Texture of each material
+	for (size_t i = 0; i < materials.size(); i++)
+	{
+		Material& material = materials[i];
+		const TexMetadata& metadata = material.metadata;
 
-	// Setting Texture Buffer
-	result = device->CreateCommittedResource(
-		&CD3DX12_HEAP_PROPERTIES(D3D12_CPU_PAGE_PROPERTY_WRITE_BACK, D3D12_MEMORY_POOL_L0),
-		D3D12_HEAP_FLAG_NONE,
-		&texresDesc,
-		D3D12_RESOURCE_STATE_GENERIC_READ, // Texture specifications
-		nullptr,
-		IID_PPV_ARGS(&texBuff));
+		// Resource settings (full mip chain)
+		CD3DX12_RESOURCE_DESC texresDesc = CD3DX12_RESOURCE_DESC::Tex2D(
+			metadata.format,
+			metadata.width,
+			(UINT)metadata.height,
+			(UINT16)metadata.arraySize,
+			(UINT16)metadata.mipLevels
+		);
+
+		// Setting Texture Buffer
+		result = device->CreateCommittedResource(
+			&CD3DX12_HEAP_PROPERTIES(D3D12_CPU_PAGE_PROPERTY_WRITE_BACK, D3D12_MEMORY_POOL_L0),
+			D3D12_HEAP_FLAG_NONE,
+			&texresDesc,
+			D3D12_RESOURCE_STATE_GENERIC_READ, // Texture specifications
+			nullptr,
+			IID_PPV_ARGS(&material.texBuff));
+
+		// Transfer the small mips now (least detailed first), the rest is streamed
+		material.residentMip = (UINT)metadata.mipLevels;
+		while (material.residentMip > 1)
+		{
+			const UINT mip = material.residentMip - 1;
+			if ((metadata.width >> mip) > STREAMING_RESIDENT_SIZE || (metadata.height >> mip) > STREAMING_RESIDENT_SIZE)
+			{
+				break;
+			}
+			UploadMip(material, mip);
+			material.residentMip = mip;
+		}
+
+		// The most detailed mip is always needed
+		if (material.residentMip == (UINT)metadata.mipLevels)
+		{
+			material.residentMip--;
+			UploadMip(material, material.residentMip);
+		}
+
+		// CPU copy is no longer needed
+		if (material.residentMip == 0)
+		{
+			material.scratchImg.Release();
+		}
+
+		// Shader Resource View Creation
+		CreateMaterialView(device, i);
+	}
+}
+
+bool Model::UpdateTextureStreaming(uint64_t frameNumber, uint64_t finishedFrameCount)
+{
+	size_t uploadedBytes = 0;
+	bool remaining = false;
+
+	for (size_t i = 0; i < materials.size(); i++)
+	{
+		Material& material = materials[i];
+		if (material.residentMip == 0)
+		{
+			continue;
+		}
+
+		// The other descriptor is still read by a frame in flight
+		if (finishedFrameCount < material.viewRetiredFrame)
+		{
+			remaining = true;
+			continue;
+		}
+
+		// One mip per material and call, within the budget (the first one always proceeds)
+		const UINT mip = material.residentMip - 1;
+		const size_t mipBytes = material.scratchImg.GetImage(mip, 0, 0)->slicePitch;
+		if (uploadedBytes > 0 && uploadedBytes + mipBytes > STREAMING_BUDGET)
+		{
+			remaining = true;
+			continue;
+		}
+		UploadMip(material, mip);
+		material.residentMip = mip;
+		uploadedBytes += mipBytes;
+
+		// Make the new mip visible to the shader through the other descriptor,
+		// frames recorded so far keep reading the current one
+		ComPtr<ID3D12Device> device;
+		material.texBuff->GetDevice(IID_PPV_ARGS(&device));
+		material.viewSlot = (material.viewSlot + 1) % VIEWS_PER_MATERIAL;
+		material.viewRetiredFrame = frameNumber;
+		CreateMaterialView(device.Get(), i);
+
+		if (material.residentMip == 0)
+		{
+			material.scratchImg.Release();
+		}
+		else
+		{
+			remaining = true;
+		}
+	}
+
+	return remaining;
+}
+
+bool Model::HasStreamingMips() const
+{
+	for (const Material& material : materials)
+	{
+		if (material.residentMip > 0)
+		{
+			return true;
+		}
+	}
+	return false;
+}
+
+void Model::UploadMip(Material& material, UINT mip)
+{
+	// Texture Image Data
+	const DirectX::Image* img = material.scratchImg.GetImage(mip, 0, 0); // Raw data extraction
+	assert(img);
 
 	// Transfer Data to Texture Buffer
-	result = texBuff->WriteToSubresource(
-		0,
+	HRESULT result = material.texBuff->WriteToSubresource(
+		mip,
 		nullptr, // copy to all areas
 		img->pixels, // Original teledata address
 		(UINT)img->rowPitch, // 1 line size
 		(UINT)img->slicePitch // 1 sheet size
 	);
+	assert(SUCCEEDED(result));
+}
 
-	// SRV descriptor heap creation
-	D3D12_DESCRIPTOR_HEAP_DESC descHeapDesc = {};
-	descHeapDesc.Type = D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV;
-	descHeapDesc.Flags = D3D12_DESCRIPTOR_HEAP_FLAG_SHADER_VISIBLE; // As visible from the shader
-	descHeapDesc.NumDescriptors = 1; // Number of textures
-	result = device->CreateDescriptorHeap(&descHeapDesc, IID_PPV_ARGS(&descHeapSRV)); // Creation
+void Model::CreateMaterialView(ID3D12Device* device, size_t materialIndex)
+{
+	const Material& material = materials[materialIndex];
 
 	// Shader Resource View Creation
 	D3D12_SHADER_RESOURCE_VIEW_DESC srvDesc{};
-	D3D12_RESOURCE_DESC resDesc = texBuff->GetDesc();
+	D3D12_RESOURCE_DESC resDesc = material.texBuff->GetDesc();
 
 	srvDesc.Format = resDesc.Format;
 	srvDesc.Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
 	srvDesc.ViewDimension = D3D12_SRV_DIMENSION_TEXTURE2D; // 2D Texture
-	srvDesc.Texture2D.MipLevels = 1;
+	// Only the uploaded mips are sampled
+	srvDesc.Texture2D.MostDetailedMip = material.residentMip;
+	srvDesc.Texture2D.MipLevels = resDesc.MipLevels - material.residentMip;
 
-	device->CreateShaderResourceView(texBuff.Get(), // Buffer associated with view
+	device->CreateShaderResourceView(material.texBuff.Get(), // Buffer associated with view
 		&srvDesc, // Texture setting information
-		descHeapSRV->GetCPUDescriptorHandleForHeapStart() // Heap destination address
+		CD3DX12_CPU_DESCRIPTOR_HANDLE(descHeapSRV->GetCPUDescriptorHandleForHeapStart(),
+			(INT)(materialIndex * VIEWS_PER_MATERIAL + material.viewSlot), descriptorSize) // Heap destination address
 	);
 }
 
-void Model::Draw(ID3D12GraphicsCommandList* cmdList)
+D3D12_GPU_DESCRIPTOR_HANDLE Model::GetMaterialView(UINT materialIndex) const
+{
+	return CD3DX12_GPU_DESCRIPTOR_HANDLE(descHeapSRV->GetGPUDescriptorHandleForHeapStart(),
+		(INT)(materialIndex * VIEWS_PER_MATERIAL + materials[materialIndex].viewSlot), descriptorSize);
+}
+
+void Model::Draw(ID3D12GraphicsCommandList* cmdList, UINT instanceCount)
+{
+	// Set descriptor heap
+	ID3D12DescriptorHeap* ppHeaps[] = { descHeapSRV.Get() };
+	cmdList->SetDescriptorHeaps(_countof(ppHeaps), ppHeaps);
+
+	DrawSubmeshes(cmdList, instanceCount);
+}
+
+void Model::DrawSubmeshes(ID3D12GraphicsCommandList* cmdList, UINT instanceCount)
 {
 	// Set vertex buffer (VBV)
 	cmdList->IASetVertexBuffers(0, 1, &vbView);
@@ -123,13 +378,414 @@ void Model::Draw(ID3D12GraphicsCommandList* cmdList)
 	// Set index buffer (IBV)
 	cmdList->IASetIndexBuffer(&ibView);
 
-	// Set descriptor heap
-	ID3D12DescriptorHeap* ppHeaps[] = { descHeapSRV.Get() };
-	cmdList->SetDescriptorHeaps(_countof(ppHeaps), ppHeaps);
+	// Set constant buffer view (dequantization)
+	if (constBuffQuantization)
+	{
+		cmdList->SetGraphicsRootConstantBufferView(3, constBuffQuantization->GetGPUVirtualAddress());
+	}
+
+	// Draw command (one per submesh, sorted by material)
+	UINT boundMaterial = UINT_MAX;
+	for (const Submesh& submesh : submeshes)
+	{
+		// Shader Resource View set only when the material changes
+		if (submesh.materialIndex != boundMaterial)
+		{
+			boundMaterial = submesh.materialIndex;
+			cmdList->SetGraphicsRootDescriptorTable(1, GetMaterialView(boundMaterial));
+		}
+
+		cmdList->DrawIndexedInstanced(submesh.indexCount, instanceCount, submesh.indexStart, submesh.baseVertex, 0);
+	}
+}
+
+const AnimationClip* Model::FindAnimationClip(const std::string& clipName) const
+{
+	for (const AnimationClip& animationClip : animationClips)
+	{
+		if (animationClip.GetName() == clipName)
+		{
+			return &animationClip;
+		}
+	}
+	return nullptr;
+}
+
+int32_t Model::FindJointIndex(const std::string& jointName) const
+{
+	for (size_t i = 0; i < joints.size(); i++)
+	{
+		if (joints[i].name == jointName)
+		{
+			return (int32_t)i;
+		}
+	}
+	return -1;
+}
+
+void Model::BuildSkeleton()
+{
+	std::vector<int32_t> parentIndices(joints.size());
+	for (size_t i = 0; i < joints.size(); i++)
+	{
+		parentIndices[i] = joints[i].parentIndex;
+	}
+
+	std::vector<int32_t> boneJointIndices(bones.size());
+	std::vector<XMMATRIX> invInitialPoses(bones.size());
+	std::vector<BoundingBox> boneBounds(bones.size());
+	for (size_t i = 0; i < bones.size(); i++)
+	{
+		boneJointIndices[i] = bones[i].jointIndex;
+		invInitialPoses[i] = bones[i].invInitialPose;
+		boneBounds[i] = bones[i].bounds;
+	}
+
+	skeleton.Initialize(parentIndices, boneJointIndices, invInitialPoses, boneBounds);
+}
+
+void Model::SelectIndexFormat()
+{
+	// Number of vertices addressed by the largest submesh
+	uint32_t maxIndex = 0;
+	for (uint32_t index : indices)
+	{
+		maxIndex = (std::max)(maxIndex, index);
+	}
+
+	// Fits into 16-bit indices as it is
+	if (maxIndex < MAX_SHORT_INDEX_VERTICES)
+	{
+		indexFormat = DXGI_FORMAT_R16_UINT;
+	}
+	// Split into submeshes that each fit into 16-bit indices
+	else if (preferShortIndices)
+	{
+		SplitForShortIndices();
+		indexFormat = DXGI_FORMAT_R16_UINT;
+	}
+	// Use 32-bit indices
+	else
+	{
+		indexFormat = DXGI_FORMAT_R32_UINT;
+	}
+
+	SortSubmeshes();
+}
+
+void Model::SplitForShortIndices()
+{
+	// Mark for a vertex not yet used in the current submesh
+	const uint32_t UNUSED = 0xffffffff;
+
+	std::vector<VertexPosNormalUvSkin> splitVertices;
+	splitVertices.reserve(vertices.size());
+
+	// Original vertex index -> index inside the current submesh
+	std::vector<uint32_t> remap(vertices.size(), UNUSED);
+	// Original vertices used by the current submesh (to reset remap)
+	std::vector<uint32_t> usedVertices;
+	usedVertices.reserve(MAX_SHORT_INDEX_VERTICES);
+
+	std::vector<Submesh> splitSubmeshes;
+	splitSubmeshes.reserve(submeshes.size());
+
+	for (const Submesh& source : submeshes)
+	{
+		// Each submesh starts with its own vertex range
+		Submesh current = source;
+		current.indexCount = 0;
+		current.baseVertex = (INT)splitVertices.size();
+		for (uint32_t vertex : usedVertices)
+		{
+			remap[vertex] = UNUSED;
+		}
+		usedVertices.clear();
+
+		const UINT indexEnd = source.indexStart + source.indexCount;
+		for (UINT i = source.indexStart; i + 2 < indexEnd; i += 3)
+		{
+			// Number of vertices this triangle adds to the current submesh
+			size_t newVertexCount = 0;
+			for (UINT j = 0; j < 3; j++)
+			{
+				if (remap[source.baseVertex + indices[i + j]] == UNUSED)
+				{
+					newVertexCount++;
+				}
+			}
+
+			// Close the submesh when the triangle no longer fits
+			if (usedVertices.size() + newVertexCount > MAX_SHORT_INDEX_VERTICES)
+			{
+				splitSubmeshes.push_back(current);
+				current.indexStart += current.indexCount;
+				current.indexCount = 0;
+				current.baseVertex = (INT)splitVertices.size();
 
-	// Shader Resource View set
-	cmdList->SetGraphicsRootDescriptorTable(1, descHeapSRV->GetGPUDescriptorHandleForHeapStart());
+				for (uint32_t vertex : usedVertices)
+				{
+					remap[vertex] = UNUSED;
+				}
+				usedVertices.clear();
+			}
 
-	// Draw command
-	cmdList->DrawIndexedInstanced((UINT)indices.size(), 1, 0, 0, 0);
-}
\ No newline at end of file
+			// Rewrite the indices relative to the submesh base vertex
+			for (UINT j = 0; j < 3; j++)
+			{
+				uint32_t& index = indices[i + j];
+				const uint32_t vertex = source.baseVertex + index;
+				if (remap[vertex] == UNUSED)
+				{
+					remap[vertex] = (uint32_t)usedVertices.size();
+					usedVertices.push_back(vertex);
+					splitVertices.push_back(vertices[vertex]);
+				}
+				index = remap[vertex];
+			}
+			current.indexCount += 3;
+		}
+
+		if (current.indexCount > 0)
+		{
+			splitSubmeshes.push_back(current);
+		}
+	}
+
+	// Vertices shared between submeshes are duplicated
+	vertices.swap(splitVertices);
+	submeshes.swap(splitSubmeshes);
+
+	char str[128];
+	sprintf_s(str, "Model: %s split into %zu submeshes (%zu vertices) for 16-bit indices\n",
+		name.c_str(), submeshes.size(), vertices.size());
+	OutputDebugStringA(str);
+}
+
+void Model::BenchmarkIndexFormats(size_t vertexCount)
+{
+	// Grid as close to square as possible
+	const size_t width = (std::max)((size_t)2, (size_t)ceil(sqrt((double)vertexCount)));
+	const size_t height = (std::max)((size_t)2, (vertexCount + width - 1) / width);
+
+	auto gridVertex = [width, height](size_t x, size_t y)
+	{
+		VertexPosNormalUvSkin vertex = {};
+		vertex.pos = { (float)x, 0.0f, (float)y };
+		vertex.normal = { 0.0f, 1.0f, 0.0f };
+		vertex.uv = { (float)x / (width - 1), (float)y / (height - 1), 0.0f };
+		vertex.boneWeight[0] = 1.0f;
+		return vertex;
+	};
+
+	// Triangle soup as the FBX faces produce it, one vertex per corner
+	std::vector<VertexPosNormalUvSkin> corners;
+	corners.reserve((width - 1) * (height - 1) * 6);
+	for (size_t y = 0; y + 1 < height; y++)
+	{
+		for (size_t x = 0; x + 1 < width; x++)
+		{
+			corners.push_back(gridVertex(x, y));
+			corners.push_back(gridVertex(x, y + 1));
+			corners.push_back(gridVertex(x + 1, y));
+			corners.push_back(gridVertex(x + 1, y));
+			corners.push_back(gridVertex(x, y + 1));
+			corners.push_back(gridVertex(x + 1, y + 1));
+		}
+	}
+
+	// Welding
+	auto weldStart = std::chrono::steady_clock::now();
+	VertexWelder welder;
+	welder.Reserve(corners.size());
+	std::vector<uint32_t> weldedIndices(corners.size());
+	for (size_t i = 0; i < corners.size(); i++)
+	{
+		weldedIndices[i] = welder.Add(corners[i]);
+	}
+	const VertexWelder::Stats weldStats = welder.GetStats();
+	std::vector<VertexPosNormalUvSkin> weldedVertices;
+	welder.TakeVertices(weldedVertices);
+	auto weldEnd = std::chrono::steady_clock::now();
+
+	const double weldMilliseconds = std::chrono::duration<double, std::milli>(weldEnd - weldStart).count();
+	char str[256];
+	sprintf_s(str, "Model: welded %zu corners into %zu vertices (reuse %.2f) in %.3f ms, %.1f M corners/s\n",
+		weldStats.inputVertexCount, weldStats.uniqueVertexCount, weldStats.GetReuseRatio(), weldMilliseconds,
+		weldMilliseconds > 0.0 ? corners.size() / weldMilliseconds / 1000.0 : 0.0);
+	OutputDebugStringA(str);
+
+	// Index format selection with and without the 16-bit preference
+	const bool preferShort = preferShortIndices;
+	for (int pass = 0; pass < 2; pass++)
+	{
+		preferShortIndices = pass == 0;
+
+		Model model;
+		model.name = "grid";
+		model.vertices = weldedVertices;
+		model.indices = weldedIndices;
+		model.submeshes.resize(1);
+		model.submeshes[0].indexCount = (UINT)weldedIndices.size();
+
+		auto selectStart = std::chrono::steady_clock::now();
+		model.SelectIndexFormat();
+		auto selectEnd = std::chrono::steady_clock::now();
+
+		// Corner i of the index buffer must still read corner i of the soup
+		size_t invalidCount = 0;
+		for (const Submesh& submesh : model.submeshes)
+		{
+			for (UINT i = submesh.indexStart; i < submesh.indexStart + submesh.indexCount; i++)
+			{
+				const uint64_t vertex = (uint64_t)submesh.baseVertex + model.indices[i];
+				if ((model.indexFormat == DXGI_FORMAT_R16_UINT && model.indices[i] > 0xFFFF) ||
+					vertex >= model.vertices.size() ||
+					memcmp(&model.vertices[(size_t)vertex], &corners[i], sizeof(VertexPosNormalUvSkin)) != 0)
+				{
+					invalidCount++;
+				}
+			}
+		}
+
+		sprintf_s(str, "Model: %s preferred, %s, %zu submeshes, %zu vertices, selected in %.3f ms, %zu invalid indices\n",
+			pass == 0 ? "16-bit" : "32-bit", model.indexFormat == DXGI_FORMAT_R16_UINT ? "R16" : "R32",
+			model.submeshes.size(), model.vertices.size(),
+			std::chrono::duration<double, std::milli>(selectEnd - selectStart).count(), invalidCount);
+		OutputDebugStringA(str);
+	}
+	preferShortIndices = preferShort;
+}
+
+void Model::SortSubmeshes()
+{
+	// Keep the original order within a material
+	std::stable_sort(submeshes.begin(), submeshes.end(),
+		[](const Submesh& lhs, const Submesh& rhs)
+		{
+			return lhs.materialIndex < rhs.materialIndex;
+		});
+}
+
+void Model::EncodeCompactVertices(VertexCompact* dst, ConstBufferDataQuantization& quantization) const
+{
+	// Bounding box of positions and UVs
+	XMVECTOR posMin = XMVectorReplicate(FLT_MAX);
+	XMVECTOR posMax = XMVectorReplicate(-FLT_MAX);
+	XMFLOAT2 uvMin(FLT_MAX, FLT_MAX);
+	XMFLOAT2 uvMax(-FLT_MAX, -FLT_MAX);
+	for (const VertexPosNormalUvSkin& vertex : vertices)
+	{
+		XMVECTOR pos = XMLoadFloat3(&vertex.pos);
+		posMin = XMVectorMin(posMin, pos);
+		posMax = XMVectorMax(posMax, pos);
+		uvMin.x = (std::min)(uvMin.x, vertex.uv.x);
+		uvMin.y = (std::min)(uvMin.y, vertex.uv.y);
+		uvMax.x = (std::max)(uvMax.x, vertex.uv.x);
+		uvMax.y = (std::max)(uvMax.y, vertex.uv.y);
+	}
+	if (vertices.empty())
+	{
+		posMin = posMax = XMVectorZero();
+		uvMin = uvMax = XMFLOAT2(0.0f, 0.0f);
+	}
+
+	// Snorm16 positions are relative to the box, half float positions are stored as they are
+	const bool halfPositions = vertexFormat == VertexFormat::CompactHalf;
+	XMVECTOR posScale = XMVectorMax((posMax - posMin) * 0.5f, XMVectorReplicate(1e-6f));
+	XMVECTOR posOffset = (posMax + posMin) * 0.5f;
+	if (halfPositions)
+	{
+		posScale = XMVectorReplicate(1.0f);
+		posOffset = XMVectorZero();
+	}
+	XMStoreFloat4(&quantization.posScale, posScale);
+	XMStoreFloat4(&quantization.posOffset, posOffset);
+	const float uvScaleX = (std::max)(uvMax.x - uvMin.x, 1e-6f);
+	const float uvScaleY = (std::max)(uvMax.y - uvMin.y, 1e-6f);
+	quantization.uvScaleOffset = XMFLOAT4(uvScaleX, uvScaleY, uvMin.x, uvMin.y);
+
+	// Largest differences between the original and the decoded vertices
+	float maxPosError = 0.0f;
+	float maxNormalError = 0.0f;
+	float maxUvError = 0.0f;
+	float maxWeightError = 0.0f;
+
+	const XMVECTOR invPosScale = XMVectorReciprocal(posScale);
+	for (size_t i = 0; i < vertices.size(); i++)
+	{
+		const VertexPosNormalUvSkin& vertex = vertices[i];
+		VertexCompact& compact = dst[i];
+
+		// Position
+		XMFLOAT3 pos;
+		XMVECTOR original = XMLoadFloat3(&vertex.pos);
+		XMStoreFloat3(&pos, (original - posOffset) * invPosScale);
+		XMVECTOR decoded;
+		if (halfPositions)
+		{
+			compact.pos[0] = PackedVector::XMConvertFloatToHalf(pos.x);
+			compact.pos[1] = PackedVector::XMConvertFloatToHalf(pos.y);
+			compact.pos[2] = PackedVector::XMConvertFloatToHalf(pos.z);
+			compact.pos[3] = PackedVector::XMConvertFloatToHalf(1.0f);
+			decoded = XMVectorSet(
+				PackedVector::XMConvertHalfToFloat(compact.pos[0]),
+				PackedVector::XMConvertHalfToFloat(compact.pos[1]),
+				PackedVector::XMConvertHalfToFloat(compact.pos[2]), 0.0f);
+		}
+		else
+		{
+			compact.pos[0] = (uint16_t)EncodeSnorm16(pos.x);
+			compact.pos[1] = (uint16_t)EncodeSnorm16(pos.y);
+			compact.pos[2] = (uint16_t)EncodeSnorm16(pos.z);
+			compact.pos[3] = (uint16_t)EncodeSnorm16(1.0f);
+			decoded = XMVectorSet(
+				(int16_t)compact.pos[0] / 32767.0f,
+				(int16_t)compact.pos[1] / 32767.0f,
+				(int16_t)compact.pos[2] / 32767.0f, 0.0f);
+		}
+		decoded = decoded * posScale + posOffset;
+		maxPosError = (std::max)(maxPosError, XMVectorGetX(XMVector3Length(decoded - original)));
+
+		// Normal
+		XMFLOAT3 normal;
+		XMStoreFloat3(&normal, XMVector3Normalize(XMLoadFloat3(&vertex.normal)));
+		XMFLOAT2 octahedral = EncodeOctahedral(normal);
+		compact.normal[0] = EncodeSnorm16(octahedral.x);
+		compact.normal[1] = EncodeSnorm16(octahedral.y);
+		XMVECTOR decodedNormal = DecodeOctahedral(compact.normal[0] / 32767.0f, compact.normal[1] / 32767.0f);
+		maxNormalError = (std::max)(maxNormalError,
+			XMVectorGetX(XMVector3AngleBetweenNormals(decodedNormal, XMLoadFloat3(&normal))));
+
+		// UV
+		compact.uv[0] = EncodeUnorm16((vertex.uv.x - uvMin.x) / uvScaleX);
+		compact.uv[1] = EncodeUnorm16((vertex.uv.y - uvMin.y) / uvScaleY);
+		maxUvError = (std::max)(maxUvError, fabsf(compact.uv[0] / 65535.0f * uvScaleX + uvMin.x - vertex.uv.x));
+		maxUvError = (std::max)(maxUvError, fabsf(compact.uv[1] / 65535.0f * uvScaleY + uvMin.y - vertex.uv.y));
+
+		// Skin weights rounded to 1/255, the largest one absorbs the rounding so that they sum to 1
+		int weightTotal = 0;
+		int largest = 0;
+		for (int j = 0; j < MAX_BONE_INDICES; j++)
+		{
+			compact.boneIndex[j] = (uint8_t)vertex.boneIndex[j];
+			compact.boneWeight[j] = (uint8_t)lroundf((std::min)((std::max)(vertex.boneWeight[j], 0.0f), 1.0f) * 255.0f);
+			weightTotal += compact.boneWeight[j];
+			if (vertex.boneWeight[j] > vertex.boneWeight[largest])
+			{
+				largest = j;
+			}
+		}
+		compact.boneWeight[largest] = (uint8_t)(compact.boneWeight[largest] + 255 - weightTotal);
+		for (int j = 0; j < MAX_BONE_INDICES; j++)
+		{
+			maxWeightError = (std::max)(maxWeightError, fabsf(compact.boneWeight[j] / 255.0f - vertex.boneWeight[j]));
+		}
+	}
+
+	char str[256];
+	sprintf_s(str, "Model: %s compact vertices %zu -> %zu bytes, max error pos %g, normal %.4f deg, uv %g, weight %g\n",
+		name.c_str(), sizeof(VertexPosNormalUvSkin) * vertices.size(), sizeof(VertexCompact) * vertices.size(),
+		maxPosError, XMConvertToDegrees(maxNormalError), maxUvError, maxWeightError);
+	OutputDebugStringA(str);
+}
@@ -1,8 +1,12 @@
 #pragma once
 
+#include "AnimationClip.h"
+#include "Skeleton.h"
+
 #include <string>
 #include <vector>
 #include <DirectXMath.h>
+#include <DirectXCollision.h>
 #include <DirectXTex.h>
 #include <Windows.h>
 #include <wrl.h>
@@ -51,6 +55,46 @@ public: // Constant
 	// Maximum number of bone instances
 	static const int MAX_BONE_INDICES = 4;
 
+	// Maximum number of vertices addressable by 16-bit indices
+	static const size_t MAX_SHORT_INDEX_VERTICES = 0x10000;
+
+	// Maximum number of bones addressable by the 8-bit bone numbers of compact vertices
+	static const size_t MAX_COMPACT_BONES = 0x100;
+
+	// Mips up to this size are uploaded by CreateBuffers, larger ones are streamed in afterwards
+	static const size_t STREAMING_RESIDENT_SIZE = 64;
+
+	// Texture bytes uploaded per UpdateTextureStreaming call
+	static const size_t STREAMING_BUDGET = 4 * 1024 * 1024;
+
+	// SRV descriptors per material: the one drawn with and the one the next streamed mip is written to
+	static const UINT VIEWS_PER_MATERIAL = 2;
+
+public: // Enumeration
+	// Layout of the vertices in the vertex buffer
+	enum class VertexFormat
+	{
+		// VertexPosNormalUvSkin as it is
+		Full,
+		// VertexCompact, position as snorm16 in the bounding box
+		Compact,
+		// VertexCompact, position as half float
+		CompactHalf,
+		// Number of formats
+		Count,
+	};
+
+	// Blending of the bone transformations in the vertex shader
+	enum class SkinningMode
+	{
+		// Blend of skinning matrices (loses volume at twisted and bent joints)
+		Linear,
+		// Blend of dual quaternions (rigid bones only, scale of the bones is ignored)
+		DualQuaternion,
+		// Number of modes
+		Count,
+	};
+
 public: // Subclass
 	// Vertex data structure
 	struct VertexPosNormalUvSkin
@@ -62,6 +106,62 @@ public: // Subclass
 		float boneWeight[MAX_BONE_INDICES]; // Bone Weight
 	};
 
+	// Compact vertex data structure (24 bytes)
+	struct VertexCompact
+	{
+		uint16_t pos[4]; // Position (snorm16 in the bounding box, or half float), w unused
+		int16_t normal[2]; // Octahedral encoded normal (snorm16)
+		uint16_t uv[2]; // Texture coordinates (unorm16 in the UV range)
+		uint8_t boneIndex[MAX_BONE_INDICES]; // Bone Number
+		uint8_t boneWeight[MAX_BONE_INDICES]; // Bone Weight (unorm8, sums to 255)
+	};
+
+	// Data structure for constant buffer (dequantization of compact vertices)
+	struct ConstBufferDataQuantization
+	{
+		XMFLOAT4 posScale; // Half extent of the bounding box
+		XMFLOAT4 posOffset; // Center of the bounding box
+		XMFLOAT4 uvScaleOffset; // UV range (xy: scale, zw: offset)
+	};
+
+	// Range of the index buffer drawn with one draw call
+	struct Submesh
+	{
+		// First index in the index buffer
+		UINT indexStart = 0;
+		// Number of indices
+		UINT indexCount = 0;
+		// Value added to each index before reading the vertex buffer
+		INT baseVertex = 0;
+		// Index into the material array
+		UINT materialIndex = 0;
+	};
+
+	// Material
+	struct Material
+	{
+		// Name (empty for the default material)
+		std::string name;
+		// Ambient coefficient
+		DirectX::XMFLOAT3 ambient = { 1,1,1 };
+		// Diffuse coefficient
+		DirectX::XMFLOAT3 diffuse = { 1,1,1 };
+		// Texture file path
+		std::string texturePath;
+		// Texture metadata
+		DirectX::TexMetadata metadata = {};
+		// Scratch image (released once all mips are uploaded)
+		DirectX::ScratchImage scratchImg = {};
+		// Texture Buffer
+		ComPtr<ID3D12Resource> texBuff;
+		// Most detailed mip uploaded to the texture buffer
+		UINT residentMip = 0;
+		// Descriptor of the material drawn with, [0, VIEWS_PER_MATERIAL)
+		UINT viewSlot = 0;
+		// Frames numbered below this one may still read the other descriptor
+		uint64_t viewRetiredFrame = 0;
+	};
+
 	// Bone structure
 	struct Bone
 	{
@@ -71,8 +171,14 @@ public: // Subclass
 		// Inverse matrix of initial posture
 		DirectX::XMMATRIX invInitialPose;
 
-		// Cluster (FBX example channel information)
-		FbxCluster* fbxCluster;
+		// Joint moving the bone (-1 if not animated)
+		int32_t jointIndex = -1;
+
+		// Initial posture box of the vertices the bone influences, in the space of the mesh (negative extents if none)
+		DirectX::BoundingBox bounds = DirectX::BoundingBox(DirectX::XMFLOAT3(0, 0, 0), DirectX::XMFLOAT3(-1, -1, -1));
+
+		// Cluster (FBX example channel information, only valid during the import)
+		FbxCluster* fbxCluster = nullptr;
 
 		// Constructor
 		Bone(const std::string& name)
@@ -81,31 +187,129 @@ public: // Subclass
 		}
 	};
 
+	// Node of the animated hierarchy
+	struct Joint
+	{
+		// Name
+		std::string name;
+		// Index of the parent joint (-1 if root, always smaller than the own index)
+		int32_t parentIndex = -1;
+	};
+
 public:
 	// Friend Class
 	friend class FbxLoader;
+	friend class ObjLoader;
 
 public:
-	// Destructor
+	// Stop the texture streaming of the model (FbxLoader)
 	~Model();
 
 	// Create Buffer
 	void CreateBuffers(ID3D12Device* device);
 
-	// Drawing
-	void Draw(ID3D12GraphicsCommandList* cmdList);
+	// Drawing (instanceCount copies, the vertex shader tells them apart by SV_InstanceID)
+	void Draw(ID3D12GraphicsCommandList* cmdList, UINT instanceCount = 1);
+
+	// Drawing without setting the descriptor heap (already set to GetDescriptorHeap, as by a DrawQueue)
+	void DrawSubmeshes(ID3D12GraphicsCommandList* cmdList, UINT instanceCount = 1);
+
+	// Shader visible heap of the material textures
+	ID3D12DescriptorHeap* GetDescriptorHeap() const { return descHeapSRV.Get(); }
+
+	/// <summary>
+	/// Upload the next more detailed mips of the textures (within STREAMING_BUDGET bytes)
+	/// Call once per frame before recording it (FbxLoader::UpdateStreaming). The view of the new mip goes to the
+	/// other descriptor of the material, a material whose other descriptor is still read by a frame in flight
+	/// waits for a later call.
+	/// </summary>
+	/// <param name="frameNumber">Number of the frame about to be recorded</param>
+	/// <param name="finishedFrameCount">Number of frames the GPU has finished</param>
+	/// <returns>True while mips remain to be uploaded</returns>
+	bool UpdateTextureStreaming(uint64_t frameNumber, uint64_t finishedFrameCount);
+
+	// Mips remain to be uploaded by UpdateTextureStreaming
+	bool HasStreamingMips() const;
+
+	/// <summary>
+	/// Choose 16- or 32-bit indices and sort the submeshes by material (called after loading)
+	/// Submeshes over 65536 vertices are split when 16-bit indices are preferred
+	/// </summary>
+	void SelectIndexFormat();
+
+	// Prefer 16-bit indices (split large meshes) over 32-bit indices
+	static void SetPreferShortIndices(bool prefer) { preferShortIndices = prefer; }
+
+	/// <summary>
+	/// Weld the triangle soup of a generated grid, select 16- and 32-bit indices for it and check that
+	/// every index fits its format and still reads the vertex of the soup, reporting times and results
+	/// </summary>
+	/// <param name="vertexCount">Number of grid vertices (200000 needs several 16-bit submeshes)</param>
+	static void BenchmarkIndexFormats(size_t vertexCount);
+
+	// Vertex format of the vertex buffer (valid after CreateBuffers)
+	VertexFormat GetVertexFormat() const { return vertexFormat; }
+
+	// Skinning used for every object drawing the model
+	void SetSkinningMode(SkinningMode skinningMode) { this->skinningMode = skinningMode; }
+	SkinningMode GetSkinningMode() const { return skinningMode; }
+
+	// Initial posture box of all vertices in the space of the mesh (valid after CreateBuffers)
+	const DirectX::BoundingBox& GetBoundingBox() const { return boundingBox; }
 
 	// Get model transformation matrix
 	const XMMATRIX& GetModelTransform() { return meshNode->globalTransform; }
 
 	// getter
-	FbxScene* GetFbxScene() { return fbxScene; }
+	std::vector<Bone>& GetBones() { return bones; }
 
 	// getter
-	std::vector<Bone>& GetBones() { return bones; }
+	const std::vector<VertexPosNormalUvSkin>& GetVertices() const { return vertices; }
+
+	// getter
+	const std::vector<Joint>& GetJoints() const { return joints; }
+
+	// getter
+	const std::vector<AnimationClip>& GetAnimationClips() const { return animationClips; }
+
+	// Animation clip of the name (nullptr if none)
+	const AnimationClip* FindAnimationClip(const std::string& clipName) const;
+
+	// Index of the joint of the name (-1 if none)
+	int32_t FindJointIndex(const std::string& jointName) const;
+
+	// getter
+	const Skeleton& GetSkeleton() const { return skeleton; }
+
+private:
+	// Split the mesh into submeshes addressing at most MAX_SHORT_INDEX_VERTICES vertices each
+	void SplitForShortIndices();
+
+	// Sort the submeshes by material to minimise state changes when drawing
+	void SortSubmeshes();
+
+	// Set up the runtime skeleton from the joints and bones (called after loading)
+	void BuildSkeleton();
+
+	// Copy one mip of the scratch image into the texture buffer
+	static void UploadMip(Material& material, UINT mip);
+
+	// Create the SRV of a material covering its resident mips in its current descriptor
+	void CreateMaterialView(ID3D12Device* device, size_t materialIndex);
+
+	// GPU handle of the current descriptor of a material
+	D3D12_GPU_DESCRIPTOR_HANDLE GetMaterialView(UINT materialIndex) const;
+
+	/// <summary>
+	/// Encode the vertices into the compact format and report the round-trip error
+	/// </summary>
+	/// <param name="dst">Destination (one compact vertex per vertex)</param>
+	/// <param name="quantization">Receives the dequantization constants</param>
+	void EncodeCompactVertices(VertexCompact* dst, ConstBufferDataQuantization& quantization) const;
 
 private:
-	FbxScene* fbxScene = nullptr;
+	// Prefer 16-bit indices (split large meshes) over 32-bit indices
+	static bool preferShortIndices;
 
 	// Model Name
 	std::string name;
@@ -113,37 +317,57 @@ private:
 	// Node Array
 	std::vector<Node> nodes;
 
-	// Node with mesh
+	// Node with mesh (the first one; all submeshes are in its space)
 	Node* meshNode = nullptr;
 
 	// Bone Vector
 	std::vector<Bone> bones;
 
+	// Joints of the animated hierarchy (bone nodes and their ancestors, parents first)
+	std::vector<Joint> joints;
+
+	// Animation clips (tracks in joint order)
+	std::vector<AnimationClip> animationClips;
+
+	// Runtime hierarchy of the joints and the skin bind data
+	Skeleton skeleton;
+
 	// Vertex data array
 	std::vector<VertexPosNormalUvSkin> vertices;
 
-	// Vertex index array
-	std::vector<unsigned short> indices;
+	// Vertex index array (relative to the base vertex of each submesh)
+	std::vector<uint32_t> indices;
+
+	// Submesh array
+	std::vector<Submesh> submeshes;
+
+	// Index format of the index buffer (R16_UINT or R32_UINT)
+	DXGI_FORMAT indexFormat = DXGI_FORMAT_R16_UINT;
+
+	// Material array
+	std::vector<Material> materials;
+
+	// Vertex format requested by the loader (falls back to Full when it cannot represent the model)
+	VertexFormat vertexFormat = VertexFormat::Full;
+
+	// Skinning of the vertex shader
+	SkinningMode skinningMode = SkinningMode::Linear;
 
-	// Ambient coefficient
-	DirectX::XMFLOAT3 ambient = { 1,1,1 };
-	// Diffuse coefficient
-	DirectX::XMFLOAT3 diffuse = { 1,1,1 };
-	// Texture metadata
-	DirectX::TexMetadata metadata = {};
-	// Scratch image
-	DirectX::ScratchImage scratchImg = {};
+	// Initial posture box of all vertices
+	DirectX::BoundingBox boundingBox;
 
 	// Vertex Buffer
 	ComPtr<ID3D12Resource> vertBuff;
 	// Index Buffer
 	ComPtr<ID3D12Resource> indexBuff;
-	// Texture Buffer
-	ComPtr<ID3D12Resource> texBuff;
 	// Vertex Buffer View
 	D3D12_VERTEX_BUFFER_VIEW vbView = {};
 	// Index Buffer View
 	D3D12_INDEX_BUFFER_VIEW ibView = {};
-	// SRV descriptor heap
+	// Constant buffer (dequantization of compact vertices)
+	ComPtr<ID3D12Resource> constBuffQuantization;
+	// SRV descriptor heap (VIEWS_PER_MATERIAL descriptors per material)
 	ComPtr<ID3D12DescriptorHeap> descHeapSRV;
+	// Size of one SRV descriptor
+	UINT descriptorSize = 0;
 };
\ No newline at end of file
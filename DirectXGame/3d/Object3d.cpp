@@ -1,6 +1,6 @@
 #include "Object3d.h"
-#include "FbxLoader/FbxLoader.h"
 
+#include <algorithm>
 #include <d3dcompiler.h>
 #pragma comment(lib, "d3dcompiler.lib")
 
@@ -14,46 +14,16 @@ ID3D12Device* Object3d::device = nullptr;
 Camera* Object3d::camera = nullptr;
 
 ComPtr<ID3D12RootSignature> Object3d::rootsignature;
-ComPtr<ID3D12PipelineState> Object3d::pipelinestate;
+ComPtr<ID3D12PipelineState> Object3d::pipelinestates[(int)Model::SkinningMode::Count][(int)Model::VertexFormat::Count];
+ComPtr<ID3D12PipelineState> Object3d::instancedPipelinestates[(int)Model::SkinningMode::Count][(int)Model::VertexFormat::Count];
 
 void Object3d::Initialize()
 {
-	HRESULT result;
-	// Creation of Constant Buffer
-	result = device->CreateCommittedResource(
-		&CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD),
-		D3D12_HEAP_FLAG_NONE,
-		&CD3DX12_RESOURCE_DESC::Buffer((sizeof(ConstBufferDataTransform) + 0xff) & ~0xff),
-		D3D12_RESOURCE_STATE_GENERIC_READ,
-		nullptr,
-		IID_PPV_ARGS(&constBuffTransform));
-
-	// Constant Buffer Creation (skinning)
-	result = device->CreateCommittedResource(
-		&CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD), // Upload possible
-		D3D12_HEAP_FLAG_NONE,
-		&CD3DX12_RESOURCE_DESC::Buffer((sizeof(ConstBufferDataSkin) + 0xff) & ~0xff),
-		D3D12_RESOURCE_STATE_GENERIC_READ,
-		nullptr,
-		IID_PPV_ARGS(&constBuffSkin));
-
-	// Data transfer to constant buffer
-	ConstBufferDataSkin* constMapSkin = nullptr;
-	result = constBuffSkin->Map(0, nullptr, (void**)&constMapSkin);
-	for (int i = 0; i < MAX_BONES; i++)
-	{
-		constMapSkin->bones[i] = XMMatrixIdentity();
-	}
-	constBuffSkin->Unmap(0, nullptr);
-
 	// Create graphics pipeline
 	Object3d::CreateGraphicsPipeline();
-
-	// Set time for 1 frame at 60fps
-	frameTime.SetTime(0, 0, 0, 1, 0, FbxTime::EMode::eFrames60);
 }
 
-void Object3d::Update()
+void Object3d::Update(float deltaTime)
 {
 	XMMATRIX matScale, matRot, matTrans;
 
@@ -71,96 +41,218 @@ void Object3d::Update()
 	matWorld *= matRot; // Reflect the rotation in the world matrix
 	matWorld *= matTrans; // Reflect translation in world matrix
 
-	// View projection matrix
-	const XMMATRIX& matViewProjection = camera->GetViewProjectionMatrix();
+	// Data transfer to constant buffer
+	TransferConstBuffer();
 
-	// Model mesh transformation
-	const XMMATRIX& modelTransform = model->GetModelTransform();
+	// Objects of an AnimationSystem are animated on its worker threads
+	if (animatedBySystem)
+	{
+		return;
+	}
 
+	UpdateSkinPalette(deltaTime);
+}
+
+void Object3d::TransferConstBuffer()
+{
+	ConstBufferDataTransform constData;
+	// View projection matrix
+	constData.viewproj = camera->GetViewProjectionMatrix();
+	// Model mesh transformation
+	constData.world = model->GetModelTransform() * matWorld;
 	// Camera coordinates
-	const XMFLOAT3& cameraPos = camera->GetEye();
+	constData.cameraPos = camera->GetEye();
 
-	HRESULT result;
+	UploadAllocator* uploadAllocator = UploadAllocator::GetInstance();
+	constBuffTransformAddress = uploadAllocator->Upload(constData);
+	constBuffTransformFrame = uploadAllocator->GetFrameNumber();
+}
 
-	// Data transfer to constant buffer
-	ConstBufferDataTransform* constMap = nullptr;
-	result = constBuffTransform->Map(0, nullptr, (void**)&constMap);
-	if (SUCCEEDED(result))
+void Object3d::UpdateAnimation(float deltaTime, XMVECTOR* palette)
+{
+	// Joint hierarchy and skin of the model
+	const Skeleton& skeleton = model->GetSkeleton();
+
+	// Start the first clip (again if the model was replaced)
+	if (animationPlayer.IsPlaying() == false || animationPlayer.GetModel() != model)
 	{
-		constMap->viewproj = matViewProjection;
-		constMap->world = modelTransform * matWorld;
-		constMap->cameraPos = cameraPos;
-		constBuffTransform->Unmap(0, nullptr);
+		PlayAnimation();
 	}
 
-	// Bone array
-	std::vector<Model::Bone>& bones = model->GetBones();
-
-	if (isPlay == false)
+	const Model::SkinningMode skinningMode = model->GetSkinningMode();
+	const size_t boneCount = skeleton.GetBoneCount();
+	if (animationPlayer.IsPlaying() == false || boneCount == 0)
 	{
-		PlayAnimation();
+		// Without animation the bones stay in the initial posture (also bone 0 of unskinned meshes)
+		FillIdentityPalette(palette, (std::max)(boneCount, (size_t)1), skinningMode);
+		skinnedBounds = model->GetBoundingBox();
+		return;
 	}
 
-	if (isPlay)
+	// Advance by the real elapsed time
+	animationPlayer.Update(deltaTime);
+
+	// Current posture of every joint, then the skinning transformations straight into the palette
+	animationPlayer.Evaluate(localPose);
+	skeleton.ComputeModelTransforms(localPose, jointTransforms.data());
+	if (!skeleton.ComputeBounds(jointTransforms.data(), skinnedBounds))
+	{
+		skinnedBounds = model->GetBoundingBox();
+	}
+	if (skinningMode == Model::SkinningMode::DualQuaternion)
+	{
+		skeleton.ComputeSkinDualQuaternions(jointTransforms.data(), palette);
+	}
+	else
 	{
-		// Advance one frame
-		currentTime += frameTime;
+		skeleton.ComputeSkinMatrices(jointTransforms.data(), reinterpret_cast<XMMATRIX*>(palette));
+	}
+}
 
-		// Return to the previous position after playing to the end
-		if (currentTime > endTime)
+BoundingBox Object3d::GetBoundingBox() const
+{
+	BoundingBox bounds;
+	skinnedBounds.Transform(bounds, model->GetModelTransform() * matWorld);
+	return bounds;
+}
+
+size_t Object3d::GetPaletteSize() const
+{
+	return (std::max)(model->GetSkeleton().GetBoneCount(), (size_t)1) * GetPaletteStride();
+}
+
+size_t Object3d::GetPaletteStride() const
+{
+	return model->GetSkinningMode() == Model::SkinningMode::DualQuaternion ? 2 : 4;
+}
+
+void Object3d::FillIdentityPalette(XMVECTOR* palette, size_t boneCount, Model::SkinningMode skinningMode)
+{
+	if (skinningMode == Model::SkinningMode::DualQuaternion)
+	{
+		for (size_t i = 0; i < boneCount; i++)
 		{
-			currentTime = startTime;
+			palette[i * 2] = XMQuaternionIdentity();
+			palette[i * 2 + 1] = XMVectorZero();
 		}
+		return;
 	}
 
-	// Constant buffer data transfer
-	ConstBufferDataSkin* constMapSkin = nullptr;
-	result = constBuffSkin->Map(0, nullptr, (void**)&constMapSkin);
+	XMMATRIX* matrices = reinterpret_cast<XMMATRIX*>(palette);
+	for (size_t i = 0; i < boneCount; i++)
+	{
+		matrices[i] = XMMatrixIdentity();
+	}
+}
 
-	for (int i = 0; i < bones.size(); i++)
+void Object3d::UpdateSkinPalette(float deltaTime)
+{
+	// The palettes of the previous frames may still be read by the GPU, so every frame writes a new one
+	UploadAllocator* uploadAllocator = UploadAllocator::GetInstance();
+	const UploadAllocator::Allocation allocation = uploadAllocator->Allocate(sizeof(XMVECTOR) * GetPaletteSize());
+	skinPaletteAddress = allocation.gpuAddress;
+	skinPaletteFrame = uploadAllocator->GetFrameNumber();
+	if (allocation.cpuAddress != nullptr)
 	{
-		// Current posture matrix
-		XMMATRIX matCurrentPose;
-		// Get the current posture matrix
-		FbxAMatrix fbxCurrentPose = bones[i].fbxCluster->GetLink()->EvaluateGlobalTransform(currentTime);
-		// Convert to XMMATRIX
-		FbxLoader::ConvertMatrixFromFbx(&matCurrentPose, fbxCurrentPose);
-		// Synthesize into a skinning matrix
-		constMapSkin->bones[i] = bones[i].invInitialPose * matCurrentPose;
+		UpdateAnimation(deltaTime, (XMVECTOR*)allocation.cpuAddress);
 	}
-	constBuffSkin->Unmap(0, nullptr);
+}
+
+void Object3d::UploadIdentityPalette()
+{
+	UploadAllocator* uploadAllocator = UploadAllocator::GetInstance();
+	const UploadAllocator::Allocation allocation = uploadAllocator->Allocate(sizeof(XMVECTOR) * GetPaletteSize());
+	skinPaletteAddress = allocation.gpuAddress;
+	skinPaletteFrame = uploadAllocator->GetFrameNumber();
+	if (allocation.cpuAddress != nullptr)
+	{
+		FillIdentityPalette((XMVECTOR*)allocation.cpuAddress, GetPaletteSize() / GetPaletteStride(), model->GetSkinningMode());
+	}
+}
+
+bool Object3d::PrepareFrameData()
+{
+	const uint64_t frameNumber = UploadAllocator::GetInstance()->GetFrameNumber();
+	if (constBuffTransformFrame != frameNumber)
+	{
+		TransferConstBuffer();
+	}
+	if (paletteAddress == 0 && skinPaletteFrame != frameNumber)
+	{
+		UploadIdentityPalette();
+	}
+	return constBuffTransformAddress != 0 && (paletteAddress != 0 || skinPaletteAddress != 0);
 }
 
 void Object3d::CreateGraphicsPipeline()
 {
 	HRESULT result = S_FALSE;
-	ComPtr<ID3DBlob> vsBlob; // Vertex shader object
+	ComPtr<ID3DBlob> vsBlobs[2][(int)Model::SkinningMode::Count]; // Vertex shader object (plain/instanced, per skinning mode)
+	ComPtr<ID3DBlob> vsCompactBlobs[2][(int)Model::SkinningMode::Count]; // Vertex shader object (compact vertices)
 	ComPtr<ID3DBlob> psBlob;    // Pixel shader object
 	ComPtr<ID3DBlob> errorBlob; // Error object
 
 	assert(device);
 
-	// Load and compile vertex shader
-	result = D3DCompileFromFile(
-		L"Resources/shaders/FBXVS.hlsl",    // Shader file name
-		nullptr,
-		D3D_COMPILE_STANDARD_FILE_INCLUDE, // Enable to include
-		"main", "vs_5_0",    // Entry point name, shader model specification
-		D3DCOMPILE_DEBUG | D3DCOMPILE_SKIP_OPTIMIZATION, // Debug settings
-		0,
-		&vsBlob, &errorBlob);
-	if (FAILED(result)) {
-		// Copy the error content from errorBlob to string type
-		std::string errstr;
-		errstr.resize(errorBlob->GetBufferSize());
+	// Shader variants of the skinning modes, for single objects and for instanced drawing
+	const D3D_SHADER_MACRO linearDefines[] = { { nullptr, nullptr } };
+	const D3D_SHADER_MACRO dualQuaternionDefines[] = { { "DUAL_QUATERNION_SKINNING", "1" }, { nullptr, nullptr } };
+	const D3D_SHADER_MACRO linearInstancedDefines[] = { { "INSTANCED", "1" }, { nullptr, nullptr } };
+	const D3D_SHADER_MACRO dualQuaternionInstancedDefines[] = {
+		{ "DUAL_QUATERNION_SKINNING", "1" }, { "INSTANCED", "1" }, { nullptr, nullptr } };
+	const D3D_SHADER_MACRO* skinningDefines[2][(int)Model::SkinningMode::Count] = {
+		{ linearDefines, dualQuaternionDefines }, { linearInstancedDefines, dualQuaternionInstancedDefines } };
 
-		std::copy_n((char*)errorBlob->GetBufferPointer(),
-			errorBlob->GetBufferSize(),
-			errstr.begin());
-		errstr += "\n";
-		// Display error details in output window
-		OutputDebugStringA(errstr.c_str());
-		exit(1);
+	for (int variant = 0; variant < 2 * (int)Model::SkinningMode::Count; variant++)
+	{
+		const int instanced = variant / (int)Model::SkinningMode::Count;
+		const int mode = variant % (int)Model::SkinningMode::Count;
+
+		// Load and compile vertex shader
+		result = D3DCompileFromFile(
+			L"Resources/shaders/FBXVS.hlsl",    // Shader file name
+			skinningDefines[instanced][mode],
+			D3D_COMPILE_STANDARD_FILE_INCLUDE, // Enable to include
+			"main", "vs_5_0",    // Entry point name, shader model specification
+			D3DCOMPILE_DEBUG | D3DCOMPILE_SKIP_OPTIMIZATION, // Debug settings
+			0,
+			&vsBlobs[instanced][mode], &errorBlob);
+		if (FAILED(result)) {
+			// Copy the error content from errorBlob to string type
+			std::string errstr;
+			errstr.resize(errorBlob->GetBufferSize());
+
+			std::copy_n((char*)errorBlob->GetBufferPointer(),
+				errorBlob->GetBufferSize(),
+				errstr.begin());
+			errstr += "\n";
+			// Display error details in output window
+			OutputDebugStringA(errstr.c_str());
+			exit(1);
+		}
+
+		// Load and compile vertex shader (compact vertices)
+		result = D3DCompileFromFile(
+			L"Resources/shaders/FBXCompactVS.hlsl",    // Shader file name
+			skinningDefines[instanced][mode],
+			D3D_COMPILE_STANDARD_FILE_INCLUDE, // Enable to include
+			"main", "vs_5_0",    // Entry point name, shader model specification
+			D3DCOMPILE_DEBUG | D3DCOMPILE_SKIP_OPTIMIZATION, // Debug settings
+			0,
+			&vsCompactBlobs[instanced][mode], &errorBlob);
+		if (FAILED(result)) {
+			// Copy the error content from errorBlob to string type
+			std::string errstr;
+			errstr.resize(errorBlob->GetBufferSize());
+
+			std::copy_n((char*)errorBlob->GetBufferPointer(),
+				errorBlob->GetBufferSize(),
+				errstr.begin());
+			errstr += "\n";
+			// Display error details in output window
+			OutputDebugStringA(errstr.c_str());
+			exit(1);
+		}
 	}
 
 	// Loading and compiling pixel shaders
@@ -215,9 +307,42 @@ void Object3d::CreateGraphicsPipeline()
 		},
 	};
 
+	// Vertex layout (Model::VertexCompact, position as snorm16)
+	D3D12_INPUT_ELEMENT_DESC inputLayoutCompact[] = {
+		{ // xyz coordinates relative to the bounding box
+			"POSITION", 0, DXGI_FORMAT_R16G16B16A16_SNORM, 0,
+			D3D12_APPEND_ALIGNED_ELEMENT,
+			D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0
+		},
+		{ // Octahedral encoded normal vector
+			"NORMAL", 0, DXGI_FORMAT_R16G16_SNORM, 0,
+			D3D12_APPEND_ALIGNED_ELEMENT,
+			D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0
+		},
+		{ // uv coordinates relative to the UV range
+			"TEXCOORD", 0, DXGI_FORMAT_R16G16_UNORM, 0,
+			D3D12_APPEND_ALIGNED_ELEMENT,
+			D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0
+		},
+		{ // Bone number to receive (4)
+			"BONEINDICES", 0, DXGI_FORMAT_R8G8B8A8_UINT, 0,
+			D3D12_APPEND_ALIGNED_ELEMENT,
+			D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0
+		},
+		{ // Bone skin weight (4)
+			"BONEWEIGHTS", 0, DXGI_FORMAT_R8G8B8A8_UNORM, 0,
+			D3D12_APPEND_ALIGNED_ELEMENT,
+			D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0
+		},
+	};
+
+	// Vertex layout (Model::VertexCompact, position as half float)
+	D3D12_INPUT_ELEMENT_DESC inputLayoutCompactHalf[_countof(inputLayoutCompact)];
+	std::copy_n(inputLayoutCompact, _countof(inputLayoutCompact), inputLayoutCompactHalf);
+	inputLayoutCompactHalf[0].Format = DXGI_FORMAT_R16G16B16A16_FLOAT;
+
 	// Set the flow of the graphics pipeline
 	D3D12_GRAPHICS_PIPELINE_STATE_DESC gpipeline{};
-	gpipeline.VS = CD3DX12_SHADER_BYTECODE(vsBlob.Get());
 	gpipeline.PS = CD3DX12_SHADER_BYTECODE(psBlob.Get());
 
 	// Sample mask
@@ -266,13 +391,19 @@ void Object3d::CreateGraphicsPipeline()
 
 	// [gp[^
 	//CD3DX12_ROOT_PARAMETER rootparams[2];
-	CD3DX12_ROOT_PARAMETER rootparams[3];
+	CD3DX12_ROOT_PARAMETER rootparams[6];
 	// CBV (for coordinate transformation matrix)
 	rootparams[0].InitAsConstantBufferView(0, 0, D3D12_SHADER_VISIBILITY_ALL);
 	// SRV (texture)
 	rootparams[1].InitAsDescriptorTable(1, &descRangeSRV, D3D12_SHADER_VISIBILITY_ALL);
-	// CBV (skinning)
-	rootparams[2].InitAsConstantBufferView(3, 0, D3D12_SHADER_VISIBILITY_ALL);
+	// Constants (first bone of the object in the palette, first instance of an instanced draw)
+	rootparams[2].InitAsConstants(2, 3, 0, D3D12_SHADER_VISIBILITY_VERTEX);
+	// CBV (dequantization of compact vertices)
+	rootparams[3].InitAsConstantBufferView(4, 0, D3D12_SHADER_VISIBILITY_ALL);
+	// SRV (skinning palette, structured buffer of matrices or dual quaternions)
+	rootparams[4].InitAsShaderResourceView(1, 0, D3D12_SHADER_VISIBILITY_VERTEX);
+	// SRV (world matrices and palette offsets of instanced drawing)
+	rootparams[5].InitAsShaderResourceView(2, 0, D3D12_SHADER_VISIBILITY_VERTEX);
 
 	// Static sampler
 	CD3DX12_STATIC_SAMPLER_DESC samplerDesc = CD3DX12_STATIC_SAMPLER_DESC(0);
@@ -290,9 +421,32 @@ void Object3d::CreateGraphicsPipeline()
 
 	gpipeline.pRootSignature = rootsignature.Get();
 
-	// Graphics pipeline generation
-	result = device->CreateGraphicsPipelineState(&gpipeline, IID_PPV_ARGS(pipelinestate.ReleaseAndGetAddressOf()));
-	if (FAILED(result)) { assert(0); }
+	for (int variant = 0; variant < 2 * (int)Model::SkinningMode::Count; variant++)
+	{
+		const int instanced = variant / (int)Model::SkinningMode::Count;
+		const int mode = variant % (int)Model::SkinningMode::Count;
+		ComPtr<ID3D12PipelineState>* modePipelines = instanced ? instancedPipelinestates[mode] : pipelinestates[mode];
+
+		// Graphics pipeline generation
+		gpipeline.VS = CD3DX12_SHADER_BYTECODE(vsBlobs[instanced][mode].Get());
+		gpipeline.InputLayout.pInputElementDescs = inputLayout;
+		gpipeline.InputLayout.NumElements = _countof(inputLayout);
+		result = device->CreateGraphicsPipelineState(&gpipeline, IID_PPV_ARGS(modePipelines[(int)Model::VertexFormat::Full].ReleaseAndGetAddressOf()));
+		if (FAILED(result)) { assert(0); }
+
+		// Graphics pipeline generation (compact vertices)
+		gpipeline.VS = CD3DX12_SHADER_BYTECODE(vsCompactBlobs[instanced][mode].Get());
+		gpipeline.InputLayout.pInputElementDescs = inputLayoutCompact;
+		gpipeline.InputLayout.NumElements = _countof(inputLayoutCompact);
+		result = device->CreateGraphicsPipelineState(&gpipeline, IID_PPV_ARGS(modePipelines[(int)Model::VertexFormat::Compact].ReleaseAndGetAddressOf()));
+		if (FAILED(result)) { assert(0); }
+
+		// Graphics pipeline generation (compact vertices, half float positions)
+		gpipeline.InputLayout.pInputElementDescs = inputLayoutCompactHalf;
+		gpipeline.InputLayout.NumElements = _countof(inputLayoutCompactHalf);
+		result = device->CreateGraphicsPipelineState(&gpipeline, IID_PPV_ARGS(modePipelines[(int)Model::VertexFormat::CompactHalf].ReleaseAndGetAddressOf()));
+		if (FAILED(result)) { assert(0); }
+	}
 }
 
 void Object3d::Draw(ID3D12GraphicsCommandList* cmdList)
@@ -303,8 +457,14 @@ void Object3d::Draw(ID3D12GraphicsCommandList* cmdList)
 		return;
 	}
 
-	// Pipeline state setting
-	cmdList->SetPipelineState(pipelinestate.Get());
+	// Constant buffer and palette of this frame
+	if (!PrepareFrameData())
+	{
+		return;
+	}
+
+	// Pipeline state setting (matching the skinning mode and the vertex format of the model)
+	cmdList->SetPipelineState(pipelinestates[(int)model->GetSkinningMode()][(int)model->GetVertexFormat()].Get());
 
 	// Root Graphics Signature setting
 	cmdList->SetGraphicsRootSignature(rootsignature.Get());
@@ -312,38 +472,89 @@ void Object3d::Draw(ID3D12GraphicsCommandList* cmdList)
 	// Set the primitive shape
 	cmdList->IASetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
 
-	// Set constant buffer view
-	cmdList->SetGraphicsRootConstantBufferView(0, constBuffTransform->GetGPUVirtualAddress());
+	// Set descriptor heap
+	ID3D12DescriptorHeap* ppHeaps[] = { model->GetDescriptorHeap() };
+	cmdList->SetDescriptorHeaps(_countof(ppHeaps), ppHeaps);
 
-	// Set constant buffer view (skinning)
-	cmdList->SetGraphicsRootConstantBufferView(2, constBuffSkin->GetGPUVirtualAddress());
+	RecordDraw(cmdList, this);
+}
 
-	// Model Drawing
-	model->Draw(cmdList);
+void Object3d::Submit(DrawQueue* drawQueue)
+{
+	// Return if no model
+	if (model == nullptr)
+	{
+		return;
+	}
+
+	// Constant buffer and palette of this frame
+	if (!PrepareFrameData())
+	{
+		return;
+	}
+
+	DrawQueue::DrawPacket packet;
+	packet.pipelineState = pipelinestates[(int)model->GetSkinningMode()][(int)model->GetVertexFormat()].Get();
+	packet.rootSignature = rootsignature.Get();
+	packet.topology = D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST;
+	packet.descriptorHeap = model->GetDescriptorHeap();
+	packet.record = RecordDraw;
+	packet.data = this;
+
+	// Objects of the same model together, nearer ones first
+	const XMFLOAT3& eye = camera->GetEye();
+	const float depth = XMVectorGetX(XMVector3Length(matWorld.r[3] - XMVectorSet(eye.x, eye.y, eye.z, 1.0f)));
+	packet.key = drawQueue->MakeKey(DrawQueue::Pass::Opaque, packet.pipelineState, model, depth);
+	drawQueue->Add(packet);
 }
 
-void Object3d::PlayAnimation()
+void Object3d::RecordDraw(ID3D12GraphicsCommandList* cmdList, const void* data)
 {
-	FbxScene* fbxScene = model->GetFbxScene();
+	const Object3d* object = (const Object3d*)data;
 
-	// Get animation frame 0
-	FbxAnimStack* animstack = fbxScene->GetSrcObject<FbxAnimStack>(0);
+	// Set constant buffer view
+	cmdList->SetGraphicsRootConstantBufferView(0, object->constBuffTransformAddress);
 
-	// Get name of animation
-	const char* animstackname = animstack->GetName();
+	// Skinning palette (the shared palette of the AnimationSystem if animated there)
+	if (object->paletteAddress != 0)
+	{
+		cmdList->SetGraphicsRootShaderResourceView(4, object->paletteAddress);
+		cmdList->SetGraphicsRoot32BitConstant(2, object->paletteOffset, 0);
+	}
+	else
+	{
+		cmdList->SetGraphicsRootShaderResourceView(4, object->skinPaletteAddress);
+		cmdList->SetGraphicsRoot32BitConstant(2, 0, 0);
+	}
 
-	// Animation time information
-	FbxTakeInfo* takeinfo = fbxScene->GetTakeInfo(animstackname);
+	// Model Drawing
+	object->model->DrawSubmeshes(cmdList);
+}
 
-	// Get start time
-	startTime = takeinfo->mLocalTimeSpan.GetStart();
+void Object3d::PlayAnimation()
+{
+	const std::vector<AnimationClip>& animationClips = model->GetAnimationClips();
 
-	// Get end time
-	endTime = takeinfo->mLocalTimeSpan.GetStop();
+	// Model without animation
+	if (animationClips.empty())
+	{
+		return;
+	}
+
+	// Play the first clip
+	PlayAnimation(animationClips[0].GetName());
+}
 
-	// Match start time
-	currentTime = startTime;
+bool Object3d::PlayAnimation(const std::string& clipName, float fadeTime, bool loop)
+{
+	// Working memory of the posture (allocated once per model, never while playing)
+	if (animationPlayer.GetModel() != model)
+	{
+		const Skeleton& skeleton = model->GetSkeleton();
+		animationPlayer.Initialize(model);
+		localPose.Resize(skeleton.GetJointCount());
+		jointTransforms.resize(skeleton.GetJointCount());
+	}
 
-	// Make request during playback
-	isPlay = true;
+	return animationPlayer.Play(clipName, fadeTime, loop);
 }
\ No newline at end of file
@@ -1,7 +1,10 @@
 #pragma once
 
 #include "Model.h"
+#include "AnimationPlayer.h"
 #include "Camera.h"
+#include "DrawQueue.h"
+#include "UploadAllocator.h"
 
 #include <Windows.h>
 #include <wrl.h>
@@ -9,6 +12,7 @@
 #include <d3dx12.h>
 #include <DirectXMath.h>
 #include <string>
+#include <vector>
 
 class Object3d
 {
@@ -20,12 +24,9 @@ protected: // Alias
 	using XMFLOAT2 = DirectX::XMFLOAT2;
 	using XMFLOAT3 = DirectX::XMFLOAT3;
 	using XMFLOAT4 = DirectX::XMFLOAT4;
+	using XMVECTOR = DirectX::XMVECTOR;
 	using XMMATRIX = DirectX::XMMATRIX;
 
-public: // Constant
-	// Maximum Bone Number
-	static const int MAX_BONES = 32;
-
 public:
 	// Data structure for constant buffer (for coordinate transformation matrix)
 	struct ConstBufferDataTransform
@@ -35,12 +36,6 @@ public:
 		XMFLOAT3 cameraPos; // Camera coordinates (world coordinates)
 	};
 
-	// Data structure for constant buffer (skinning)
-	struct ConstBufferDataSkin
-	{
-		XMMATRIX bones[MAX_BONES];
-	};
-
 public:
 	/// <summary>
 	/// Initialization
@@ -50,7 +45,23 @@ public:
 	/// <summary>
 	/// Every Frame Processing
 	/// </summary>
-	void Update();
+	/// <param name="deltaTime">Seconds since the previous frame (advances the animation)</param>
+	void Update(float deltaTime);
+
+	/// <summary>
+	/// Advance the animation and write the skinning transformations (matrices or dual quaternions, by the
+	/// skinning mode of the model)
+	/// Touches only this object, so different objects can be updated concurrently
+	/// </summary>
+	/// <param name="deltaTime">Seconds since the previous frame</param>
+	/// <param name="palette">Destination of the skinning transformations, GetPaletteSize() vectors (16-byte aligned)</param>
+	void UpdateAnimation(float deltaTime, XMVECTOR* palette);
+
+	// Number of palette vectors of the model (at least one bone, unskinned meshes use bone 0)
+	size_t GetPaletteSize() const;
+
+	// Vectors per bone in the palette (4 for a matrix, 2 for a dual quaternion)
+	size_t GetPaletteStride() const;
 
 	/// <summary>
 	/// Generate graphics pipeline
@@ -62,6 +73,12 @@ public:
 	/// </summary>
 	void Draw(ID3D12GraphicsCommandList* cmdList);
 
+	/// <summary>
+	/// Queue the drawing in a DrawQueue (opaque pass, front to back)
+	/// </summary>
+	/// <param name="drawQueue">Queue executed after the update of the object</param>
+	void Submit(DrawQueue* drawQueue);
+
 	/// <summary>
 	/// Setting model
 	/// </summary>
@@ -75,13 +92,38 @@ public:
 	const XMFLOAT3& GetRotation() { return rotation; }
 
 	/// <summary>
-	/// Animation Initialization
+	/// World space box containing the object in its current posture (for culling)
+	/// Skinned meshes use the bone boxes moved by the current bones, so the vertices are never skinned on the CPU.
+	/// </summary>
+	DirectX::BoundingBox GetBoundingBox() const;
+
+	/// <summary>
+	/// Animation Initialization (first clip of the model)
 	/// </summary>
 	void PlayAnimation();
 
+	/// <summary>
+	/// Play an animation clip by name
+	/// </summary>
+	/// <param name="clipName">Name of the clip (animation stack)</param>
+	/// <param name="fadeTime">Seconds of the cross-fade from the playing clip</param>
+	/// <param name="loop">Return to the start after the end</param>
+	/// <returns>False if the model has no clip of the name</returns>
+	bool PlayAnimation(const std::string& clipName, float fadeTime = 0.0f, bool loop = true);
+
+	// Player of the clips (layers, masks, speed)
+	AnimationPlayer& GetAnimationPlayer() { return animationPlayer; }
+
 protected:
-	// Constant Buffer
-	ComPtr<ID3D12Resource> constBuffTransform;
+	// Constant Buffer (in the UploadAllocator, written again every frame)
+	D3D12_GPU_VIRTUAL_ADDRESS constBuffTransformAddress = 0;
+	// Frame of the UploadAllocator the constant buffer was written in
+	uint64_t constBuffTransformFrame = UINT64_MAX;
+
+public:
+	// Friend Class
+	friend class AnimationSystem;
+	friend class InstancedRenderer;
 
 public:
 	// setter
@@ -90,11 +132,38 @@ public:
 
 	// Root signature
 	static ComPtr<ID3D12RootSignature> rootsignature;
-	// Pipeline state
-	static ComPtr<ID3D12PipelineState> pipelinestate;
+	// Pipeline state (one per skinning mode and vertex format)
+	static ComPtr<ID3D12PipelineState> pipelinestates[(int)Model::SkinningMode::Count][(int)Model::VertexFormat::Count];
+	// Pipeline state of instanced drawing (world matrices and palette offsets from the instance buffer)
+	static ComPtr<ID3D12PipelineState> instancedPipelinestates[(int)Model::SkinningMode::Count][(int)Model::VertexFormat::Count];
 
-	// Constant Buffer (skinning)
-	ComPtr<ID3D12Resource> constBuffSkin;
+	// Skinning transformations of this object when it is not animated by an AnimationSystem
+	// (in the UploadAllocator, written again every frame)
+	D3D12_GPU_VIRTUAL_ADDRESS skinPaletteAddress = 0;
+	// Frame of the UploadAllocator the palette was written in
+	uint64_t skinPaletteFrame = UINT64_MAX;
+
+private:
+	// Animate into a palette of this frame
+	void UpdateSkinPalette(float deltaTime);
+
+	// Write the transformation into the constant buffer of this frame
+	void TransferConstBuffer();
+
+	// Write a palette of this frame with the bones in the initial posture
+	void UploadIdentityPalette();
+
+	/// <summary>
+	/// Write the constant buffer and the palette again if they are from an earlier frame (object not updated)
+	/// </summary>
+	/// <returns>False if the upload memory of the frame is full</returns>
+	bool PrepareFrameData();
+
+	// Write identity transformations for a number of bones
+	static void FillIdentityPalette(XMVECTOR* palette, size_t boneCount, Model::SkinningMode skinningMode);
+
+	// Root parameters and draw of an object whose state is set (record function of its draw packet)
+	static void RecordDraw(ID3D12GraphicsCommandList* cmdList, const void* data);
 
 private:
 	// Device
@@ -115,18 +184,23 @@ protected:
 	// Model
 	Model* model = nullptr;
 
-	// 1 frame time
-	FbxTime frameTime;
+	// Blends the clips of the model
+	AnimationPlayer animationPlayer;
+
+	// Local joint transformations blended from the clips
+	Skeleton::LocalPose localPose;
 
-	// Animation start time
-	FbxTime startTime;
+	// Model space joint transformations
+	std::vector<XMMATRIX> jointTransforms;
 
-	// Animation end time
-	FbxTime endTime;
+	// Box of the skinned vertices in the space of the mesh (updated with the animation)
+	DirectX::BoundingBox skinnedBounds;
 
-	// Animation current time
-	FbxTime currentTime;
+	// Animated by an AnimationSystem instead of Update
+	bool animatedBySystem = false;
 
-	// Animation is playing
-	bool isPlay = false;
+	// Palette holding the skinning matrices this frame (0 to use skinPaletteAddress)
+	D3D12_GPU_VIRTUAL_ADDRESS paletteAddress = 0;
+	// Index of the first bone of this object in the palette (in matrices or dual quaternions)
+	UINT paletteOffset = 0;
 };
\ No newline at end of file
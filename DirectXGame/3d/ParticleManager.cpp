@@ -47,8 +47,6 @@ void ParticleManager::Initialize(ID3D12Device* device)
 
 	this->device = device;
 
-	HRESULT result;
-
 	// デスクリプタヒープの初期化
 	InitializeDescriptorHeap();
 
@@ -60,24 +58,10 @@ void ParticleManager::Initialize(ID3D12Device* device)
 
 	// モデル生成
 	CreateModel();
-
-	// 定数バッファの生成
-	result = device->CreateCommittedResource(
-		&CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD), 	// アップロード可能
-		D3D12_HEAP_FLAG_NONE,
-		&CD3DX12_RESOURCE_DESC::Buffer((sizeof(ConstBufferData) + 0xff)&~0xff),
-		D3D12_RESOURCE_STATE_GENERIC_READ,
-		nullptr,
-		IID_PPV_ARGS(&constBuff));
-	if (FAILED(result)) {
-		assert(0);
-	}
 }
 
 void ParticleManager::Update()
 {
-	HRESULT result;
-
 	// 寿命が尽きたパーティクルを全削除
 	particles.remove_if([](Particle& x) { return x.frame >= x.num_frame; });
 
@@ -107,45 +91,41 @@ void ParticleManager::Update()
 		it->rotation = it->s_rotation + (it->e_rotation - it->s_rotation) / f;
 	}	
 
-	// 頂点バッファへデータ転送
-	int vertCount = 0;
-	VertexPos* vertMap = nullptr;
-	result = vertBuff->Map(0, nullptr, (void**)&vertMap);
-	if (SUCCEEDED(result)) {
-		// パーティクルの情報を1つずつ反映
-		for (std::forward_list<Particle>::iterator it = particles.begin();
-			it != particles.end();
-			it++) {
-			// 座標
-			vertMap->pos = it->position;
-			// スケール
-			vertMap->scale = it->scale;
-			// 次の頂点へ
-			vertMap++;
-			if (++vertCount >= vertexCount) {
-				break;
-			}
-		}
-		vertBuff->Unmap(0, nullptr);
+	// 頂点バッファへデータ転送(GPUが前のフレームの頂点を読んでいる間も書けるよう毎フレーム新しい領域へ)
+	UINT vertCount = (UINT)std::distance(particles.begin(), particles.end());
+	if (vertCount > vertexCount) {
+		vertCount = vertexCount;
 	}
+	UploadAllocator::Allocation vertAllocation = UploadAllocator::GetInstance()->Allocate(sizeof(VertexPos) * vertCount, sizeof(float));
+	VertexPos* vertMap = (VertexPos*)vertAllocation.cpuAddress;
+	if (vertMap == nullptr) {
+		vertCount = 0;
+	}
+	// パーティクルの情報を1つずつ反映
+	std::forward_list<Particle>::iterator it = particles.begin();
+	for (UINT i = 0; i < vertCount; i++, it++) {
+		// 座標
+		vertMap->pos = it->position;
+		// スケール
+		vertMap->scale = it->scale;
+		// 次の頂点へ
+		vertMap++;
+	}
+	vbView.BufferLocation = vertAllocation.gpuAddress;
+	vbView.SizeInBytes = sizeof(VertexPos) * vertCount;
+	drawCount = vertCount;
 
 	// 定数バッファへデータ転送
-	ConstBufferData* constMap = nullptr;
-	result = constBuff->Map(0, nullptr, (void**)&constMap);
-	constMap->mat = camera->GetViewProjectionMatrix();
-	constMap->matBillboard = camera->GetBillboardMatrix();
-	constBuff->Unmap(0, nullptr);
+	ConstBufferData constData;
+	constData.mat = camera->GetViewProjectionMatrix();
+	constData.matBillboard = camera->GetBillboardMatrix();
+	constBuffAddress = UploadAllocator::GetInstance()->Upload(constData);
 }
 
 void ParticleManager::Draw(ID3D12GraphicsCommandList * cmdList)
 {
-	UINT drawNum = (UINT)std::distance(particles.begin(), particles.end());
-	if (drawNum > vertexCount) {
-		drawNum = vertexCount;
-	}
-
 	// パーティクルが1つもない場合
-	if (drawNum == 0) {
+	if (drawCount == 0) {
 		return;
 	}
 
@@ -158,20 +138,45 @@ void ParticleManager::Draw(ID3D12GraphicsCommandList * cmdList)
 	cmdList->SetGraphicsRootSignature(rootsignature.Get());
 	// プリミティブ形状を設定
 	cmdList->IASetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY_POINTLIST);
-		
-	// 頂点バッファの設定
-	cmdList->IASetVertexBuffers(0, 1, &vbView);
 
 	// デスクリプタヒープの配列
 	ID3D12DescriptorHeap* ppHeaps[] = { descHeap.Get() };
 	cmdList->SetDescriptorHeaps(_countof(ppHeaps), ppHeaps);
 
+	RecordDraw(cmdList, this);
+}
+
+void ParticleManager::Submit(DrawQueue* drawQueue)
+{
+	// パーティクルが1つもない場合
+	if (drawCount == 0) {
+		return;
+	}
+
+	DrawQueue::DrawPacket packet;
+	packet.pipelineState = pipelinestate.Get();
+	packet.rootSignature = rootsignature.Get();
+	packet.topology = D3D_PRIMITIVE_TOPOLOGY_POINTLIST;
+	packet.descriptorHeap = descHeap.Get();
+	packet.record = RecordDraw;
+	packet.data = this;
+	// 頂点は1つのバッファにまとめて描画するため深度は使わない
+	packet.key = drawQueue->MakeKey(DrawQueue::Pass::Transparent, packet.pipelineState, nullptr, 0.0f);
+	drawQueue->Add(packet);
+}
+
+void ParticleManager::RecordDraw(ID3D12GraphicsCommandList* cmdList, const void* data)
+{
+	const ParticleManager* particleManager = (const ParticleManager*)data;
+
+	// 頂点バッファの設定
+	cmdList->IASetVertexBuffers(0, 1, &particleManager->vbView);
 	// 定数バッファビューをセット
-	cmdList->SetGraphicsRootConstantBufferView(0, constBuff->GetGPUVirtualAddress());
+	cmdList->SetGraphicsRootConstantBufferView(0, particleManager->constBuffAddress);
 	// シェーダリソースビューをセット
-	cmdList->SetGraphicsRootDescriptorTable(1, gpuDescHandleSRV);
+	cmdList->SetGraphicsRootDescriptorTable(1, particleManager->gpuDescHandleSRV);
 	// 描画コマンド
-	cmdList->DrawInstanced(drawNum, 1, 0, 0);
+	cmdList->DrawInstanced(particleManager->drawCount, 1, 0, 0);
 }
 
 void ParticleManager::Add(int life, XMFLOAT3 position, XMFLOAT3 velocity, XMFLOAT3 accel, float start_scale, float end_scale)
@@ -453,23 +458,6 @@ void ParticleManager::LoadTexture()
 
 void ParticleManager::CreateModel()
 {
-	HRESULT result = S_FALSE;
-
-	// 頂点バッファ生成
-	result = device->CreateCommittedResource(
-		&CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD),
-		D3D12_HEAP_FLAG_NONE,
-		&CD3DX12_RESOURCE_DESC::Buffer(sizeof(VertexPos)*vertexCount),
-		D3D12_RESOURCE_STATE_GENERIC_READ,
-		nullptr,
-		IID_PPV_ARGS(&vertBuff));
-	if (FAILED(result)) {
-		assert(0);
-		return;
-	}
-
-	// 頂点バッファビューの作成
-	vbView.BufferLocation = vertBuff->GetGPUVirtualAddress();
-	vbView.SizeInBytes = sizeof(VertexPos)*vertexCount;
+	// 頂点バッファビューの作成(位置とサイズは毎フレームUpdateで設定)
 	vbView.StrideInBytes = sizeof(VertexPos);
 }
\ No newline at end of file
@@ -8,6 +8,8 @@
 #include <forward_list>
 
 #include "Camera.h"
+#include "DrawQueue.h"
+#include "UploadAllocator.h"
 
 /// <summary>
 /// パーティクルマネージャ
@@ -98,6 +100,12 @@ public: // メンバ関数
 	/// </summary>
 	void Draw(ID3D12GraphicsCommandList * cmdList);
 
+	/// <summary>
+	/// 描画パケットの追加(半透明パス)
+	/// </summary>
+	/// <param name="drawQueue">描画キュー</param>
+	void Submit(DrawQueue* drawQueue);
+
 	/// <summary>
 	/// カメラのセット
 	/// </summary>
@@ -149,23 +157,30 @@ private: // メンバ変数
 	ComPtr<ID3D12PipelineState> pipelinestate;
 	// デスクリプタヒープ
 	ComPtr<ID3D12DescriptorHeap> descHeap;
-	// 頂点バッファ
-	ComPtr<ID3D12Resource> vertBuff;
 	// テクスチャバッファ
 	ComPtr<ID3D12Resource> texbuff;
 	// シェーダリソースビューのハンドル(CPU)
 	CD3DX12_CPU_DESCRIPTOR_HANDLE cpuDescHandleSRV;
 	// シェーダリソースビューのハンドル(CPU)
 	CD3DX12_GPU_DESCRIPTOR_HANDLE gpuDescHandleSRV;
-	// 頂点バッファビュー
-	D3D12_VERTEX_BUFFER_VIEW vbView;
-	// 定数バッファ
-	ComPtr<ID3D12Resource> constBuff;
+	// 頂点バッファビュー(頂点はアップロードアロケータ内、毎フレームUpdateで転送)
+	D3D12_VERTEX_BUFFER_VIEW vbView{};
+	// 定数バッファ(アップロードアロケータ内、毎フレームUpdateで転送)
+	D3D12_GPU_VIRTUAL_ADDRESS constBuffAddress = 0;
 	// パーティクル配列
 	std::forward_list<Particle> particles;
 	// カメラ
 	Camera* camera = nullptr;
+	// 描画する頂点数(Updateで転送した数)
+	UINT drawCount = 0;
 private:
+	/// <summary>
+	/// ステート設定済みのコマンドリストへの描画(描画パケットの記録関数)
+	/// </summary>
+	/// <param name="cmdList">コマンドリスト</param>
+	/// <param name="data">パーティクルマネージャ</param>
+	static void RecordDraw(ID3D12GraphicsCommandList* cmdList, const void* data);
+
 	ParticleManager() = default;
 	ParticleManager(const ParticleManager&) = delete;
 	~ParticleManager() = default;
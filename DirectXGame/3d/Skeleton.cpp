@@ -0,0 +1,153 @@
+#include "Skeleton.h"
+#include "AnimationClip.h"
+
+#include <Windows.h>
+
+#include <chrono>
+#include <cstdio>
+
+using namespace DirectX;
+
+void Skeleton::LocalPose::Resize(size_t jointCount)
+{
+	scales.resize(jointCount, g_XMOne);
+	rotations.resize(jointCount, g_XMIdentityR3);
+	translations.resize(jointCount, g_XMZero);
+}
+
+void Skeleton::Initialize(const vector<int32_t>& parentIndices, const vector<int32_t>& boneJointIndices,
+	const vector<XMMATRIX>& invInitialPoses, const vector<BoundingBox>& boneBounds)
+{
+	this->parentIndices = parentIndices;
+	this->boneJointIndices = boneJointIndices;
+	this->invInitialPoses = invInitialPoses;
+	this->boneBounds = boneBounds;
+}
+
+void Skeleton::ComputeModelTransforms(const LocalPose& localPose, XMMATRIX* modelTransforms) const
+{
+	const XMVECTOR* scales = localPose.scales.data();
+	const XMVECTOR* rotations = localPose.rotations.data();
+	const XMVECTOR* translations = localPose.translations.data();
+
+	// Parents come before their children, so every parent is already in model space
+	for (size_t i = 0; i < parentIndices.size(); i++)
+	{
+		// Scale * rotation * translation, the scale applied to the rotation rows directly
+		XMMATRIX matrix = XMMatrixRotationQuaternion(rotations[i]);
+		matrix.r[0] = XMVectorMultiply(matrix.r[0], XMVectorSplatX(scales[i]));
+		matrix.r[1] = XMVectorMultiply(matrix.r[1], XMVectorSplatY(scales[i]));
+		matrix.r[2] = XMVectorMultiply(matrix.r[2], XMVectorSplatZ(scales[i]));
+		matrix.r[3] = XMVectorSelect(g_XMIdentityR3, translations[i], g_XMSelect1110);
+
+		const int32_t parentIndex = parentIndices[i];
+		modelTransforms[i] = parentIndex >= 0 ? XMMatrixMultiply(matrix, modelTransforms[parentIndex]) : matrix;
+	}
+}
+
+void Skeleton::ComputeSkinMatrices(const XMMATRIX* modelTransforms, XMMATRIX* skinMatrices) const
+{
+	for (size_t i = 0; i < boneJointIndices.size(); i++)
+	{
+		// Bones without animation stay in the initial posture
+		const int32_t jointIndex = boneJointIndices[i];
+		skinMatrices[i] = jointIndex >= 0 ? XMMatrixMultiply(invInitialPoses[i], modelTransforms[jointIndex]) : XMMatrixIdentity();
+	}
+}
+
+void Skeleton::ComputeSkinDualQuaternions(const XMMATRIX* modelTransforms, XMVECTOR* dualQuaternions) const
+{
+	for (size_t i = 0; i < boneJointIndices.size(); i++)
+	{
+		XMVECTOR& real = dualQuaternions[i * 2];
+		XMVECTOR& dual = dualQuaternions[i * 2 + 1];
+
+		// Bones without animation stay in the initial posture
+		const int32_t jointIndex = boneJointIndices[i];
+		XMVECTOR scale, rotation, translation;
+		if (jointIndex < 0 ||
+			!XMMatrixDecompose(&scale, &rotation, &translation, XMMatrixMultiply(invInitialPoses[i], modelTransforms[jointIndex])))
+		{
+			real = XMQuaternionIdentity();
+			dual = XMVectorZero();
+			continue;
+		}
+
+		// Rotation first, then translation: dual = 0.5 * t * r (t as pure quaternion)
+		translation = XMVectorSelect(g_XMZero, translation, g_XMSelect1110);
+		real = rotation;
+		dual = XMVectorScale(XMQuaternionMultiply(rotation, translation), 0.5f);
+	}
+}
+
+bool Skeleton::ComputeBounds(const XMMATRIX* modelTransforms, BoundingBox& bounds) const
+{
+	XMVECTOR boundsMin = g_XMFltMax;
+	XMVECTOR boundsMax = XMVectorNegate(g_XMFltMax);
+	bool hasBounds = false;
+	for (size_t i = 0; i < boneBounds.size(); i++)
+	{
+		// Bone without vertices
+		const BoundingBox& boneBox = boneBounds[i];
+		if (boneBox.Extents.x < 0.0f)
+		{
+			continue;
+		}
+
+		// Bones without animation stay in the initial posture
+		const int32_t jointIndex = boneJointIndices[i];
+		const XMMATRIX skinMatrix = jointIndex >= 0 ? XMMatrixMultiply(invInitialPoses[i], modelTransforms[jointIndex]) : XMMatrixIdentity();
+
+		// Box around the moved box: moved center, extents through the absolute rotation and scale
+		const XMVECTOR center = XMVector3Transform(XMLoadFloat3(&boneBox.Center), skinMatrix);
+		XMVECTOR extents = XMVectorScale(XMVectorAbs(skinMatrix.r[0]), boneBox.Extents.x);
+		extents = XMVectorMultiplyAdd(XMVectorReplicate(boneBox.Extents.y), XMVectorAbs(skinMatrix.r[1]), extents);
+		extents = XMVectorMultiplyAdd(XMVectorReplicate(boneBox.Extents.z), XMVectorAbs(skinMatrix.r[2]), extents);
+
+		boundsMin = XMVectorMin(boundsMin, XMVectorSubtract(center, extents));
+		boundsMax = XMVectorMax(boundsMax, XMVectorAdd(center, extents));
+		hasBounds = true;
+	}
+
+	if (hasBounds)
+	{
+		BoundingBox::CreateFromPoints(bounds, boundsMin, boundsMax);
+	}
+	return hasBounds;
+}
+
+void Skeleton::BenchmarkPosePipeline(const AnimationClip& clip) const
+{
+	// Number of frames timed per skeleton count
+	const int frameCount = 60;
+
+	LocalPose localPose;
+	localPose.Resize(GetJointCount());
+	clip.Sample(0.0f, localPose);
+
+	const size_t skeletonCounts[] = { 1, 100, 1000 };
+	for (size_t skeletonCount : skeletonCounts)
+	{
+		vector<XMMATRIX> modelTransforms(skeletonCount * GetJointCount());
+		vector<XMMATRIX> skinMatrices(skeletonCount * GetBoneCount());
+
+		auto start = std::chrono::steady_clock::now();
+		for (int frame = 0; frame < frameCount; frame++)
+		{
+			for (size_t i = 0; i < skeletonCount; i++)
+			{
+				XMMATRIX* skeletonTransforms = modelTransforms.data() + i * GetJointCount();
+				ComputeModelTransforms(localPose, skeletonTransforms);
+				ComputeSkinMatrices(skeletonTransforms, skinMatrices.data() + i * GetBoneCount());
+			}
+		}
+		auto end = std::chrono::steady_clock::now();
+
+		const double milliseconds = std::chrono::duration<double, std::milli>(end - start).count() / frameCount;
+		char str[256];
+		sprintf_s(str, "Skeleton: %zu skeletons x %zu joints / %zu bones, %.4f ms per frame (%.1f M joints/s)\n",
+			skeletonCount, GetJointCount(), GetBoneCount(), milliseconds,
+			milliseconds > 0.0 ? skeletonCount * GetJointCount() / (milliseconds * 1000.0) : 0.0);
+		OutputDebugStringA(str);
+	}
+}
@@ -0,0 +1,101 @@
+#pragma once
+
+#include <DirectXMath.h>
+#include <DirectXCollision.h>
+
+#include <cstdint>
+#include <vector>
+
+class AnimationClip;
+
+/// <summary>
+/// Runtime joint hierarchy of a model
+/// Joints are in topological order (parents before children) so that the model space pass is one linear loop,
+/// local poses are kept as separate scale/rotation/translation arrays (structure of arrays).
+/// </summary>
+class Skeleton
+{
+private: // Alias
+	// Using DirectX::
+	using XMVECTOR = DirectX::XMVECTOR;
+	using XMMATRIX = DirectX::XMMATRIX;
+	using BoundingBox = DirectX::BoundingBox;
+
+	// Using std::
+	template <class T> using vector = std::vector<T>;
+
+public: // Subclass
+	// Local transformation of every joint
+	struct LocalPose
+	{
+		vector<XMVECTOR> scales;
+		// Quaternions
+		vector<XMVECTOR> rotations;
+		vector<XMVECTOR> translations;
+
+		// Allocate the arrays for a number of joints
+		void Resize(size_t jointCount);
+	};
+
+public:
+	/// <summary>
+	/// Set up the hierarchy and the bind data of the skin
+	/// </summary>
+	/// <param name="parentIndices">Parent of every joint (-1 if root, always smaller than the own index)</param>
+	/// <param name="boneJointIndices">Joint of every bone (-1 if not animated)</param>
+	/// <param name="invInitialPoses">Inverse initial posture of every bone</param>
+	/// <param name="boneBounds">Initial posture box of the vertices of every bone (negative extents if none)</param>
+	void Initialize(const vector<int32_t>& parentIndices, const vector<int32_t>& boneJointIndices,
+		const vector<XMMATRIX>& invInitialPoses, const vector<BoundingBox>& boneBounds);
+
+	/// <summary>
+	/// Concatenate local joint transformations into model space joint transformations
+	/// </summary>
+	/// <param name="localPose">Local transformation of every joint</param>
+	/// <param name="modelTransforms">Destination, one matrix per joint</param>
+	void ComputeModelTransforms(const LocalPose& localPose, XMMATRIX* modelTransforms) const;
+
+	/// <summary>
+	/// Skinning matrices (inverse initial posture * current posture) of every bone
+	/// </summary>
+	/// <param name="modelTransforms">Model space joint transformations</param>
+	/// <param name="skinMatrices">Destination, one matrix per bone</param>
+	void ComputeSkinMatrices(const XMMATRIX* modelTransforms, XMMATRIX* skinMatrices) const;
+
+	/// <summary>
+	/// Skinning transformations of every bone as unit dual quaternions (half the size of the matrices)
+	/// The scale of the skinning matrices cannot be represented and is dropped.
+	/// </summary>
+	/// <param name="modelTransforms">Model space joint transformations</param>
+	/// <param name="dualQuaternions">Destination, two vectors per bone (real part: rotation, dual part: translation)</param>
+	void ComputeSkinDualQuaternions(const XMMATRIX* modelTransforms, XMVECTOR* dualQuaternions) const;
+
+	/// <summary>
+	/// Conservative box of the skinned vertices: the union of the bone boxes moved by their skinning matrices
+	/// (a blended vertex lies between its bones' positions, so it stays inside the union)
+	/// </summary>
+	/// <param name="modelTransforms">Model space joint transformations</param>
+	/// <param name="bounds">Destination in the space of the mesh</param>
+	/// <returns>False if no bone has vertices</returns>
+	bool ComputeBounds(const XMMATRIX* modelTransforms, BoundingBox& bounds) const;
+
+	/// <summary>
+	/// Report the throughput of the local to skin matrix pipeline for 1, 100 and 1000 skeletons
+	/// </summary>
+	/// <param name="clip">Clip of this skeleton, its first frame is the pose of every skeleton</param>
+	void BenchmarkPosePipeline(const AnimationClip& clip) const;
+
+	// getter
+	size_t GetJointCount() const { return parentIndices.size(); }
+	size_t GetBoneCount() const { return boneJointIndices.size(); }
+
+private:
+	// Parent of every joint (-1 if root)
+	vector<int32_t> parentIndices;
+	// Joint of every bone (-1 if not animated)
+	vector<int32_t> boneJointIndices;
+	// Inverse initial posture of every bone
+	vector<XMMATRIX> invInitialPoses;
+	// Initial posture box of the vertices of every bone
+	vector<BoundingBox> boneBounds;
+};
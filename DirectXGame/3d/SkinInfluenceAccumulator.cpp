@@ -0,0 +1,148 @@
+#include "SkinInfluenceAccumulator.h"
+
+#include <Windows.h>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <list>
+#include <random>
+
+template <int K>
+void SkinInfluenceAccumulator<K>::Benchmark(size_t vertexCount, int influencesPerVertex)
+{
+	// Bones of the generated skin
+	const uint32_t boneCount = 64;
+	// Number of timed runs per path
+	const int runCount = 5;
+
+	influencesPerVertex = (std::min)((std::max)(influencesPerVertex, 1), (int)boneCount);
+
+	// Generated skin in the order of an FBX file: one cluster per bone, listing its vertices and weights
+	// (every vertex gets different bones with weights summing to 1)
+	struct ClusterEntry
+	{
+		uint32_t vertex;
+		float weight;
+	};
+	std::vector<std::vector<ClusterEntry>> clusters(boneCount);
+	std::mt19937 random(12345);
+	std::uniform_real_distribution<float> weightDistribution(0.05f, 1.0f);
+	std::vector<float> weights(influencesPerVertex);
+	for (size_t vertex = 0; vertex < vertexCount; vertex++)
+	{
+		float total = 0.0f;
+		for (float& weight : weights)
+		{
+			weight = weightDistribution(random);
+			total += weight;
+		}
+		const uint32_t firstBone = random() % boneCount;
+		for (int i = 0; i < influencesPerVertex; i++)
+		{
+			clusters[(firstBone + i) % boneCount].push_back(ClusterEntry{ (uint32_t)vertex, weights[i] / total });
+		}
+	}
+
+	std::vector<uint32_t> boneIndices(vertexCount * K);
+	std::vector<float> boneWeights(vertexCount * K);
+
+	// Largest distance of the weight sum of a vertex from 1
+	auto measureSumError = [&]()
+	{
+		float maxError = 0.0f;
+		for (size_t vertex = 0; vertex < vertexCount; vertex++)
+		{
+			float total = 0.0f;
+			for (int i = 0; i < K; i++)
+			{
+				total += boneWeights[vertex * K + i];
+			}
+			maxError = (std::max)(maxError, fabsf(total - 1.0f));
+		}
+		return maxError;
+	};
+
+	// Previous path: a list of influences per vertex, sorted, the first K kept and bone 0 patched to reach 1
+	struct WeightSet
+	{
+		uint32_t index;
+		float weight;
+	};
+	auto listStart = std::chrono::steady_clock::now();
+	for (int run = 0; run < runCount; run++)
+	{
+		std::vector<std::list<WeightSet>> weightLists(vertexCount);
+		for (uint32_t bone = 0; bone < boneCount; bone++)
+		{
+			for (const ClusterEntry& entry : clusters[bone])
+			{
+				weightLists[entry.vertex].emplace_back(WeightSet{ bone, entry.weight });
+			}
+		}
+		for (size_t vertex = 0; vertex < vertexCount; vertex++)
+		{
+			std::list<WeightSet>& weightList = weightLists[vertex];
+			weightList.sort([](const WeightSet& lhs, const WeightSet& rhs) { return lhs.weight > rhs.weight; });
+
+			uint32_t* indices = &boneIndices[vertex * K];
+			float* vertexWeights = &boneWeights[vertex * K];
+			std::fill(indices, indices + K, 0);
+			std::fill(vertexWeights, vertexWeights + K, 0.0f);
+			int slot = 0;
+			for (const WeightSet& weightSet : weightList)
+			{
+				indices[slot] = weightSet.index;
+				vertexWeights[slot] = weightSet.weight;
+				if (++slot >= K)
+				{
+					float weight = 0.0f;
+					for (int i = 1; i < K; i++)
+					{
+						weight += vertexWeights[i];
+					}
+					vertexWeights[0] = 1.0f - weight;
+					break;
+				}
+			}
+		}
+	}
+	auto listEnd = std::chrono::steady_clock::now();
+	const float listSumError = measureSumError();
+
+	// Top-K accumulation
+	size_t droppedCount = 0;
+	for (int run = 0; run < runCount; run++)
+	{
+		SkinInfluenceAccumulator<K> influences(vertexCount);
+		for (uint32_t bone = 0; bone < boneCount; bone++)
+		{
+			for (const ClusterEntry& entry : clusters[bone])
+			{
+				influences.Add(entry.vertex, bone, entry.weight);
+			}
+		}
+		for (size_t vertex = 0; vertex < vertexCount; vertex++)
+		{
+			influences.Write(vertex, &boneIndices[vertex * K], &boneWeights[vertex * K]);
+		}
+		droppedCount = influences.GetDroppedCount();
+	}
+	auto accumulatorEnd = std::chrono::steady_clock::now();
+	const float accumulatorSumError = measureSumError();
+
+	const double listMilliseconds = std::chrono::duration<double, std::milli>(listEnd - listStart).count() / runCount;
+	const double accumulatorMilliseconds = std::chrono::duration<double, std::milli>(accumulatorEnd - listEnd).count() / runCount;
+	char str[256];
+	sprintf_s(str, "SkinInfluenceAccumulator<%d>: %zu vertices x %d influences, per-vertex lists %.3f ms, top-K %.3f ms (%.1fx)\n",
+		K, vertexCount, influencesPerVertex, listMilliseconds, accumulatorMilliseconds,
+		accumulatorMilliseconds > 0.0 ? listMilliseconds / accumulatorMilliseconds : 0.0);
+	OutputDebugStringA(str);
+	sprintf_s(str, "SkinInfluenceAccumulator<%d>: max weight sum error, lists %g, top-K %g (%zu influences dropped)\n",
+		K, listSumError, accumulatorSumError, droppedCount);
+	OutputDebugStringA(str);
+}
+
+// Supported influence counts
+template class SkinInfluenceAccumulator<4>;
+template class SkinInfluenceAccumulator<8>;
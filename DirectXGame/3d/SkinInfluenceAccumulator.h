@@ -0,0 +1,127 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/// <summary>
+/// Collects the K strongest bone influences of each vertex in flat fixed-size slots
+/// Memory is allocated once for all vertices, adding an influence never allocates
+/// </summary>
+/// <typeparam name="K">Number of influences kept per vertex (4 or 8)</typeparam>
+template <int K>
+class SkinInfluenceAccumulator
+{
+	static_assert(K == 4 || K == 8, "Only 4 or 8 influences per vertex are supported");
+
+public: // Constant
+	// Number of influences kept per vertex
+	static const int INFLUENCE_COUNT = K;
+
+public: // Subclass
+	// Bone number and skin weight pair
+	struct Influence
+	{
+		uint32_t boneIndex;
+		float weight;
+	};
+
+public:
+	/// <summary>
+	/// Constructor
+	/// </summary>
+	/// <param name="vertexCount">Number of vertices</param>
+	explicit SkinInfluenceAccumulator(size_t vertexCount)
+		: influences(vertexCount * K), counts(vertexCount, 0)
+	{
+	}
+
+	/// <summary>
+	/// Add an influence, keeping the slots of the vertex sorted by descending weight
+	/// </summary>
+	/// <param name="vertex">Vertex number</param>
+	/// <param name="boneIndex">Bone number</param>
+	/// <param name="weight">Skin weight</param>
+	void Add(size_t vertex, uint32_t boneIndex, float weight)
+	{
+		// Influences without effect are ignored
+		if (!(weight > 0.0f))
+		{
+			return;
+		}
+
+		Influence* slots = &influences[vertex * K];
+		uint8_t& count = counts[vertex];
+
+		// All slots in use and weaker than the weakest one
+		if (count == K)
+		{
+			droppedCount++;
+			if (weight <= slots[K - 1].weight)
+			{
+				return;
+			}
+			count--;
+		}
+
+		// Insertion sort step from the end
+		int slot = count;
+		while (slot > 0 && slots[slot - 1].weight < weight)
+		{
+			slots[slot] = slots[slot - 1];
+			slot--;
+		}
+		slots[slot] = Influence{ boneIndex, weight };
+		count++;
+	}
+
+	/// <summary>
+	/// Write the normalised influences of a vertex (unused slots get bone 0 with weight 0)
+	/// A vertex without influences follows bone 0 entirely
+	/// </summary>
+	/// <param name="vertex">Vertex number</param>
+	/// <param name="boneIndices">Destination of K bone numbers</param>
+	/// <param name="boneWeights">Destination of K weights, summing to 1</param>
+	template <typename IndexType>
+	void Write(size_t vertex, IndexType* boneIndices, float* boneWeights) const
+	{
+		const Influence* slots = &influences[vertex * K];
+		const int count = counts[vertex];
+
+		float total = 0.0f;
+		for (int i = 0; i < count; i++)
+		{
+			total += slots[i].weight;
+		}
+
+		for (int i = 0; i < K; i++)
+		{
+			boneIndices[i] = i < count ? (IndexType)slots[i].boneIndex : 0;
+			boneWeights[i] = i < count ? slots[i].weight / total : 0.0f;
+		}
+
+		if (count == 0)
+		{
+			boneWeights[0] = 1.0f;
+		}
+	}
+
+	// Number of influences that did not fit into the slots (dropped or replaced)
+	size_t GetDroppedCount() const { return droppedCount; }
+
+	/// <summary>
+	/// Time the accumulation of a generated skin against the previous sorted per-vertex lists
+	/// and report the largest weight sum error of both
+	/// </summary>
+	/// <param name="vertexCount">Number of vertices</param>
+	/// <param name="influencesPerVertex">Bones influencing each vertex</param>
+	static void Benchmark(size_t vertexCount, int influencesPerVertex);
+
+private:
+	// K slots per vertex
+	std::vector<Influence> influences;
+	// Slots in use per vertex
+	std::vector<uint8_t> counts;
+	// Influences beyond K
+	size_t droppedCount = 0;
+};
@@ -0,0 +1,104 @@
+#include "VertexWelder.h"
+
+#include <cstring>
+
+/// <summary>
+/// Static Member Variable Entity
+/// </summary>
+const uint32_t VertexWelder::EMPTY_SLOT;
+
+void VertexWelder::Reserve(size_t count)
+{
+	vertices.reserve(count);
+
+	// Keep the load factor at 0.5 or less
+	size_t capacity = 16;
+	while (capacity < count * 2)
+	{
+		capacity <<= 1;
+	}
+	if (capacity > table.size())
+	{
+		Rehash(capacity);
+	}
+}
+
+uint32_t VertexWelder::Add(const Vertex& vertex)
+{
+	stats.inputVertexCount++;
+
+	// Grow before the table becomes more than half full
+	if ((vertices.size() + 1) * 2 > table.size())
+	{
+		Rehash(table.empty() ? 16 : table.size() * 2);
+	}
+
+	// Linear probing
+	const size_t mask = table.size() - 1;
+	size_t slot = HashVertex(vertex) & mask;
+	while (table[slot] != EMPTY_SLOT)
+	{
+		// Identical vertex already registered
+		if (memcmp(&vertices[table[slot]], &vertex, sizeof(Vertex)) == 0)
+		{
+			return table[slot];
+		}
+		slot = (slot + 1) & mask;
+	}
+
+	// New unique vertex
+	uint32_t index = (uint32_t)vertices.size();
+	vertices.push_back(vertex);
+	table[slot] = index;
+	stats.uniqueVertexCount = vertices.size();
+
+	return index;
+}
+
+void VertexWelder::TakeVertices(std::vector<Vertex>& dst)
+{
+	dst.swap(vertices);
+	vertices.clear();
+	table.clear();
+	stats = Stats();
+}
+
+uint32_t VertexWelder::HashVertex(const Vertex& vertex)
+{
+	// FNV-1a over 32-bit words (the vertex consists of 4 byte members only)
+	static_assert(sizeof(Vertex) % sizeof(uint32_t) == 0, "Vertex must be made of 32-bit members");
+
+	uint32_t words[sizeof(Vertex) / sizeof(uint32_t)];
+	memcpy(words, &vertex, sizeof(Vertex));
+
+	uint32_t hash = 2166136261u;
+	for (uint32_t word : words)
+	{
+		hash ^= word;
+		hash *= 16777619u;
+	}
+
+	// Final mix so that the low bits used for the slot depend on all bits
+	hash ^= hash >> 15;
+	hash *= 0x2c1b3c6du;
+	hash ^= hash >> 12;
+
+	return hash;
+}
+
+void VertexWelder::Rehash(size_t newCapacity)
+{
+	table.assign(newCapacity, EMPTY_SLOT);
+
+	// Re-register all unique vertices
+	const size_t mask = newCapacity - 1;
+	for (uint32_t i = 0; i < (uint32_t)vertices.size(); i++)
+	{
+		size_t slot = HashVertex(vertices[i]) & mask;
+		while (table[slot] != EMPTY_SLOT)
+		{
+			slot = (slot + 1) & mask;
+		}
+		table[slot] = i;
+	}
+}
@@ -0,0 +1,72 @@
+#pragma once
+
+#include "Model.h"
+
+#include <cstdint>
+#include <vector>
+
+/// <summary>
+/// Merges bitwise identical vertices (position, normal, uv, skin) into a unique vertex set
+/// </summary>
+class VertexWelder
+{
+public: // Alias
+	using Vertex = Model::VertexPosNormalUvSkin;
+
+public: // Subclass
+	// Welding statistics
+	struct Stats
+	{
+		// Number of vertices passed to Add
+		size_t inputVertexCount = 0;
+		// Number of unique vertices after welding
+		size_t uniqueVertexCount = 0;
+
+		// Average number of references per unique vertex
+		float GetReuseRatio() const
+		{
+			return uniqueVertexCount ? (float)inputVertexCount / uniqueVertexCount : 0.0f;
+		}
+	};
+
+public:
+	/// <summary>
+	/// Reserve memory for the expected number of input vertices
+	/// </summary>
+	/// <param name="count">Expected number of vertices passed to Add</param>
+	void Reserve(size_t count);
+
+	/// <summary>
+	/// Add a vertex, returns the index of the identical vertex if it already exists
+	/// </summary>
+	/// <param name="vertex">Vertex to add</param>
+	/// <returns>Index into the unique vertex array</returns>
+	uint32_t Add(const Vertex& vertex);
+
+	/// <summary>
+	/// Move out the unique vertex array and reset the welder
+	/// </summary>
+	/// <param name="dst">Destination (overwritten)</param>
+	void TakeVertices(std::vector<Vertex>& dst);
+
+	// getter
+	const Stats& GetStats() const { return stats; }
+
+private:
+	// Hash of all vertex bits
+	static uint32_t HashVertex(const Vertex& vertex);
+
+	// Rebuild the hash table with the given capacity (power of two)
+	void Rehash(size_t newCapacity);
+
+private:
+	// Mark for an empty hash table slot
+	static const uint32_t EMPTY_SLOT = 0xffffffff;
+
+	// Unique vertices
+	std::vector<Vertex> vertices;
+	// Open addressing table of indices into vertices
+	std::vector<uint32_t> table;
+	// Statistics
+	Stats stats;
+};
@@ -0,0 +1,116 @@
+#pragma once
+
+#include <cstdint>
+
+/// <summary>
+/// Binary layout of a baked model (*.bmdl)
+/// Written next to the source FBX after the first import and memory-mapped on later loads.
+/// All sections are tightly packed in the order they are declared here:
+/// Header, dependency file names x dependencyCount, NodeRecord x nodeCount, vertices, indices, SubmeshRecord x submeshCount,
+/// MaterialRecord x materialCount, BoneRecord x boneCount, JointRecord x jointCount, clips x clipCount
+/// A clip is a ClipRecord followed by its name and, per track, the scale, rotation and translation channels.
+/// A channel is a ChannelRecord followed by its key frames (uint16_t x keyCount) and values (uint16_t x 3 x keyCount).
+/// Strings are stored as (uint32_t length, chars) without a terminator.
+/// </summary>
+namespace BakedModelFormat
+{
+	// File identifier ("BMDL")
+	static const uint32_t MAGIC = 0x4C444D42;
+
+	// Increase whenever the layout or the content of Model changes
+	static const uint32_t VERSION = 9;
+
+	// File extension
+	static const char* const EXTENSION = ".bmdl";
+
+	// File header
+	struct Header
+	{
+		uint32_t magic;
+		uint32_t version;
+		// Size of one vertex (guards against Model::VertexPosNormalUvSkin changes)
+		uint32_t vertexStride;
+		// Size of one index
+		uint32_t indexStride;
+		uint32_t nodeCount;
+		// Index of the node with the mesh (-1 if none)
+		int32_t meshNodeIndex;
+		uint32_t vertexCount;
+		uint32_t indexCount;
+		uint32_t submeshCount;
+		// DXGI_FORMAT of the index buffer
+		uint32_t indexFormat;
+		uint32_t materialCount;
+		uint32_t boneCount;
+		uint32_t jointCount;
+		uint32_t clipCount;
+		// Import settings of the bake, a file baked with other settings is stale
+		uint32_t optimizeMeshes;
+		float rotationTolerance;
+		float translationTolerance;
+		float scaleTolerance;
+		// Files read besides the source file (OBJ material libraries, relative to the model folder)
+		uint32_t dependencyCount;
+	};
+
+	// Fixed part of a node, followed by its name
+	struct NodeRecord
+	{
+		float scaling[4];
+		float rotation[4];
+		float translation[4];
+		float transform[16];
+		float globalTransform[16];
+		// Index of the parent node (-1 if root)
+		int32_t parentIndex;
+	};
+
+	// Submesh
+	struct SubmeshRecord
+	{
+		uint32_t indexStart;
+		uint32_t indexCount;
+		int32_t baseVertex;
+		uint32_t materialIndex;
+	};
+
+	// Fixed part of a material, followed by its name and texture path
+	struct MaterialRecord
+	{
+		float ambient[3];
+		float diffuse[3];
+	};
+
+	// Fixed part of a bone, followed by its name
+	struct BoneRecord
+	{
+		float invInitialPose[16];
+		// Joint moving the bone (-1 if not animated)
+		int32_t jointIndex;
+		// Initial posture box of the vertices of the bone (negative extents if none)
+		float boundsCenter[3];
+		float boundsExtents[3];
+	};
+
+	// Fixed part of a joint, followed by its name
+	struct JointRecord
+	{
+		// Index of the parent joint (-1 if root)
+		int32_t parentIndex;
+	};
+
+	// Fixed part of an animation clip, followed by its name and jointCount tracks
+	struct ClipRecord
+	{
+		float sampleRate;
+		uint32_t frameCount;
+	};
+
+	// Fixed part of a compressed channel
+	struct ChannelRecord
+	{
+		uint32_t keyCount;
+		float rangeMin[3];
+		float rangeExtent[3];
+	};
+}
@@ -1,6 +1,17 @@
 ﻿#include "FbxLoader.h"
+#include "BakedModelFormat.h"
+#include "MeshOptimizer.h"
+#include "ObjLoader/ObjLoader.h"
+#include "SkinInfluenceAccumulator.h"
+#include "VertexWelder.h"
 
+#include <algorithm>
 #include <cassert>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <objbase.h>
 
 using namespace DirectX;
 
@@ -11,6 +22,56 @@ const std::string FbxLoader::baseDirectory = "Resources/";
 
 const std::string FbxLoader::defaultTextureFileName = "white1x1.png";
 
+const int FbxLoader::ANIMATION_SAMPLE_RATE;
+
+// Time span of an animation stack
+static void GetAnimationSpan(FbxScene* fbxScene, FbxAnimStack* animStack, FbxTime& start, FbxTime& stop)
+{
+    // Get animation time information
+    FbxTakeInfo* takeInfo = fbxScene->GetTakeInfo(animStack->GetName());
+    FbxTimeSpan timeSpan = takeInfo ? takeInfo->mLocalTimeSpan : animStack->GetLocalTimeSpan();
+    start = timeSpan.GetStart();
+    stop = timeSpan.GetStop();
+}
+
+// Grow the initial posture box of every bone by the vertices it influences (in the space of the mesh node)
+static void ExpandBoneBounds(std::vector<Model::Bone>& bones, const std::vector<Model::VertexPosNormalUvSkin>& vertices)
+{
+    std::vector<XMVECTOR> boundsMin(bones.size(), g_XMFltMax);
+    std::vector<XMVECTOR> boundsMax(bones.size(), XMVectorNegate(g_XMFltMax));
+    for (const Model::VertexPosNormalUvSkin& vertex : vertices)
+    {
+        const XMVECTOR pos = XMLoadFloat3(&vertex.pos);
+        for (int i = 0; i < Model::MAX_BONE_INDICES; i++)
+        {
+            const UINT boneIndex = vertex.boneIndex[i];
+            if (vertex.boneWeight[i] > 0.0f && boneIndex < bones.size())
+            {
+                boundsMin[boneIndex] = XMVectorMin(boundsMin[boneIndex], pos);
+                boundsMax[boneIndex] = XMVectorMax(boundsMax[boneIndex], pos);
+            }
+        }
+    }
+
+    for (size_t i = 0; i < bones.size(); i++)
+    {
+        // Bone without vertices in this mesh
+        if (XMVector3Greater(boundsMin[i], boundsMax[i]))
+        {
+            continue;
+        }
+
+        // Add to the box the bone already has
+        BoundingBox bounds;
+        BoundingBox::CreateFromPoints(bounds, boundsMin[i], boundsMax[i]);
+        if (bones[i].bounds.Extents.x >= 0.0f)
+        {
+            BoundingBox::CreateMerged(bounds, bounds, bones[i].bounds);
+        }
+        bones[i].bounds = bounds;
+    }
+}
+
 FbxLoader* FbxLoader::GetInstance()
 {
     static FbxLoader instance;
@@ -39,492 +100,2004 @@ void FbxLoader::Initialize(ID3D12Device* device)
     // Assign member variables from pulling
     this->device = device;
 
-    // Fbx manager generation
-    fbxManager = FbxManager::Create();
-
-    // Fbx manager input/output settings
-    FbxIOSettings* ios = FbxIOSettings::Create(fbxManager, IOSROOT);
-    fbxManager->SetIOSettings(ios);
+    // Fbx manager and importer generation
+    CreateImporter(fbxManager, fbxImporter);
 
-    // Fbx importer generation
-    fbxImporter = FbxImporter::Create(fbxManager, "");
+    // Start the loading workers (one core is left to the main thread)
+    unsigned int workerCount = std::thread::hardware_concurrency();
+    workerCount = workerCount > 1 ? workerCount - 1 : 1;
+    stopWorkers = false;
+    for (unsigned int i = 0; i < workerCount; i++)
+    {
+        workers.emplace_back(&FbxLoader::WorkerMain, this);
+    }
 }
 
 void FbxLoader::Finalize()
 {
+    // Stop the loading workers (requests still queued are abandoned)
+    {
+        std::lock_guard<std::mutex> lock(jobMutex);
+        stopWorkers = true;
+    }
+    jobCondition.notify_all();
+    for (std::thread& worker : workers)
+    {
+        worker.join();
+    }
+    workers.clear();
+
+    // Models imported but never picked up by the main thread (their handles report a broken promise)
+    for (LoadJob& job : uploadQueue)
+    {
+        delete job.model;
+    }
+    uploadQueue.clear();
+    jobQueue.clear();
+    pendingLoads.clear();
+    streamingModels.clear();
+
     // Destroy various FBX instances
     fbxImporter->Destroy();
     fbxManager->Destroy();
 }
 
-Model* FbxLoader::LoadModelFromFile(const string& modelName)
+void FbxLoader::CreateImporter(FbxManager*& manager, FbxImporter*& importer)
 {
-    // Continue from the folder with same name as the model
-    const string directoryPath = baseDirectory + modelName + "/";
-
-    // Extention, add FBX
-    const string fileName = modelName + ".fbx";
-
-    // Connect to get full bus
-    const string fullpath = directoryPath + fileName;
-
-    // Specify each file and read the FBX file
-    if (!fbxImporter->Initialize(fullpath.c_str(), -1, fbxManager->GetIOSettings()))
-    {
-        assert(0);
-    }
-
-    // Scene generation
-    FbxScene* fbxScene = FbxScene::Create(fbxManager, "fbxScene");
-
-    // Import FBX informaiton loaded from file into scene
-    fbxImporter->Import(fbxScene);
-
-    // Model Generation
-    Model* model = new Model();
-    model->name = modelName;
+    // Fbx manager generation
+    manager = FbxManager::Create();
 
-    // Get number of nodes
-    int nodeCount = fbxScene->GetNodeCount();
+    // Fbx manager input/output settings
+    FbxIOSettings* ios = FbxIOSettings::Create(manager, IOSROOT);
+    manager->SetIOSettings(ios);
 
-    // By allocation the required number of memories in advance, it is possible to prevent he address from shifting
-    model->nodes.reserve(nodeCount);
+    // Fbx importer generation
+    importer = FbxImporter::Create(manager, "");
+}
 
-    // Analyze root node request and pour into model
-    ParseNodeRecursive(model, fbxScene->GetRootNode());
+Model* FbxLoader::LoadModelFromFile(const string& modelName)
+{
+    // Measure the load time
+    auto loadStart = std::chrono::steady_clock::now();
 
-    // FBX scene release
-    //fbxScene->Destroy();
-    model->fbxScene = fbxScene;
+    // CPU side import with the main thread's importer
+    Model* model = ImportModel(modelName, fbxManager, fbxImporter, GetImportSettings());
 
     // Create Buffer
     model->CreateBuffers(device);
+    if (model->HasStreamingMips())
+    {
+        streamingModels.push_back(model);
+    }
+
+    auto loadEnd = std::chrono::steady_clock::now();
+    char str[256];
+    sprintf_s(str, "FbxLoader: %s loaded in %.3f ms\n", modelName.c_str(),
+        std::chrono::duration<double, std::milli>(loadEnd - loadStart).count());
+    OutputDebugStringA(str);
 
     return model;
 }
 
-void FbxLoader::ParseNodeRecursive(Model* model, FbxNode* fbxNode, Node* parent)
+FbxLoader::ModelHandle FbxLoader::LoadModelAsync(const string& modelName)
 {
-    // Add node ot model
-    model->nodes.emplace_back();
-    Node& node = model->nodes.back();
+    // Workers are started by Initialize
+    assert(!workers.empty());
 
-    // Get node name
-    node.name = fbxNode->GetName();
-
-    // FBX node local move information
-    FbxDouble3 rotation = fbxNode->LclRotation.Get();
-    FbxDouble3 scaling = fbxNode->LclScaling.Get();
-    FbxDouble3 translation = fbxNode->LclTranslation.Get();
+    LoadJob job;
+    job.modelName = modelName;
+    job.settings = GetImportSettings();
+    ModelHandle handle = job.promise.get_future().share();
 
-    // Format conversion and assignment
-    node.rotation = { (float)rotation[0], (float)rotation[1], (float)rotation[2], 0.0f };
-    node.scaling = { (float)scaling[0], (float)scaling[1], (float)scaling[2], 0.0f };
-    node.translation = { (float)translation[0], (float)translation[1], (float)translation[2], 1.0f };
+    {
+        std::lock_guard<std::mutex> lock(jobMutex);
 
-    // Convert rotation from degrees to radians
-    node.rotation.m128_f32[0] = XMConvertToRadians(node.rotation.m128_f32[0]);
-    node.rotation.m128_f32[1] = XMConvertToRadians(node.rotation.m128_f32[1]);
-    node.rotation.m128_f32[2] = XMConvertToRadians(node.rotation.m128_f32[2]);
+        // Share the request still in flight, two workers must not import and bake the same model at once
+        auto pending = pendingLoads.find(modelName);
+        if (pending != pendingLoads.end())
+        {
+            return pending->second;
+        }
+        pendingLoads[modelName] = handle;
 
-    // Scale, rotation, translation matrix calculation
-    XMMATRIX matScaling, matRotation, matTranslation;
-    matScaling = XMMatrixScalingFromVector(node.scaling);
-    matRotation = XMMatrixRotationRollPitchYawFromVector(node.rotation);
-    matTranslation = XMMatrixTranslationFromVector(node.translation);
+        jobQueue.push_back(std::move(job));
+    }
+    jobCondition.notify_one();
 
-    // Calculation of local transformation matrix
-    node.transform = XMMatrixIdentity();
-    node.transform *= matScaling;
-    node.transform *= matRotation;
-    node.transform *= matTranslation;
+    return handle;
+}
 
-    // Calculation of global transformation matrix
-    node.globalTransform = node.transform;
-    if (parent)
+void FbxLoader::ProcessLoadedModels()
+{
+    // Take all finished imports at once so the workers are not blocked during buffer creation
+    std::vector<LoadJob> finished;
     {
-        node.parent = parent;
-
-        // Multiply the parent transformation
-        node.globalTransform *= parent->globalTransform;
+        std::lock_guard<std::mutex> lock(uploadMutex);
+        finished.swap(uploadQueue);
     }
 
-    // Analyze the mesh information of FBX node
-    FbxNodeAttribute* fbxNodeAttribute = fbxNode->GetNodeAttribute();
-
-    if (fbxNodeAttribute)
+    for (LoadJob& job : finished)
     {
-        if (fbxNodeAttribute->GetAttributeType() == FbxNodeAttribute::eMesh)
+        // Create Buffer
+        job.model->CreateBuffers(device);
+        if (job.model->HasStreamingMips())
         {
-            model->meshNode = &node;
-            ParseMesh(model, fbxNode);
+            streamingModels.push_back(job.model);
         }
-    }
 
-    // Recursive call to child nodes
-    for (int i = 0; i < fbxNode->GetChildCount(); i++)
-    {
-        ParseNodeRecursive(model, fbxNode->GetChild(i), &node);
+        job.promise.set_value(job.model);
+
+        // Later requests load the model again
+        std::lock_guard<std::mutex> lock(jobMutex);
+        pendingLoads.erase(job.modelName);
     }
 }
 
-void FbxLoader::ParseMesh(Model* model, FbxNode* fbxNode)
+Model* FbxLoader::WaitModel(const ModelHandle& handle)
 {
-    // Get mesh of node
-    FbxMesh* fbxMesh = fbxNode->GetMesh();
-
-    // Vertex coordinate reading
-    ParseMeshVertices(model, fbxMesh);
+    // Keep creating buffers while waiting, otherwise the handle would never become ready
+    while (handle.wait_for(std::chrono::milliseconds(1)) != std::future_status::ready)
+    {
+        ProcessLoadedModels();
+    }
 
-    // Surface data reading
-    ParseMeshFaces(model, fbxMesh);
+    return handle.get();
+}
 
-    // Material reading
-    ParseMaterial(model, fbxNode);
+void FbxLoader::UpdateStreaming(uint64_t frameNumber, uint64_t finishedFrameCount)
+{
+    // Once per model however many objects draw it, finished models leave the list
+    streamingModels.erase(std::remove_if(streamingModels.begin(), streamingModels.end(),
+        [frameNumber, finishedFrameCount](Model* model) { return !model->UpdateTextureStreaming(frameNumber, finishedFrameCount); }),
+        streamingModels.end());
+}
 
-    // Skinning reading
-    ParseSkin(model, fbxMesh);
+void FbxLoader::CancelStreaming(Model* model)
+{
+    streamingModels.erase(std::remove(streamingModels.begin(), streamingModels.end(), model), streamingModels.end());
 }
 
-void FbxLoader::ParseMeshVertices(Model* model, FbxMesh* fbxMesh)
+bool FbxLoader::CookModel(const string& modelName)
 {
-    auto& vertices = model->vertices;
+    const string bakedPath = baseDirectory + modelName + "/" + modelName + BakedModelFormat::EXTENSION;
 
-    // Number of vertex coordinates
-    const int controlPointsCount = fbxMesh->GetControlPointsCount();
+    // Always import from the source file
+    DeleteFileA(bakedPath.c_str());
 
-    // Secure as many vertex data arrays as needed
-    Model::VertexPosNormalUvSkin vert{};
-    model->vertices.resize(controlPointsCount, vert);
+    // Own FBX SDK instances so that several models can be cooked at once
+    FbxManager* manager = nullptr;
+    FbxImporter* importer = nullptr;
+    CreateImporter(manager, importer);
 
-    // Get the vertex coordinate array of FBX mesh
-    FbxVector4* pCoord = fbxMesh->GetControlPoints();
+    Model* model = ImportModel(modelName, manager, importer, GetImportSettings());
+    delete model;
 
-    // Copy all vertex coordinates of FBX mesh to the array in the model
-    for (int i = 0; i < controlPointsCount; i++)
-    {
-        Model::VertexPosNormalUvSkin& vertex = vertices[i];
-        
-        // Copy of coordinates
-        vertex.pos.x = (float)pCoord[i][0];
-        vertex.pos.y = (float)pCoord[i][1];
-        vertex.pos.z = (float)pCoord[i][2];
-    }
+    importer->Destroy();
+    manager->Destroy();
+
+    return GetFileAttributesA(bakedPath.c_str()) != INVALID_FILE_ATTRIBUTES;
 }
 
-void FbxLoader::ParseMeshFaces(Model* model, FbxMesh* fbxMesh)
+Model* FbxLoader::ImportModelFromFile(const string& modelName)
 {
-    auto& vertices = model->vertices;
-    auto& indices = model->indices;
-
-    // 1 files does not support multiple mesh models
-    assert(indices.size() == 0);
+    // Own FBX SDK instances, like CookModel
+    FbxManager* manager = nullptr;
+    FbxImporter* importer = nullptr;
+    CreateImporter(manager, importer);
 
-    // Number of faces
-    const int polygonCount = fbxMesh->GetPolygonCount();
+    Model* model = ImportModel(modelName, manager, importer, GetImportSettings());
 
-    // Number of UV data
-    const int textureUVCount = fbxMesh->GetTextureUVCount();
+    importer->Destroy();
+    manager->Destroy();
 
-    // UV name list
-    FbxStringList uvNames;
-    fbxMesh->GetUVSetNames(uvNames);
+    return model;
+}
 
-    // Reading information for each surface
-    for (int i = 0; i < polygonCount; i++)
+std::vector<std::string> FbxLoader::FindModelNames()
+{
+    // Every model folder in the resource directory holding an FBX or OBJ file of the same name
+    std::vector<string> modelNames;
+    WIN32_FIND_DATAA findData;
+    HANDLE find = FindFirstFileA((baseDirectory + "*").c_str(), &findData);
+    if (find != INVALID_HANDLE_VALUE)
     {
-        // Get number of vertices that match the face (3 is a triangle polygon)
-        const int polygonSize = fbxMesh->GetPolygonSize(i);
-        assert(polygonSize <= 4);
-
-        // Process one vertex at a time
-        for (int j = 0; j < polygonSize; j++)
+        do
         {
-            // FBX vertex array index
-            int index = fbxMesh->GetPolygonVertex(i, j);
-            assert(index >= 0);
-
-            // Read vertex normals
-            Model::VertexPosNormalUvSkin& vertex = vertices[index];
-            FbxVector4 normal;
-            if (fbxMesh->GetPolygonVertexNormal(i, j, normal))
+            const string name = findData.cFileName;
+            if ((findData.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) && name != "." && name != ".." &&
+                (GetFileAttributesA((baseDirectory + name + "/" + name + ".fbx").c_str()) != INVALID_FILE_ATTRIBUTES ||
+                GetFileAttributesA((baseDirectory + name + "/" + name + ".obj").c_str()) != INVALID_FILE_ATTRIBUTES))
             {
-                vertex.normal.x = (float)normal[0];
-                vertex.normal.y = (float)normal[1];
-                vertex.normal.z = (float)normal[2];
+                modelNames.push_back(name);
             }
+        } while (FindNextFileA(find, &findData));
+        FindClose(find);
+    }
 
-            // Texture UV reading
-            if (textureUVCount > 0)
-            {
-                FbxVector2 uvs;
-                bool lUnmappedUV;
-
-                // Read by number 0 (?)
-                if (fbxMesh->GetPolygonVertexUV(i, j, uvNames[0], uvs, lUnmappedUV))
-                {
-                    vertex.uv.x = (float)uvs[0];
-                    vertex.uv.y = (float)uvs[1];
-                }
-            }
+    return modelNames;
+}
 
-            // Add vertex index to index distribution column
-            // Up to 3rd vertex
-            if (j < 3)
-            {
-                // Add one point and build a triangle with the other two points
-                indices.push_back(index);
-            }
-            // 4th point
-            else
-            {
-                // Add 3 points
-                // Build a riangle with 2, 3, 0 of 0, 1, 2, 3 of quadrilateral
-                int index2 = indices[indices.size() - 1];
-                int index3 = index;
-                int index0 = indices[indices.size() - 3];
-                indices.push_back(index2);
-                indices.push_back(index3);
-                indices.push_back(index0);
-            }
-        }
+void FbxLoader::DeleteBakedModels(const std::vector<string>& modelNames)
+{
+    for (const string& name : modelNames)
+    {
+        DeleteFileA((baseDirectory + name + "/" + name + BakedModelFormat::EXTENSION).c_str());
     }
 }
 
-void FbxLoader::ParseMaterial(Model* model, FbxNode* fbxNode)
+void FbxLoader::BenchmarkLoading()
 {
-    const int materialCount = fbxNode->GetMaterialCount();
-    if (materialCount > 0)
+    const std::vector<string> modelNames = FindModelNames();
+
+    // Serial: one model after another on the main thread (from the source files, each load writes the baked file)
+    DeleteBakedModels(modelNames);
+    auto serialStart = std::chrono::steady_clock::now();
+    for (const string& name : modelNames)
     {
-        // Get front line material
-        FbxSurfaceMaterial* material = fbxNode->GetMaterial(0);
+        delete LoadModelFromFile(name);
+    }
+    auto serialEnd = std::chrono::steady_clock::now();
 
-        // Flag indicating whether the texture has been loaded
-        bool textureLoaded = false;
+    // Parallel: all requests at once, buffers created as the imports finish (from the source files again)
+    DeleteBakedModels(modelNames);
+    auto parallelStart = std::chrono::steady_clock::now();
+    std::vector<ModelHandle> handles;
+    for (const string& name : modelNames)
+    {
+        handles.push_back(LoadModelAsync(name));
+    }
+    for (const ModelHandle& handle : handles)
+    {
+        delete WaitModel(handle);
+    }
+    auto parallelEnd = std::chrono::steady_clock::now();
 
-        if (material)
-        {
-            // Check if it is a FBXSurfaceLambert class
-            if (material->GetClassId().Is(FbxSurfaceLambert::ClassId))
-            {
-                FbxSurfaceLambert* lambert = static_cast<FbxSurfaceLambert*>(material);
-
-                // Optical light coefficient
-                FbxPropertyT<FbxDouble3> ambient = lambert->Ambient;
-                model->ambient.x = (float)ambient.Get()[0];
-                model->ambient.y = (float)ambient.Get()[1];
-                model->ambient.z = (float)ambient.Get()[2];
-
-                // Optical Light Reflection Coefficient
-                FbxPropertyT<FbxDouble3> diffuse = lambert->Diffuse;
-                model->diffuse.x = (float)diffuse.Get()[0];
-                model->diffuse.y = (float)diffuse.Get()[1];
-                model->diffuse.z = (float)diffuse.Get()[2];
-            }
+    char str[256];
+    sprintf_s(str, "FbxLoader: %zu models from source, serial %.3f ms, parallel %.3f ms (%zu workers)\n", modelNames.size(),
+        std::chrono::duration<double, std::milli>(serialEnd - serialStart).count(),
+        std::chrono::duration<double, std::milli>(parallelEnd - parallelStart).count(), workers.size());
+    OutputDebugStringA(str);
+}
 
-            // Remove diffuse texture
-            const FbxProperty diffuseProperty = material->FindProperty(FbxSurfaceMaterial::sDiffuse);
-            if (diffuseProperty.IsValid())
-            {
-                const FbxFileTexture* texture = diffuseProperty.GetSrcObject<FbxFileTexture>();
-                if (texture)
-                {
-                    const char* filepath = texture->GetFileName();
-                    
-                    // Extract file name from file bus
-                    string path_str(filepath);
-                    string name = ExtractFileName(path_str);
-
-                    // Read texture
-                    LoadTexture(model, baseDirectory + model->name + "/" + name);
-                    textureLoaded = true;
-                }
-            }
-        }
+void FbxLoader::BenchmarkBakedLoading()
+{
+    const std::vector<string> modelNames = FindModelNames();
+    const ImportSettings settings = GetImportSettings();
 
-        // If there is no texture, paste a white texture
-        if (!textureLoaded)
-        {
-            LoadTexture(model, baseDirectory + defaultTextureFileName);
-        }
+    // CPU side imports only, with one FBX SDK instance for both paths
+    FbxManager* manager = nullptr;
+    FbxImporter* importer = nullptr;
+    CreateImporter(manager, importer);
+
+    double sourceTotal = 0.0;
+    double bakedTotal = 0.0;
+    for (const string& name : modelNames)
+    {
+        // Source file (FBX or OBJ), writing the baked file
+        DeleteBakedModels(std::vector<string>(1, name));
+        auto sourceStart = std::chrono::steady_clock::now();
+        delete ImportModel(name, manager, importer, settings);
+        auto sourceEnd = std::chrono::steady_clock::now();
+
+        // Baked file just written
+        delete ImportModel(name, manager, importer, settings);
+        auto bakedEnd = std::chrono::steady_clock::now();
+
+        const double sourceMilliseconds = std::chrono::duration<double, std::milli>(sourceEnd - sourceStart).count();
+        const double bakedMilliseconds = std::chrono::duration<double, std::milli>(bakedEnd - sourceEnd).count();
+        sourceTotal += sourceMilliseconds;
+        bakedTotal += bakedMilliseconds;
+
+        char str[256];
+        sprintf_s(str, "FbxLoader: %s source %.3f ms, baked %.3f ms (%.1fx)\n", name.c_str(), sourceMilliseconds,
+            bakedMilliseconds, bakedMilliseconds > 0.0 ? sourceMilliseconds / bakedMilliseconds : 0.0);
+        OutputDebugStringA(str);
     }
+
+    char str[256];
+    sprintf_s(str, "FbxLoader: %zu models, source %.3f ms, baked %.3f ms (%.1fx)\n", modelNames.size(), sourceTotal,
+        bakedTotal, bakedTotal > 0.0 ? sourceTotal / bakedTotal : 0.0);
+    OutputDebugStringA(str);
+
+    importer->Destroy();
+    manager->Destroy();
 }
 
-void FbxLoader::ParseSkin(Model* model, FbxMesh* fbxMesh)
+void FbxLoader::BenchmarkAnimation(const string& modelName, int instanceCount)
 {
-    // Skinning information
-    FbxSkin* fbxSkin = static_cast<FbxSkin*>(fbxMesh->GetDeformer(0, FbxDeformer::eSkin));
-
-    // If no skinning information, end
-    if (fbxSkin == nullptr)
+    // Number of frames timed
+    const int frameCount = 60;
+
+    // Own FBX SDK instances, the scene has to stay alive for the evaluator
+    FbxManager* manager = nullptr;
+    FbxImporter* importer = nullptr;
+    CreateImporter(manager, importer);
+
+    const string fullpath = baseDirectory + modelName + "/" + modelName + ".fbx";
+    FbxScene* fbxScene = FbxScene::Create(manager, "fbxScene");
+    if (!importer->Initialize(fullpath.c_str(), -1, manager->GetIOSettings()) || !importer->Import(fbxScene) ||
+        fbxScene->GetSrcObjectCount<FbxAnimStack>() == 0)
     {
-        // Process for each vertex
-        for (int i = 0; i < model->vertices.size(); i++)
-        {
-            // Make the shadow of the first bone (identity matrix) 100%
-            model->vertices[i].boneIndex[0] = 0;
-            model->vertices[i].boneWeight[0] = 1.0f;
-        }
-
+        importer->Destroy();
+        manager->Destroy();
         return;
     }
 
-    // Bone array reference
-    std::vector<Model::Bone>& bones = model->bones;
+    // CPU side model with its bones and baked clips
+    Model model;
+    model.nodes.reserve(fbxScene->GetNodeCount());
+    ParseNodeRecursive(&model, fbxScene->GetRootNode());
+    ParseAnimation(&model, fbxScene, animationCompression);
+    if (model.animationClips.empty())
+    {
+        fbxScene->Destroy();
+        importer->Destroy();
+        manager->Destroy();
+        return;
+    }
+
+    FbxAnimStack* animStack = fbxScene->GetSrcObject<FbxAnimStack>(0);
+    fbxScene->SetCurrentAnimationStack(animStack);
+    FbxTime startTime, stopTime;
+    GetAnimationSpan(fbxScene, animStack, startTime, stopTime);
+
+    const AnimationClip& clip = model.animationClips[0];
+    std::vector<Model::Bone>& bones = model.bones;
+    const Skeleton& skeleton = model.GetSkeleton();
+    Skeleton::LocalPose localPose;
+    localPose.Resize(skeleton.GetJointCount());
+    std::vector<XMMATRIX> jointTransforms(skeleton.GetJointCount());
+    std::vector<XMMATRIX> skinFbx(bones.size());
+    std::vector<XMMATRIX> skinBaked(bones.size());
+
+    // Instances play at different times so that the evaluator cannot reuse its results
+    auto instanceTime = [&](int frame, int instance)
+    {
+        const float duration = clip.GetDuration();
+        const float time = (float)(frame + instance * 7) / ANIMATION_SAMPLE_RATE;
+        return duration > 0.0f ? fmodf(time, duration) : 0.0f;
+    };
+
+    // Skinning matrices of one instance through the FBX evaluator (the previous runtime path)
+    auto evaluateFbx = [&](float time)
+    {
+        FbxTime fbxTime;
+        fbxTime.SetSecondDouble(startTime.GetSecondDouble() + time);
+        for (size_t i = 0; i < bones.size(); i++)
+        {
+            XMMATRIX matCurrentPose;
+            ConvertMatrixFromFbx(&matCurrentPose, bones[i].fbxCluster->GetLink()->EvaluateGlobalTransform(fbxTime));
+            skinFbx[i] = bones[i].invInitialPose * matCurrentPose;
+        }
+    };
+
+    // Skinning matrices of one instance from the baked clip
+    auto evaluateBaked = [&](float time)
+    {
+        clip.Sample(time, localPose);
+        skeleton.ComputeModelTransforms(localPose, jointTransforms.data());
+        skeleton.ComputeSkinMatrices(jointTransforms.data(), skinBaked.data());
+    };
+
+    auto fbxStart = std::chrono::steady_clock::now();
+    for (int frame = 0; frame < frameCount; frame++)
+    {
+        for (int instance = 0; instance < instanceCount; instance++)
+        {
+            evaluateFbx(instanceTime(frame, instance));
+        }
+    }
+    auto fbxEnd = std::chrono::steady_clock::now();
+    for (int frame = 0; frame < frameCount; frame++)
+    {
+        for (int instance = 0; instance < instanceCount; instance++)
+        {
+            evaluateBaked(instanceTime(frame, instance));
+        }
+    }
+    auto bakedEnd = std::chrono::steady_clock::now();
+
+    // Largest matrix element difference between both paths on the sampled frames
+    float maxError = 0.0f;
+    for (uint32_t frame = 0; frame < clip.GetFrameCount(); frame++)
+    {
+        const float time = (float)frame / ANIMATION_SAMPLE_RATE;
+        evaluateFbx(time);
+        evaluateBaked(time);
+        for (size_t i = 0; i < bones.size(); i++)
+        {
+            for (int row = 0; row < 4; row++)
+            {
+                XMFLOAT4 difference;
+                XMStoreFloat4(&difference, XMVectorAbs(XMVectorSubtract(skinFbx[i].r[row], skinBaked[i].r[row])));
+                maxError = (std::max)({ maxError, difference.x, difference.y, difference.z, difference.w });
+            }
+        }
+    }
+
+    const double fbxMilliseconds = std::chrono::duration<double, std::milli>(fbxEnd - fbxStart).count() / frameCount;
+    const double bakedMilliseconds = std::chrono::duration<double, std::milli>(bakedEnd - fbxEnd).count() / frameCount;
+    char str[256];
+    sprintf_s(str, "FbxLoader: %s %d instances x %zu bones, FBX evaluator %.3f ms/frame, baked clip %.3f ms/frame (%.1fx), max error %g\n",
+        modelName.c_str(), instanceCount, bones.size(), fbxMilliseconds, bakedMilliseconds,
+        bakedMilliseconds > 0.0 ? fbxMilliseconds / bakedMilliseconds : 0.0, maxError);
+    OutputDebugStringA(str);
+
+    fbxScene->Destroy();
+    importer->Destroy();
+    manager->Destroy();
+}
+
+void FbxLoader::BenchmarkTextureFormats(const string& fileName)
+{
+    // Number of timed loads per format
+    const int runCount = 10;
+
+    const string sourcePath = baseDirectory + fileName;
+    const size_t extensionPos = sourcePath.find_last_of('.');
+    if (extensionPos == string::npos)
+    {
+        return;
+    }
+    const string ddsPath = sourcePath.substr(0, extensionPos) + ".dds";
+
+    wchar_t wsourcePath[256];
+    wchar_t wddsPath[256];
+    MultiByteToWideChar(CP_ACP, 0, sourcePath.c_str(), -1, wsourcePath, _countof(wsourcePath));
+    MultiByteToWideChar(CP_ACP, 0, ddsPath.c_str(), -1, wddsPath, _countof(wddsPath));
+
+    TexMetadata sourceMetadata = {};
+    ScratchImage sourceImage;
+    if (FAILED(LoadFromWICFile(wsourcePath, WIC_FLAGS_NONE, &sourceMetadata, sourceImage)))
+    {
+        return;
+    }
+
+    // Without a cooked variant, write one like the AssetCooker: full mip chain, BC1/BC3 if made of whole blocks
+    const bool writeDds = GetFileAttributesA(ddsPath.c_str()) == INVALID_FILE_ATTRIBUTES;
+    if (writeDds)
+    {
+        ScratchImage mipChain;
+        if (FAILED(GenerateMipMaps(*sourceImage.GetImage(0, 0, 0), TEX_FILTER_DEFAULT, 0, mipChain)))
+        {
+            return;
+        }
+        ScratchImage compressed;
+        ScratchImage* output = &mipChain;
+        if (sourceMetadata.width % 4 == 0 && sourceMetadata.height % 4 == 0)
+        {
+            const DXGI_FORMAT format = mipChain.IsAlphaAllOpaque() ? DXGI_FORMAT_BC1_UNORM : DXGI_FORMAT_BC3_UNORM;
+            if (FAILED(Compress(mipChain.GetImages(), mipChain.GetImageCount(), mipChain.GetMetadata(),
+                format, TEX_COMPRESS_DEFAULT, TEX_THRESHOLD_DEFAULT, compressed)))
+            {
+                return;
+            }
+            output = &compressed;
+        }
+        if (FAILED(SaveToDDSFile(output->GetImages(), output->GetImageCount(), output->GetMetadata(), DDS_FLAGS_NONE, wddsPath)))
+        {
+            return;
+        }
+    }
+
+    // Decode of the source, as LoadTexture does without a DDS file
+    auto sourceStart = std::chrono::steady_clock::now();
+    for (int run = 0; run < runCount; run++)
+    {
+        LoadFromWICFile(wsourcePath, WIC_FLAGS_NONE, &sourceMetadata, sourceImage);
+    }
+    auto sourceEnd = std::chrono::steady_clock::now();
+
+    // Read of the cooked variant
+    TexMetadata ddsMetadata = {};
+    ScratchImage ddsImage;
+    HRESULT result = S_OK;
+    for (int run = 0; run < runCount && SUCCEEDED(result); run++)
+    {
+        result = LoadFromDDSFile(wddsPath, DDS_FLAGS_NONE, &ddsMetadata, ddsImage);
+    }
+    auto ddsEnd = std::chrono::steady_clock::now();
+
+    if (writeDds)
+    {
+        DeleteFileA(ddsPath.c_str());
+    }
+    if (FAILED(result))
+    {
+        return;
+    }
+
+    const double sourceMilliseconds = std::chrono::duration<double, std::milli>(sourceEnd - sourceStart).count() / runCount;
+    const double ddsMilliseconds = std::chrono::duration<double, std::milli>(ddsEnd - sourceEnd).count() / runCount;
+    char str[512];
+    sprintf_s(str, "FbxLoader: %s %zux%zu, source %.3f ms %zu bytes (1 mip), DDS %.3f ms %zu bytes (%zu mips, format %d) (%.1fx)\n",
+        fileName.c_str(), sourceMetadata.width, sourceMetadata.height, sourceMilliseconds, sourceImage.GetPixelsSize(),
+        ddsMilliseconds, ddsImage.GetPixelsSize(), ddsMetadata.mipLevels, (int)ddsMetadata.format,
+        ddsMilliseconds > 0.0 ? sourceMilliseconds / ddsMilliseconds : 0.0);
+    OutputDebugStringA(str);
+}
+
+void FbxLoader::WorkerMain()
+{
+    // WIC texture loading needs COM on this thread
+    HRESULT result = CoInitializeEx(nullptr, COINIT_MULTITHREADED);
+
+    // Each worker owns its FBX SDK instances, an importer can only read one file at a time
+    FbxManager* manager = nullptr;
+    FbxImporter* importer = nullptr;
+    CreateImporter(manager, importer);
+
+    while (true)
+    {
+        LoadJob job;
+        {
+            std::unique_lock<std::mutex> lock(jobMutex);
+            jobCondition.wait(lock, [this] { return stopWorkers || !jobQueue.empty(); });
+            if (stopWorkers)
+            {
+                break;
+            }
+            job = std::move(jobQueue.front());
+            jobQueue.pop_front();
+        }
+
+        // CPU side import, the GPU resources are created on the main thread
+        job.model = ImportModel(job.modelName, manager, importer, job.settings);
+
+        std::lock_guard<std::mutex> lock(uploadMutex);
+        uploadQueue.push_back(std::move(job));
+    }
+
+    importer->Destroy();
+    manager->Destroy();
+
+    if (SUCCEEDED(result))
+    {
+        CoUninitialize();
+    }
+}
+
+Model* FbxLoader::ImportModel(const string& modelName, FbxManager* manager, FbxImporter* importer,
+    const ImportSettings& settings)
+{
+    // Measure the import time
+    auto loadStart = std::chrono::steady_clock::now();
+
+    // Continue from the folder with same name as the model
+    const string directoryPath = baseDirectory + modelName + "/";
+
+    // Extention, add FBX
+    const string fileName = modelName + ".fbx";
+
+    // Connect to get full bus
+    string fullpath = directoryPath + fileName;
+
+    // Models without an FBX file are read from the OBJ file of the same name
+    const bool isObj = GetFileAttributesA(fullpath.c_str()) == INVALID_FILE_ATTRIBUTES &&
+        GetFileAttributesA((directoryPath + modelName + ".obj").c_str()) != INVALID_FILE_ATTRIBUTES;
+    if (isObj)
+    {
+        fullpath = directoryPath + modelName + ".obj";
+    }
+
+    // Baked model file placed next to the FBX file
+    const string bakedPath = directoryPath + modelName + BakedModelFormat::EXTENSION;
+
+    // Model Generation
+    Model* model = new Model();
+    model->name = modelName;
+    model->vertexFormat = settings.vertexFormat;
+
+    // Skip the FBX SDK entirely when the baked model is up to date
+    if (IsBakedModelFresh(bakedPath, fullpath, settings))
+    {
+        if (LoadBakedModel(model, bakedPath))
+        {
+            auto loadEnd = std::chrono::steady_clock::now();
+            char str[256];
+            sprintf_s(str, "FbxLoader: %s imported from baked file in %.3f ms\n", modelName.c_str(),
+                std::chrono::duration<double, std::milli>(loadEnd - loadStart).count());
+            OutputDebugStringA(str);
+
+            return model;
+        }
+
+        // Broken file, start over from FBX
+        delete model;
+        model = new Model();
+        model->name = modelName;
+        model->vertexFormat = settings.vertexFormat;
+    }
+
+    if (isObj)
+    {
+        ObjLoader objLoader;
+        if (!objLoader.LoadModel(model, directoryPath, modelName + ".obj"))
+        {
+            assert(0);
+        }
+
+        // Same post-processing as the FBX path, OBJ has no animation so it is always baked
+        model->SelectIndexFormat();
+        if (settings.optimizeMeshes)
+        {
+            OptimizeModel(model);
+        }
+        SaveBakedModel(model, bakedPath, settings, objLoader.GetMaterialLibraries());
+
+        auto loadEnd = std::chrono::steady_clock::now();
+        char str[256];
+        sprintf_s(str, "FbxLoader: %s imported from OBJ in %.3f ms\n", modelName.c_str(),
+            std::chrono::duration<double, std::milli>(loadEnd - loadStart).count());
+        OutputDebugStringA(str);
+
+        return model;
+    }
+
+    // Specify each file and read the FBX file
+    if (!importer->Initialize(fullpath.c_str(), -1, manager->GetIOSettings()))
+    {
+        assert(0);
+    }
+
+    // Scene generation
+    FbxScene* fbxScene = FbxScene::Create(manager, "fbxScene");
+
+    // Import FBX informaiton loaded from file into scene
+    importer->Import(fbxScene);
+
+    // Get number of nodes
+    int nodeCount = fbxScene->GetNodeCount();
+
+    // By allocation the required number of memories in advance, it is possible to prevent he address from shifting
+    model->nodes.reserve(nodeCount);
+
+    // Analyze root node request and pour into model
+    ParseNodeRecursive(model, fbxScene->GetRootNode());
+
+    // Box of every bone from the weights as the shader sees them, once every mesh is in the space of the mesh node
+    // (meshes without skin move with bone 0, even when they come before the mesh that creates it)
+    ExpandBoneBounds(model->bones, model->vertices);
+
+    // Bake the animation, the model does not need the scene afterwards
+    ParseAnimation(model, fbxScene, settings.animationCompression);
+
+    // FBX scene release
+    for (Model::Bone& bone : model->bones)
+    {
+        bone.fbxCluster = nullptr;
+    }
+    fbxScene->Destroy();
+
+    // Choose the index width (splitting large meshes if needed)
+    model->SelectIndexFormat();
+
+    // Reorder for the GPU caches (stored in the baked model as well)
+    if (settings.optimizeMeshes)
+    {
+        OptimizeModel(model);
+    }
+
+    SaveBakedModel(model, bakedPath, settings);
+
+    auto loadEnd = std::chrono::steady_clock::now();
+    char str[256];
+    sprintf_s(str, "FbxLoader: %s imported from FBX in %.3f ms\n", modelName.c_str(),
+        std::chrono::duration<double, std::milli>(loadEnd - loadStart).count());
+    OutputDebugStringA(str);
+
+    return model;
+}
+
+void FbxLoader::ParseNodeRecursive(Model* model, FbxNode* fbxNode, Node* parent)
+{
+    // Add node ot model
+    model->nodes.emplace_back();
+    Node& node = model->nodes.back();
+
+    // Get node name
+    node.name = fbxNode->GetName();
+
+    // FBX node local move information
+    FbxDouble3 rotation = fbxNode->LclRotation.Get();
+    FbxDouble3 scaling = fbxNode->LclScaling.Get();
+    FbxDouble3 translation = fbxNode->LclTranslation.Get();
+
+    // Format conversion and assignment
+    node.rotation = { (float)rotation[0], (float)rotation[1], (float)rotation[2], 0.0f };
+    node.scaling = { (float)scaling[0], (float)scaling[1], (float)scaling[2], 0.0f };
+    node.translation = { (float)translation[0], (float)translation[1], (float)translation[2], 1.0f };
+
+    // Convert rotation from degrees to radians
+    node.rotation.m128_f32[0] = XMConvertToRadians(node.rotation.m128_f32[0]);
+    node.rotation.m128_f32[1] = XMConvertToRadians(node.rotation.m128_f32[1]);
+    node.rotation.m128_f32[2] = XMConvertToRadians(node.rotation.m128_f32[2]);
+
+    // Scale, rotation, translation matrix calculation
+    XMMATRIX matScaling, matRotation, matTranslation;
+    matScaling = XMMatrixScalingFromVector(node.scaling);
+    matRotation = XMMatrixRotationRollPitchYawFromVector(node.rotation);
+    matTranslation = XMMatrixTranslationFromVector(node.translation);
+
+    // Calculation of local transformation matrix
+    node.transform = XMMatrixIdentity();
+    node.transform *= matScaling;
+    node.transform *= matRotation;
+    node.transform *= matTranslation;
+
+    // Calculation of global transformation matrix
+    node.globalTransform = node.transform;
+    if (parent)
+    {
+        node.parent = parent;
+
+        // Multiply the parent transformation
+        node.globalTransform *= parent->globalTransform;
+    }
+
+    // Analyze the mesh information of FBX node
+    FbxNodeAttribute* fbxNodeAttribute = fbxNode->GetNodeAttribute();
+
+    if (fbxNodeAttribute)
+    {
+        if (fbxNodeAttribute->GetAttributeType() == FbxNodeAttribute::eMesh)
+        {
+            // The first mesh node gives the model transformation
+            if (model->meshNode == nullptr)
+            {
+                model->meshNode = &node;
+            }
+            ParseMesh(model, fbxNode, node);
+        }
+    }
+
+    // Recursive call to child nodes
+    for (int i = 0; i < fbxNode->GetChildCount(); i++)
+    {
+        ParseNodeRecursive(model, fbxNode->GetChild(i), &node);
+    }
+}
+
+void FbxLoader::ParseMesh(Model* model, FbxNode* fbxNode, const Node& node)
+{
+    // Get mesh of node
+    FbxMesh* fbxMesh = fbxNode->GetMesh();
+
+    // Vertices per control point of this mesh
+    std::vector<Model::VertexPosNormalUvSkin> controlPoints;
+
+    // Vertex coordinate reading
+    ParseMeshVertices(model, fbxMesh, controlPoints);
+
+    // All submeshes share the transformation of the first mesh node, so other meshes are brought into its space
+    const XMMATRIX toMeshNode = &node != model->meshNode ?
+        node.globalTransform * XMMatrixInverse(nullptr, model->meshNode->globalTransform) : XMMatrixIdentity();
+
+    // Skinning reading (per control point, before the vertices are split by the faces)
+    ParseSkin(model, fbxMesh, controlPoints);
+
+    // Material reading
+    std::vector<UINT> materialIndices;
+    ParseMaterial(model, fbxNode, materialIndices);
+
+    // Surface data reading
+    const size_t vertexStart = model->vertices.size();
+    ParseMeshFaces(model, fbxMesh, controlPoints, materialIndices);
+
+    // Bring other meshes into the space of the first mesh node
+    if (&node != model->meshNode)
+    {
+        for (size_t i = vertexStart; i < model->vertices.size(); i++)
+        {
+            Model::VertexPosNormalUvSkin& vertex = model->vertices[i];
+            XMVECTOR pos = XMVector3TransformCoord(XMLoadFloat3(&vertex.pos), toMeshNode);
+            XMVECTOR normal = XMVector3Normalize(XMVector3TransformNormal(XMLoadFloat3(&vertex.normal), toMeshNode));
+            XMStoreFloat3(&vertex.pos, pos);
+            XMStoreFloat3(&vertex.normal, normal);
+        }
+    }
+}
+
+void FbxLoader::ParseMeshVertices(Model* model, FbxMesh* fbxMesh, std::vector<Model::VertexPosNormalUvSkin>& vertices)
+{
+    // Number of vertex coordinates
+    const int controlPointsCount = fbxMesh->GetControlPointsCount();
+
+    // Secure as many vertex data arrays as needed
+    Model::VertexPosNormalUvSkin vert{};
+    vertices.resize(controlPointsCount, vert);
+
+    // Get the vertex coordinate array of FBX mesh
+    FbxVector4* pCoord = fbxMesh->GetControlPoints();
+
+    // Copy all vertex coordinates of FBX mesh to the array in the model
+    for (int i = 0; i < controlPointsCount; i++)
+    {
+        Model::VertexPosNormalUvSkin& vertex = vertices[i];
+        
+        // Copy of coordinates
+        vertex.pos.x = (float)pCoord[i][0];
+        vertex.pos.y = (float)pCoord[i][1];
+        vertex.pos.z = (float)pCoord[i][2];
+    }
+}
+
+void FbxLoader::ParseMeshFaces(Model* model, FbxMesh* fbxMesh,
+    const std::vector<Model::VertexPosNormalUvSkin>& controlPoints, const std::vector<UINT>& materialIndices)
+{
+    auto& vertices = model->vertices;
+    auto& indices = model->indices;
+
+    // Number of faces
+    const int polygonCount = fbxMesh->GetPolygonCount();
+
+    // Number of UV data
+    const int textureUVCount = fbxMesh->GetTextureUVCount();
+
+    // UV name list
+    FbxStringList uvNames;
+    fbxMesh->GetUVSetNames(uvNames);
+
+    // Material assignment per polygon (none or all same: every polygon uses material 0)
+    FbxGeometryElementMaterial* materialElement = fbxMesh->GetElementMaterial();
+    const bool materialPerPolygon = materialElement &&
+        materialElement->GetMappingMode() == FbxGeometryElement::eByPolygon &&
+        materialIndices.size() > 1;
+
+    // Indices grouped by the material of the node (local to this mesh)
+    std::vector<std::vector<uint32_t>> materialGroups(materialIndices.size());
+
+    // Control points with different normals/UVs per face are split, identical ones are merged
+    VertexWelder welder;
+    welder.Reserve(fbxMesh->GetPolygonVertexCount());
+
+    // Reading information for each surface
+    for (int i = 0; i < polygonCount; i++)
+    {
+        // Get number of vertices that match the face (3 is a triangle polygon)
+        const int polygonSize = fbxMesh->GetPolygonSize(i);
+        assert(polygonSize <= 4);
+
+        // Index list of the material of this face
+        int materialIndex = materialPerPolygon ? materialElement->GetIndexArray().GetAt(i) : 0;
+        if (materialIndex < 0 || materialIndex >= (int)materialGroups.size())
+        {
+            materialIndex = 0;
+        }
+        std::vector<uint32_t>& groupIndices = materialGroups[materialIndex];
+
+        // Process one vertex at a time
+        for (int j = 0; j < polygonSize; j++)
+        {
+            // FBX vertex array index
+            int controlPointIndex = fbxMesh->GetPolygonVertex(i, j);
+            assert(controlPointIndex >= 0);
+
+            // Start from the control point (position and skin)
+            Model::VertexPosNormalUvSkin vertex = controlPoints[controlPointIndex];
+
+            // Read vertex normals
+            FbxVector4 normal;
+            if (fbxMesh->GetPolygonVertexNormal(i, j, normal))
+            {
+                vertex.normal.x = (float)normal[0];
+                vertex.normal.y = (float)normal[1];
+                vertex.normal.z = (float)normal[2];
+            }
+
+            // Texture UV reading
+            if (textureUVCount > 0)
+            {
+                FbxVector2 uvs;
+                bool lUnmappedUV;
+
+                // Read by number 0 (?)
+                if (fbxMesh->GetPolygonVertexUV(i, j, uvNames[0], uvs, lUnmappedUV))
+                {
+                    vertex.uv.x = (float)uvs[0];
+                    vertex.uv.y = (float)uvs[1];
+                }
+            }
+
+            // Index of the welded vertex
+            uint32_t index = welder.Add(vertex);
+
+            // Add vertex index to index distribution column
+            // Up to 3rd vertex
+            if (j < 3)
+            {
+                // Add one point and build a triangle with the other two points
+                groupIndices.push_back(index);
+            }
+            // 4th point
+            else
+            {
+                // Add 3 points
+                // Build a riangle with 2, 3, 0 of 0, 1, 2, 3 of quadrilateral
+                uint32_t index2 = groupIndices[groupIndices.size() - 1];
+                uint32_t index3 = index;
+                uint32_t index0 = groupIndices[groupIndices.size() - 3];
+                groupIndices.push_back(index2);
+                groupIndices.push_back(index3);
+                groupIndices.push_back(index0);
+            }
+        }
+    }
+
+    // Report vertex count and reuse ratio
+    const VertexWelder::Stats& stats = welder.GetStats();
+    char str[256];
+    sprintf_s(str, "FbxLoader: %s welded %zu polygon vertices into %zu vertices (%d control points, reuse ratio %.2f)\n",
+        fbxMesh->GetNode()->GetName(), stats.inputVertexCount, stats.uniqueVertexCount,
+        (int)controlPoints.size(), stats.GetReuseRatio());
+    OutputDebugStringA(str);
+
+    // Append the welded vertices, indices stay local to this mesh
+    const INT baseVertex = (INT)vertices.size();
+    std::vector<Model::VertexPosNormalUvSkin> meshVertices;
+    welder.TakeVertices(meshVertices);
+    vertices.insert(vertices.end(), meshVertices.begin(), meshVertices.end());
+
+    // One submesh per material used by this mesh
+    for (size_t i = 0; i < materialGroups.size(); i++)
+    {
+        if (materialGroups[i].empty())
+        {
+            continue;
+        }
+
+        Model::Submesh submesh;
+        submesh.indexStart = (UINT)indices.size();
+        submesh.indexCount = (UINT)materialGroups[i].size();
+        submesh.baseVertex = baseVertex;
+        submesh.materialIndex = materialIndices[i];
+        model->submeshes.push_back(submesh);
+
+        indices.insert(indices.end(), materialGroups[i].begin(), materialGroups[i].end());
+    }
+}
+
+void FbxLoader::ParseMaterial(Model* model, FbxNode* fbxNode, std::vector<UINT>& materialIndices)
+{
+    const int materialCount = fbxNode->GetMaterialCount();
+
+    // Node without material uses the default material
+    if (materialCount == 0)
+    {
+        materialIndices.push_back(GetDefaultMaterial(model));
+        return;
+    }
+
+    materialIndices.reserve(materialCount);
+    for (int i = 0; i < materialCount; i++)
+    {
+        FbxSurfaceMaterial* material = fbxNode->GetMaterial(i);
+        if (material == nullptr)
+        {
+            materialIndices.push_back(GetDefaultMaterial(model));
+            continue;
+        }
+
+        // Materials shared between mesh nodes are read only once
+        const string materialName = material->GetName();
+        UINT index = 0;
+        while (index < model->materials.size() && model->materials[index].name != materialName)
+        {
+            index++;
+        }
+        materialIndices.push_back(index);
+        if (index < model->materials.size())
+        {
+            continue;
+        }
+
+        model->materials.emplace_back();
+        Model::Material& modelMaterial = model->materials.back();
+        modelMaterial.name = materialName;
+
+        // Flag indicating whether the texture has been loaded
+        bool textureLoaded = false;
+
+        // Check if it is a FBXSurfaceLambert class
+        if (material->GetClassId().Is(FbxSurfaceLambert::ClassId))
+        {
+            FbxSurfaceLambert* lambert = static_cast<FbxSurfaceLambert*>(material);
+
+            // Optical light coefficient
+            FbxPropertyT<FbxDouble3> ambient = lambert->Ambient;
+            modelMaterial.ambient.x = (float)ambient.Get()[0];
+            modelMaterial.ambient.y = (float)ambient.Get()[1];
+            modelMaterial.ambient.z = (float)ambient.Get()[2];
+
+            // Optical Light Reflection Coefficient
+            FbxPropertyT<FbxDouble3> diffuse = lambert->Diffuse;
+            modelMaterial.diffuse.x = (float)diffuse.Get()[0];
+            modelMaterial.diffuse.y = (float)diffuse.Get()[1];
+            modelMaterial.diffuse.z = (float)diffuse.Get()[2];
+        }
+
+        // Remove diffuse texture
+        const FbxProperty diffuseProperty = material->FindProperty(FbxSurfaceMaterial::sDiffuse);
+        if (diffuseProperty.IsValid())
+        {
+            const FbxFileTexture* texture = diffuseProperty.GetSrcObject<FbxFileTexture>();
+            if (texture)
+            {
+                const char* filepath = texture->GetFileName();
+
+                // Extract file name from file bus
+                string path_str(filepath);
+                string name = ExtractFileName(path_str);
+
+                // Read texture
+                LoadTexture(modelMaterial, baseDirectory + model->name + "/" + name);
+                textureLoaded = true;
+            }
+        }
+
+        // If there is no texture, paste a white texture
+        if (!textureLoaded)
+        {
+            LoadTexture(modelMaterial, baseDirectory + defaultTextureFileName);
+        }
+    }
+}
+
+UINT FbxLoader::GetDefaultMaterial(Model* model)
+{
+    // Reuse the default material if it already exists
+    for (UINT i = 0; i < model->materials.size(); i++)
+    {
+        if (model->materials[i].name.empty())
+        {
+            return i;
+        }
+    }
+
+    // White material without a name
+    model->materials.emplace_back();
+    LoadTexture(model->materials.back(), baseDirectory + defaultTextureFileName);
+
+    return (UINT)model->materials.size() - 1;
+}
+
+void FbxLoader::ParseSkin(Model* model, FbxMesh* fbxMesh, std::vector<Model::VertexPosNormalUvSkin>& vertices)
+{
+    // Skinning information
+    FbxSkin* fbxSkin = static_cast<FbxSkin*>(fbxMesh->GetDeformer(0, FbxDeformer::eSkin));
+
+    // If no skinning information, end
+    if (fbxSkin == nullptr)
+    {
+        // Process for each vertex
+        for (int i = 0; i < vertices.size(); i++)
+        {
+            // Make the shadow of the first bone (identity matrix) 100%
+            vertices[i].boneIndex[0] = 0;
+            vertices[i].boneWeight[0] = 1.0f;
+        }
+        return;
+    }
+
+    // Bone array reference
+    std::vector<Model::Bone>& bones = model->bones;
 
     // Bone number
     int clusterCount = fbxSkin->GetClusterCount();
-    bones.reserve(clusterCount);
+    bones.reserve(bones.size() + clusterCount);
+
+    // Model bone index of each cluster (meshes sharing a skeleton share the bones)
+    std::vector<UINT> clusterBoneIndices(clusterCount);
+
+    // About all bones
+    for (int i = 0; i < clusterCount; i++)
+    {
+        // FBX bone information
+        FbxCluster* fbxCluster = fbxSkin->GetCluster(i);
+
+        // Bone already added by another mesh
+        UINT boneIndex = 0;
+        while (boneIndex < bones.size() && bones[boneIndex].fbxCluster->GetLink() != fbxCluster->GetLink())
+        {
+            boneIndex++;
+        }
+        clusterBoneIndices[i] = boneIndex;
+        if (boneIndex < bones.size())
+        {
+            continue;
+        }
+
+        // Get name of node in bone itself
+        const char* boneName = fbxCluster->GetLink()->GetName();
+
+        // Add a new bone and get new bone's features
+        bones.emplace_back(Model::Bone(boneName));
+        Model::Bone& bone = bones.back();
+
+        // Introduce your own bones and FBX bones
+        bone.fbxCluster = fbxCluster;
+
+        // Get initial atitude matrix from FBX
+        FbxAMatrix fbxMat;
+        fbxCluster->GetTransformLinkMatrix(fbxMat);
+
+        // Convert to XMMatrix type
+        XMMATRIX initialPose;
+        ConvertMatrixFromFbx(&initialPose, fbxMat);
+
+        // Get the inverse matrix of hte initial attitude matrix
+        bone.invInitialPose = XMMatrixInverse(nullptr, initialPose);
+    }
+
+    // Strongest influences of each vertex (as many as the vertex can hold)
+    SkinInfluenceAccumulator<Model::MAX_BONE_INDICES> influences(vertices.size());
+
+    // About all bones
+    for (int i = 0; i < clusterCount; i++)
+    {
+        // FBX bone information
+        FbxCluster* fbxCluster = fbxSkin->GetCluster(i);
+
+        // Number of vertices that receive shadows on this bone
+        int controlPointIndicesCount = fbxCluster->GetControlPointIndicesCount();
+
+        // Array of vertices affected by this bone
+        int* controlPointIndices = fbxCluster->GetControlPointIndices();
+        double* controlPointWeights = fbxCluster->GetControlPointWeights();
+
+        // About all vertices affected by shadows
+        for (int j = 0; j < controlPointIndicesCount; j++)
+        {
+            influences.Add(controlPointIndices[j], clusterBoneIndices[i], (float)controlPointWeights[j]);
+        }
+    }
+
+    // Write to vertex data, weights adjusted to total 1.0f (100%)
+    for (size_t i = 0; i < vertices.size(); i++)
+    {
+        influences.Write(i, vertices[i].boneIndex, vertices[i].boneWeight);
+    }
+
+    // Influences lost to the per vertex limit
+    if (influences.GetDroppedCount() > 0)
+    {
+        char str[256];
+        sprintf_s(str, "FbxLoader: %s: %zu skin influences beyond %d per vertex dropped\n",
+            fbxMesh->GetNode()->GetName(), influences.GetDroppedCount(), Model::MAX_BONE_INDICES);
+        OutputDebugStringA(str);
+    }
+}
+
+void FbxLoader::ParseAnimation(Model* model, FbxScene* fbxScene, const AnimationClip::CompressionSettings& compression)
+{
+    // Bone array reference
+    std::vector<Model::Bone>& bones = model->bones;
+
+    // Joints: the bone nodes and all of their ancestors, parents before children
+    std::vector<FbxNode*> jointNodes;
+    for (Model::Bone& bone : bones)
+    {
+        // Chain from the bone node up to the first node already added
+        std::vector<FbxNode*> chain;
+        for (FbxNode* fbxNode = bone.fbxCluster->GetLink();
+            fbxNode && std::find(jointNodes.begin(), jointNodes.end(), fbxNode) == jointNodes.end();
+            fbxNode = fbxNode->GetParent())
+        {
+            chain.push_back(fbxNode);
+        }
+        jointNodes.insert(jointNodes.end(), chain.rbegin(), chain.rend());
+
+        bone.jointIndex = (int32_t)(std::find(jointNodes.begin(), jointNodes.end(), bone.fbxCluster->GetLink()) - jointNodes.begin());
+    }
+
+    model->joints.resize(jointNodes.size());
+    for (size_t i = 0; i < jointNodes.size(); i++)
+    {
+        Model::Joint& joint = model->joints[i];
+        joint.name = jointNodes[i]->GetName();
+        auto parent = std::find(jointNodes.begin(), jointNodes.begin() + i, jointNodes[i]->GetParent());
+        joint.parentIndex = parent != jointNodes.begin() + i ? (int32_t)(parent - jointNodes.begin()) : -1;
+    }
+    model->BuildSkeleton();
+
+    if (jointNodes.empty())
+    {
+        return;
+    }
+
+    // One clip per animation stack
+    const int animStackCount = fbxScene->GetSrcObjectCount<FbxAnimStack>();
+    std::vector<XMMATRIX> globalTransforms(jointNodes.size());
+    for (int i = 0; i < animStackCount; i++)
+    {
+        FbxAnimStack* animStack = fbxScene->GetSrcObject<FbxAnimStack>(i);
+        fbxScene->SetCurrentAnimationStack(animStack);
+
+        FbxTime startTime, stopTime;
+        GetAnimationSpan(fbxScene, animStack, startTime, stopTime);
+        const double duration = (std::max)((stopTime - startTime).GetSecondDouble(), 0.0);
+
+        // Every frame of every joint, compressed once complete
+        const uint32_t frameCount = (uint32_t)(duration * ANIMATION_SAMPLE_RATE + 1e-4) + 1;
+        std::vector<AnimationClip::Track> sampledTracks(jointNodes.size());
+        for (AnimationClip::Track& track : sampledTracks)
+        {
+            track.scales.reserve(frameCount);
+            track.rotations.reserve(frameCount);
+            track.translations.reserve(frameCount);
+        }
+
+        for (uint32_t frame = 0; frame < frameCount; frame++)
+        {
+            FbxTime time;
+            time.SetSecondDouble((std::min)(startTime.GetSecondDouble() + (double)frame / ANIMATION_SAMPLE_RATE,
+                stopTime.GetSecondDouble()));
+
+            for (size_t j = 0; j < jointNodes.size(); j++)
+            {
+                // Same global posture as the FBX evaluator, made relative to the parent joint
+                ConvertMatrixFromFbx(&globalTransforms[j], jointNodes[j]->EvaluateGlobalTransform(time));
+                XMMATRIX localTransform = globalTransforms[j];
+                if (model->joints[j].parentIndex >= 0)
+                {
+                    localTransform *= XMMatrixInverse(nullptr, globalTransforms[model->joints[j].parentIndex]);
+                }
+
+                XMVECTOR scale, rotation, translation;
+                XMMatrixDecompose(&scale, &rotation, &translation, localTransform);
+
+                // Keep consecutive rotations in the same hemisphere so that they interpolate along the short arc
+                AnimationClip::Track& track = sampledTracks[j];
+                if (!track.rotations.empty() &&
+                    XMVectorGetX(XMVector4Dot(rotation, XMLoadFloat4(&track.rotations.back()))) < 0.0f)
+                {
+                    rotation = XMVectorNegate(rotation);
+                }
+
+                track.scales.emplace_back();
+                track.rotations.emplace_back();
+                track.translations.emplace_back();
+                XMStoreFloat3(&track.scales.back(), scale);
+                XMStoreFloat4(&track.rotations.back(), rotation);
+                XMStoreFloat3(&track.translations.back(), translation);
+            }
+        }
+
+        model->animationClips.emplace_back();
+        AnimationClip& clip = model->animationClips.back();
+        AnimationClip::CompressionReport report =
+            clip.Build(animStack->GetName(), (float)ANIMATION_SAMPLE_RATE, sampledTracks, compression);
+
+        // Size against the largest joint space error
+        char str[256];
+        sprintf_s(str, "FbxLoader: clip %s %u frames x %zu joints, %zu -> %zu bytes (%.1f%%), max error rotation %.4f deg, translation %.5f, scale %.5f\n",
+            clip.name.c_str(), clip.frameCount, jointNodes.size(), report.rawBytes, report.compressedBytes,
+            report.rawBytes ? 100.0 * report.compressedBytes / report.rawBytes : 0.0,
+            XMConvertToDegrees(report.maxRotationError), report.maxTranslationError, report.maxScaleError);
+        OutputDebugStringA(str);
+    }
+}
+
+void FbxLoader::LoadTexture(Model::Material& material, const std::string& fullpath)
+{
+    HRESULT result = S_FALSE;
+
+    // Measure the load time
+    auto loadStart = std::chrono::steady_clock::now();
+
+    // Remember the texture reference for the baked model
+    material.texturePath = fullpath;
+
+    TexMetadata& metadata = material.metadata;
+    ScratchImage& scratchImg = material.scratchImg;
+
+    // Pre-compressed texture with mip chain placed next to the original (same name, .dds)
+    const size_t extensionPos = fullpath.find_last_of('.');
+    const string ddsPath = fullpath.substr(0, extensionPos) + ".dds";
+
+    // Convert to unicode string
+    wchar_t wfilepath[256];
+    bool loaded = false;
+    if (extensionPos != string::npos && GetFileAttributesA(ddsPath.c_str()) != INVALID_FILE_ATTRIBUTES)
+    {
+        MultiByteToWideChar(CP_ACP, 0, ddsPath.c_str(), -1, wfilepath, _countof(wfilepath));
+        result = LoadFromDDSFile(
+            wfilepath, DDS_FLAGS_NONE,
+            &metadata, scratchImg);
+
+        // Only plain 2D textures are supported by the model
+        loaded = SUCCEEDED(result) && metadata.dimension == TEX_DIMENSION_TEXTURE2D &&
+            metadata.arraySize == 1 && !metadata.IsCubemap();
+    }
+
+    // load WIC texture
+    if (!loaded)
+    {
+        MultiByteToWideChar(CP_ACP, 0, fullpath.c_str(), -1, wfilepath, _countof(wfilepath));
+        result = LoadFromWICFile(
+            wfilepath, WIC_FLAGS_NONE,
+            &metadata, scratchImg);
+        if (FAILED(result))
+        {
+            assert(0);
+        }
+    }
+
+    auto loadEnd = std::chrono::steady_clock::now();
+    char str[512];
+    sprintf_s(str, "FbxLoader: %s (%s, %zu mips) loaded in %.3f ms, %zu bytes on the CPU until uploaded\n",
+        loaded ? ddsPath.c_str() : fullpath.c_str(), loaded ? "DDS" : "WIC", metadata.mipLevels,
+        std::chrono::duration<double, std::milli>(loadEnd - loadStart).count(), scratchImg.GetPixelsSize());
+    OutputDebugStringA(str);
+}
+
+std::string FbxLoader::ExtractFileName(const std::string& path)
+{
+    size_t pos1;
 
-    // About all bones
-    for (int i = 0; i < clusterCount; i++)
+    // Search for the last part where limiter "\\" appears
+    pos1 = path.rfind('\\');
+    if (pos1 != string::npos)
     {
-        // FBX bone information
-        FbxCluster* fbxCluster = fbxSkin->GetCluster(i);
+        return path.substr(pos1 + 1, path.size() - pos1 - 1);
+    }
 
-        // Get name of node in bone itself
-        const char* boneName = fbxCluster->GetLink()->GetName();
+    // Search for the last part where the limiter "/" appears
+    pos1 = path.rfind('/');
+    if (pos1 != string::npos)
+    {
+        return path.substr(pos1 + 1, path.size() - pos1 - 1);
+    }
 
-        // Add a new bone and get new bone's features
-        bones.emplace_back(Model::Bone(boneName));
-        Model::Bone& bone = bones.back();
+    return path;
+}
 
-        // Introduce your own bones and FBX bones
-        bone.fbxCluster = fbxCluster;
+void FbxLoader::OptimizeModel(Model* model)
+{
+    auto& vertices = model->vertices;
+    auto& indices = model->indices;
 
-        // Get initial atitude matrix from FBX
-        FbxAMatrix fbxMat;
-        fbxCluster->GetTransformLinkMatrix(fbxMat);
+    // Triangle order of each submesh
+    for (Model::Submesh& submesh : model->submeshes)
+    {
+        uint32_t* submeshIndices = indices.data() + submesh.indexStart;
+        const size_t vertexCount = *std::max_element(submeshIndices, submeshIndices + submesh.indexCount) + 1;
 
-        // Convert to XMMatrix type
-        XMMATRIX initialPose;
-        ConvertMatrixFromFbx(&initialPose, fbxMat);
+        MeshOptimizer::VertexCacheStats before = MeshOptimizer::AnalyzeVertexCache(submeshIndices, submesh.indexCount, vertexCount);
 
-        // Get the inverse matrix of hte initial attitude matrix
-        bone.invInitialPose = XMMatrixInverse(nullptr, initialPose);
+        // Vertex cache first, then overdraw keeps the cache friendly clusters intact
+        MeshOptimizer::OptimizeVertexCache(submeshIndices, submesh.indexCount, vertexCount);
+        MeshOptimizer::OptimizeOverdraw(submeshIndices, submesh.indexCount,
+            &vertices[submesh.baseVertex].pos, sizeof(Model::VertexPosNormalUvSkin), vertexCount);
+
+        MeshOptimizer::VertexCacheStats after = MeshOptimizer::AnalyzeVertexCache(submeshIndices, submesh.indexCount, vertexCount);
+
+        char str[256];
+        sprintf_s(str, "FbxLoader: %s submesh (material %u, %u triangles) ACMR %.3f -> %.3f, ATVR %.3f -> %.3f\n",
+            model->name.c_str(), submesh.materialIndex, submesh.indexCount / 3, before.acmr, after.acmr, before.atvr, after.atvr);
+        OutputDebugStringA(str);
     }
 
-    // Bone number and Skin weight pair
-    struct WeightSet
+    // Vertex order of each vertex range (submeshes sharing a base vertex share the range)
+    std::vector<INT> baseVertices;
+    for (const Model::Submesh& submesh : model->submeshes)
     {
-        UINT index;
-        float weight;
-    };
+        baseVertices.push_back(submesh.baseVertex);
+    }
+    std::sort(baseVertices.begin(), baseVertices.end());
+    baseVertices.erase(std::unique(baseVertices.begin(), baseVertices.end()), baseVertices.end());
 
-    // Two-dimensional array (Jagg array)
-    // list: A complete list of bones where the vertices are affected
-    // vector: do it for all vertices
-    std::vector<std::list<WeightSet>>weightLists(model->vertices.size());
+    std::vector<uint32_t> remap;
+    std::vector<Model::VertexPosNormalUvSkin> rangeVertices;
+    for (size_t i = 0; i < baseVertices.size(); i++)
+    {
+        const size_t rangeStart = baseVertices[i];
+        const size_t rangeEnd = i + 1 < baseVertices.size() ? baseVertices[i + 1] : vertices.size();
 
-    // About all bones
-    for (int i = 0; i < clusterCount; i++)
+        // New position of each vertex in the order of first use
+        remap.assign(rangeEnd - rangeStart, UINT32_MAX);
+        uint32_t nextVertex = 0;
+        for (Model::Submesh& submesh : model->submeshes)
+        {
+            if (submesh.baseVertex == (INT)rangeStart)
+            {
+                MeshOptimizer::BuildVertexFetchRemap(indices.data() + submesh.indexStart, submesh.indexCount, remap.data(), nextVertex);
+            }
+        }
+
+        // Unreferenced vertices go to the end of the range
+        for (uint32_t& newIndex : remap)
+        {
+            if (newIndex == UINT32_MAX)
+            {
+                newIndex = nextVertex++;
+            }
+        }
+
+        // Apply the new order
+        rangeVertices.assign(vertices.begin() + rangeStart, vertices.begin() + rangeEnd);
+        for (size_t v = 0; v < rangeVertices.size(); v++)
+        {
+            vertices[rangeStart + remap[v]] = rangeVertices[v];
+        }
+    }
+}
+
+// Write raw bytes to a baked model file
+static void WriteBytes(std::ofstream& file, const void* data, size_t size)
+{
+    file.write(reinterpret_cast<const char*>(data), size);
+}
+
+// Write a length-prefixed string to a baked model file
+static void WriteString(std::ofstream& file, const std::string& str)
+{
+    uint32_t length = (uint32_t)str.size();
+    WriteBytes(file, &length, sizeof(length));
+    WriteBytes(file, str.data(), length);
+}
+
+// Read raw bytes from a mapped baked model file, fails when running past the end
+static bool ReadBytes(const char*& cursor, const char* end, void* dst, size_t size)
+{
+    if ((size_t)(end - cursor) < size)
     {
-        // FBX bone information
-        FbxCluster* fbxCluster = fbxSkin->GetCluster(i);
+        return false;
+    }
+    memcpy(dst, cursor, size);
+    cursor += size;
+    return true;
+}
 
-        // Number of vertices that receive shadows on this bone
-        int controlPointIndicesCount = fbxCluster->GetControlPointIndicesCount();
+// Whether count records of at least size bytes each still fit in the rest of a mapped baked model file,
+// checked before allocating so that a corrupt count cannot request a huge buffer
+static bool HasRoomFor(const char* cursor, const char* end, uint64_t count, size_t size)
+{
+    return count <= (uint64_t)(end - cursor) / size;
+}
 
-        // Array of vertices affected by this bone
-        int* controlPointIndices = fbxCluster->GetControlPointIndices();
-        double* controlPointWeights = fbxCluster->GetControlPointWeights();
+// Write a compressed animation channel to a baked model file
+static void WriteChannel(std::ofstream& file, const AnimationClip::Channel& channel)
+{
+    BakedModelFormat::ChannelRecord record = {};
+    record.keyCount = (uint32_t)channel.frames.size();
+    memcpy(record.rangeMin, &channel.rangeMin, sizeof(record.rangeMin));
+    memcpy(record.rangeExtent, &channel.rangeExtent, sizeof(record.rangeExtent));
+    WriteBytes(file, &record, sizeof(record));
+    WriteBytes(file, channel.frames.data(), sizeof(channel.frames[0]) * channel.frames.size());
+    WriteBytes(file, channel.values.data(), sizeof(channel.values[0]) * channel.values.size());
+}
 
-        // About all vertices affected by shadows
-        for (int j = 0; j < controlPointIndicesCount; j++)
+// Read a length-prefixed string from a mapped baked model file
+static bool ReadString(const char*& cursor, const char* end, std::string& str)
+{
+    uint32_t length = 0;
+    if (!ReadBytes(cursor, end, &length, sizeof(length)) || (size_t)(end - cursor) < length)
+    {
+        return false;
+    }
+    str.assign(cursor, length);
+    cursor += length;
+    return true;
+}
+
+// Read a length-prefixed string from an open baked model file
+static bool ReadString(std::ifstream& file, std::string& str)
+{
+    uint32_t length = 0;
+    if (!file.read(reinterpret_cast<char*>(&length), sizeof(length)))
+    {
+        return false;
+    }
+    str.resize(length);
+    return length == 0 || file.read(&str[0], length);
+}
+
+// Read a compressed animation channel from a mapped baked model file, key frames must ascend from 0 within the clip
+static bool ReadChannel(const char*& cursor, const char* end, uint32_t frameCount, AnimationClip::Channel& channel)
+{
+    BakedModelFormat::ChannelRecord record;
+    if (!ReadBytes(cursor, end, &record, sizeof(record)) || record.keyCount == 0 || record.keyCount > frameCount)
+    {
+        return false;
+    }
+    if (!HasRoomFor(cursor, end, record.keyCount, sizeof(uint16_t) * 4))
+    {
+        return false;
+    }
+    memcpy(&channel.rangeMin, record.rangeMin, sizeof(record.rangeMin));
+    memcpy(&channel.rangeExtent, record.rangeExtent, sizeof(record.rangeExtent));
+    channel.frames.resize(record.keyCount);
+    channel.values.resize(record.keyCount * 3);
+    if (!ReadBytes(cursor, end, channel.frames.data(), sizeof(channel.frames[0]) * channel.frames.size()) ||
+        !ReadBytes(cursor, end, channel.values.data(), sizeof(channel.values[0]) * channel.values.size()) ||
+        channel.frames[0] != 0 || channel.frames.back() >= frameCount)
+    {
+        return false;
+    }
+    for (size_t i = 1; i < channel.frames.size(); i++)
+    {
+        if (channel.frames[i] <= channel.frames[i - 1])
         {
-            // Vertex number
-            int vertIndex = controlPointIndices[j];
+            return false;
+        }
+    }
+    return true;
+}
+
+bool FbxLoader::SaveBakedModel(Model* model, const string& bakedPath, const ImportSettings& settings,
+    const std::vector<string>& dependencies)
+{
+    // Readers never see a half written file, the complete file replaces the old one at the end
+    const string temporaryPath = bakedPath + ".tmp";
+    std::ofstream file(temporaryPath, std::ios::binary | std::ios::trunc);
+    if (!file)
+    {
+        return false;
+    }
+
+    // Header
+    BakedModelFormat::Header header = {};
+    header.magic = BakedModelFormat::MAGIC;
+    header.version = BakedModelFormat::VERSION;
+    header.vertexStride = sizeof(Model::VertexPosNormalUvSkin);
+    header.indexStride = sizeof(model->indices[0]);
+    header.nodeCount = (uint32_t)model->nodes.size();
+    header.meshNodeIndex = model->meshNode ? (int32_t)(model->meshNode - model->nodes.data()) : -1;
+    header.vertexCount = (uint32_t)model->vertices.size();
+    header.indexCount = (uint32_t)model->indices.size();
+    header.submeshCount = (uint32_t)model->submeshes.size();
+    header.indexFormat = (uint32_t)model->indexFormat;
+    header.boneCount = (uint32_t)model->bones.size();
+    header.materialCount = (uint32_t)model->materials.size();
+    header.jointCount = (uint32_t)model->joints.size();
+    header.clipCount = (uint32_t)model->animationClips.size();
+    header.optimizeMeshes = settings.optimizeMeshes ? 1 : 0;
+    header.rotationTolerance = settings.animationCompression.rotationTolerance;
+    header.translationTolerance = settings.animationCompression.translationTolerance;
+    header.scaleTolerance = settings.animationCompression.scaleTolerance;
+    header.dependencyCount = (uint32_t)dependencies.size();
+    WriteBytes(file, &header, sizeof(header));
+
+    // Dependencies
+    for (const string& dependency : dependencies)
+    {
+        WriteString(file, dependency);
+    }
+
+    // Nodes
+    for (const Node& node : model->nodes)
+    {
+        BakedModelFormat::NodeRecord record = {};
+        XMStoreFloat4(reinterpret_cast<XMFLOAT4*>(record.scaling), node.scaling);
+        XMStoreFloat4(reinterpret_cast<XMFLOAT4*>(record.rotation), node.rotation);
+        XMStoreFloat4(reinterpret_cast<XMFLOAT4*>(record.translation), node.translation);
+        XMStoreFloat4x4(reinterpret_cast<XMFLOAT4X4*>(record.transform), node.transform);
+        XMStoreFloat4x4(reinterpret_cast<XMFLOAT4X4*>(record.globalTransform), node.globalTransform);
+        record.parentIndex = node.parent ? (int32_t)(node.parent - model->nodes.data()) : -1;
+        WriteBytes(file, &record, sizeof(record));
+        WriteString(file, node.name);
+    }
 
-            // Skin weight
-            float weight = (float)controlPointWeights[j];
+    // Vertices and indices
+    WriteBytes(file, model->vertices.data(), sizeof(model->vertices[0]) * model->vertices.size());
+    WriteBytes(file, model->indices.data(), sizeof(model->indices[0]) * model->indices.size());
 
-            // Pawn and weight pairs in the pawn list affected by vertex
-            weightLists[vertIndex].emplace_back(WeightSet{ (UINT)i, weight });
+    // Submeshes
+    for (const Model::Submesh& submesh : model->submeshes)
+    {
+        BakedModelFormat::SubmeshRecord record = {};
+        record.indexStart = submesh.indexStart;
+        record.indexCount = submesh.indexCount;
+        record.baseVertex = submesh.baseVertex;
+        record.materialIndex = submesh.materialIndex;
+        WriteBytes(file, &record, sizeof(record));
+    }
+
+    // Materials
+    for (const Model::Material& material : model->materials)
+    {
+        BakedModelFormat::MaterialRecord record = {};
+        memcpy(record.ambient, &material.ambient, sizeof(record.ambient));
+        memcpy(record.diffuse, &material.diffuse, sizeof(record.diffuse));
+        WriteBytes(file, &record, sizeof(record));
+        WriteString(file, material.name);
+        WriteString(file, material.texturePath);
+    }
+
+    // Bones
+    for (const Model::Bone& bone : model->bones)
+    {
+        BakedModelFormat::BoneRecord record = {};
+        XMStoreFloat4x4(reinterpret_cast<XMFLOAT4X4*>(record.invInitialPose), bone.invInitialPose);
+        record.jointIndex = bone.jointIndex;
+        XMStoreFloat3(reinterpret_cast<XMFLOAT3*>(record.boundsCenter), XMLoadFloat3(&bone.bounds.Center));
+        XMStoreFloat3(reinterpret_cast<XMFLOAT3*>(record.boundsExtents), XMLoadFloat3(&bone.bounds.Extents));
+        WriteBytes(file, &record, sizeof(record));
+        WriteString(file, bone.name);
+    }
+
+    // Joints
+    for (const Model::Joint& joint : model->joints)
+    {
+        BakedModelFormat::JointRecord record = {};
+        record.parentIndex = joint.parentIndex;
+        WriteBytes(file, &record, sizeof(record));
+        WriteString(file, joint.name);
+    }
+
+    // Animation clips
+    for (const AnimationClip& clip : model->animationClips)
+    {
+        BakedModelFormat::ClipRecord record = {};
+        record.sampleRate = clip.sampleRate;
+        record.frameCount = clip.frameCount;
+        WriteBytes(file, &record, sizeof(record));
+        WriteString(file, clip.name);
+
+        for (const AnimationClip::CompressedTrack& track : clip.tracks)
+        {
+            WriteChannel(file, track.scale);
+            WriteChannel(file, track.rotation);
+            WriteChannel(file, track.translation);
         }
     }
 
-    // Reference for rewriting vertex array
-    auto& vertices = model->vertices;
+    file.close();
+    if (!file.good())
+    {
+        DeleteFileA(temporaryPath.c_str());
+        return false;
+    }
+    if (!MoveFileExA(temporaryPath.c_str(), bakedPath.c_str(), MOVEFILE_REPLACE_EXISTING))
+    {
+        DeleteFileA(temporaryPath.c_str());
+        return false;
+    }
+    return true;
+}
+
+bool FbxLoader::LoadBakedModel(Model* model, const string& bakedPath)
+{
+    // Map the whole file into memory
+    HANDLE fileHandle = CreateFileA(bakedPath.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+        OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (fileHandle == INVALID_HANDLE_VALUE)
+    {
+        return false;
+    }
+
+    LARGE_INTEGER fileSize = {};
+    GetFileSizeEx(fileHandle, &fileSize);
+
+    HANDLE mappingHandle = CreateFileMappingA(fileHandle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    const char* view = mappingHandle ? (const char*)MapViewOfFile(mappingHandle, FILE_MAP_READ, 0, 0, 0) : nullptr;
+    if (view == nullptr)
+    {
+        if (mappingHandle)
+        {
+            CloseHandle(mappingHandle);
+        }
+        CloseHandle(fileHandle);
+        return false;
+    }
+
+    const char* cursor = view;
+    const char* end = view + fileSize.QuadPart;
+    bool succeeded = false;
 
-    // Processing for each vertex
-    for (int i = 0; i < vertices.size(); i++)
+    // Parse all sections, any inconsistency rejects the file
+    do
     {
-        // Select the 4 largest from the weights of the vertices
-        auto& weightList = weightLists[i];
+        // Header
+        BakedModelFormat::Header header = {};
+        if (!ReadBytes(cursor, end, &header, sizeof(header)) ||
+            header.magic != BakedModelFormat::MAGIC ||
+            header.version != BakedModelFormat::VERSION ||
+            header.vertexStride != sizeof(Model::VertexPosNormalUvSkin) ||
+            header.indexStride != sizeof(model->indices[0]) ||
+            header.meshNodeIndex >= (int32_t)header.nodeCount)
+        {
+            break;
+        }
+
+        // Dependencies (only used by IsBakedModelFresh)
+        bool dependenciesValid = true;
+        for (uint32_t i = 0; i < header.dependencyCount && dependenciesValid; i++)
+        {
+            string dependency;
+            dependenciesValid = ReadString(cursor, end, dependency);
+        }
+        if (!dependenciesValid)
+        {
+            break;
+        }
+
+        // Nodes (reserved up front so that parent pointers stay valid)
+        if (!HasRoomFor(cursor, end, header.nodeCount, sizeof(BakedModelFormat::NodeRecord) + sizeof(uint32_t)))
+        {
+            break;
+        }
+        model->nodes.resize(header.nodeCount);
+        bool nodesValid = true;
+        for (uint32_t i = 0; i < header.nodeCount && nodesValid; i++)
+        {
+            Node& node = model->nodes[i];
+            BakedModelFormat::NodeRecord record;
+            nodesValid = ReadBytes(cursor, end, &record, sizeof(record)) && ReadString(cursor, end, node.name) &&
+                record.parentIndex < (int32_t)i;
+            if (!nodesValid)
+            {
+                break;
+            }
+            node.scaling = XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(record.scaling));
+            node.rotation = XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(record.rotation));
+            node.translation = XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(record.translation));
+            node.transform = XMLoadFloat4x4(reinterpret_cast<const XMFLOAT4X4*>(record.transform));
+            node.globalTransform = XMLoadFloat4x4(reinterpret_cast<const XMFLOAT4X4*>(record.globalTransform));
+            node.parent = record.parentIndex >= 0 ? &model->nodes[record.parentIndex] : nullptr;
+        }
+        if (!nodesValid)
+        {
+            break;
+        }
+        model->meshNode = header.meshNodeIndex >= 0 ? &model->nodes[header.meshNodeIndex] : nullptr;
+
+        // Vertices and indices
+        if (!HasRoomFor(cursor, end, header.vertexCount, sizeof(model->vertices[0])) ||
+            !HasRoomFor(cursor + sizeof(model->vertices[0]) * header.vertexCount, end, header.indexCount, sizeof(model->indices[0])))
+        {
+            break;
+        }
+        model->vertices.resize(header.vertexCount);
+        model->indices.resize(header.indexCount);
+        if (!ReadBytes(cursor, end, model->vertices.data(), sizeof(model->vertices[0]) * model->vertices.size()) ||
+            !ReadBytes(cursor, end, model->indices.data(), sizeof(model->indices[0]) * model->indices.size()))
+        {
+            break;
+        }
+
+        // Bone numbers must stay inside the skinning palette of the model (unskinned meshes use bone 0)
+        const uint32_t paletteSize = (std::max)(header.boneCount, 1u);
+        bool boneIndicesValid = true;
+        for (const Model::VertexPosNormalUvSkin& vertex : model->vertices)
+        {
+            for (int i = 0; i < Model::MAX_BONE_INDICES; i++)
+            {
+                boneIndicesValid = boneIndicesValid && vertex.boneIndex[i] < paletteSize;
+            }
+        }
+        if (!boneIndicesValid)
+        {
+            break;
+        }
 
-        // Specify a lambda expression for size comparison and sort downwards
-        weightList.sort(
-            [](auto const& lhs, auto const& rhs)
+        // Submeshes
+        model->indexFormat = (DXGI_FORMAT)header.indexFormat;
+        if (model->indexFormat != DXGI_FORMAT_R16_UINT && model->indexFormat != DXGI_FORMAT_R32_UINT)
+        {
+            break;
+        }
+        if (!HasRoomFor(cursor, end, header.submeshCount, sizeof(BakedModelFormat::SubmeshRecord)))
+        {
+            break;
+        }
+        model->submeshes.resize(header.submeshCount);
+        bool submeshesValid = true;
+        for (Model::Submesh& submesh : model->submeshes)
+        {
+            BakedModelFormat::SubmeshRecord record;
+            submeshesValid = ReadBytes(cursor, end, &record, sizeof(record)) &&
+                (uint64_t)record.indexStart + record.indexCount <= header.indexCount &&
+                record.baseVertex >= 0 && record.materialIndex < header.materialCount;
+            if (!submeshesValid)
+            {
+                break;
+            }
+            // Every index must fit the index format and, offset by the base vertex, stay inside the vertex buffer
+            uint32_t maxIndex = 0;
+            for (uint32_t i = record.indexStart; i < record.indexStart + record.indexCount; i++)
+            {
+                maxIndex = (std::max)(maxIndex, model->indices[i]);
+            }
+            submeshesValid = record.indexCount == 0 ||
+                ((uint64_t)maxIndex + record.baseVertex < header.vertexCount &&
+                (model->indexFormat != DXGI_FORMAT_R16_UINT || maxIndex <= 0xFFFF));
+            if (!submeshesValid)
             {
-                // Returns true if the left key is larger, false otherwise
-                return lhs.weight > rhs.weight;
-            });
+                break;
+            }
+            submesh.indexStart = record.indexStart;
+            submesh.indexCount = record.indexCount;
+            submesh.baseVertex = record.baseVertex;
+            submesh.materialIndex = record.materialIndex;
+        }
+        if (!submeshesValid)
+        {
+            break;
+        }
 
-        int weightArrayIndex = 0;
+        // Materials and their textures
+        if (!HasRoomFor(cursor, end, header.materialCount, sizeof(BakedModelFormat::MaterialRecord) + sizeof(uint32_t) * 2))
+        {
+            break;
+        }
+        model->materials.resize(header.materialCount);
+        bool materialsValid = true;
+        for (Model::Material& material : model->materials)
+        {
+            BakedModelFormat::MaterialRecord record;
+            string texturePath;
+            materialsValid = ReadBytes(cursor, end, &record, sizeof(record)) &&
+                ReadString(cursor, end, material.name) && ReadString(cursor, end, texturePath);
+            if (!materialsValid)
+            {
+                break;
+            }
+            memcpy(&material.ambient, record.ambient, sizeof(record.ambient));
+            memcpy(&material.diffuse, record.diffuse, sizeof(record.diffuse));
+            LoadTexture(material, texturePath);
+        }
+        if (!materialsValid)
+        {
+            break;
+        }
 
-        // Obstacle sort from the weight list
-        for (auto& weightSet : weightList)
+        // Bones
+        if (!HasRoomFor(cursor, end, header.boneCount, sizeof(BakedModelFormat::BoneRecord) + sizeof(uint32_t)))
+        {
+            break;
+        }
+        model->bones.reserve(header.boneCount);
+        bool bonesValid = true;
+        for (uint32_t i = 0; i < header.boneCount && bonesValid; i++)
+        {
+            BakedModelFormat::BoneRecord record;
+            string boneName;
+            bonesValid = ReadBytes(cursor, end, &record, sizeof(record)) && ReadString(cursor, end, boneName);
+            bonesValid = bonesValid && record.jointIndex >= -1 && record.jointIndex < (int32_t)header.jointCount;
+            if (bonesValid)
+            {
+                model->bones.emplace_back(Model::Bone(boneName));
+                model->bones.back().invInitialPose = XMLoadFloat4x4(reinterpret_cast<const XMFLOAT4X4*>(record.invInitialPose));
+                model->bones.back().jointIndex = record.jointIndex;
+                model->bones.back().bounds = BoundingBox(*reinterpret_cast<const XMFLOAT3*>(record.boundsCenter),
+                    *reinterpret_cast<const XMFLOAT3*>(record.boundsExtents));
+            }
+        }
+        if (!bonesValid)
         {
-            // Write to vertex data
-            vertices[i].boneIndex[weightArrayIndex] = weightSet.index;
-            vertices[i].boneWeight[weightArrayIndex] = weightSet.weight;
+            break;
+        }
 
-            // End when reaching 4
-            if (++weightArrayIndex >= Model::MAX_BONE_INDICES)
+        // Joints
+        if (!HasRoomFor(cursor, end, header.jointCount, sizeof(BakedModelFormat::JointRecord) + sizeof(uint32_t)))
+        {
+            break;
+        }
+        model->joints.resize(header.jointCount);
+        bool jointsValid = true;
+        for (uint32_t i = 0; i < header.jointCount && jointsValid; i++)
+        {
+            BakedModelFormat::JointRecord record;
+            jointsValid = ReadBytes(cursor, end, &record, sizeof(record)) &&
+                ReadString(cursor, end, model->joints[i].name) && record.parentIndex < (int32_t)i;
+            if (jointsValid)
             {
-                float weight = 0.0f;
+                model->joints[i].parentIndex = record.parentIndex;
+            }
+        }
+        if (!jointsValid)
+        {
+            break;
+        }
 
-                // Total weight for second and subsequent obstacles
-                for (int j = 1; j < Model::MAX_BONE_INDICES; j++)
+        // Animation clips
+        if (!HasRoomFor(cursor, end, header.clipCount, sizeof(BakedModelFormat::ClipRecord) + sizeof(uint32_t)))
+        {
+            break;
+        }
+        model->animationClips.resize(header.clipCount);
+        bool clipsValid = true;
+        for (AnimationClip& clip : model->animationClips)
+        {
+            BakedModelFormat::ClipRecord record;
+            clipsValid = ReadBytes(cursor, end, &record, sizeof(record)) && ReadString(cursor, end, clip.name) &&
+                record.frameCount > 0 && record.sampleRate > 0.0f;
+            if (!clipsValid)
+            {
+                break;
+            }
+            clip.sampleRate = record.sampleRate;
+            clip.frameCount = record.frameCount;
+            clipsValid = HasRoomFor(cursor, end, header.jointCount, sizeof(BakedModelFormat::ChannelRecord) * 3);
+            if (!clipsValid)
+            {
+                break;
+            }
+            clip.tracks.resize(header.jointCount);
+            for (AnimationClip::CompressedTrack& track : clip.tracks)
+            {
+                clipsValid = ReadChannel(cursor, end, clip.frameCount, track.scale) &&
+                    ReadChannel(cursor, end, clip.frameCount, track.rotation) &&
+                    ReadChannel(cursor, end, clip.frameCount, track.translation);
+                if (!clipsValid)
                 {
-                    weight += vertices[i].boneWeight[j];
+                    break;
                 }
-
-                // Adjusted to otal 1.0f (100%)
-                vertices[i].boneWeight[0] = 1.0f - weight;
+            }
+            if (!clipsValid)
+            {
                 break;
             }
         }
-    }
+        if (!clipsValid)
+        {
+            break;
+        }
+
+        model->BuildSkeleton();
+
+        succeeded = true;
+    } while (false);
+
+    UnmapViewOfFile(view);
+    CloseHandle(mappingHandle);
+    CloseHandle(fileHandle);
+
+    return succeeded;
 }
 
-void FbxLoader::LoadTexture(Model* model, const std::string& fullpath)
+bool FbxLoader::IsBakedModelFresh(const string& bakedPath, const string& sourcePath, const ImportSettings& settings)
 {
-    HRESULT result = S_FALSE;
+    WIN32_FILE_ATTRIBUTE_DATA bakedAttributes = {};
+    WIN32_FILE_ATTRIBUTE_DATA sourceAttributes = {};
 
-    // load WIC texture
-    TexMetadata& metadata = model->metadata;
-    ScratchImage& scratchImg = model->scratchImg;
+    // No baked file yet
+    if (!GetFileAttributesExA(bakedPath.c_str(), GetFileExInfoStandard, &bakedAttributes))
+    {
+        return false;
+    }
 
-    // Convert to unicode string
-    wchar_t wfilepath[128];
-    MultiByteToWideChar(CP_ACP, 0, fullpath.c_str(), -1, wfilepath, _countof(wfilepath));
-    result = LoadFromWICFile(
-        wfilepath, WIC_FLAGS_NONE,
-        &metadata, scratchImg);
-    if (FAILED(result))
+    // Without a source file the baked file is all we have
+    if (!GetFileAttributesExA(sourcePath.c_str(), GetFileExInfoStandard, &sourceAttributes))
     {
-        assert(0);
+        return true;
     }
-}
 
-std::string FbxLoader::ExtractFileName(const std::string& path)
-{
-    size_t pos1;
+    // Baked file must not be older than the source file
+    if (CompareFileTime(&bakedAttributes.ftLastWriteTime, &sourceAttributes.ftLastWriteTime) < 0)
+    {
+        return false;
+    }
 
-    // Search for the last part where limiter "\\" appears
-    pos1 = path.rfind('\\');
-    if (pos1 != string::npos)
+    // Baked with the current import settings
+    std::ifstream file(bakedPath, std::ios::binary);
+    BakedModelFormat::Header header = {};
+    if (!file.read(reinterpret_cast<char*>(&header), sizeof(header)) ||
+        header.magic != BakedModelFormat::MAGIC ||
+        header.version != BakedModelFormat::VERSION ||
+        header.optimizeMeshes != (settings.optimizeMeshes ? 1u : 0u) ||
+        header.rotationTolerance != settings.animationCompression.rotationTolerance ||
+        header.translationTolerance != settings.animationCompression.translationTolerance ||
+        header.scaleTolerance != settings.animationCompression.scaleTolerance)
     {
-        return path.substr(pos1 + 1, path.size() - pos1 - 1);
+        return false;
     }
 
-    // Search for the last part where the limiter "/" appears
-    pos1 = path.rfind('/');
-    if (pos1 != string::npos)
+    // Baked file must not be older than any other file it was read from (a missing one is a change too)
+    const string directoryPath = bakedPath.substr(0, bakedPath.find_last_of("/\\") + 1);
+    for (uint32_t i = 0; i < header.dependencyCount; i++)
     {
-        return path.substr(pos1 + 1, path.size() - pos1 - 1);
+        string dependency;
+        WIN32_FILE_ATTRIBUTE_DATA dependencyAttributes = {};
+        if (!ReadString(file, dependency) ||
+            !GetFileAttributesExA((directoryPath + dependency).c_str(), GetFileExInfoStandard, &dependencyAttributes) ||
+            CompareFileTime(&bakedAttributes.ftLastWriteTime, &dependencyAttributes.ftLastWriteTime) < 0)
+        {
+            return false;
+        }
     }
 
-    return path;
-}
\ No newline at end of file
+    return true;
+}
@@ -5,7 +5,14 @@
 
 #include <d3d12.h>
 #include <d3dx12.h>
+#include <condition_variable>
+#include <deque>
+#include <future>
+#include <mutex>
 #include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
 
 class FbxLoader
 {
@@ -13,10 +20,26 @@ private:
 	// std abbreviation
 	using string = std::string;
 
+public: // Alias
+	// Handle of a model requested with LoadModelAsync, ready once the GPU buffers exist
+	using ModelHandle = std::shared_future<Model*>;
+
+public: // Subclass
+	// Settings a model is imported with (taken when the load is requested)
+	struct ImportSettings
+	{
+		Model::VertexFormat vertexFormat;
+		bool optimizeMeshes;
+		AnimationClip::CompressionSettings animationCompression;
+	};
+
 public:
 	// Model Storage Route Bus
 	static const string baseDirectory;
 
+	// Keys per second of baked animation clips
+	static const int ANIMATION_SAMPLE_RATE = 60;
+
 	// Standard texture file name when there is no texture
 	static const string defaultTextureFileName;
 
@@ -52,6 +75,78 @@ public:
 	//void LoadModelFromFile(const string& modelName);
 	Model* LoadModelFromFile(const string& modelName);
 
+	/// <summary>
+	/// Request a model to be loaded by the worker threads with the current settings
+	/// A request for a model that is still loading returns the handle (and model) of the first request
+	/// </summary>
+	/// <param name="modelName">Model Name</param>
+	/// <returns>Handle that becomes ready after ProcessLoadedModels created the buffers</returns>
+	ModelHandle LoadModelAsync(const string& modelName);
+
+	/// <summary>
+	/// Create the GPU buffers of models imported by the workers and complete their handles (main thread)
+	/// </summary>
+	void ProcessLoadedModels();
+
+	/// <summary>
+	/// Wait for an asynchronous load, processing finished models meanwhile (main thread)
+	/// </summary>
+	/// <param name="handle">Handle returned by LoadModelAsync</param>
+	/// <returns>Loaded model</returns>
+	Model* WaitModel(const ModelHandle& handle);
+
+	/// <summary>
+	/// Stream the texture mips of every loaded model once (main thread, once per frame before recording it)
+	/// </summary>
+	/// <param name="frameNumber">Number of the frame about to be recorded</param>
+	/// <param name="finishedFrameCount">Number of frames the GPU has finished</param>
+	void UpdateStreaming(uint64_t frameNumber, uint64_t finishedFrameCount);
+
+	// Forget a model that is deleted before its textures are streamed (called by the Model destructor)
+	void CancelStreaming(Model* model);
+
+	/// <summary>
+	/// Import a model and write its baked model file without creating GPU resources (offline cooking)
+	/// Thread-safe, Initialize is not required
+	/// </summary>
+	/// <param name="modelName">Model Name</param>
+	/// <returns>True if the baked model file was written</returns>
+	bool CookModel(const string& modelName);
+
+	/// <summary>
+	/// Import a model without creating GPU resources (tools and checks without a device)
+	/// Thread-safe, Initialize is not required
+	/// </summary>
+	/// <param name="modelName">Model Name</param>
+	/// <returns>Model on the CPU side only, deleted by the caller</returns>
+	Model* ImportModelFromFile(const string& modelName);
+
+	/// <summary>
+	/// Load every model in the resource directory serially, then in parallel, and report both times
+	/// Both passes import from the source files (the baked model files are deleted before each pass)
+	/// </summary>
+	void BenchmarkLoading();
+
+	/// <summary>
+	/// Import every model in the resource directory from its source file (writing the baked file),
+	/// then from the baked file, and report both times per model and in total (CPU side only)
+	/// </summary>
+	void BenchmarkBakedLoading();
+
+	/// <summary>
+	/// Time the skinning matrices of many instances computed by the FBX evaluator and from the baked clip
+	/// </summary>
+	/// <param name="modelName">Name of an animated FBX model</param>
+	/// <param name="instanceCount">Number of instances animated per frame</param>
+	void BenchmarkAnimation(const string& modelName, int instanceCount);
+
+	/// <summary>
+	/// Load a texture from its PNG/JPG source and from its DDS variant (written temporarily as the AssetCooker does
+	/// if there is none) and report the load times and CPU bytes of both
+	/// </summary>
+	/// <param name="fileName">Texture file in the resource directory</param>
+	void BenchmarkTextureFormats(const string& fileName);
+
 	/// <summary>
 	/// Recursively analyze node configuration
 	/// </summary>
@@ -64,25 +159,113 @@ public:
 	/// </summary>
 	/// <param name="model">Imported Model Object</param>
 	/// <param name="fbxNode">Node to be analyzed</param>
-	void ParseMesh(Model* model, FbxNode* fbxNode);
+	/// <param name="node">Model node of fbxNode</param>
+	void ParseMesh(Model* model, FbxNode* fbxNode, const Node& node);
+
+	// Vertex coordinate reading (one vertex per control point)
+	void ParseMeshVertices(Model* model, FbxMesh* fbxMesh, std::vector<Model::VertexPosNormalUvSkin>& vertices);
 
-	// Vertex coordinate reading
-	void ParseMeshVertices(Model* model, FbxMesh* fbxMesh);
+	// Surface information reading (appends welded vertices, indices and submeshes to the model)
+	void ParseMeshFaces(Model* model, FbxMesh* fbxMesh,
+		const std::vector<Model::VertexPosNormalUvSkin>& controlPoints, const std::vector<UINT>& materialIndices);
 
-	// Surface information reading
-	void ParseMeshFaces(Model* model, FbxMesh* fbxMesh);
+	// Material reading (model material index of each node material)
+	void ParseMaterial(Model* model, FbxNode* fbxNode, std::vector<UINT>& materialIndices);
 
-	// Material reading
-	void ParseMaterial(Model* model, FbxNode* fbxNode);
+	// Index of the white default material (added on first use)
+	UINT GetDefaultMaterial(Model* model);
 
-	// Read Skinning Information
-	void ParseSkin(Model* model, FbxMesh* fbxMesh);
+	// Read Skinning Information (per control point)
+	void ParseSkin(Model* model, FbxMesh* fbxMesh, std::vector<Model::VertexPosNormalUvSkin>& vertices);
+
+	/// <summary>
+	/// Build the joint hierarchy of the bones and bake every animation stack into a clip
+	/// </summary>
+	/// <param name="model">Imported model object (after ParseNodeRecursive)</param>
+	/// <param name="fbxScene">Scene of the model</param>
+	/// <param name="compression">Error tolerances of the clips</param>
+	void ParseAnimation(Model* model, FbxScene* fbxScene, const AnimationClip::CompressionSettings& compression);
 
 	// Texture reading
-	void LoadTexture(Model* model, const std::string& fullpath);
+	void LoadTexture(Model::Material& material, const std::string& fullpath);
 
 	std::string ExtractFileName(const std::string& path);
 
+	/// <summary>
+	/// Reorder triangles and vertices of every submesh for the GPU caches and report ACMR/ATVR
+	/// </summary>
+	/// <param name="model">Model to optimise (after SelectIndexFormat)</param>
+	void OptimizeModel(Model* model);
+
+	// Enable or disable the mesh optimisation of newly imported models
+	void SetOptimizeMeshes(bool optimize) { optimizeMeshes = optimize; }
+
+	// Vertex format of newly loaded models (set before requesting the loads)
+	void SetVertexFormat(Model::VertexFormat format) { vertexFormat = format; }
+
+	// Error tolerances of the animation clips of newly imported models (set before requesting the loads)
+	void SetAnimationCompression(const AnimationClip::CompressionSettings& settings) { animationCompression = settings; }
+
+	// Current import settings
+	ImportSettings GetImportSettings() const { return { vertexFormat, optimizeMeshes, animationCompression }; }
+
+	/// <summary>
+	/// Write the parsed model to a baked model file (through a temporary file replacing it at the end)
+	/// </summary>
+	/// <param name="model">Model to write</param>
+	/// <param name="bakedPath">Destination file path</param>
+	/// <param name="settings">Settings the model was imported with</param>
+	/// <param name="dependencies">Files read besides the source file, relative to the model folder</param>
+	/// <returns>Success or failure</returns>
+	bool SaveBakedModel(Model* model, const string& bakedPath, const ImportSettings& settings,
+		const std::vector<string>& dependencies = std::vector<string>());
+
+	/// <summary>
+	/// Read a model from a baked model file (memory-mapped, no FBX SDK involved)
+	/// </summary>
+	/// <param name="model">Import destination model object</param>
+	/// <param name="bakedPath">Baked model file path</param>
+	/// <returns>Success or failure</returns>
+	bool LoadBakedModel(Model* model, const string& bakedPath);
+
+	/// <summary>
+	/// Check whether the baked model file exists, is newer than the source file and its dependencies,
+	/// and was baked with the current import settings
+	/// </summary>
+	/// <param name="bakedPath">Baked model file path</param>
+	/// <param name="sourcePath">Source FBX file path</param>
+	/// <param name="settings">Settings the model is imported with</param>
+	/// <returns>True if the baked file can be used</returns>
+	bool IsBakedModelFresh(const string& bakedPath, const string& sourcePath, const ImportSettings& settings);
+
+private: // Subclass
+	// Model loading request
+	struct LoadJob
+	{
+		string modelName;
+		// Settings at the time of the request
+		ImportSettings settings;
+		// Imported model (set by the worker)
+		Model* model = nullptr;
+		std::promise<Model*> promise;
+	};
+
+private:
+	// Create an FBX manager with IO settings and an importer
+	static void CreateImporter(FbxManager*& manager, FbxImporter*& importer);
+
+	// CPU side model loading (baked file or FBX), without GPU buffers
+	Model* ImportModel(const string& modelName, FbxManager* manager, FbxImporter* importer, const ImportSettings& settings);
+
+	// Loop of a loading worker thread
+	void WorkerMain();
+
+	// Names of the models in the resource directory (folders holding an FBX or OBJ file of the same name)
+	static std::vector<string> FindModelNames();
+
+	// Delete the baked model files of the models
+	static void DeleteBakedModels(const std::vector<string>& modelNames);
+
 private:
 	// privateなコンストラクタ（シングルトンパターン）
 	FbxLoader() = default;
@@ -99,4 +282,25 @@ private:
 	FbxManager* fbxManager = nullptr;
 	// FBXImporter
 	FbxImporter* fbxImporter = nullptr;
+	// Optimise meshes after import
+	bool optimizeMeshes = true;
+	// Vertex format of loaded models
+	Model::VertexFormat vertexFormat = Model::VertexFormat::Compact;
+	// Error tolerances of imported animation clips
+	AnimationClip::CompressionSettings animationCompression;
+
+	// Loading worker threads
+	std::vector<std::thread> workers;
+	// Requests waiting for a worker
+	std::deque<LoadJob> jobQueue;
+	std::mutex jobMutex;
+	std::condition_variable jobCondition;
+	bool stopWorkers = false;
+	// Handles of the requests not completed yet by model name (guarded by jobMutex)
+	std::unordered_map<string, ModelHandle> pendingLoads;
+	// Imported models waiting for their buffers
+	std::vector<LoadJob> uploadQueue;
+	std::mutex uploadMutex;
+	// Models with texture mips still to upload (main thread)
+	std::vector<Model*> streamingModels;
 };
\ No newline at end of file
@@ -0,0 +1,669 @@
+#include "ObjLoader.h"
+#include "FbxLoader/FbxLoader.h"
+#include "VertexWelder.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <sstream>
+#include <thread>
+
+using namespace DirectX;
+
+/// <summary>
+/// Static Member Variable Entity
+/// </summary>
+const size_t ObjLoader::PARALLEL_THRESHOLD;
+
+// Skip spaces and tabs
+static void SkipBlanks(const char*& cursor, const char* end)
+{
+	while (cursor < end && (*cursor == ' ' || *cursor == '\t'))
+	{
+		cursor++;
+	}
+}
+
+// Start of the next line
+static const char* NextLine(const char* cursor, const char* end)
+{
+	const char* newline = (const char*)memchr(cursor, '\n', end - cursor);
+	return newline ? newline + 1 : end;
+}
+
+// Consume the keyword if the line starts with it followed by a blank
+static bool MatchKeyword(const char*& cursor, const char* lineEnd, const char* keyword)
+{
+	const size_t length = strlen(keyword);
+	if ((size_t)(lineEnd - cursor) > length && memcmp(cursor, keyword, length) == 0 &&
+		(cursor[length] == ' ' || cursor[length] == '\t'))
+	{
+		cursor += length;
+		return true;
+	}
+	return false;
+}
+
+// Rest of the line without surrounding blanks
+static std::string ReadName(const char* cursor, const char* lineEnd)
+{
+	SkipBlanks(cursor, lineEnd);
+	while (lineEnd > cursor && (lineEnd[-1] == ' ' || lineEnd[-1] == '\t' || lineEnd[-1] == '\r'))
+	{
+		lineEnd--;
+	}
+	return std::string(cursor, lineEnd);
+}
+
+// OBJ index (1-based or negative relative) to 0-based index, -1 if invalid
+static int32_t ResolveIndex(int value, size_t base, size_t localCount)
+{
+	if (value > 0)
+	{
+		return value - 1;
+	}
+	const int64_t index = (int64_t)(base + localCount) + value;
+	return value < 0 && index >= 0 ? (int32_t)index : -1;
+}
+
+float ObjLoader::ParseFloat(const char*& cursor, const char* end)
+{
+	// Powers of ten exactly representable as double
+	static const double POWERS_OF_TEN[] = {
+		1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+		1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22,
+	};
+	const int MAX_POWER = (int)(sizeof(POWERS_OF_TEN) / sizeof(POWERS_OF_TEN[0])) - 1;
+
+	SkipBlanks(cursor, end);
+
+	// Sign
+	bool negative = false;
+	if (cursor < end && (*cursor == '-' || *cursor == '+'))
+	{
+		negative = *cursor == '-';
+		cursor++;
+	}
+
+	// Digits collected into an integer mantissa and a decimal exponent
+	uint64_t mantissa = 0;
+	int exponent = 0;
+	int significantDigits = 0;
+	while (cursor < end && *cursor >= '0' && *cursor <= '9')
+	{
+		if (significantDigits < 18)
+		{
+			mantissa = mantissa * 10 + (*cursor - '0');
+			significantDigits += mantissa != 0;
+		}
+		else
+		{
+			exponent++;
+		}
+		cursor++;
+	}
+	if (cursor < end && *cursor == '.')
+	{
+		cursor++;
+		while (cursor < end && *cursor >= '0' && *cursor <= '9')
+		{
+			if (significantDigits < 18)
+			{
+				mantissa = mantissa * 10 + (*cursor - '0');
+				significantDigits += mantissa != 0;
+				exponent--;
+			}
+			cursor++;
+		}
+	}
+
+	// Exponent part
+	if (cursor < end && (*cursor == 'e' || *cursor == 'E'))
+	{
+		const char* exponentStart = cursor++;
+		bool negativeExponent = false;
+		if (cursor < end && (*cursor == '-' || *cursor == '+'))
+		{
+			negativeExponent = *cursor == '-';
+			cursor++;
+		}
+		if (cursor < end && *cursor >= '0' && *cursor <= '9')
+		{
+			int value = 0;
+			while (cursor < end && *cursor >= '0' && *cursor <= '9')
+			{
+				value = (std::min)(value * 10 + (*cursor - '0'), 1000);
+				cursor++;
+			}
+			exponent += negativeExponent ? -value : value;
+		}
+		else
+		{
+			// Not an exponent, leave the 'e' to the caller
+			cursor = exponentStart;
+		}
+	}
+
+	double value = (double)mantissa;
+	if (exponent < 0)
+	{
+		value = -exponent <= MAX_POWER ? value / POWERS_OF_TEN[-exponent] : value * pow(10.0, exponent);
+	}
+	else if (exponent > 0)
+	{
+		value = exponent <= MAX_POWER ? value * POWERS_OF_TEN[exponent] : value * pow(10.0, exponent);
+	}
+
+	return (float)(negative ? -value : value);
+}
+
+int ObjLoader::ParseInt(const char*& cursor, const char* end)
+{
+	SkipBlanks(cursor, end);
+
+	bool negative = false;
+	if (cursor < end && (*cursor == '-' || *cursor == '+'))
+	{
+		negative = *cursor == '-';
+		cursor++;
+	}
+
+	int value = 0;
+	while (cursor < end && *cursor >= '0' && *cursor <= '9')
+	{
+		value = value * 10 + (*cursor - '0');
+		cursor++;
+	}
+
+	return negative ? -value : value;
+}
+
+bool ObjLoader::LoadModel(Model* model, const string& directoryPath, const string& fileName)
+{
+	// Measure the parse throughput
+	auto parseStart = std::chrono::steady_clock::now();
+
+	const string fullpath = directoryPath + fileName;
+	materialLibraries.clear();
+
+	// Map the whole file into memory
+	HANDLE fileHandle = CreateFileA(fullpath.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+		OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+	if (fileHandle == INVALID_HANDLE_VALUE)
+	{
+		return false;
+	}
+
+	LARGE_INTEGER fileSize = {};
+	GetFileSizeEx(fileHandle, &fileSize);
+
+	HANDLE mappingHandle = fileSize.QuadPart > 0 ? CreateFileMappingA(fileHandle, nullptr, PAGE_READONLY, 0, 0, nullptr) : nullptr;
+	const char* view = mappingHandle ? (const char*)MapViewOfFile(mappingHandle, FILE_MAP_READ, 0, 0, 0) : nullptr;
+	if (view == nullptr)
+	{
+		if (mappingHandle)
+		{
+			CloseHandle(mappingHandle);
+		}
+		CloseHandle(fileHandle);
+		return false;
+	}
+	const char* end = view + fileSize.QuadPart;
+
+	// Line aligned chunks, one per hardware thread for large files
+	size_t chunkCount = 1;
+	if ((size_t)fileSize.QuadPart > PARALLEL_THRESHOLD)
+	{
+		chunkCount = (std::max)(std::thread::hardware_concurrency(), 1u);
+	}
+	std::vector<Chunk> chunks(chunkCount);
+	const char* chunkBegin = view;
+	for (size_t i = 0; i < chunkCount; i++)
+	{
+		Chunk& chunk = chunks[i];
+		chunk.begin = chunkBegin;
+		chunk.end = i + 1 == chunkCount ? end : (std::max)(chunkBegin, view + fileSize.QuadPart * (i + 1) / chunkCount);
+		if (chunk.end < end && chunk.end > view && chunk.end[-1] != '\n')
+		{
+			chunk.end = NextLine(chunk.end, end);
+		}
+		chunkBegin = chunk.end;
+	}
+
+	// Run a pass over all chunks, on worker threads when there are several
+	auto runPass = [&chunks](void (*pass)(Chunk&))
+	{
+		std::vector<std::thread> threads;
+		for (size_t i = 1; i < chunks.size(); i++)
+		{
+			threads.emplace_back(pass, std::ref(chunks[i]));
+		}
+		pass(chunks[0]);
+		for (std::thread& thread : threads)
+		{
+			thread.join();
+		}
+	};
+
+	// First pass, then the global index of the first attribute and the active material of each chunk
+	runPass(&ObjLoader::CountChunk);
+	size_t positionCount = 0;
+	size_t texcoordCount = 0;
+	size_t normalCount = 0;
+	string currentMaterial;
+	for (Chunk& chunk : chunks)
+	{
+		const size_t chunkPositions = chunk.positionBase;
+		const size_t chunkTexcoords = chunk.texcoordBase;
+		const size_t chunkNormals = chunk.normalBase;
+		chunk.positionBase = positionCount;
+		chunk.texcoordBase = texcoordCount;
+		chunk.normalBase = normalCount;
+		positionCount += chunkPositions;
+		texcoordCount += chunkTexcoords;
+		normalCount += chunkNormals;
+
+		chunk.initialMaterial = currentMaterial;
+		if (!chunk.lastMaterial.empty())
+		{
+			currentMaterial = chunk.lastMaterial;
+		}
+	}
+
+	// Second pass
+	runPass(&ObjLoader::ParseChunk);
+
+	UnmapViewOfFile(view);
+	CloseHandle(mappingHandle);
+	CloseHandle(fileHandle);
+
+	auto parseEnd = std::chrono::steady_clock::now();
+
+	// Attributes of the whole file
+	std::vector<XMFLOAT3> positions;
+	std::vector<XMFLOAT2> texcoords;
+	std::vector<XMFLOAT3> normals;
+	positions.reserve(positionCount);
+	texcoords.reserve(texcoordCount);
+	normals.reserve(normalCount);
+	size_t cornerCount = 0;
+	for (Chunk& chunk : chunks)
+	{
+		if (chunk.failed)
+		{
+			return false;
+		}
+		positions.insert(positions.end(), chunk.positions.begin(), chunk.positions.end());
+		texcoords.insert(texcoords.end(), chunk.texcoords.begin(), chunk.texcoords.end());
+		normals.insert(normals.end(), chunk.normals.begin(), chunk.normals.end());
+		cornerCount += chunk.corners.size();
+	}
+
+	// Materials of all referenced libraries
+	for (const Chunk& chunk : chunks)
+	{
+		for (const string& library : chunk.materialLibraries)
+		{
+			if (std::find(materialLibraries.begin(), materialLibraries.end(), library) == materialLibraries.end())
+			{
+				materialLibraries.push_back(library);
+				LoadMaterialLibrary(model, directoryPath, library);
+			}
+		}
+	}
+	std::map<string, UINT> materialIndices;
+	for (UINT i = 0; i < (UINT)model->materials.size(); i++)
+	{
+		materialIndices[model->materials[i].name] = i;
+	}
+
+	// Indices grouped by material
+	std::vector<std::vector<uint32_t>> materialGroups(model->materials.size());
+
+	// Corners with the same attributes are merged, same as the FBX path
+	VertexWelder welder;
+	welder.Reserve(cornerCount);
+
+	for (const Chunk& chunk : chunks)
+	{
+		for (size_t run = 0; run < chunk.materialRuns.size(); run++)
+		{
+			// Material of the run (unknown or missing names use the default material)
+			auto found = materialIndices.find(chunk.materialRuns[run].materialName);
+			const UINT materialIndex = found != materialIndices.end() ? found->second :
+				FbxLoader::GetInstance()->GetDefaultMaterial(model);
+			if (materialIndex >= materialGroups.size())
+			{
+				materialGroups.resize(materialIndex + 1);
+			}
+			std::vector<uint32_t>& groupIndices = materialGroups[materialIndex];
+
+			const size_t cornerStart = chunk.materialRuns[run].cornerStart;
+			const size_t cornerEnd = run + 1 < chunk.materialRuns.size() ? chunk.materialRuns[run + 1].cornerStart : chunk.corners.size();
+			for (size_t i = cornerStart; i + 3 <= cornerEnd; i += 3)
+			{
+				const Corner* triangle = &chunk.corners[i];
+
+				// Reject references outside the attribute arrays
+				for (int j = 0; j < 3; j++)
+				{
+					if ((size_t)triangle[j].position >= positions.size() ||
+						(triangle[j].texcoord >= 0 && (size_t)triangle[j].texcoord >= texcoords.size()) ||
+						(triangle[j].normal >= 0 && (size_t)triangle[j].normal >= normals.size()))
+					{
+						return false;
+					}
+				}
+
+				// Face normal for corners without one
+				XMFLOAT3 faceNormal(0.0f, 0.0f, 0.0f);
+				if (triangle[0].normal < 0 || triangle[1].normal < 0 || triangle[2].normal < 0)
+				{
+					XMVECTOR p0 = XMLoadFloat3(&positions[triangle[0].position]);
+					XMVECTOR p1 = XMLoadFloat3(&positions[triangle[1].position]);
+					XMVECTOR p2 = XMLoadFloat3(&positions[triangle[2].position]);
+					XMStoreFloat3(&faceNormal, XMVector3Normalize(XMVector3Cross(p1 - p0, p2 - p0)));
+				}
+
+				for (int j = 0; j < 3; j++)
+				{
+					Model::VertexPosNormalUvSkin vertex = {};
+					vertex.pos = positions[triangle[j].position];
+					vertex.normal = triangle[j].normal >= 0 ? normals[triangle[j].normal] : faceNormal;
+					if (triangle[j].texcoord >= 0)
+					{
+						// OBJ texture coordinates start at the bottom
+						vertex.uv.x = texcoords[triangle[j].texcoord].x;
+						vertex.uv.y = 1.0f - texcoords[triangle[j].texcoord].y;
+					}
+					// Follow the first bone (identity matrix) entirely
+					vertex.boneWeight[0] = 1.0f;
+
+					groupIndices.push_back(welder.Add(vertex));
+				}
+			}
+		}
+	}
+
+	// Welded vertices and one submesh per material
+	welder.TakeVertices(model->vertices);
+	for (size_t i = 0; i < materialGroups.size(); i++)
+	{
+		if (materialGroups[i].empty())
+		{
+			continue;
+		}
+
+		Model::Submesh submesh;
+		submesh.indexStart = (UINT)model->indices.size();
+		submesh.indexCount = (UINT)materialGroups[i].size();
+		submesh.baseVertex = 0;
+		submesh.materialIndex = (UINT)i;
+		model->submeshes.push_back(submesh);
+
+		model->indices.insert(model->indices.end(), materialGroups[i].begin(), materialGroups[i].end());
+	}
+
+	// A single node holding the mesh
+	model->nodes.emplace_back();
+	Node& node = model->nodes.back();
+	node.name = fileName;
+	node.transform = XMMatrixIdentity();
+	node.globalTransform = XMMatrixIdentity();
+	model->meshNode = &node;
+
+	auto buildEnd = std::chrono::steady_clock::now();
+	const double parseSeconds = std::chrono::duration<double>(parseEnd - parseStart).count();
+	char str[256];
+	sprintf_s(str, "ObjLoader: %s parsed %.2f MB in %.3f ms (%.1f MB/s, %zu chunks), %zu vertices built in %.3f ms\n",
+		fileName.c_str(), fileSize.QuadPart / (1024.0 * 1024.0), parseSeconds * 1000.0,
+		parseSeconds > 0.0 ? fileSize.QuadPart / (1024.0 * 1024.0) / parseSeconds : 0.0, chunkCount,
+		model->vertices.size(), std::chrono::duration<double, std::milli>(buildEnd - parseEnd).count());
+	OutputDebugStringA(str);
+
+	return true;
+}
+
+void ObjLoader::CountChunk(Chunk& chunk)
+{
+	size_t positionCount = 0;
+	size_t texcoordCount = 0;
+	size_t normalCount = 0;
+
+	for (const char* line = chunk.begin; line < chunk.end; line = NextLine(line, chunk.end))
+	{
+		const char* cursor = line;
+		SkipBlanks(cursor, chunk.end);
+		if (cursor + 1 >= chunk.end)
+		{
+			continue;
+		}
+
+		if (cursor[0] == 'v')
+		{
+			const char next = cursor[1];
+			if (next == ' ' || next == '\t')
+			{
+				positionCount++;
+			}
+			else if (next == 't' && cursor + 2 < chunk.end && (cursor[2] == ' ' || cursor[2] == '\t'))
+			{
+				texcoordCount++;
+			}
+			else if (next == 'n' && cursor + 2 < chunk.end && (cursor[2] == ' ' || cursor[2] == '\t'))
+			{
+				normalCount++;
+			}
+		}
+		else if (cursor[0] == 'u' || cursor[0] == 'm')
+		{
+			const char* lineEnd = (const char*)memchr(cursor, '\n', chunk.end - cursor);
+			lineEnd = lineEnd ? lineEnd : chunk.end;
+			if (MatchKeyword(cursor, lineEnd, "usemtl"))
+			{
+				chunk.lastMaterial = ReadName(cursor, lineEnd);
+			}
+			else if (MatchKeyword(cursor, lineEnd, "mtllib"))
+			{
+				chunk.materialLibraries.push_back(ReadName(cursor, lineEnd));
+			}
+		}
+	}
+
+	// Stored in the base members until the global offsets are known
+	chunk.positionBase = positionCount;
+	chunk.texcoordBase = texcoordCount;
+	chunk.normalBase = normalCount;
+}
+
+void ObjLoader::ParseChunk(Chunk& chunk)
+{
+	chunk.materialRuns.push_back(MaterialRun{ 0, chunk.initialMaterial });
+
+	// Corners of the current polygon
+	std::vector<Corner> polygon;
+
+	for (const char* line = chunk.begin; line < chunk.end && !chunk.failed; line = NextLine(line, chunk.end))
+	{
+		const char* lineEnd = (const char*)memchr(line, '\n', chunk.end - line);
+		lineEnd = lineEnd ? lineEnd : chunk.end;
+		const char* cursor = line;
+		SkipBlanks(cursor, lineEnd);
+
+		if (MatchKeyword(cursor, lineEnd, "v"))
+		{
+			XMFLOAT3 position;
+			position.x = ParseFloat(cursor, lineEnd);
+			position.y = ParseFloat(cursor, lineEnd);
+			position.z = ParseFloat(cursor, lineEnd);
+			chunk.positions.push_back(position);
+		}
+		else if (MatchKeyword(cursor, lineEnd, "vt"))
+		{
+			XMFLOAT2 texcoord;
+			texcoord.x = ParseFloat(cursor, lineEnd);
+			texcoord.y = ParseFloat(cursor, lineEnd);
+			chunk.texcoords.push_back(texcoord);
+		}
+		else if (MatchKeyword(cursor, lineEnd, "vn"))
+		{
+			XMFLOAT3 normal;
+			normal.x = ParseFloat(cursor, lineEnd);
+			normal.y = ParseFloat(cursor, lineEnd);
+			normal.z = ParseFloat(cursor, lineEnd);
+			chunk.normals.push_back(normal);
+		}
+		else if (MatchKeyword(cursor, lineEnd, "f"))
+		{
+			// Corners: v, v/vt, v//vn or v/vt/vn
+			polygon.clear();
+			while (true)
+			{
+				SkipBlanks(cursor, lineEnd);
+				if (cursor >= lineEnd || *cursor == '\r' || *cursor == '#')
+				{
+					break;
+				}
+
+				Corner corner = { -1, -1, -1 };
+				corner.position = ResolveIndex(ParseInt(cursor, lineEnd), chunk.positionBase, chunk.positions.size());
+				if (cursor < lineEnd && *cursor == '/')
+				{
+					cursor++;
+					if (cursor < lineEnd && *cursor != '/')
+					{
+						corner.texcoord = ResolveIndex(ParseInt(cursor, lineEnd), chunk.texcoordBase, chunk.texcoords.size());
+						if (corner.texcoord < 0)
+						{
+							chunk.failed = true;
+						}
+					}
+					if (cursor < lineEnd && *cursor == '/')
+					{
+						cursor++;
+						corner.normal = ResolveIndex(ParseInt(cursor, lineEnd), chunk.normalBase, chunk.normals.size());
+						if (corner.normal < 0)
+						{
+							chunk.failed = true;
+						}
+					}
+				}
+
+				// Anything else than a blank after the corner is malformed
+				if (corner.position < 0 || (cursor < lineEnd && *cursor != ' ' && *cursor != '\t' && *cursor != '\r'))
+				{
+					chunk.failed = true;
+					break;
+				}
+				polygon.push_back(corner);
+			}
+
+			// Triangle fan (0, i - 1, i)
+			for (size_t i = 2; i < polygon.size(); i++)
+			{
+				chunk.corners.push_back(polygon[0]);
+				chunk.corners.push_back(polygon[i - 1]);
+				chunk.corners.push_back(polygon[i]);
+			}
+		}
+		else if (MatchKeyword(cursor, lineEnd, "usemtl"))
+		{
+			// Replace a run without faces instead of adding an empty one
+			MaterialRun& last = chunk.materialRuns.back();
+			if (last.cornerStart == chunk.corners.size())
+			{
+				last.materialName = ReadName(cursor, lineEnd);
+			}
+			else
+			{
+				chunk.materialRuns.push_back(MaterialRun{ chunk.corners.size(), ReadName(cursor, lineEnd) });
+			}
+		}
+	}
+}
+
+void ObjLoader::LoadMaterialLibrary(Model* model, const string& directoryPath, const string& fileName)
+{
+	std::ifstream file(directoryPath + fileName);
+	if (file.fail())
+	{
+		return;
+	}
+
+	// Materials added by this library (textures are read at the end)
+	const size_t firstMaterial = model->materials.size();
+	std::vector<string> textureNames;
+	bool skipMaterial = true;
+
+	string line;
+	while (std::getline(file, line))
+	{
+		std::istringstream lineStream(line);
+		string key;
+		lineStream >> key;
+
+		if (key == "newmtl")
+		{
+			string name;
+			std::getline(lineStream >> std::ws, name);
+			if (!name.empty() && name.back() == '\r')
+			{
+				name.pop_back();
+			}
+
+			// Materials with a name already in the model are kept as they are
+			skipMaterial = false;
+			for (const Model::Material& material : model->materials)
+			{
+				skipMaterial |= material.name == name;
+			}
+			if (!skipMaterial)
+			{
+				model->materials.emplace_back();
+				model->materials.back().name = name;
+				textureNames.emplace_back();
+			}
+		}
+		else if (skipMaterial)
+		{
+			continue;
+		}
+		else if (key == "Ka")
+		{
+			XMFLOAT3& ambient = model->materials.back().ambient;
+			lineStream >> ambient.x >> ambient.y >> ambient.z;
+		}
+		else if (key == "Kd")
+		{
+			XMFLOAT3& diffuse = model->materials.back().diffuse;
+			lineStream >> diffuse.x >> diffuse.y >> diffuse.z;
+		}
+		else if (key == "map_Kd")
+		{
+			string& textureName = textureNames.back();
+			std::getline(lineStream >> std::ws, textureName);
+			if (!textureName.empty() && textureName.back() == '\r')
+			{
+				textureName.pop_back();
+			}
+		}
+	}
+
+	// Textures, the white default one if the material has none
+	FbxLoader* fbxLoader = FbxLoader::GetInstance();
+	for (size_t i = firstMaterial; i < model->materials.size(); i++)
+	{
+		const string& textureName = textureNames[i - firstMaterial];
+		if (textureName.empty())
+		{
+			fbxLoader->LoadTexture(model->materials[i], FbxLoader::baseDirectory + FbxLoader::defaultTextureFileName);
+		}
+		else
+		{
+			fbxLoader->LoadTexture(model->materials[i], directoryPath + textureName);
+		}
+	}
+}
@@ -0,0 +1,109 @@
+#pragma once
+
+#include "Model.h"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/// <summary>
+/// Wavefront OBJ/MTL reader producing the same Model structure as FbxLoader
+/// The file is memory-mapped and split into line aligned chunks that are parsed in parallel.
+/// </summary>
+class ObjLoader
+{
+private:
+	// std abbreviation
+	using string = std::string;
+
+public: // Constant
+	// Files larger than this are parsed in parallel chunks
+	static const size_t PARALLEL_THRESHOLD = 1024 * 1024;
+
+public:
+	/// <summary>
+	/// Read an OBJ file and the MTL libraries it references into the model (CPU side only)
+	/// </summary>
+	/// <param name="model">Import destination model object</param>
+	/// <param name="directoryPath">Folder of the OBJ file (with trailing slash)</param>
+	/// <param name="fileName">OBJ file name</param>
+	/// <returns>Success or failure</returns>
+	bool LoadModel(Model* model, const string& directoryPath, const string& fileName);
+
+	// MTL libraries referenced by the last loaded file (relative to its folder)
+	const std::vector<string>& GetMaterialLibraries() const { return materialLibraries; }
+
+	/// <summary>
+	/// Parse a decimal floating point number (with optional exponent), skipping leading blanks
+	/// </summary>
+	/// <param name="cursor">Read position (advanced past the number)</param>
+	/// <param name="end">End of the text</param>
+	/// <returns>Value (0 if there is no number)</returns>
+	static float ParseFloat(const char*& cursor, const char* end);
+
+	/// <summary>
+	/// Parse a signed decimal integer, skipping leading blanks
+	/// </summary>
+	/// <param name="cursor">Read position (advanced past the number)</param>
+	/// <param name="end">End of the text</param>
+	/// <returns>Value (0 if there is no number)</returns>
+	static int ParseInt(const char*& cursor, const char* end);
+
+private: // Subclass
+	// Face corner (0-based attribute indices, -1 if absent)
+	struct Corner
+	{
+		int32_t position;
+		int32_t texcoord;
+		int32_t normal;
+	};
+
+	// Material switch inside a chunk
+	struct MaterialRun
+	{
+		// First corner using the material
+		size_t cornerStart;
+		string materialName;
+	};
+
+	// Line aligned part of the file
+	struct Chunk
+	{
+		const char* begin = nullptr;
+		const char* end = nullptr;
+
+		// Counts of the first pass, turned into the global index of the first element
+		size_t positionBase = 0;
+		size_t texcoordBase = 0;
+		size_t normalBase = 0;
+		// Last material selected in the chunk (first pass)
+		string lastMaterial;
+		// Material active at the start of the chunk
+		string initialMaterial;
+		// MTL libraries referenced in the chunk
+		std::vector<string> materialLibraries;
+
+		// Attributes and triangulated corners of the second pass
+		std::vector<DirectX::XMFLOAT3> positions;
+		std::vector<DirectX::XMFLOAT2> texcoords;
+		std::vector<DirectX::XMFLOAT3> normals;
+		std::vector<Corner> corners;
+		std::vector<MaterialRun> materialRuns;
+		// Parse error found
+		bool failed = false;
+	};
+
+private:
+	// First pass: count the attributes and find the material statements
+	static void CountChunk(Chunk& chunk);
+
+	// Second pass: parse the attributes and faces
+	static void ParseChunk(Chunk& chunk);
+
+	// Read a MTL library and add its materials to the model
+	void LoadMaterialLibrary(Model* model, const string& directoryPath, const string& fileName);
+
+private:
+	// MTL libraries of the last loaded file
+	std::vector<string> materialLibraries;
+};
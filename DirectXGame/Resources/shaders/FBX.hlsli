@@ -23,10 +23,179 @@ struct VSOutput
 	float2 uv : TEXCOORD; // UV
 };
 
-// Bone max
-static const int MAX_BONES = 32;
-
 cbuffer skinning:register(b3) // Bone skinning insertion
 {
-	matrix matSkinning[MAX_BONES];
-}
\ No newline at end of file
+	uint paletteOffset; // First bone of the object in the palette
+	uint instanceOffset; // First instance of the draw in the instance buffer (instanced drawing)
+}
+
+#ifdef INSTANCED
+// Per-object data of instanced drawing (InstancedRenderer::InstanceData)
+struct InstanceData
+{
+	matrix world; // World matrix
+	uint paletteOffset; // First bone of the object in the palette
+	uint3 padding;
+};
+
+// Objects of every instanced draw this frame
+StructuredBuffer<InstanceData> instances : register(t2);
+#endif
+
+// Data of the object drawn by a vertex
+struct ObjectData
+{
+	matrix world; // World matrix
+	uint paletteOffset; // First bone of the object in the palette
+};
+
+// Object of the instance (the constants of the object when not instanced)
+ObjectData GetObjectData(uint instanceID)
+{
+	ObjectData output;
+#ifdef INSTANCED
+	InstanceData instance = instances[instanceOffset + instanceID];
+	output.world = instance.world;
+	output.paletteOffset = instance.paletteOffset;
+#else
+	output.world = world;
+	output.paletteOffset = paletteOffset;
+#endif
+	return output;
+}
+
+#ifdef DUAL_QUATERNION_SKINNING
+// Unit dual quaternion (rotation, then translation)
+struct DualQuaternion
+{
+	float4 real; // Rotation
+	float4 dual; // 0.5 * translation * rotation
+};
+
+// Skinning dual quaternions of every object (shared by many objects, any number of bones)
+StructuredBuffer<DualQuaternion> skinPalette : register(t1);
+#else
+// Skinning matrices of every object (shared by many objects, any number of bones)
+StructuredBuffer<matrix> skinPalette : register(t1);
+#endif
+
+cbuffer quantization : register(b4) // Dequantization of compact vertices
+{
+	float4 posScale; // Half extent of the bounding box
+	float4 posOffset; // Center of the bounding box
+	float4 uvScaleOffset; // UV range (xy: scale, zw: offset)
+}
+
+// Compact vertex buffer entry (Model::VertexCompact)
+struct VSCompactInput
+{
+	float4 pos : POSITION; // Position (snorm16 in the bounding box, or half)
+	float2 normal : NORMAL; // Octahedral encoded normal (snorm16)
+	float2 uv : TEXCOORD; // Texture Coordinates (unorm16 in the UV range)
+	uint4 boneIndices : BONEINDICES; // Bone Number (uint8)
+	float4 boneWeights : BONEWEIGHTS; // Bone Weight (unorm8)
+};
+
+// Unit vector from octahedral encoding
+float3 DecodeOctahedral(float2 e)
+{
+	float3 n = float3(e.x, e.y, 1.0f - abs(e.x) - abs(e.y));
+	float t = saturate(-n.z);
+	n.x += n.x >= 0.0f ? -t : t;
+	n.y += n.y >= 0.0f ? -t : t;
+	return normalize(n);
+}
+
+// Compact vertex to the full vertex entry
+VSInput DecodeCompactVertex(VSCompactInput input)
+{
+	VSInput output;
+	output.pos = float4(input.pos.xyz * posScale.xyz + posOffset.xyz, 1.0f);
+	output.normal = DecodeOctahedral(input.normal);
+	output.uv = input.uv * uvScaleOffset.xy + uvScaleOffset.zw;
+	output.boneIndices = input.boneIndices;
+	output.boneWeights = input.boneWeights;
+	return output;
+}
+
+// Enter vertices and normals after skinning
+struct SkinOutput
+{
+	float4 pos;
+	float3 normal;
+};
+
+#ifdef DUAL_QUATERNION_SKINNING
+SkinOutput ComputeSkin(VSInput input, uint firstBone)
+{
+	SkinOutput output;
+
+	// Blend of the dual quaternions, all in the hemisphere of bone 0 (shortest rotation)
+	DualQuaternion dq0 = skinPalette[firstBone + input.boneIndices.x];
+	DualQuaternion dq1 = skinPalette[firstBone + input.boneIndices.y];
+	DualQuaternion dq2 = skinPalette[firstBone + input.boneIndices.z];
+	DualQuaternion dq3 = skinPalette[firstBone + input.boneIndices.w];
+	float4 weights = input.boneWeights;
+	weights.y *= dot(dq0.real, dq1.real) < 0.0f ? -1.0f : 1.0f;
+	weights.z *= dot(dq0.real, dq2.real) < 0.0f ? -1.0f : 1.0f;
+	weights.w *= dot(dq0.real, dq3.real) < 0.0f ? -1.0f : 1.0f;
+
+	float4 real = weights.x * dq0.real + weights.y * dq1.real + weights.z * dq2.real + weights.w * dq3.real;
+	float4 dual = weights.x * dq0.dual + weights.y * dq1.dual + weights.z * dq2.dual + weights.w * dq3.dual;
+
+	// Normalize (the blend keeps the volume instead of shrinking towards the joint)
+	float invLength = rcp(length(real));
+	real *= invLength;
+	dual *= invLength;
+
+	// Rotate, then translate by 2 * dual * conjugate(real)
+	float3 position = input.pos.xyz;
+	position += 2.0f * cross(real.xyz, cross(real.xyz, position) + real.w * position);
+	position += 2.0f * (real.w * dual.xyz - dual.w * real.xyz + cross(real.xyz, dual.xyz));
+	output.pos = float4(position, 1.0f);
+
+	output.normal = input.normal + 2.0f * cross(real.xyz, cross(real.xyz, input.normal) + real.w * input.normal);
+
+	return output;
+}
+#else
+SkinOutput ComputeSkin(VSInput input, uint firstBone)
+{
+	// Clear Zero
+	SkinOutput output = (SkinOutput)0;
+
+	uint iBone; // Bone number to calculate
+	float weight; // Bone weight
+	matrix m; // Skinning matrix
+
+	// Bone 0
+	iBone = input.boneIndices.x;
+	weight = input.boneWeights.x;
+	m = skinPalette[firstBone + iBone];
+	output.pos += weight * mul(m, input.pos);
+	output.normal += weight * mul((float3x3)m, input.normal);
+
+	// Bone 1
+	iBone = input.boneIndices.y;
+	weight = input.boneWeights.y;
+	m = skinPalette[firstBone + iBone];
+	output.pos += weight * mul(m, input.pos);
+	output.normal += weight * mul((float3x3)m, input.normal);
+
+	// Bone 2
+	iBone = input.boneIndices.z;
+	weight = input.boneWeights.z;
+	m = skinPalette[firstBone + iBone];
+	output.pos += weight * mul(m, input.pos);
+	output.normal += weight * mul((float3x3)m, input.normal);
+
+	// Bone 3
+	iBone = input.boneIndices.w;
+	weight = input.boneWeights.w;
+	m = skinPalette[firstBone + iBone];
+	output.pos += weight * mul(m, input.pos);
+	output.normal += weight * mul((float3x3)m, input.normal);
+
+	return output;
+}
+#endif
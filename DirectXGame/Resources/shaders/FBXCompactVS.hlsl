@@ -0,0 +1,24 @@
+#include "FBX.hlsli"
+
+// Entry point (compact vertices)
+VSOutput main(VSCompactInput compactInput, uint instanceID : SV_InstanceID)
+{
+	// Dequantize into the full vertex entry
+	VSInput input = DecodeCompactVertex(compactInput);
+	// World matrix and bones of the object (of the instance when drawn instanced)
+	ObjectData objectData = GetObjectData(instanceID);
+	// Skinning calculation
+	SkinOutput skinned = ComputeSkin(input, objectData.paletteOffset);
+	// Apply scaling and rotation by world matrix to normals
+	float4 wnormal = normalize(mul(objectData.world, float4(input.normal, 0)));
+	// Value to pass to the pixel shader
+	VSOutput output;
+	// Coordinate change due to matrix
+	output.svpos = mul(mul(viewproj, objectData.world), skinned.pos);
+	// Pass the world normal to the final stage
+	output.normal = wnormal.xyz;
+	// Pass the input value as it is to the next stage
+	output.uv = input.uv;
+
+	return output;
+}
\ No newline at end of file
@@ -1,54 +1,7 @@
 #include "FBX.hlsli"
 
-// Enter vertices and normals after skinning
-struct SkinOutput
-{
-	float4 pos;
-	float3 normal;
-};
-
-SkinOutput ComputeSkin(VSInput input)
-{
-	// Clear Zero
-	SkinOutput output = (SkinOutput)0;
-
-	uint iBone; // Bone number to calculate
-	float weight; // Bone weight
-	matrix m; // Skinning matrix
-
-	// Bone 0
-	iBone = input.boneIndices.x;
-	weight = input.boneWeights.x;
-	m = matSkinning[iBone];
-	output.pos += weight * mul(m, input.pos);
-	output.normal += weight * mul((float3x3)m, input.normal);
-
-	// Bone 1
-	iBone = input.boneIndices.y;
-	weight = input.boneWeights.y;
-	m = matSkinning[iBone];
-	output.pos += weight * mul(m, input.pos);
-	output.normal += weight * mul((float3x3)m, input.normal);
-
-	// Bone 2
-	iBone = input.boneIndices.z;
-	weight = input.boneWeights.z;
-	m = matSkinning[iBone];
-	output.pos += weight * mul(m, input.pos);
-	output.normal += weight * mul((float3x3)m, input.normal);
-
-	// Bone 3
-	iBone = input.boneIndices.w;
-	weight = input.boneWeights.w;
-	m = matSkinning[iBone];
-	output.pos += weight * mul(m, input.pos);
-	output.normal += weight * mul((float3x3)m, input.normal);
-
-	return output;
-}
-
 // Skinning Calculation
-//SkinOutput ComputeSkin(VSInput input)
+//SkinOutput ComputeSkin(VSInput input, uint firstBone)
 //{
 //	// Clear zero
 //	SkinOutput output;
@@ -58,7 +11,7 @@ SkinOutput ComputeSkin(VSInput input)
 //
 //	// Bone 0 only
 //	iBone = input.boneIndices.x;
-//	m = matSkinning[iBone];
+//	m = skinPalette[firstBone + iBone];
 //	output.pos = mul(m, input.pos);
 //	output.normal = mul((float3x3)m, input.normal);
 //
@@ -66,16 +19,18 @@ SkinOutput ComputeSkin(VSInput input)
 //}
 
 // Entry point
-VSOutput main(VSInput input)
+VSOutput main(VSInput input, uint instanceID : SV_InstanceID)
 {
+	// World matrix and bones of the object (of the instance when drawn instanced)
+	ObjectData objectData = GetObjectData(instanceID);
 	// Skinning calculation
-	SkinOutput skinned = ComputeSkin(input);
+	SkinOutput skinned = ComputeSkin(input, objectData.paletteOffset);
 	// Apply scaling and rotation by world matrix to normals
-	float4 wnormal = normalize(mul(world, float4(input.normal, 0)));
+	float4 wnormal = normalize(mul(objectData.world, float4(input.normal, 0)));
 	// Value to pass to the pixel shader
 	VSOutput output;
 	// Coordinate change due to matrix
-	output.svpos = mul(mul(viewproj, world), skinned.pos);
+	output.svpos = mul(mul(viewproj, objectData.world), skinned.pos);
 	// Pass the world normal to the final stage
 	output.normal = wnormal.xyz;
 	// Pass the input value as it is to the next stage
@@ -0,0 +1,84 @@
+#include "CommandListPool.h"
+
+#include <cassert>
+
+/// <summary>
+/// Static Member Variable Entity
+/// </summary>
+const size_t CommandListPool::MAX_COMMAND_LISTS;
+
+bool CommandListPool::Initialize(ID3D12Device* device, size_t listCount)
+{
+	HRESULT result;
+
+	assert(device);
+	assert(listCount >= 1 && listCount <= MAX_COMMAND_LISTS);
+	this->listCount = listCount;
+
+	for (size_t i = 0; i < listCount; i++)
+	{
+		for (int frame = 0; frame < FramePacer::FRAMES_IN_FLIGHT; frame++)
+		{
+			result = device->CreateCommandAllocator(D3D12_COMMAND_LIST_TYPE_DIRECT, IID_PPV_ARGS(&commandAllocators[frame][i]));
+			if (FAILED(result))
+			{
+				assert(0);
+				return false;
+			}
+		}
+
+		// Lists are created open, they start closed so that Open can reset them
+		result = device->CreateCommandList(0, D3D12_COMMAND_LIST_TYPE_DIRECT, commandAllocators[0][i].Get(), nullptr, IID_PPV_ARGS(&commandLists[i]));
+		if (FAILED(result))
+		{
+			assert(0);
+			return false;
+		}
+		commandLists[i]->Close();
+	}
+
+	frameIndex = 0;
+	openCount = 0;
+	return true;
+}
+
+void CommandListPool::BeginFrame(int frameIndex)
+{
+	assert(frameIndex >= 0 && frameIndex < FramePacer::FRAMES_IN_FLIGHT);
+	assert(openCount == 0);
+	this->frameIndex = frameIndex;
+}
+
+ID3D12GraphicsCommandList* CommandListPool::Open()
+{
+	if (openCount >= listCount)
+	{
+		assert(0);
+		return nullptr;
+	}
+
+	// A list may be reset as soon as it was executed, its allocator only once the GPU is done with it
+	ID3D12CommandAllocator* commandAllocator = commandAllocators[frameIndex][openCount].Get();
+	ID3D12GraphicsCommandList* commandList = commandLists[openCount].Get();
+	commandAllocator->Reset();
+	commandList->Reset(commandAllocator, nullptr);
+	openCount++;
+	return commandList;
+}
+
+void CommandListPool::Execute(ID3D12CommandQueue* commandQueue)
+{
+	ID3D12CommandList* cmdLists[MAX_COMMAND_LISTS];
+	for (size_t i = 0; i < openCount; i++)
+	{
+		commandLists[i]->Close();
+		cmdLists[i] = commandLists[i].Get();
+	}
+	if (openCount > 0)
+	{
+		commandQueue->ExecuteCommandLists((UINT)openCount, cmdLists);
+	}
+
+	executedCount = openCount;
+	openCount = 0;
+}
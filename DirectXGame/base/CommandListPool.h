@@ -0,0 +1,70 @@
+#pragma once
+
+#include "FramePacer.h"
+
+#include <d3d12.h>
+#include <wrl.h>
+
+#include <cstddef>
+
+/// <summary>
+/// Command lists of a frame, recorded on any thread and executed in order with one ExecuteCommandLists
+/// Every list has one allocator per frame in flight, so the allocators of a frame are only reset once the
+/// FramePacer has waited for the GPU to finish the frame that used them last. Open and Execute are called from
+/// the main thread; a list handed out by Open may then be recorded on any one thread.
+/// </summary>
+class CommandListPool
+{
+private: // Alias
+	// using Microsoft::WRL
+	template <class T> using ComPtr = Microsoft::WRL::ComPtr<T>;
+
+public: // Constant
+	// Largest number of command lists per frame
+	static const size_t MAX_COMMAND_LISTS = 16;
+
+public:
+	/// <summary>
+	/// Create the command lists and their allocators
+	/// </summary>
+	/// <param name="device">D3D12Device</param>
+	/// <param name="listCount">Command lists per frame (up to MAX_COMMAND_LISTS)</param>
+	/// <returns>Success</returns>
+	bool Initialize(ID3D12Device* device, size_t listCount = MAX_COMMAND_LISTS);
+
+	/// <summary>
+	/// Start a frame on the allocators of a frame slot (the GPU must have finished the frame that used them last)
+	/// </summary>
+	/// <param name="frameIndex">Slot of the frame (FramePacer::GetFrameIndex)</param>
+	void BeginFrame(int frameIndex);
+
+	/// <summary>
+	/// Reset and open the next command list of the frame, executed after every list opened before it
+	/// The list starts without any state (render targets, viewports, root signature)
+	/// </summary>
+	/// <returns>Command list (nullptr if every list of the frame is open)</returns>
+	ID3D12GraphicsCommandList* Open();
+
+	/// <summary>
+	/// Close the lists opened this frame and execute them in order of Open with one ExecuteCommandLists
+	/// </summary>
+	/// <param name="commandQueue">Command queue</param>
+	void Execute(ID3D12CommandQueue* commandQueue);
+
+	// Command lists that can still be opened this frame
+	size_t GetAvailableCount() const { return listCount - openCount; }
+
+	// Command lists executed by the last Execute
+	size_t GetExecutedCount() const { return executedCount; }
+
+private:
+	ComPtr<ID3D12GraphicsCommandList> commandLists[MAX_COMMAND_LISTS];
+	// Allocators of every frame slot and list
+	ComPtr<ID3D12CommandAllocator> commandAllocators[FramePacer::FRAMES_IN_FLIGHT][MAX_COMMAND_LISTS];
+	size_t listCount = 0;
+	// Frame slot of the allocators in use
+	int frameIndex = 0;
+	// Lists opened this frame, in execution order
+	size_t openCount = 0;
+	size_t executedCount = 0;
+};
@@ -0,0 +1,363 @@
+#include "CountingCommandList.h"
+
+void CountingCommandList::Clear()
+{
+	callCount = 0;
+	drawCount = 0;
+	stream.clear();
+}
+
+void CountingCommandList::Write(const void* data, size_t size)
+{
+	const uint8_t* bytes = (const uint8_t*)data;
+	stream.insert(stream.end(), bytes, bytes + size);
+}
+
+HRESULT STDMETHODCALLTYPE CountingCommandList::QueryInterface(REFIID riid, void** ppvObject)
+{
+	if (ppvObject == nullptr)
+	{
+		return E_POINTER;
+	}
+	if (riid == __uuidof(IUnknown) || riid == __uuidof(ID3D12Object) || riid == __uuidof(ID3D12DeviceChild) ||
+		riid == __uuidof(ID3D12CommandList) || riid == __uuidof(ID3D12GraphicsCommandList))
+	{
+		*ppvObject = this;
+		return S_OK;
+	}
+	*ppvObject = nullptr;
+	return E_NOINTERFACE;
+}
+
+ULONG STDMETHODCALLTYPE CountingCommandList::AddRef()
+{
+	return 1;
+}
+
+ULONG STDMETHODCALLTYPE CountingCommandList::Release()
+{
+	return 1;
+}
+
+HRESULT STDMETHODCALLTYPE CountingCommandList::GetPrivateData(REFGUID guid, UINT* pDataSize, void* pData)
+{
+	return DXGI_ERROR_NOT_FOUND;
+}
+
+HRESULT STDMETHODCALLTYPE CountingCommandList::SetPrivateData(REFGUID guid, UINT DataSize, const void* pData)
+{
+	return S_OK;
+}
+
+HRESULT STDMETHODCALLTYPE CountingCommandList::SetPrivateDataInterface(REFGUID guid, const IUnknown* pData)
+{
+	return S_OK;
+}
+
+HRESULT STDMETHODCALLTYPE CountingCommandList::SetName(LPCWSTR Name)
+{
+	return S_OK;
+}
+
+HRESULT STDMETHODCALLTYPE CountingCommandList::GetDevice(REFIID riid, void** ppvDevice)
+{
+	// Headless, there is no device
+	if (ppvDevice != nullptr)
+	{
+		*ppvDevice = nullptr;
+	}
+	return E_NOINTERFACE;
+}
+
+D3D12_COMMAND_LIST_TYPE STDMETHODCALLTYPE CountingCommandList::GetType()
+{
+	return D3D12_COMMAND_LIST_TYPE_DIRECT;
+}
+
+HRESULT STDMETHODCALLTYPE CountingCommandList::Close()
+{
+	Record();
+	return S_OK;
+}
+
+HRESULT STDMETHODCALLTYPE CountingCommandList::Reset(ID3D12CommandAllocator* pAllocator, ID3D12PipelineState* pInitialState)
+{
+	Clear();
+	return S_OK;
+}
+
+void STDMETHODCALLTYPE CountingCommandList::ClearState(ID3D12PipelineState* pPipelineState)
+{
+	Record(pPipelineState);
+}
+
+void STDMETHODCALLTYPE CountingCommandList::DrawInstanced(UINT VertexCountPerInstance, UINT InstanceCount, UINT StartVertexLocation, UINT StartInstanceLocation)
+{
+	Record(VertexCountPerInstance, InstanceCount, StartVertexLocation, StartInstanceLocation);
+	drawCount++;
+}
+
+void STDMETHODCALLTYPE CountingCommandList::DrawIndexedInstanced(UINT IndexCountPerInstance, UINT InstanceCount, UINT StartIndexLocation, INT BaseVertexLocation, UINT StartInstanceLocation)
+{
+	Record(IndexCountPerInstance, InstanceCount, StartIndexLocation, BaseVertexLocation, StartInstanceLocation);
+	drawCount++;
+}
+
+void STDMETHODCALLTYPE CountingCommandList::Dispatch(UINT ThreadGroupCountX, UINT ThreadGroupCountY, UINT ThreadGroupCountZ)
+{
+	Record(ThreadGroupCountX, ThreadGroupCountY, ThreadGroupCountZ);
+}
+
+void STDMETHODCALLTYPE CountingCommandList::CopyBufferRegion(ID3D12Resource* pDstBuffer, UINT64 DstOffset, ID3D12Resource* pSrcBuffer, UINT64 SrcOffset, UINT64 NumBytes)
+{
+	Record(pDstBuffer, DstOffset, pSrcBuffer, SrcOffset, NumBytes);
+}
+
+void STDMETHODCALLTYPE CountingCommandList::CopyTextureRegion(const D3D12_TEXTURE_COPY_LOCATION* pDst, UINT DstX, UINT DstY, UINT DstZ, const D3D12_TEXTURE_COPY_LOCATION* pSrc, const D3D12_BOX* pSrcBox)
+{
+	Record(*pDst, DstX, DstY, DstZ, *pSrc, pSrcBox);
+}
+
+void STDMETHODCALLTYPE CountingCommandList::CopyResource(ID3D12Resource* pDstResource, ID3D12Resource* pSrcResource)
+{
+	Record(pDstResource, pSrcResource);
+}
+
+void STDMETHODCALLTYPE CountingCommandList::CopyTiles(ID3D12Resource* pTiledResource, const D3D12_TILED_RESOURCE_COORDINATE* pTileRegionStartCoordinate, const D3D12_TILE_REGION_SIZE* pTileRegionSize, ID3D12Resource* pBuffer, UINT64 BufferStartOffsetInBytes, D3D12_TILE_COPY_FLAGS Flags)
+{
+	Record(pTiledResource, *pTileRegionStartCoordinate, *pTileRegionSize, pBuffer, BufferStartOffsetInBytes, Flags);
+}
+
+void STDMETHODCALLTYPE CountingCommandList::ResolveSubresource(ID3D12Resource* pDstResource, UINT DstSubresource, ID3D12Resource* pSrcResource, UINT SrcSubresource, DXGI_FORMAT Format)
+{
+	Record(pDstResource, DstSubresource, pSrcResource, SrcSubresource, Format);
+}
+
+void STDMETHODCALLTYPE CountingCommandList::IASetPrimitiveTopology(D3D12_PRIMITIVE_TOPOLOGY PrimitiveTopology)
+{
+	Record(PrimitiveTopology);
+}
+
+void STDMETHODCALLTYPE CountingCommandList::RSSetViewports(UINT NumViewports, const D3D12_VIEWPORT* pViewports)
+{
+	Record(NumViewports);
+	Write(pViewports, sizeof(D3D12_VIEWPORT) * NumViewports);
+}
+
+void STDMETHODCALLTYPE CountingCommandList::RSSetScissorRects(UINT NumRects, const D3D12_RECT* pRects)
+{
+	Record(NumRects);
+	Write(pRects, sizeof(D3D12_RECT) * NumRects);
+}
+
+void STDMETHODCALLTYPE CountingCommandList::OMSetBlendFactor(const FLOAT BlendFactor[4])
+{
+	Record();
+	Write(BlendFactor, sizeof(FLOAT) * 4);
+}
+
+void STDMETHODCALLTYPE CountingCommandList::OMSetStencilRef(UINT StencilRef)
+{
+	Record(StencilRef);
+}
+
+void STDMETHODCALLTYPE CountingCommandList::SetPipelineState(ID3D12PipelineState* pPipelineState)
+{
+	Record(pPipelineState);
+}
+
+void STDMETHODCALLTYPE CountingCommandList::ResourceBarrier(UINT NumBarriers, const D3D12_RESOURCE_BARRIER* pBarriers)
+{
+	Record(NumBarriers);
+	Write(pBarriers, sizeof(D3D12_RESOURCE_BARRIER) * NumBarriers);
+}
+
+void STDMETHODCALLTYPE CountingCommandList::ExecuteBundle(ID3D12GraphicsCommandList* pCommandList)
+{
+	Record(pCommandList);
+}
+
+void STDMETHODCALLTYPE CountingCommandList::SetDescriptorHeaps(UINT NumDescriptorHeaps, ID3D12DescriptorHeap* const* ppDescriptorHeaps)
+{
+	Record(NumDescriptorHeaps);
+	Write(ppDescriptorHeaps, sizeof(ID3D12DescriptorHeap*) * NumDescriptorHeaps);
+}
+
+void STDMETHODCALLTYPE CountingCommandList::SetComputeRootSignature(ID3D12RootSignature* pRootSignature)
+{
+	Record(pRootSignature);
+}
+
+void STDMETHODCALLTYPE CountingCommandList::SetGraphicsRootSignature(ID3D12RootSignature* pRootSignature)
+{
+	Record(pRootSignature);
+}
+
+void STDMETHODCALLTYPE CountingCommandList::SetComputeRootDescriptorTable(UINT RootParameterIndex, D3D12_GPU_DESCRIPTOR_HANDLE BaseDescriptor)
+{
+	Record(RootParameterIndex, BaseDescriptor);
+}
+
+void STDMETHODCALLTYPE CountingCommandList::SetGraphicsRootDescriptorTable(UINT RootParameterIndex, D3D12_GPU_DESCRIPTOR_HANDLE BaseDescriptor)
+{
+	Record(RootParameterIndex, BaseDescriptor);
+}
+
+void STDMETHODCALLTYPE CountingCommandList::SetComputeRoot32BitConstant(UINT RootParameterIndex, UINT SrcData, UINT DestOffsetIn32BitValues)
+{
+	Record(RootParameterIndex, SrcData, DestOffsetIn32BitValues);
+}
+
+void STDMETHODCALLTYPE CountingCommandList::SetGraphicsRoot32BitConstant(UINT RootParameterIndex, UINT SrcData, UINT DestOffsetIn32BitValues)
+{
+	Record(RootParameterIndex, SrcData, DestOffsetIn32BitValues);
+}
+
+void STDMETHODCALLTYPE CountingCommandList::SetComputeRoot32BitConstants(UINT RootParameterIndex, UINT Num32BitValuesToSet, const void* pSrcData, UINT DestOffsetIn32BitValues)
+{
+	Record(RootParameterIndex, Num32BitValuesToSet, DestOffsetIn32BitValues);
+	Write(pSrcData, sizeof(UINT) * Num32BitValuesToSet);
+}
+
+void STDMETHODCALLTYPE CountingCommandList::SetGraphicsRoot32BitConstants(UINT RootParameterIndex, UINT Num32BitValuesToSet, const void* pSrcData, UINT DestOffsetIn32BitValues)
+{
+	Record(RootParameterIndex, Num32BitValuesToSet, DestOffsetIn32BitValues);
+	Write(pSrcData, sizeof(UINT) * Num32BitValuesToSet);
+}
+
+void STDMETHODCALLTYPE CountingCommandList::SetComputeRootConstantBufferView(UINT RootParameterIndex, D3D12_GPU_VIRTUAL_ADDRESS BufferLocation)
+{
+	Record(RootParameterIndex, BufferLocation);
+}
+
+void STDMETHODCALLTYPE CountingCommandList::SetGraphicsRootConstantBufferView(UINT RootParameterIndex, D3D12_GPU_VIRTUAL_ADDRESS BufferLocation)
+{
+	Record(RootParameterIndex, BufferLocation);
+}
+
+void STDMETHODCALLTYPE CountingCommandList::SetComputeRootShaderResourceView(UINT RootParameterIndex, D3D12_GPU_VIRTUAL_ADDRESS BufferLocation)
+{
+	Record(RootParameterIndex, BufferLocation);
+}
+
+void STDMETHODCALLTYPE CountingCommandList::SetGraphicsRootShaderResourceView(UINT RootParameterIndex, D3D12_GPU_VIRTUAL_ADDRESS BufferLocation)
+{
+	Record(RootParameterIndex, BufferLocation);
+}
+
+void STDMETHODCALLTYPE CountingCommandList::SetComputeRootUnorderedAccessView(UINT RootParameterIndex, D3D12_GPU_VIRTUAL_ADDRESS BufferLocation)
+{
+	Record(RootParameterIndex, BufferLocation);
+}
+
+void STDMETHODCALLTYPE CountingCommandList::SetGraphicsRootUnorderedAccessView(UINT RootParameterIndex, D3D12_GPU_VIRTUAL_ADDRESS BufferLocation)
+{
+	Record(RootParameterIndex, BufferLocation);
+}
+
+void STDMETHODCALLTYPE CountingCommandList::IASetIndexBuffer(const D3D12_INDEX_BUFFER_VIEW* pView)
+{
+	Record(pView);
+	if (pView != nullptr)
+	{
+		Write(pView, sizeof(*pView));
+	}
+}
+
+void STDMETHODCALLTYPE CountingCommandList::IASetVertexBuffers(UINT StartSlot, UINT NumViews, const D3D12_VERTEX_BUFFER_VIEW* pViews)
+{
+	Record(StartSlot, NumViews);
+	if (pViews != nullptr)
+	{
+		Write(pViews, sizeof(D3D12_VERTEX_BUFFER_VIEW) * NumViews);
+	}
+}
+
+void STDMETHODCALLTYPE CountingCommandList::SOSetTargets(UINT StartSlot, UINT NumViews, const D3D12_STREAM_OUTPUT_BUFFER_VIEW* pViews)
+{
+	Record(StartSlot, NumViews);
+	if (pViews != nullptr)
+	{
+		Write(pViews, sizeof(D3D12_STREAM_OUTPUT_BUFFER_VIEW) * NumViews);
+	}
+}
+
+void STDMETHODCALLTYPE CountingCommandList::OMSetRenderTargets(UINT NumRenderTargetDescriptors, const D3D12_CPU_DESCRIPTOR_HANDLE* pRenderTargetDescriptors, BOOL RTsSingleHandleToDescriptorRange, const D3D12_CPU_DESCRIPTOR_HANDLE* pDepthStencilDescriptor)
+{
+	Record(NumRenderTargetDescriptors, RTsSingleHandleToDescriptorRange, pDepthStencilDescriptor);
+	Write(pRenderTargetDescriptors, sizeof(D3D12_CPU_DESCRIPTOR_HANDLE) * (RTsSingleHandleToDescriptorRange ? 1 : NumRenderTargetDescriptors));
+}
+
+void STDMETHODCALLTYPE CountingCommandList::ClearDepthStencilView(D3D12_CPU_DESCRIPTOR_HANDLE DepthStencilView, D3D12_CLEAR_FLAGS ClearFlags, FLOAT Depth, UINT8 Stencil, UINT NumRects, const D3D12_RECT* pRects)
+{
+	Record(DepthStencilView, ClearFlags, Depth, Stencil, NumRects);
+	Write(pRects, sizeof(D3D12_RECT) * NumRects);
+}
+
+void STDMETHODCALLTYPE CountingCommandList::ClearRenderTargetView(D3D12_CPU_DESCRIPTOR_HANDLE RenderTargetView, const FLOAT ColorRGBA[4], UINT NumRects, const D3D12_RECT* pRects)
+{
+	Record(RenderTargetView, NumRects);
+	Write(ColorRGBA, sizeof(FLOAT) * 4);
+	Write(pRects, sizeof(D3D12_RECT) * NumRects);
+}
+
+void STDMETHODCALLTYPE CountingCommandList::ClearUnorderedAccessViewUint(D3D12_GPU_DESCRIPTOR_HANDLE ViewGPUHandleInCurrentHeap, D3D12_CPU_DESCRIPTOR_HANDLE ViewCPUHandle, ID3D12Resource* pResource, const UINT Values[4], UINT NumRects, const D3D12_RECT* pRects)
+{
+	Record(ViewGPUHandleInCurrentHeap, ViewCPUHandle, pResource, NumRects);
+	Write(Values, sizeof(UINT) * 4);
+	Write(pRects, sizeof(D3D12_RECT) * NumRects);
+}
+
+void STDMETHODCALLTYPE CountingCommandList::ClearUnorderedAccessViewFloat(D3D12_GPU_DESCRIPTOR_HANDLE ViewGPUHandleInCurrentHeap, D3D12_CPU_DESCRIPTOR_HANDLE ViewCPUHandle, ID3D12Resource* pResource, const FLOAT Values[4], UINT NumRects, const D3D12_RECT* pRects)
+{
+	Record(ViewGPUHandleInCurrentHeap, ViewCPUHandle, pResource, NumRects);
+	Write(Values, sizeof(FLOAT) * 4);
+	Write(pRects, sizeof(D3D12_RECT) * NumRects);
+}
+
+void STDMETHODCALLTYPE CountingCommandList::DiscardResource(ID3D12Resource* pResource, const D3D12_DISCARD_REGION* pRegion)
+{
+	Record(pResource, pRegion);
+}
+
+void STDMETHODCALLTYPE CountingCommandList::BeginQuery(ID3D12QueryHeap* pQueryHeap, D3D12_QUERY_TYPE Type, UINT Index)
+{
+	Record(pQueryHeap, Type, Index);
+}
+
+void STDMETHODCALLTYPE CountingCommandList::EndQuery(ID3D12QueryHeap* pQueryHeap, D3D12_QUERY_TYPE Type, UINT Index)
+{
+	Record(pQueryHeap, Type, Index);
+}
+
+void STDMETHODCALLTYPE CountingCommandList::ResolveQueryData(ID3D12QueryHeap* pQueryHeap, D3D12_QUERY_TYPE Type, UINT StartIndex, UINT NumQueries, ID3D12Resource* pDestinationBuffer, UINT64 AlignedDestinationBufferOffset)
+{
+	Record(pQueryHeap, Type, StartIndex, NumQueries, pDestinationBuffer, AlignedDestinationBufferOffset);
+}
+
+void STDMETHODCALLTYPE CountingCommandList::SetPredication(ID3D12Resource* pBuffer, UINT64 AlignedBufferOffset, D3D12_PREDICATION_OP Operation)
+{
+	Record(pBuffer, AlignedBufferOffset, Operation);
+}
+
+void STDMETHODCALLTYPE CountingCommandList::SetMarker(UINT Metadata, const void* pData, UINT Size)
+{
+	Record(Metadata, Size);
+	Write(pData, Size);
+}
+
+void STDMETHODCALLTYPE CountingCommandList::BeginEvent(UINT Metadata, const void* pData, UINT Size)
+{
+	Record(Metadata, Size);
+	Write(pData, Size);
+}
+
+void STDMETHODCALLTYPE CountingCommandList::EndEvent()
+{
+	Record();
+}
+
+void STDMETHODCALLTYPE CountingCommandList::ExecuteIndirect(ID3D12CommandSignature* pCommandSignature, UINT MaxCommandCount, ID3D12Resource* pArgumentBuffer, UINT64 ArgumentBufferOffset, ID3D12Resource* pCountBuffer, UINT64 CountBufferOffset)
+{
+	Record(pCommandSignature, MaxCommandCount, pArgumentBuffer, ArgumentBufferOffset, pCountBuffer, CountBufferOffset);
+}
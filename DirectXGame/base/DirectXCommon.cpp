@@ -61,6 +61,9 @@ void DirectXCommon::Initialize(WinApp* winApp)
 
 void DirectXCommon::Finalize()
 {
+	// 実行中のフレームの完了待ち
+	WaitForIdle();
+
 	ImGui_ImplDX12_Shutdown();
 	ImGui_ImplWin32_Shutdown();
 	ImGui::DestroyContext();
@@ -123,40 +126,53 @@ void DirectXCommon::PostDraw()
 	ImGui::Render();
 	ID3D12DescriptorHeap* ppHeaps[] = { imguiHeap.Get() };
 	commandList->SetDescriptorHeaps(_countof(ppHeaps), ppHeaps);
-	ImGui_ImplDX12_RenderDrawData(ImGui::GetDrawData(), commandList.Get());
+	ImGui_ImplDX12_RenderDrawData(ImGui::GetDrawData(), commandList);
 
 	// リソースバリアを変更（描画対象→表示状態）
 	UINT bbIndex = swapchain->GetCurrentBackBufferIndex();
 	commandList->ResourceBarrier(1, &CD3DX12_RESOURCE_BARRIER::Transition(backBuffers[bbIndex].Get(), D3D12_RESOURCE_STATE_RENDER_TARGET, D3D12_RESOURCE_STATE_PRESENT));
 
-	// 命令のクローズ
-	commandList->Close();
+	// 命令のクローズとコマンドリストの実行(挿入したリストも含め記録順に一括で)
+	commandListPool.Execute(commandQueue.Get());
 
-	// コマンドリストの実行
-	ID3D12CommandList* cmdLists[] = { commandList.Get() }; // コマンドリストの配列
-	commandQueue->ExecuteCommandLists(1, cmdLists);
+	// バッファをフリップ
+	swapchain->Present(1, 0);
 
 	// コマンドリスト実行完了待ち前の時間
 	auto timePreCommand = std::chrono::steady_clock::now();
 
-	// コマンドリストの実行完了を待つ
-	commandQueue->Signal(fence.Get(), ++fenceVal);
-	if (fence->GetCompletedValue() != fenceVal) {
-		HANDLE event = CreateEvent(nullptr, false, false, nullptr);
-		fence->SetEventOnCompletion(fenceVal, event);
-		WaitForSingleObject(event, INFINITE);
-		CloseHandle(event);
-	}
+	// 次のフレームのコマンドアロケータをGPUが使い終わるまで待つ(このフレームの実行とは重なる)
+	framePacer.NextFrame();
 
 	// コマンドリスト実行完了待ち後の時間
 	auto timePostCommand = std::chrono::steady_clock::now();
 	commandWaitTime = std::chrono::duration_cast<std::chrono::microseconds>(timePostCommand - timePreCommand).count() / 1000000.0f;
 
-	commandAllocator->Reset(); // キューをクリア
-	commandList->Reset(commandAllocator.Get(), nullptr);	// 再びコマンドリストを貯める準備
+	// 再びコマンドリストを貯める準備
+	commandListPool.BeginFrame(framePacer.GetFrameIndex());
+	commandList = commandListPool.Open();
+}
 
-	// バッファをフリップ
-	swapchain->Present(1, 0);
+bool DirectXCommon::ForkCommandLists(size_t count, ID3D12GraphicsCommandList** cmdLists)
+{
+	// 挿入するリストと、その後に続くメインのリストの分が必要
+	if (count + 1 > commandListPool.GetAvailableCount()) {
+		return false;
+	}
+
+	for (size_t i = 0; i < count; i++) {
+		cmdLists[i] = commandListPool.Open();
+	}
+	commandList = commandListPool.Open();
+
+	return true;
+}
+
+void DirectXCommon::WaitForIdle()
+{
+	if (fence) {
+		framePacer.WaitForIdle();
+	}
 }
 
 void DirectXCommon::ClearRenderTarget()
@@ -297,19 +313,15 @@ bool DirectXCommon::InitializeCommand()
 {
 	HRESULT result = S_FALSE;
 
-	// コマンドアロケータを生成
-	result = device->CreateCommandAllocator(D3D12_COMMAND_LIST_TYPE_DIRECT, IID_PPV_ARGS(&commandAllocator));
-	if (FAILED(result)) {
+	// コマンドリストとフレームごとのコマンドアロケータを生成
+	if (!commandListPool.Initialize(device.Get())) {
 		assert(0);
-		return result;
+		return false;
 	}
 
-	// コマンドリストを生成
-	result = device->CreateCommandList(0, D3D12_COMMAND_LIST_TYPE_DIRECT, commandAllocator.Get(), nullptr, IID_PPV_ARGS(&commandList));
-	if (FAILED(result)) {
-		assert(0);
-		return result;
-	}
+	// 最初のフレームのコマンドリスト
+	commandListPool.BeginFrame(0);
+	commandList = commandListPool.Open();
 
 	// 標準設定でコマンドキューを生成
 	D3D12_COMMAND_QUEUE_DESC cmdQueueDesc{};
@@ -419,15 +431,50 @@ bool DirectXCommon::CreateFence()
 	HRESULT result = S_FALSE;
 
 	// フェンスの生成
-	result = device->CreateFence(fenceVal, D3D12_FENCE_FLAG_NONE, IID_PPV_ARGS(&fence));
+	result = device->CreateFence(0, D3D12_FENCE_FLAG_NONE, IID_PPV_ARGS(&fence));
 	if (FAILED(result)) {
 		assert(0);
 		return false;
 	}
 
+	// フレームペーサーの初期化
+	fenceTimeline.Initialize(commandQueue.Get(), fence.Get());
+	framePacer.Initialize(&fenceTimeline);
+
 	return true;
 }
 
+DirectXCommon::FenceTimeline::~FenceTimeline()
+{
+	if (event) {
+		CloseHandle(event);
+	}
+}
+
+void DirectXCommon::FenceTimeline::Initialize(ID3D12CommandQueue* commandQueue, ID3D12Fence* fence)
+{
+	this->commandQueue = commandQueue;
+	this->fence = fence;
+	event = CreateEvent(nullptr, false, false, nullptr);
+	assert(event);
+}
+
+void DirectXCommon::FenceTimeline::Signal(uint64_t value)
+{
+	commandQueue->Signal(fence, value);
+}
+
+uint64_t DirectXCommon::FenceTimeline::GetCompletedValue()
+{
+	return fence->GetCompletedValue();
+}
+
+void DirectXCommon::FenceTimeline::WaitForValue(uint64_t value)
+{
+	fence->SetEventOnCompletion(value, event);
+	WaitForSingleObject(event, INFINITE);
+}
+
 bool DirectXCommon::InitImgui()
 {
 	HRESULT result = S_FALSE;
@@ -10,6 +10,8 @@
 #include <chrono>
 
 #include "WinApp.h"
+#include "FramePacer.h"
+#include "CommandListPool.h"
 
 /// <summary>
 /// DirectX汎用
@@ -20,6 +22,24 @@ private: // エイリアス
 	// Microsoft::WRL::を省略
 	template <class T> using ComPtr = Microsoft::WRL::ComPtr<T>;
 
+private: // サブクラス
+	// フェンスで見たGPUの進捗(フレームペーサー用)
+	class FenceTimeline : public FramePacer::Timeline
+	{
+	public:
+		~FenceTimeline();
+		void Initialize(ID3D12CommandQueue* commandQueue, ID3D12Fence* fence);
+		void Signal(uint64_t value) override;
+		uint64_t GetCompletedValue() override;
+		void WaitForValue(uint64_t value) override;
+
+	private:
+		ID3D12CommandQueue* commandQueue = nullptr;
+		ID3D12Fence* fence = nullptr;
+		// 完了待ちのイベント
+		HANDLE event = nullptr;
+	};
+
 public: // メンバ関数
 	/// <summary>
 	/// デストラクタ
@@ -46,6 +66,11 @@ public: // メンバ関数
 	/// </summary>
 	void PostDraw();
 
+	/// <summary>
+	/// 実行中の全フレームの完了待ち(リソース解放前)
+	/// </summary>
+	void WaitForIdle();
+
 	/// <summary>
 	/// レンダーターゲットのクリア
 	/// </summary>
@@ -66,7 +91,52 @@ public: // メンバ関数
 	/// 描画コマンドリストの取得
 	/// </summary>
 	/// <returns>描画コマンドリスト</returns>
-	ID3D12GraphicsCommandList* GetCommandList() { return commandList.Get(); }
+	ID3D12GraphicsCommandList* GetCommandList() { return commandList; }
+
+	/// <summary>
+	/// 現在の位置に並列記録用のコマンドリストを挿入(メインスレッドから呼ぶ)
+	/// 挿入したリストは描画コマンドリストのここまでの内容の後、順番通りに実行される。
+	/// 描画コマンドリストは挿入したリストの後に続く新しいリストに替わる。
+	/// どのリストもレンダーターゲット、ビューポート等は未設定で始まる。
+	/// </summary>
+	/// <param name="count">挿入するリストの数</param>
+	/// <param name="cmdLists">挿入したリストの格納先(count個)</param>
+	/// <returns>成否(リストが足りなければ失敗)</returns>
+	bool ForkCommandLists(size_t count, ID3D12GraphicsCommandList** cmdLists);
+
+	/// <summary>
+	/// 挿入できるコマンドリストの数の取得(後に続くメインのリストの分を除く)
+	/// </summary>
+	/// <returns>リストの数</returns>
+	size_t GetAvailableCommandListCount() const
+	{
+		const size_t availableCount = commandListPool.GetAvailableCount();
+		return availableCount > 0 ? availableCount - 1 : 0;
+	}
+
+	/// <summary>
+	/// 前のフレームで実行したコマンドリストの数の取得
+	/// </summary>
+	/// <returns>リストの数</returns>
+	size_t GetExecutedCommandListCount() const { return commandListPool.GetExecutedCount(); }
+
+	/// <summary>
+	/// 記録中のフレームの番号の取得(0からFRAMES_IN_FLIGHT-1)
+	/// </summary>
+	/// <returns>フレームの番号</returns>
+	int GetFrameIndex() const { return framePacer.GetFrameIndex(); }
+
+	/// <summary>
+	/// 記録中のフレームの通し番号の取得
+	/// </summary>
+	/// <returns>フレームの通し番号</returns>
+	uint64_t GetFrameNumber() const { return framePacer.GetFrameNumber(); }
+
+	/// <summary>
+	/// GPUが描画を終えたフレームの数の取得(この数より小さい通し番号のフレームは完了済み)
+	/// </summary>
+	/// <returns>完了したフレームの数</returns>
+	uint64_t GetFinishedFrameCount() const { return framePacer.GetFinishedFrameCount(); }
 
 private: // メンバ変数
 	// ウィンドウズアプリケーション管理
@@ -75,8 +145,10 @@ private: // メンバ変数
 	// Direct3D関連
 	ComPtr<IDXGIFactory6> dxgiFactory;
 	ComPtr<ID3D12Device> device;
-	ComPtr<ID3D12GraphicsCommandList> commandList;
-	ComPtr<ID3D12CommandAllocator> commandAllocator;
+	// 記録中のメインのコマンドリスト(プール内)
+	ID3D12GraphicsCommandList* commandList = nullptr;
+	// フレームのコマンドリストと、フレームごとのコマンドアロケータ(GPUが使い終わるまで再利用しない)
+	CommandListPool commandListPool;
 	ComPtr<ID3D12CommandQueue> commandQueue;
 	ComPtr<IDXGISwapChain4> swapchain;
 	std::vector<ComPtr<ID3D12Resource>> backBuffers;
@@ -84,7 +156,9 @@ private: // メンバ変数
 	ComPtr<ID3D12DescriptorHeap> rtvHeaps;
 	ComPtr<ID3D12DescriptorHeap> dsvHeap;
 	ComPtr<ID3D12Fence> fence;
-	UINT64 fenceVal = 0;
+	FenceTimeline fenceTimeline;
+	// CPUをGPUのFRAMES_IN_FLIGHTフレーム先までに抑える
+	FramePacer framePacer;
 
 	ComPtr<ID3D12DescriptorHeap> imguiHeap;
 	float deltaTime = 0.0f;
@@ -0,0 +1,412 @@
+#include "DrawQueue.h"
+#include "CountingCommandList.h"
+#include "JobSystem.h"
+
+#include <Windows.h>
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <random>
+
+/// <summary>
+/// Static Member Variable Entity
+/// </summary>
+const int DrawQueue::PASS_BITS;
+const int DrawQueue::PIPELINE_BITS;
+const int DrawQueue::MATERIAL_BITS;
+const int DrawQueue::DEPTH_BITS;
+const size_t DrawQueue::MIN_PACKETS_PER_LIST;
+
+uint64_t DrawQueue::MakeKey(Pass pass, const void* pipelineState, const void* material, float depth)
+{
+	// Non-negative floats compare like their bit patterns
+	uint32_t depthBits = 0;
+	if (pass == Pass::Opaque || pass == Pass::Transparent)
+	{
+		depth = (std::max)(depth, 0.0f);
+		std::memcpy(&depthBits, &depth, sizeof(depthBits));
+		// Far packets first
+		if (pass == Pass::Transparent)
+		{
+			depthBits = ~depthBits;
+		}
+	}
+
+	const uint64_t pipelineId = GetId(pipelineState) & ((1u << PIPELINE_BITS) - 1);
+	const uint64_t materialId = GetId(material) & ((1u << MATERIAL_BITS) - 1);
+	return ((uint64_t)pass << (PIPELINE_BITS + MATERIAL_BITS + DEPTH_BITS)) |
+		(pipelineId << (MATERIAL_BITS + DEPTH_BITS)) |
+		(materialId << DEPTH_BITS) |
+		depthBits;
+}
+
+void DrawQueue::Add(const DrawPacket& packet)
+{
+	packets.push_back(packet);
+}
+
+void DrawQueue::Execute(ID3D12GraphicsCommandList* cmdList)
+{
+	statistics = Statistics();
+	statistics.packetCount = packets.size();
+
+	Sort();
+	RecordRange(cmdList, 0, entries.size(), statistics);
+
+	packets.clear();
+}
+
+void DrawQueue::ExecuteParallel(ID3D12GraphicsCommandList* const* cmdLists, size_t listCount, SetupFunction setup, const void* setupData)
+{
+	assert(listCount >= 1);
+
+	statistics = Statistics();
+	statistics.packetCount = packets.size();
+
+	Sort();
+
+	// Contiguous ranges of the sorted order, so executing the lists in order keeps the order of the packets
+	listStatistics.assign(listCount, Statistics());
+	const size_t entryCount = entries.size();
+	JobSystem::GetInstance()->ParallelFor(listCount, 1, [&](size_t begin, size_t end)
+		{
+			for (size_t list = begin; list < end; list++)
+			{
+				ID3D12GraphicsCommandList* cmdList = cmdLists[list];
+				if (setup != nullptr)
+				{
+					setup(cmdList, setupData);
+				}
+				RecordRange(cmdList, entryCount * list / listCount, entryCount * (list + 1) / listCount, listStatistics[list]);
+			}
+		});
+
+	for (const Statistics& listStatistic : listStatistics)
+	{
+		statistics.requestedStateChanges += listStatistic.requestedStateChanges;
+		statistics.recordedStateChanges += listStatistic.recordedStateChanges;
+	}
+
+	packets.clear();
+}
+
+size_t DrawQueue::GetParallelListCount(size_t threadCount, size_t maxListCount) const
+{
+	const size_t listCount = (std::min)((std::min)(threadCount, maxListCount), packets.size() / MIN_PACKETS_PER_LIST);
+	return (std::max)(listCount, (size_t)1);
+}
+
+void DrawQueue::Sort()
+{
+	entries.resize(packets.size());
+	for (size_t i = 0; i < packets.size(); i++)
+	{
+		entries[i].key = packets[i].key;
+		entries[i].index = (uint32_t)i;
+	}
+	RadixSort(entries, scratch);
+}
+
+void DrawQueue::RecordRange(ID3D12GraphicsCommandList* cmdList, size_t begin, size_t end, Statistics& rangeStatistics) const
+{
+	// State of the command list (unknown at the start)
+	ID3D12PipelineState* boundPipelineState = nullptr;
+	ID3D12RootSignature* boundRootSignature = nullptr;
+	D3D12_PRIMITIVE_TOPOLOGY boundTopology = D3D_PRIMITIVE_TOPOLOGY_UNDEFINED;
+	ID3D12DescriptorHeap* boundDescriptorHeap = nullptr;
+
+	for (size_t i = begin; i < end; i++)
+	{
+		const DrawPacket& packet = packets[entries[i].index];
+		rangeStatistics.requestedStateChanges += packet.descriptorHeap != nullptr ? 4 : 3;
+
+		if (packet.pipelineState != boundPipelineState)
+		{
+			cmdList->SetPipelineState(packet.pipelineState);
+			boundPipelineState = packet.pipelineState;
+			rangeStatistics.recordedStateChanges++;
+		}
+		// A new root signature also drops every root parameter, which the record functions set again
+		if (packet.rootSignature != boundRootSignature)
+		{
+			cmdList->SetGraphicsRootSignature(packet.rootSignature);
+			boundRootSignature = packet.rootSignature;
+			rangeStatistics.recordedStateChanges++;
+		}
+		if (packet.topology != boundTopology)
+		{
+			cmdList->IASetPrimitiveTopology(packet.topology);
+			boundTopology = packet.topology;
+			rangeStatistics.recordedStateChanges++;
+		}
+		if (packet.descriptorHeap != nullptr && packet.descriptorHeap != boundDescriptorHeap)
+		{
+			ID3D12DescriptorHeap* ppHeaps[] = { packet.descriptorHeap };
+			cmdList->SetDescriptorHeaps(_countof(ppHeaps), ppHeaps);
+			boundDescriptorHeap = packet.descriptorHeap;
+			rangeStatistics.recordedStateChanges++;
+		}
+
+		packet.record(cmdList, packet.data);
+	}
+}
+
+void DrawQueue::RadixSort(std::vector<SortEntry>& entries, std::vector<SortEntry>& scratch)
+{
+	const size_t count = entries.size();
+	if (count < 2)
+	{
+		return;
+	}
+	scratch.resize(count);
+
+	// Histograms of all eight digits in one read
+	size_t histograms[8][256] = {};
+	for (const SortEntry& entry : entries)
+	{
+		for (int digit = 0; digit < 8; digit++)
+		{
+			histograms[digit][(entry.key >> (digit * 8)) & 0xff]++;
+		}
+	}
+
+	SortEntry* source = entries.data();
+	SortEntry* destination = scratch.data();
+	for (int digit = 0; digit < 8; digit++)
+	{
+		size_t* histogram = histograms[digit];
+
+		// Every key has the same digit, the order does not change
+		if (histogram[(source[0].key >> (digit * 8)) & 0xff] == count)
+		{
+			continue;
+		}
+
+		// Start of every bucket
+		size_t offset = 0;
+		for (int bucket = 0; bucket < 256; bucket++)
+		{
+			const size_t bucketSize = histogram[bucket];
+			histogram[bucket] = offset;
+			offset += bucketSize;
+		}
+
+		for (size_t i = 0; i < count; i++)
+		{
+			destination[histogram[(source[i].key >> (digit * 8)) & 0xff]++] = source[i];
+		}
+		std::swap(source, destination);
+	}
+
+	// Odd number of passes, the result is in the work buffer
+	if (source != entries.data())
+	{
+		entries.swap(scratch);
+	}
+}
+
+uint32_t DrawQueue::GetId(const void* object)
+{
+	if (object == nullptr)
+	{
+		return 0;
+	}
+
+	auto it = ids.find(object);
+	if (it != ids.end())
+	{
+		return it->second;
+	}
+
+	const uint32_t id = (uint32_t)ids.size() + 1;
+	ids.emplace(object, id);
+	return id;
+}
+
+void DrawQueue::BenchmarkSort(size_t packetCount)
+{
+	// Number of timed sorts per method
+	const int runCount = 10;
+
+	// Keys like a frame: few passes, pipelines and materials, any depth
+	std::mt19937_64 random(12345);
+	std::vector<SortEntry> keys(packetCount);
+	for (size_t i = 0; i < packetCount; i++)
+	{
+		const uint64_t pass = random() % (uint64_t)Pass::Count;
+		const uint64_t pipeline = random() % 8;
+		const uint64_t material = random() % 64;
+		const uint64_t depth = random() & 0xffffffff;
+		keys[i].key = (pass << (PIPELINE_BITS + MATERIAL_BITS + DEPTH_BITS)) |
+			(pipeline << (MATERIAL_BITS + DEPTH_BITS)) | (material << DEPTH_BITS) | depth;
+		keys[i].index = (uint32_t)i;
+	}
+
+	std::vector<SortEntry> entries;
+	std::vector<SortEntry> scratch;
+	double radixMilliseconds = 0.0;
+	for (int run = 0; run < runCount; run++)
+	{
+		entries = keys;
+		auto start = std::chrono::steady_clock::now();
+		RadixSort(entries, scratch);
+		auto end = std::chrono::steady_clock::now();
+		radixMilliseconds += std::chrono::duration<double, std::milli>(end - start).count();
+	}
+	radixMilliseconds /= runCount;
+
+	// The radix sort is stable, so is the comparison
+	std::vector<SortEntry> reference;
+	double stableSortMilliseconds = 0.0;
+	for (int run = 0; run < runCount; run++)
+	{
+		reference = keys;
+		auto start = std::chrono::steady_clock::now();
+		std::stable_sort(reference.begin(), reference.end(),
+			[](const SortEntry& a, const SortEntry& b) { return a.key < b.key; });
+		auto end = std::chrono::steady_clock::now();
+		stableSortMilliseconds += std::chrono::duration<double, std::milli>(end - start).count();
+	}
+	stableSortMilliseconds /= runCount;
+
+	bool identical = true;
+	for (size_t i = 0; i < packetCount; i++)
+	{
+		if (entries[i].index != reference[i].index)
+		{
+			identical = false;
+			break;
+		}
+	}
+
+	char str[256];
+	sprintf_s(str, "DrawQueue: %zu packets, radix sort %.3f ms, std::stable_sort %.3f ms (x%.2f)%s\n",
+		packetCount, radixMilliseconds, stableSortMilliseconds,
+		radixMilliseconds > 0.0 ? stableSortMilliseconds / radixMilliseconds : 0.0,
+		identical ? "" : ", ORDER MISMATCH");
+	OutputDebugStringA(str);
+}
+
+void DrawQueue::BenchmarkParallelRecording(size_t packetCount)
+{
+	// Number of frames timed per thread count
+	const int frameCount = 30;
+
+	// Stand-ins for the pipelines, root signatures, heaps and meshes of a scene, never dereferenced by the lists
+	static uint8_t fakeObjects[64];
+
+	// Arguments of one draw, recorded like Object3d::RecordDraw and Model::DrawSubmeshes
+	struct FakeDraw
+	{
+		D3D12_VERTEX_BUFFER_VIEW vbView;
+		D3D12_INDEX_BUFFER_VIEW ibView;
+		D3D12_GPU_VIRTUAL_ADDRESS constBuffAddress;
+		D3D12_GPU_DESCRIPTOR_HANDLE material;
+		UINT indexCount;
+	};
+	const RecordFunction record = [](ID3D12GraphicsCommandList* cmdList, const void* data)
+	{
+		const FakeDraw* draw = (const FakeDraw*)data;
+		cmdList->SetGraphicsRootConstantBufferView(0, draw->constBuffAddress);
+		cmdList->SetGraphicsRootShaderResourceView(4, draw->constBuffAddress);
+		cmdList->SetGraphicsRoot32BitConstant(2, 0, 0);
+		cmdList->IASetVertexBuffers(0, 1, &draw->vbView);
+		cmdList->IASetIndexBuffer(&draw->ibView);
+		cmdList->SetGraphicsRootDescriptorTable(1, draw->material);
+		cmdList->DrawIndexedInstanced(draw->indexCount, 1, 0, 0, 0);
+	};
+
+	// Render target of the scene, set on every list
+	const SetupFunction setup = [](ID3D12GraphicsCommandList* cmdList, const void* data)
+	{
+		D3D12_CPU_DESCRIPTOR_HANDLE rtvH = { 1 };
+		D3D12_CPU_DESCRIPTOR_HANDLE dsvH = { 2 };
+		D3D12_VIEWPORT viewport = { 0.0f, 0.0f, 1280.0f, 720.0f, 0.0f, 1.0f };
+		D3D12_RECT scissorRect = { 0, 0, 1280, 720 };
+		cmdList->OMSetRenderTargets(1, &rtvH, false, &dsvH);
+		cmdList->RSSetViewports(1, &viewport);
+		cmdList->RSSetScissorRects(1, &scissorRect);
+	};
+
+	// Packets like a frame: few pipelines, heaps and materials, any depth
+	DrawQueue queue;
+	std::mt19937 random(12345);
+	std::vector<FakeDraw> draws(packetCount);
+	std::vector<DrawPacket> framePackets(packetCount);
+	for (size_t i = 0; i < packetCount; i++)
+	{
+		FakeDraw& draw = draws[i];
+		draw.vbView = { 0x10000 * (random() % 16), 0x10000, 32 };
+		draw.ibView = { 0x10000 * (random() % 16), 0x8000, DXGI_FORMAT_R16_UINT };
+		draw.constBuffAddress = 256 * i;
+		draw.material.ptr = 32 * (random() % 16);
+		draw.indexCount = 3 * (random() % 1000 + 1);
+
+		DrawPacket& packet = framePackets[i];
+		packet.pipelineState = (ID3D12PipelineState*)&fakeObjects[random() % 8];
+		packet.rootSignature = (ID3D12RootSignature*)&fakeObjects[8 + random() % 2];
+		packet.topology = D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST;
+		packet.descriptorHeap = (ID3D12DescriptorHeap*)&fakeObjects[16 + random() % 4];
+		packet.record = record;
+		packet.data = &draw;
+		packet.key = queue.MakeKey(Pass::Opaque, packet.pipelineState, &fakeObjects[32 + draw.material.ptr / 32],
+			(float)(random() % 10000) * 0.01f);
+	}
+
+	JobSystem* jobSystem = JobSystem::GetInstance();
+	const size_t maxThreadCount = jobSystem->GetThreadCount();
+	std::vector<CountingCommandList> lists(maxThreadCount);
+	std::vector<ID3D12GraphicsCommandList*> cmdLists(maxThreadCount);
+	for (size_t i = 0; i < maxThreadCount; i++)
+	{
+		cmdLists[i] = &lists[i];
+	}
+
+	double serialMilliseconds = 0.0;
+	for (size_t threadCount = 1; threadCount <= maxThreadCount; threadCount++)
+	{
+		jobSystem->SetThreadLimit(threadCount);
+
+		double milliseconds = 0.0;
+		for (int frame = 0; frame < frameCount; frame++)
+		{
+			for (CountingCommandList& list : lists)
+			{
+				list.Clear();
+			}
+			for (const DrawPacket& packet : framePackets)
+			{
+				queue.Add(packet);
+			}
+
+			auto start = std::chrono::steady_clock::now();
+			queue.ExecuteParallel(cmdLists.data(), threadCount, setup, nullptr);
+			auto end = std::chrono::steady_clock::now();
+			milliseconds += std::chrono::duration<double, std::milli>(end - start).count();
+		}
+		milliseconds /= frameCount;
+		if (threadCount == 1)
+		{
+			serialMilliseconds = milliseconds;
+		}
+
+		// Calls of the last frame, every packet must have been drawn exactly once
+		size_t callCount = 0;
+		size_t drawCount = 0;
+		for (size_t i = 0; i < threadCount; i++)
+		{
+			callCount += lists[i].GetCallCount();
+			drawCount += lists[i].GetDrawCount();
+		}
+
+		char str[256];
+		sprintf_s(str, "DrawQueue: %zu packets, %zu threads, %.3f ms per frame (x%.2f), %zu calls, %zu of %zu state calls%s\n",
+			packetCount, threadCount, milliseconds, milliseconds > 0.0 ? serialMilliseconds / milliseconds : 0.0,
+			callCount, queue.GetStatistics().recordedStateChanges, queue.GetStatistics().requestedStateChanges,
+			drawCount == packetCount ? "" : ", DRAW COUNT MISMATCH");
+		OutputDebugStringA(str);
+	}
+	jobSystem->SetThreadLimit(maxThreadCount);
+}
@@ -0,0 +1,177 @@
+#pragma once
+
+#include <d3d12.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+/// <summary>
+/// Draw packets of every system of a frame, sorted by a 64-bit key and recorded in one pass (or split over
+/// several command lists recorded in parallel)
+/// The key orders the packets by pass, pipeline, material and depth; the pipeline state, root signature,
+/// primitive topology and descriptor heap of a packet are only set when they differ from the previous packet.
+/// The record function of a packet sets its root parameters and draws, it must not change the filtered state.
+/// </summary>
+class DrawQueue
+{
+public: // Enumeration
+	// Passes in drawing order (highest bits of the key)
+	enum class Pass
+	{
+		Background,
+		// Sorted front to back
+		Opaque,
+		// Sorted back to front
+		Transparent,
+		// Submission order (sprites, text)
+		Foreground,
+		Count,
+	};
+
+public: // Alias
+	// Records the commands of a packet after its state is set
+	using RecordFunction = void(*)(ID3D12GraphicsCommandList* cmdList, const void* data);
+	// Sets the state every command list of ExecuteParallel starts with (render targets, viewports, scissor rects)
+	using SetupFunction = void(*)(ID3D12GraphicsCommandList* cmdList, const void* data);
+
+public: // Subclass
+	// One draw and the state it needs
+	struct DrawPacket
+	{
+		uint64_t key = 0;
+		ID3D12PipelineState* pipelineState = nullptr;
+		ID3D12RootSignature* rootSignature = nullptr;
+		D3D12_PRIMITIVE_TOPOLOGY topology = D3D_PRIMITIVE_TOPOLOGY_UNDEFINED;
+		// Shader visible heap of the descriptor tables (nullptr if the packet uses none)
+		ID3D12DescriptorHeap* descriptorHeap = nullptr;
+		RecordFunction record = nullptr;
+		// Passed to record, must stay valid until Execute
+		const void* data = nullptr;
+	};
+
+	// State changes of one Execute
+	struct Statistics
+	{
+		size_t packetCount = 0;
+		// State calls every packet would make on its own (pipeline, root signature, topology, heap)
+		size_t requestedStateChanges = 0;
+		// State calls actually recorded
+		size_t recordedStateChanges = 0;
+	};
+
+public: // Constant
+	// Bits of the key fields (pass | pipeline | material | depth)
+	static const int PASS_BITS = 4;
+	static const int PIPELINE_BITS = 12;
+	static const int MATERIAL_BITS = 16;
+	static const int DEPTH_BITS = 32;
+	// Fewest packets worth a command list of their own in ExecuteParallel
+	static const size_t MIN_PACKETS_PER_LIST = 64;
+
+public:
+	/// <summary>
+	/// Sort key of a packet
+	/// </summary>
+	/// <param name="pass">Pass of the packet</param>
+	/// <param name="pipelineState">Pipeline state (numbered in order of first use)</param>
+	/// <param name="material">Anything identifying the material or mesh (nullptr for none)</param>
+	/// <param name="depth">Distance from the camera (ignored in the Background and Foreground passes)</param>
+	/// <returns>Key</returns>
+	uint64_t MakeKey(Pass pass, const void* pipelineState, const void* material, float depth);
+
+	/// <summary>
+	/// Queue a packet for Execute
+	/// </summary>
+	/// <param name="packet">Packet with its key</param>
+	void Add(const DrawPacket& packet);
+
+	/// <summary>
+	/// Sort the queued packets, record them with the redundant state calls removed and clear the queue
+	/// </summary>
+	/// <param name="cmdList">Command list</param>
+	void Execute(ID3D12GraphicsCommandList* cmdList);
+
+	/// <summary>
+	/// Sort the queued packets, split them into listCount ranges in sorted order and record every range into a
+	/// command list of its own on the JobSystem threads, then clear the queue
+	/// The lists must be executed in order; the record functions of the packets must be safe to call concurrently.
+	/// </summary>
+	/// <param name="cmdLists">Open command lists, one per range</param>
+	/// <param name="listCount">Number of command lists</param>
+	/// <param name="setup">Called first on every list (nullptr for none)</param>
+	/// <param name="setupData">Passed to setup</param>
+	void ExecuteParallel(ID3D12GraphicsCommandList* const* cmdLists, size_t listCount, SetupFunction setup, const void* setupData);
+
+	/// <summary>
+	/// Number of command lists for ExecuteParallel: one per thread, as long as every list gets MIN_PACKETS_PER_LIST packets
+	/// </summary>
+	/// <param name="threadCount">Threads recording the lists</param>
+	/// <param name="maxListCount">Command lists available</param>
+	/// <returns>Number of lists (at least 1)</returns>
+	size_t GetParallelListCount(size_t threadCount, size_t maxListCount) const;
+
+	// Packets queued so far
+	size_t GetPacketCount() const { return packets.size(); }
+
+	// State changes of the last Execute or ExecuteParallel (summed over the lists)
+	const Statistics& GetStatistics() const { return statistics; }
+
+	/// <summary>
+	/// Report the time of sorting packetCount keys with the radix sort and with std::stable_sort
+	/// </summary>
+	/// <param name="packetCount">Number of keys</param>
+	static void BenchmarkSort(size_t packetCount);
+
+	/// <summary>
+	/// Report the time of recording packetCount packets with ExecuteParallel for every thread count of the JobSystem,
+	/// one command list per thread; the lists are headless CountingCommandLists, so only the CPU side is measured
+	/// </summary>
+	/// <param name="packetCount">Number of packets</param>
+	static void BenchmarkParallelRecording(size_t packetCount);
+
+private: // Subclass
+	// Key and packet index, the unit of the sort
+	struct SortEntry
+	{
+		uint64_t key;
+		uint32_t index;
+	};
+
+private:
+	/// <summary>
+	/// Stable LSD radix sort by key, 8 bits per pass; passes where every key has the same digit are skipped
+	/// </summary>
+	/// <param name="entries">Entries to sort</param>
+	/// <param name="scratch">Work buffer, resized to the size of entries</param>
+	static void RadixSort(std::vector<SortEntry>& entries, std::vector<SortEntry>& scratch);
+
+	// Sort the queued packets into entries
+	void Sort();
+
+	/// <summary>
+	/// Record the sorted packets [begin, end) with the redundant state calls removed
+	/// </summary>
+	/// <param name="cmdList">Command list (its state is unknown at the start)</param>
+	/// <param name="begin">First entry</param>
+	/// <param name="end">Entry after the last</param>
+	/// <param name="rangeStatistics">State changes of the range, added to</param>
+	void RecordRange(ID3D12GraphicsCommandList* cmdList, size_t begin, size_t end, Statistics& rangeStatistics) const;
+
+	// Number of an object for the key (in order of first use)
+	uint32_t GetId(const void* object);
+
+private:
+	// Packets queued this frame
+	std::vector<DrawPacket> packets;
+	// Sorted order
+	std::vector<SortEntry> entries;
+	std::vector<SortEntry> scratch;
+	// Numbers of the pipelines and materials seen so far
+	std::unordered_map<const void*, uint32_t> ids;
+	// State changes of the last Execute
+	Statistics statistics;
+	// State changes of every list of the last ExecuteParallel
+	std::vector<Statistics> listStatistics;
+};
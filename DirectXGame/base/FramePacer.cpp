@@ -0,0 +1,169 @@
+#include "FramePacer.h"
+
+#include <algorithm>
+#include <cassert>
+
+/// <summary>
+/// Static Member Variable Entity
+/// </summary>
+const int FramePacer::FRAMES_IN_FLIGHT;
+const int FramePacer::MAX_FRAMES_IN_FLIGHT;
+
+void FramePacer::Initialize(Timeline* timeline, int frameCount)
+{
+	assert(timeline);
+	assert(frameCount >= 1 && frameCount <= MAX_FRAMES_IN_FLIGHT);
+
+	this->timeline = timeline;
+	this->frameCount = frameCount;
+	frameIndex = 0;
+	frameNumber = 0;
+	initialValue = timeline->GetCompletedValue();
+	lastSignalledValue = initialValue;
+	for (uint64_t& slotValue : slotValues)
+	{
+		slotValue = 0;
+	}
+}
+
+bool FramePacer::NextFrame()
+{
+	// End of the frame just submitted
+	timeline->Signal(++lastSignalledValue);
+	slotValues[frameIndex] = lastSignalledValue;
+
+	// Slot of the next frame, free once the GPU has finished the frame frameCount frames back
+	frameIndex = (frameIndex + 1) % frameCount;
+	frameNumber++;
+
+	const uint64_t slotValue = slotValues[frameIndex];
+	if (timeline->GetCompletedValue() >= slotValue)
+	{
+		return false;
+	}
+	timeline->WaitForValue(slotValue);
+	return true;
+}
+
+void FramePacer::WaitForIdle()
+{
+	if (timeline->GetCompletedValue() < lastSignalledValue)
+	{
+		timeline->WaitForValue(lastSignalledValue);
+	}
+}
+
+int FramePacer::GetPendingFrameCount() const
+{
+	const uint64_t completedValue = timeline->GetCompletedValue();
+	int pendingFrameCount = 0;
+	for (int i = 0; i < frameCount; i++)
+	{
+		if (slotValues[i] > completedValue)
+		{
+			pendingFrameCount++;
+		}
+	}
+	return pendingFrameCount;
+}
+
+namespace
+{
+	// Timeline of a GPU that only advances when told to, counting the waits of the CPU
+	class FakeTimeline : public FramePacer::Timeline
+	{
+	public:
+		explicit FakeTimeline(uint64_t completedValue) : completedValue(completedValue), signalledValue(completedValue) {}
+
+		void Signal(uint64_t value) override { signalledValue = value; }
+		uint64_t GetCompletedValue() override { return completedValue; }
+		void WaitForValue(uint64_t value) override
+		{
+			// Waiting for a value never signalled would hang a real fence
+			waitCount++;
+			lastWaitValue = value;
+			if (value <= signalledValue)
+			{
+				completedValue = (std::max)(completedValue, value);
+			}
+			else
+			{
+				invalidWaitCount++;
+			}
+		}
+
+		// Finish every submitted frame
+		void Complete() { completedValue = signalledValue; }
+
+		uint64_t completedValue;
+		uint64_t signalledValue;
+		int waitCount = 0;
+		int invalidWaitCount = 0;
+		uint64_t lastWaitValue = 0;
+	};
+}
+
+FramePacer::PacingCheck FramePacer::CheckPacing()
+{
+	// Counter value before the pacer starts, as left by earlier work on the queue
+	const uint64_t startValue = 100;
+	// Frames submitted per frame count
+	const int framesPerRun = 10;
+
+	PacingCheck result;
+	for (int frameCount = 1; frameCount <= MAX_FRAMES_IN_FLIGHT; frameCount++)
+	{
+		auto check = [&](bool condition, const char* description)
+		{
+			result.checkCount++;
+			if (!condition)
+			{
+				if (result.failureCount++ == 0)
+				{
+					result.firstFailure = description;
+					result.failedFrameCount = frameCount;
+				}
+			}
+		};
+
+		FakeTimeline timeline(startValue);
+		FramePacer pacer;
+		pacer.Initialize(&timeline, frameCount);
+		check(pacer.GetFinishedFrameCount() == 0, "no frame finished after Initialize");
+
+		// Stalled GPU: the first frameCount frames are recorded without waiting
+		for (int frame = 0; frame < frameCount - 1; frame++)
+		{
+			check(!pacer.NextFrame(), "no wait while a slot is unused");
+			check(timeline.waitCount == 0, "no timeline wait while a slot is unused");
+			check(pacer.GetPendingFrameCount() == frame + 1, "pending frames count the submitted frames");
+		}
+
+		// Every further frame reuses the slot of the frame frameCount back and waits for it
+		for (int frame = frameCount - 1; frame < framesPerRun; frame++)
+		{
+			const int waitCount = timeline.waitCount;
+			check(pacer.NextFrame(), "wait when reusing the slot of an unfinished frame");
+			check(timeline.waitCount == waitCount + 1, "one timeline wait per reused slot");
+			check(timeline.lastWaitValue == startValue + frame + 2 - frameCount, "wait for the frame that used the slot");
+			check(pacer.GetFinishedFrameCount() == (uint64_t)(frame + 2 - frameCount), "finished frames after the wait");
+			check(pacer.GetFrameIndex() == (int)(pacer.GetFrameNumber() % frameCount), "slots are used in turn");
+		}
+
+		// Idle GPU: reusing the slot of a finished frame does not wait (a single slot always holds the frame just submitted)
+		if (frameCount > 1)
+		{
+			timeline.Complete();
+			const int waitCount = timeline.waitCount;
+			check(!pacer.NextFrame(), "no wait when the slot's frame is finished");
+			check(timeline.waitCount == waitCount, "no timeline wait when the slot's frame is finished");
+		}
+
+		// WaitForIdle finishes every submitted frame
+		pacer.WaitForIdle();
+		check(pacer.GetFinishedFrameCount() == pacer.GetFrameNumber(), "WaitForIdle finishes every submitted frame");
+		check(pacer.GetPendingFrameCount() == 0, "no pending frame after WaitForIdle");
+		check(timeline.invalidWaitCount == 0, "waits only for signalled values");
+	}
+	return result;
+}
@@ -0,0 +1,99 @@
+#pragma once
+
+#include <cstdint>
+
+/// <summary>
+/// Keeps the CPU at most FRAMES_IN_FLIGHT frames ahead of the GPU
+/// Every frame owns a slot (command allocator, upload region) that is reused FRAMES_IN_FLIGHT frames later;
+/// NextFrame waits until the GPU has finished the frame that used the slot last.
+/// The GPU is reached through the Timeline interface only (a fence and its command queue in DirectXCommon),
+/// so the pacing can be driven by a fake timeline without a device.
+/// </summary>
+class FramePacer
+{
+public: // Constant
+	// Frames recorded on the CPU while the GPU still executes earlier ones
+	static const int FRAMES_IN_FLIGHT = 2;
+	// Largest number of frames Initialize accepts
+	static const int MAX_FRAMES_IN_FLIGHT = 4;
+
+public: // Subclass
+	// Monotonic counter advanced by the GPU (ID3D12Fence)
+	class Timeline
+	{
+	public:
+		virtual ~Timeline() = default;
+		// Have the counter set to value once the work submitted so far is done
+		virtual void Signal(uint64_t value) = 0;
+		// Value the counter has reached
+		virtual uint64_t GetCompletedValue() = 0;
+		// Block until the counter reaches value
+		virtual void WaitForValue(uint64_t value) = 0;
+	};
+
+	// Result of CheckPacing
+	struct PacingCheck
+	{
+		// Conditions checked over every frame count
+		int checkCount = 0;
+		int failureCount = 0;
+		// First condition that did not hold (nullptr if all did) and the frame count it failed with
+		const char* firstFailure = nullptr;
+		int failedFrameCount = 0;
+	};
+
+public:
+	/// <summary>
+	/// Initialization
+	/// </summary>
+	/// <param name="timeline">Counter of the GPU (must outlive the pacer)</param>
+	/// <param name="frameCount">Frames in flight (1 waits for every frame)</param>
+	void Initialize(Timeline* timeline, int frameCount = FRAMES_IN_FLIGHT);
+
+	/// <summary>
+	/// Signal the end of the submitted frame and move to the slot of the next one,
+	/// waiting until the GPU has finished the frame that used that slot last
+	/// </summary>
+	/// <returns>True if the CPU had to wait</returns>
+	bool NextFrame();
+
+	/// <summary>
+	/// Wait until the GPU has finished every submitted frame (before releasing resources)
+	/// </summary>
+	void WaitForIdle();
+
+	// Slot of the frame being recorded, [0, frameCount)
+	int GetFrameIndex() const { return frameIndex; }
+
+	// Number of the frame being recorded (counts the NextFrame calls)
+	uint64_t GetFrameNumber() const { return frameNumber; }
+
+	// Number of frames the GPU has finished (every frame numbered below it)
+	uint64_t GetFinishedFrameCount() const { return timeline->GetCompletedValue() - initialValue; }
+
+	// Frames in flight
+	int GetFrameCount() const { return frameCount; }
+
+	// Frames submitted to the GPU and not finished yet
+	int GetPendingFrameCount() const;
+
+	/// <summary>
+	/// Drive pacers of 1 to MAX_FRAMES_IN_FLIGHT frames with a fake timeline and check that the first frames
+	/// do not wait, that reusing the slot of an unfinished frame waits for exactly that frame, and that
+	/// WaitForIdle and GetFinishedFrameCount agree with the submitted frames (needs no GPU)
+	/// </summary>
+	/// <returns>Number of checks and the first failure</returns>
+	static PacingCheck CheckPacing();
+
+private:
+	Timeline* timeline = nullptr;
+	int frameCount = FRAMES_IN_FLIGHT;
+	int frameIndex = 0;
+	uint64_t frameNumber = 0;
+	// Counter value at Initialize (frame n signals initialValue + n + 1)
+	uint64_t initialValue = 0;
+	// Counter value signalled last
+	uint64_t lastSignalledValue = 0;
+	// Counter value at the end of the frame that used each slot last (0 if unused)
+	uint64_t slotValues[MAX_FRAMES_IN_FLIGHT] = {};
+};
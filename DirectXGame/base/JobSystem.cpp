@@ -0,0 +1,174 @@
+#include "JobSystem.h"
+
+#include <algorithm>
+
+JobSystem* JobSystem::GetInstance()
+{
+	static JobSystem instance;
+	return &instance;
+}
+
+void JobSystem::Initialize(unsigned int workerCount)
+{
+	// One core is left to the main thread
+	if (workerCount == 0)
+	{
+		const unsigned int coreCount = std::thread::hardware_concurrency();
+		workerCount = coreCount > 1 ? coreCount - 1 : 1;
+	}
+
+	stopWorkers = false;
+	queues.clear();
+	for (unsigned int i = 0; i <= workerCount; i++)
+	{
+		queues.push_back(std::make_unique<WorkQueue>());
+	}
+	activeThreadCount = workerCount + 1;
+
+	for (unsigned int i = 0; i < workerCount; i++)
+	{
+		workers.emplace_back(&JobSystem::WorkerMain, this, (size_t)i);
+	}
+}
+
+void JobSystem::Finalize()
+{
+	{
+		std::lock_guard<std::mutex> lock(wakeMutex);
+		stopWorkers = true;
+	}
+	wakeCondition.notify_all();
+
+	for (std::thread& worker : workers)
+	{
+		worker.join();
+	}
+	workers.clear();
+	queues.clear();
+}
+
+void JobSystem::ParallelFor(size_t count, size_t batchSize, const LoopBody& body)
+{
+	if (count == 0)
+	{
+		return;
+	}
+
+	batchSize = (std::max)(batchSize, (size_t)1);
+	const size_t batchCount = (count + batchSize - 1) / batchSize;
+	const size_t threadCount = activeThreadCount;
+
+	// Nothing to share
+	if (workers.empty() || threadCount <= 1 || batchCount == 1)
+	{
+		body(0, count);
+		return;
+	}
+
+	std::atomic<size_t> remaining(batchCount);
+
+	// Counted before the first batch is queued, so a worker taking it at once cannot bring the count below 0
+	{
+		std::lock_guard<std::mutex> lock(wakeMutex);
+		queuedJobs += batchCount;
+	}
+
+	// Deal the batches round robin over the queues of the active threads (the last share to the calling thread)
+	const size_t callerQueueIndex = workers.size();
+	for (size_t i = 0; i < batchCount; i++)
+	{
+		const size_t threadIndex = i % threadCount;
+		const size_t queueIndex = threadIndex == threadCount - 1 ? callerQueueIndex : threadIndex;
+
+		Job job;
+		job.body = &body;
+		job.begin = i * batchSize;
+		job.end = (std::min)(count, job.begin + batchSize);
+		job.remaining = &remaining;
+
+		WorkQueue& queue = *queues[queueIndex];
+		std::lock_guard<std::mutex> lock(queue.mutex);
+		queue.jobs.push_back(job);
+	}
+	wakeCondition.notify_all();
+
+	// Work on the loop until every batch is finished (including the batches stolen by the workers)
+	Job job;
+	while (remaining.load(std::memory_order_acquire) > 0)
+	{
+		if (TakeJob(callerQueueIndex, job))
+		{
+			RunJob(job);
+		}
+		else
+		{
+			std::this_thread::yield();
+		}
+	}
+}
+
+void JobSystem::SetThreadLimit(size_t threadCount)
+{
+	activeThreadCount = (std::min)((std::max)(threadCount, (size_t)1), GetThreadCount());
+	wakeCondition.notify_all();
+}
+
+void JobSystem::WorkerMain(size_t queueIndex)
+{
+	while (true)
+	{
+		// Workers over the thread limit leave the queues to the others
+		Job job;
+		if (queueIndex + 1 < activeThreadCount && TakeJob(queueIndex, job))
+		{
+			RunJob(job);
+			continue;
+		}
+
+		std::unique_lock<std::mutex> lock(wakeMutex);
+		wakeCondition.wait(lock, [&] { return stopWorkers || (queuedJobs > 0 && queueIndex + 1 < activeThreadCount); });
+		if (stopWorkers)
+		{
+			return;
+		}
+	}
+}
+
+bool JobSystem::TakeJob(size_t queueIndex, Job& job)
+{
+	// Newest job of the own queue
+	{
+		WorkQueue& queue = *queues[queueIndex];
+		std::lock_guard<std::mutex> lock(queue.mutex);
+		if (!queue.jobs.empty())
+		{
+			job = queue.jobs.back();
+			queue.jobs.pop_back();
+			queuedJobs--;
+			return true;
+		}
+	}
+
+	// Oldest job of another queue, starting with the next one so that thieves spread out
+	for (size_t i = 1; i < queues.size(); i++)
+	{
+		WorkQueue& queue = *queues[(queueIndex + i) % queues.size()];
+		std::lock_guard<std::mutex> lock(queue.mutex);
+		if (!queue.jobs.empty())
+		{
+			job = queue.jobs.front();
+			queue.jobs.pop_front();
+			queuedJobs--;
+			return true;
+		}
+	}
+	return false;
+}
+
+void JobSystem::RunJob(const Job& job)
+{
+	(*job.body)(job.begin, job.end);
+
+	// The loop may return as soon as this reaches 0, nothing of it is touched afterwards
+	job.remaining->fetch_sub(1, std::memory_order_release);
+}
@@ -0,0 +1,109 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/// <summary>
+/// Pool of worker threads running batches of parallel loops
+/// Every thread has its own queue, idle threads steal batches from the other queues (work stealing),
+/// the calling thread works on its own loop until it is finished.
+/// </summary>
+class JobSystem
+{
+public: // Alias
+	// Body of a parallel loop, called with [begin, end) of one batch
+	using LoopBody = std::function<void(size_t begin, size_t end)>;
+
+private: // Subclass
+	// One batch of a parallel loop
+	struct Job
+	{
+		const LoopBody* body = nullptr;
+		size_t begin = 0;
+		size_t end = 0;
+		// Batches of the loop not finished yet
+		std::atomic<size_t>* remaining = nullptr;
+	};
+
+	// Queue of one thread, the owner takes from the back and thieves from the front
+	struct WorkQueue
+	{
+		std::deque<Job> jobs;
+		std::mutex mutex;
+	};
+
+public:
+	/// <summary>
+	/// Get the singleton instance
+	/// </summary>
+	/// <returns>Instance</returns>
+	static JobSystem* GetInstance();
+
+	/// <summary>
+	/// Start the worker threads
+	/// </summary>
+	/// <param name="workerCount">Number of workers (0 for one per core besides the main thread)</param>
+	void Initialize(unsigned int workerCount = 0);
+
+	/// <summary>
+	/// Stop the worker threads
+	/// </summary>
+	void Finalize();
+
+	/// <summary>
+	/// Run a loop over [0, count) on the workers and the calling thread, returns when every batch is done
+	/// Call from the main thread only (loops do not nest)
+	/// </summary>
+	/// <param name="count">Number of iterations</param>
+	/// <param name="batchSize">Iterations per batch (the unit of stealing)</param>
+	/// <param name="body">Called with the range of every batch, concurrently</param>
+	void ParallelFor(size_t count, size_t batchSize, const LoopBody& body);
+
+	/// <summary>
+	/// Limit the threads taking part in the loops (for scaling measurements)
+	/// </summary>
+	/// <param name="threadCount">Threads including the calling thread (1 runs everything serially)</param>
+	void SetThreadLimit(size_t threadCount);
+
+	// Number of threads including the calling thread
+	size_t GetThreadCount() const { return workers.size() + 1; }
+
+private:
+	// Loop of a worker thread
+	void WorkerMain(size_t queueIndex);
+
+	// Take a job from the own queue or steal one from another queue
+	bool TakeJob(size_t queueIndex, Job& job);
+
+	// Run a job and count it as finished
+	void RunJob(const Job& job);
+
+private:
+	// Private constructor (singleton pattern)
+	JobSystem() = default;
+	// Private destructor (singleton pattern)
+	~JobSystem() = default;
+	// Copy constructor prohibited (singleton pattern)
+	JobSystem(const JobSystem& obj) = delete;
+	// Copy assignment prohibited (singleton pattern)
+	void operator=(const JobSystem& obj) = delete;
+
+	// Worker threads
+	std::vector<std::thread> workers;
+	// One queue per worker, the last one belongs to the calling thread
+	std::vector<std::unique_ptr<WorkQueue>> queues;
+	// Threads taking part in the loops (including the calling thread)
+	std::atomic<size_t> activeThreadCount{ 1 };
+	// Jobs queued but not taken yet (counted before they are queued, so it never drops below 0)
+	std::atomic<size_t> queuedJobs{ 0 };
+	// Idle workers sleep until jobs are queued
+	std::mutex wakeMutex;
+	std::condition_variable wakeCondition;
+	bool stopWorkers = false;
+};
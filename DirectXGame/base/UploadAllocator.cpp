@@ -0,0 +1,179 @@
+#include "UploadAllocator.h"
+
+#include <Windows.h>
+#include <d3dx12.h>
+#include <DirectXMath.h>
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <cstdio>
+#include <vector>
+
+/// <summary>
+/// Static Member Variable Entity
+/// </summary>
+const int UploadAllocator::FRAME_COUNT;
+const size_t UploadAllocator::CONSTANT_BUFFER_ALIGNMENT;
+
+UploadAllocator* UploadAllocator::GetInstance()
+{
+	static UploadAllocator instance;
+	return &instance;
+}
+
+void UploadAllocator::Initialize(ID3D12Device* device, size_t frameSize)
+{
+	HRESULT result;
+
+	// Every region starts on a constant buffer boundary
+	this->frameSize = (frameSize + CONSTANT_BUFFER_ALIGNMENT - 1) & ~(CONSTANT_BUFFER_ALIGNMENT - 1);
+
+	// Ring buffer of every frame (stays mapped)
+	result = device->CreateCommittedResource(
+		&CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD),
+		D3D12_HEAP_FLAG_NONE,
+		&CD3DX12_RESOURCE_DESC::Buffer((UINT64)this->frameSize * FRAME_COUNT),
+		D3D12_RESOURCE_STATE_GENERIC_READ,
+		nullptr,
+		IID_PPV_ARGS(&uploadBuffer));
+	assert(SUCCEEDED(result));
+
+	result = uploadBuffer->Map(0, nullptr, (void**)&mappedBuffer);
+	assert(SUCCEEDED(result));
+
+	frameIndex = 0;
+	offset = 0;
+	allocationCount = 0;
+}
+
+void UploadAllocator::BeginFrame()
+{
+	// Use of the frame just finished
+	statistics.allocationCount = allocationCount;
+	statistics.allocatedBytes = offset;
+
+	// Next region of the ring
+	frameIndex = (frameIndex + 1) % FRAME_COUNT;
+	frameNumber++;
+	offset = 0;
+	allocationCount = 0;
+	overflowReported = false;
+}
+
+UploadAllocator::Allocation UploadAllocator::Allocate(size_t size, size_t alignment)
+{
+	assert(mappedBuffer != nullptr);
+	assert((alignment & (alignment - 1)) == 0);
+
+	// Bump the offset past the aligned allocation
+	size_t start;
+	size_t current = offset.load(std::memory_order_relaxed);
+	do
+	{
+		start = (current + alignment - 1) & ~(alignment - 1);
+		if (start + size > frameSize)
+		{
+			if (!overflowReported.exchange(true))
+			{
+				char str[256];
+				sprintf_s(str, "UploadAllocator: frame region full (%zu bytes), allocation of %zu bytes failed\n",
+					frameSize, size);
+				OutputDebugStringA(str);
+			}
+			return Allocation();
+		}
+	} while (!offset.compare_exchange_weak(current, start + size, std::memory_order_relaxed));
+	allocationCount.fetch_add(1, std::memory_order_relaxed);
+
+	const size_t regionStart = (size_t)frameIndex * frameSize;
+	Allocation allocation;
+	allocation.cpuAddress = mappedBuffer + regionStart + start;
+	allocation.gpuAddress = uploadBuffer->GetGPUVirtualAddress() + regionStart + start;
+	return allocation;
+}
+
+void UploadAllocator::ReportStatistics() const
+{
+	char str[256];
+	sprintf_s(str, "UploadAllocator: %zu allocations, %zu of %zu bytes in the last frame\n",
+		statistics.allocationCount, statistics.allocatedBytes, frameSize);
+	OutputDebugStringA(str);
+}
+
+void UploadAllocator::Benchmark(ID3D12Device* device, int allocationCount)
+{
+	HRESULT result;
+
+	// Number of timed frames per method
+	const int frameCount = 10;
+
+	// Constant buffer of the size of the transformation of an object
+	struct ConstBufferData
+	{
+		DirectX::XMMATRIX viewproj;
+		DirectX::XMMATRIX world;
+		DirectX::XMFLOAT4 color;
+	};
+	ConstBufferData data = {};
+	data.viewproj = DirectX::XMMatrixIdentity();
+	data.world = DirectX::XMMatrixIdentity();
+
+	// Every allocation fits into one region
+	allocationCount = (std::min)(allocationCount, (int)(frameSize / CONSTANT_BUFFER_ALIGNMENT));
+
+	// One committed buffer per constant buffer, mapped and unmapped at every update
+	std::vector<ComPtr<ID3D12Resource>> buffers(allocationCount);
+	for (ComPtr<ID3D12Resource>& buffer : buffers)
+	{
+		result = device->CreateCommittedResource(
+			&CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD),
+			D3D12_HEAP_FLAG_NONE,
+			&CD3DX12_RESOURCE_DESC::Buffer((sizeof(ConstBufferData) + 0xff) & ~0xff),
+			D3D12_RESOURCE_STATE_GENERIC_READ,
+			nullptr,
+			IID_PPV_ARGS(&buffer));
+		assert(SUCCEEDED(result));
+	}
+
+	auto start = std::chrono::steady_clock::now();
+	for (int frame = 0; frame < frameCount; frame++)
+	{
+		for (ComPtr<ID3D12Resource>& buffer : buffers)
+		{
+			ConstBufferData* constMap = nullptr;
+			result = buffer->Map(0, nullptr, (void**)&constMap);
+			if (SUCCEEDED(result))
+			{
+				memcpy(constMap, &data, sizeof(data));
+				buffer->Unmap(0, nullptr);
+			}
+		}
+	}
+	auto end = std::chrono::steady_clock::now();
+	const double committedMilliseconds = std::chrono::duration<double, std::milli>(end - start).count() / frameCount;
+
+	// Offset bump and copy
+	start = std::chrono::steady_clock::now();
+	for (int frame = 0; frame < frameCount; frame++)
+	{
+		BeginFrame();
+		for (int i = 0; i < allocationCount; i++)
+		{
+			Upload(data);
+		}
+	}
+	end = std::chrono::steady_clock::now();
+	const double allocatorMilliseconds = std::chrono::duration<double, std::milli>(end - start).count() / frameCount;
+
+	char str[256];
+	sprintf_s(str, "UploadAllocator: %d constant buffers, Map/Unmap %.3f ms, allocator %.3f ms (x%.1f, %.1f M allocations/s)\n",
+		allocationCount, committedMilliseconds, allocatorMilliseconds,
+		allocatorMilliseconds > 0.0 ? committedMilliseconds / allocatorMilliseconds : 0.0,
+		allocatorMilliseconds > 0.0 ? allocationCount / allocatorMilliseconds / 1000.0 : 0.0);
+	OutputDebugStringA(str);
+	ReportStatistics();
+
+	// Nothing of the benchmark is left for the first frame
+	BeginFrame();
+	statistics = Statistics();
+}
@@ -0,0 +1,133 @@
+#pragma once
+
+#include "FramePacer.h"
+
+#include <d3d12.h>
+#include <wrl.h>
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+/// <summary>
+/// Linear allocator of per-frame upload memory (constant buffers, instance data)
+/// One persistently mapped upload buffer is split into FRAME_COUNT regions used in turn (ring); an allocation is
+/// an atomic offset bump in the region of the current frame and stays valid until the region comes round again.
+/// Data must therefore be written again every frame it is drawn.
+/// </summary>
+class UploadAllocator
+{
+private: // Alias
+	// using Microsoft::WRL
+	template <class T> using ComPtr = Microsoft::WRL::ComPtr<T>;
+
+public: // Constant
+	// Regions of the ring buffer (frames the GPU may read at once)
+	static const int FRAME_COUNT = FramePacer::FRAMES_IN_FLIGHT;
+	// Alignment of constant buffer views
+	static const size_t CONSTANT_BUFFER_ALIGNMENT = D3D12_CONSTANT_BUFFER_DATA_PLACEMENT_ALIGNMENT;
+
+public: // Subclass
+	// Memory handed out by Allocate
+	struct Allocation
+	{
+		// Write-combined memory, write only
+		void* cpuAddress = nullptr;
+		D3D12_GPU_VIRTUAL_ADDRESS gpuAddress = 0;
+	};
+
+	// Use of one frame
+	struct Statistics
+	{
+		size_t allocationCount = 0;
+		size_t allocatedBytes = 0;
+	};
+
+public:
+	/// <summary>
+	/// Get the singleton instance
+	/// </summary>
+	/// <returns>Instance</returns>
+	static UploadAllocator* GetInstance();
+
+	/// <summary>
+	/// Create the upload buffer
+	/// </summary>
+	/// <param name="device">D3D12Device</param>
+	/// <param name="frameSize">Bytes per frame</param>
+	void Initialize(ID3D12Device* device, size_t frameSize = 8 * 1024 * 1024);
+
+	/// <summary>
+	/// Move to the region of the next frame (call once per frame before any allocation)
+	/// The region must no longer be read by the GPU, as after DirectXCommon::PostDraw.
+	/// </summary>
+	void BeginFrame();
+
+	/// <summary>
+	/// Allocate memory in the region of the current frame (thread safe)
+	/// </summary>
+	/// <param name="size">Bytes</param>
+	/// <param name="alignment">Power of two the GPU address is aligned to</param>
+	/// <returns>Allocation (empty if the region is full)</returns>
+	Allocation Allocate(size_t size, size_t alignment = CONSTANT_BUFFER_ALIGNMENT);
+
+	/// <summary>
+	/// Allocate a constant buffer and copy data into it
+	/// </summary>
+	/// <param name="data">Constant buffer data</param>
+	/// <returns>GPU address of the copy (0 if the region is full)</returns>
+	template <class T>
+	D3D12_GPU_VIRTUAL_ADDRESS Upload(const T& data)
+	{
+		Allocation allocation = Allocate(sizeof(T));
+		if (allocation.cpuAddress == nullptr)
+		{
+			return 0;
+		}
+		memcpy(allocation.cpuAddress, &data, sizeof(T));
+		return allocation.gpuAddress;
+	}
+
+	// Number of the current frame (counts the BeginFrame calls)
+	uint64_t GetFrameNumber() const { return frameNumber; }
+
+	// Use of the last finished frame
+	const Statistics& GetStatistics() const { return statistics; }
+
+	// Write the use of the last finished frame to the output window
+	void ReportStatistics() const;
+
+	/// <summary>
+	/// Report the time of allocationCount constant buffer updates through Map/Unmap of committed buffers and
+	/// through the allocator (call before the first frame, the allocator is reset afterwards)
+	/// </summary>
+	/// <param name="device">D3D12Device</param>
+	/// <param name="allocationCount">Constant buffers updated per frame</param>
+	void Benchmark(ID3D12Device* device, int allocationCount);
+
+private:
+	// Private constructor (singleton pattern)
+	UploadAllocator() = default;
+	// Private destructor (singleton pattern)
+	~UploadAllocator() = default;
+	// Copy constructor prohibited (singleton pattern)
+	UploadAllocator(const UploadAllocator& obj) = delete;
+	// Copy assignment prohibited (singleton pattern)
+	void operator=(const UploadAllocator& obj) = delete;
+
+	// FRAME_COUNT regions of frameSize bytes
+	ComPtr<ID3D12Resource> uploadBuffer;
+	BYTE* mappedBuffer = nullptr;
+	size_t frameSize = 0;
+	// Region of the current frame
+	int frameIndex = 0;
+	uint64_t frameNumber = 0;
+	// Bytes used in the current region, and allocations made there
+	std::atomic<size_t> offset{ 0 };
+	std::atomic<size_t> allocationCount{ 0 };
+	// The region was full this frame (reported once)
+	std::atomic<bool> overflowReported{ false };
+	// Use of the last finished frame
+	Statistics statistics;
+};
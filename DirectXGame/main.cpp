@@ -5,6 +5,8 @@
 #include "LightGroup.h"
 #include "ParticleManager.h"
 #include "FbxLoader/FbxLoader.h"
+#include "JobSystem.h"
+#include "UploadAllocator.h"
 #include "2d/PostEffect.h"
 
 // Windowsアプリでのエントリーポイント(main関数)
@@ -58,11 +60,17 @@ int WINAPI WinMain(HINSTANCE,HINSTANCE,LPSTR,int)
 	ParticleManager::GetInstance()->Initialize(dxCommon->GetDevice());
 	// FBX
 	FbxLoader::GetInstance()->Initialize(dxCommon->GetDevice());
+	// Worker threads of the parallel updates
+	JobSystem::GetInstance()->Initialize();
+	// Per-frame upload memory of the constant buffers
+	UploadAllocator::GetInstance()->Initialize(dxCommon->GetDevice());
 #pragma endregion
 
 	// ゲームシーンの初期化
 	gameScene = new GameScene();
 	gameScene->Initialize(dxCommon, input, audio);
+	// Command lists recorded in parallel draw into the render texture of the post effect
+	gameScene->SetRenderTarget(PostEffect::RecordRenderTargets, postEffect);
 	
 	// メインループ
 	while (true)
@@ -70,6 +78,11 @@ int WINAPI WinMain(HINSTANCE,HINSTANCE,LPSTR,int)
 		// メッセージ処理
 		if (win->ProcessMessage()) {	break; }
 
+		// Upload memory of this frame (PostDraw waited until the GPU finished the frame that used it last)
+		UploadAllocator::GetInstance()->BeginFrame();
+		// Texture mips of the loaded models (descriptors still read by frames in flight are left alone)
+		FbxLoader::GetInstance()->UpdateStreaming(dxCommon->GetFrameNumber(), dxCommon->GetFinishedFrameCount());
+
 		// 入力関連の毎フレーム処理
 		input->Update();
 		// ゲームシーンの毎フレーム処理
@@ -88,6 +101,9 @@ int WINAPI WinMain(HINSTANCE,HINSTANCE,LPSTR,int)
 		// 描画終了
 		dxCommon->PostDraw();
 	}
+	// GPUが使用中のリソースを解放しないよう完了を待つ
+	dxCommon->WaitForIdle();
+
 	// 各種解放
 	safe_delete(gameScene);
 	safe_delete(audio);
@@ -96,6 +112,7 @@ int WINAPI WinMain(HINSTANCE,HINSTANCE,LPSTR,int)
 	delete postEffect;
 
 	FbxLoader::GetInstance()->Finalize();
+	JobSystem::GetInstance()->Finalize();
 
 	// ゲームウィンドウの破棄
 	win->TerminateGameWindow();
@@ -1,8 +1,14 @@
 ﻿#include "GameScene.h"
 #include "Object3d.h"
 #include "FbxLoader/FbxLoader.h"
+#include "CpuSkinning.h"
+#include "SkinInfluenceAccumulator.h"
+#include "JobSystem.h"
+#include "MeshOptimizer.h"
 
+#include <algorithm>
 #include <cassert>
+#include <cstdio>
 #include <sstream>
 #include <iomanip>
 
@@ -16,6 +22,9 @@ GameScene::~GameScene()
 {
 	safe_delete(spriteBG);
 	safe_delete(lightGroup);
+	safe_delete(drawQueue);
+	safe_delete(instancedRenderer);
+	safe_delete(animationSystem);
 	safe_delete(object1);
 	safe_delete(model1);
 }
@@ -39,6 +48,9 @@ void GameScene::Initialize(DirectXCommon* dxCommon, Input* input, Audio * audio)
 	// Camera set
 	Object3d::SetCamera(camera);
 
+	// Start loading the FBX model on the worker threads while the rest is initialized
+	FbxLoader::ModelHandle model1Handle = FbxLoader::GetInstance()->LoadModelAsync("boneTest");
+
 	// デバッグテキスト用テクスチャ読み込み
 	if (!Sprite::LoadTexture(debugTextTexNumber, L"Resources/debugfont.png")) {
 		assert(0);
@@ -62,11 +74,56 @@ void GameScene::Initialize(DirectXCommon* dxCommon, Input* input, Audio * audio)
 	// Specify the FBX model and read the file
 	//FbxLoader::GetInstance()->LoadModelFromFile("cube");
 	//model1 = FbxLoader::GetInstance()->LoadModelFromFile("cube");
-	model1 = FbxLoader::GetInstance()->LoadModelFromFile("boneTest");
+	//model1 = FbxLoader::GetInstance()->LoadModelFromFile("boneTest");
+	model1 = FbxLoader::GetInstance()->WaitModel(model1Handle);
+	// Serial and parallel loading of every model in Resources from its source file (results in the output window)
+	//FbxLoader::GetInstance()->BenchmarkLoading();
+	// Import of every model in Resources from its source file and from its baked file (results in the output window)
+	//FbxLoader::GetInstance()->BenchmarkBakedLoading();
+	// Welding and 16/32-bit index selection of a generated 200000 vertex grid (results in the output window)
+	//Model::BenchmarkIndexFormats(200000);
+	// ACMR, ATVR and overdraw of a 256 x 128 segment bumpy sphere before and after the mesh optimisation (results in the output window)
+	//MeshOptimizer::Benchmark(256);
+	// Skinning matrices of 100 boneTest instances from the FBX evaluator and from the baked clip (results in the output window)
+	//FbxLoader::GetInstance()->BenchmarkAnimation("boneTest", 100);
+	// Load time and CPU bytes of the 1280x720 background from PNG and from DDS (results in the output window)
+	//FbxLoader::GetInstance()->BenchmarkTextureFormats("background.png");
 
 	object1 = new Object3d;
 	object1->Initialize();
 	object1->SetModel(model1);
+	// Dual quaternion skinning keeps the volume at bent joints
+	//model1->SetSkinningMode(Model::SkinningMode::DualQuaternion);
+
+	// Skinned objects are animated in parallel
+	animationSystem = new AnimationSystem;
+	animationSystem->Initialize(dxCommon->GetDevice());
+	animationSystem->Register(object1);
+	// Scaling of the parallel animation update over the cores (results in the output window)
+	//animationSystem->BenchmarkScaling(model1, 512);
+	// Speed and accuracy of the CPU skinning kernels (results in the output window)
+	//CpuSkinning::Benchmark(model1);
+	// Local to skin matrix pass of 1, 100 and 1000 skeletons of model1 (results in the output window)
+	//model1->GetSkeleton().BenchmarkPosePipeline(model1->GetAnimationClips()[0]);
+	// Difference of dual quaternion skinning from the matrices (results in the output window)
+	//CpuSkinning::CompareDualQuaternion(model1);
+	// Skin influences of 100000 vertices collected in top-K slots and in per-vertex lists (results in the output window)
+	//SkinInfluenceAccumulator<Model::MAX_BONE_INDICES>::Benchmark(100000, 8);
+
+	// Objects sharing a model are drawn instanced
+	instancedRenderer = new InstancedRenderer;
+	instancedRenderer->Initialize();
+	// Command recording time of 10000 objects one by one and instanced (results in the output window)
+	//instancedRenderer->BenchmarkSubmission(object1, 10000);
+
+	// Every draw goes through one queue sorted by pass, pipeline and material
+	drawQueue = new DrawQueue;
+	// Radix sort of 100000 draw packets against std::stable_sort (results in the output window)
+	//DrawQueue::BenchmarkSort(100000);
+	// Constant buffer updates through Map/Unmap and through the upload allocator (results in the output window)
+	//UploadAllocator::GetInstance()->Benchmark(dxCommon->GetDevice(), 1000);
+	// Recording of 20000 draw packets into one command list per thread, headless (results in the output window)
+	//DrawQueue::BenchmarkParallelRecording(20000);
 
 	// テクスチャ2番に読み込み
 	Sprite::LoadTexture(2, L"Resources/tex1.png");
@@ -80,6 +137,8 @@ void GameScene::Initialize(DirectXCommon* dxCommon, Input* input, Audio * audio)
 	camera->SetTarget({0, 2.5f, 0});
 	camera->SetDistance(8.0f);
 	object1->SetRotation({ 0, 90, 0 });
+
+	lastUpdateTime = std::chrono::steady_clock::now();
 }
 
 void GameScene::Update()
@@ -88,7 +147,27 @@ void GameScene::Update()
 	camera->Update();
 	particleMan->Update();
 
-	object1->Update();
+	// Real time since the previous frame (limited so that a stall does not jump the animation)
+	const std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+	const float deltaTime = (std::min)(std::chrono::duration<float>(now - lastUpdateTime).count(), 0.1f);
+	lastUpdateTime = now;
+
+	object1->Update(deltaTime);
+
+	// Animation of the registered objects on the worker threads
+	animationSystem->Update(deltaTime);
+
+	// State calls of the previous frame, requested by the draws and actually recorded
+	const DrawQueue::Statistics& drawStatistics = drawQueue->GetStatistics();
+	char text[64];
+	sprintf_s(text, "STATE %zu/%zu DRAWS %zu LISTS %zu", drawStatistics.recordedStateChanges,
+		drawStatistics.requestedStateChanges, drawStatistics.packetCount, dxCommon->GetExecutedCommandListCount());
+	debugText->Print(text, 0.0f, 0.0f, 1.0f);
+
+	// Constant buffers and instance data of the previous frame
+	const UploadAllocator::Statistics& uploadStatistics = UploadAllocator::GetInstance()->GetStatistics();
+	sprintf_s(text, "UPLOAD %zu ALLOCS %zu KB", uploadStatistics.allocationCount, uploadStatistics.allocatedBytes / 1024);
+	debugText->Print(text, 0.0f, (float)DebugText::fontHeight, 1.0f);
 }
 
 void GameScene::Draw()
@@ -100,7 +179,7 @@ void GameScene::Draw()
 	// 背景スプライト描画前処理
 	//Sprite::PreDraw(cmdList);
 	// 背景スプライト描画
-	//spriteBG->Draw();
+	//spriteBG->Submit(drawQueue, DrawQueue::Pass::Background);
 
 	/// <summary>
 	/// ここに背景スプライトの描画処理を追加できる
@@ -115,15 +194,14 @@ void GameScene::Draw()
 #pragma region 3D描画
 
 	// 3D Object Drawing
-	object1->Draw(cmdList);
+	instancedRenderer->Submit(object1);
+	instancedRenderer->Flush(drawQueue);
 
 	// パーティクルの描画
-	particleMan->Draw(cmdList);
+	particleMan->Submit(drawQueue);
 #pragma endregion
 
 #pragma region 前景スプライト描画
-	// 前景スプライト描画前処理
-	Sprite::PreDraw(cmdList);
 
 	/// <summary>
 	/// ここに前景スプライトの描画処理を追加できる
@@ -131,9 +209,24 @@ void GameScene::Draw()
 
 
 	// デバッグテキストの描画
-	debugText->DrawAll(cmdList);
-
-	// スプライト描画後処理
-	Sprite::PostDraw();
+	debugText->Submit(drawQueue);
 #pragma endregion
+
+	// All passes sorted by state, with the redundant state calls left out
+	// Enough packets are split over command lists recorded by the worker threads, executed after the list so far
+	const size_t listCount = drawQueue->GetParallelListCount(
+		JobSystem::GetInstance()->GetThreadCount(), dxCommon->GetAvailableCommandListCount());
+	ID3D12GraphicsCommandList* cmdLists[CommandListPool::MAX_COMMAND_LISTS];
+	if (listCount > 1 && renderTargetSetup != nullptr && dxCommon->ForkCommandLists(listCount, cmdLists)) {
+		drawQueue->ExecuteParallel(cmdLists, listCount, renderTargetSetup, renderTargetSetupData);
+	}
+	else {
+		drawQueue->Execute(cmdList);
+	}
+}
+
+void GameScene::SetRenderTarget(DrawQueue::SetupFunction setup, const void* setupData)
+{
+	renderTargetSetup = setup;
+	renderTargetSetupData = setupData;
 }
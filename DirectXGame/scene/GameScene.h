@@ -11,7 +11,12 @@
 #include "DebugCamera.h"
 #include "LightGroup.h"
 #include "Object3d.h"
+#include "AnimationSystem.h"
+#include "InstancedRenderer.h"
+#include "DrawQueue.h"
+#include "UploadAllocator.h"
 
+#include <chrono>
 #include <vector>
 
 /// <summary>
@@ -59,6 +64,13 @@ public: // メンバ関数
 	/// </summary>
 	void Draw();
 
+	/// <summary>
+	/// 描画先の設定(並列に記録するコマンドリストはそれぞれ最初にこれを記録する)
+	/// </summary>
+	/// <param name="setup">レンダーターゲット、ビューポート、シザー矩形を設定する関数</param>
+	/// <param name="setupData">setupに渡すデータ</param>
+	void SetRenderTarget(DrawQueue::SetupFunction setup, const void* setupData);
+
 private: // メンバ変数
 	DirectXCommon* dxCommon = nullptr;
 	Input* input = nullptr;
@@ -76,5 +88,21 @@ private: // メンバ変数
 
 	Model* model1 = nullptr;
 	Object3d* object1 = nullptr;
+
+	// Animates the objects on the worker threads
+	AnimationSystem* animationSystem = nullptr;
+
+	// Draws the objects sharing a model together
+	InstancedRenderer* instancedRenderer = nullptr;
+
+	// Draws of every system, sorted by state
+	DrawQueue* drawQueue = nullptr;
+
+	// Render target every command list of the parallel recording starts with (serial recording if not set)
+	DrawQueue::SetupFunction renderTargetSetup = nullptr;
+	const void* renderTargetSetupData = nullptr;
+
+	// Time of the previous update (animations advance by the real elapsed time)
+	std::chrono::steady_clock::time_point lastUpdateTime;
 };
 